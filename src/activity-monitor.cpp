@@ -0,0 +1,143 @@
+#include "activity-monitor.h"
+#include <obs-module.h>
+#include <obs-frontend-api.h>
+#include <algorithm>
+
+namespace {
+
+const double kDefaultReleaseDelaySeconds = 10.0;
+
+void on_frontend_event(enum obs_frontend_event event, void *data)
+{
+    auto *monitor = static_cast<ActivityMonitor*>(data);
+
+    switch (event) {
+        case OBS_FRONTEND_EVENT_STREAMING_STARTED:
+        case OBS_FRONTEND_EVENT_STREAMING_STOPPED:
+        case OBS_FRONTEND_EVENT_RECORDING_STARTED:
+        case OBS_FRONTEND_EVENT_RECORDING_STOPPED:
+        case OBS_FRONTEND_EVENT_FINISHED_LOADING:
+            monitor->refresh();
+            break;
+        default:
+            break;
+    }
+}
+
+} // namespace
+
+// ===== ActivityMonitor =====
+
+ActivityMonitor& ActivityMonitor::instance()
+{
+    static ActivityMonitor monitor;
+    return monitor;
+}
+
+ActivityMonitor::ActivityMonitor()
+    : streaming_(false)
+    , recording_(false)
+    , release_delay_ns_(static_cast<int64_t>(kDefaultReleaseDelaySeconds * 1e9))
+    , started_(false)
+{
+}
+
+void ActivityMonitor::start()
+{
+    if (started_) return;
+    obs_frontend_add_event_callback(on_frontend_event, this);
+    started_ = true;
+    refresh();
+}
+
+void ActivityMonitor::stop()
+{
+    if (!started_) return;
+    obs_frontend_remove_event_callback(on_frontend_event, this);
+    started_ = false;
+}
+
+void ActivityMonitor::refresh()
+{
+    const bool streaming = obs_frontend_streaming_active();
+    const bool recording = obs_frontend_recording_active();
+
+    const bool was_streaming = streaming_.exchange(streaming, std::memory_order_relaxed);
+    const bool was_recording = recording_.exchange(recording, std::memory_order_relaxed);
+    if (streaming != was_streaming || recording != was_recording) {
+        blog(LOG_INFO, "[ActivityMonitor] streaming=%s recording=%s",
+             streaming ? "true" : "false", recording ? "true" : "false");
+    }
+}
+
+void ActivityMonitor::set_release_delay(double seconds)
+{
+    release_delay_ns_.store(static_cast<int64_t>(std::max(0.0, seconds) * 1e9), std::memory_order_relaxed);
+}
+
+// ===== SourceActivity =====
+
+SourceActivity::SourceActivity()
+    : mode_(static_cast<int>(Mode::ALWAYS))
+    , showing_(false)
+    , active_(false)
+    , released_(false)
+    , detecting_(true)
+    , idle_since_ns_(0)
+{
+}
+
+bool SourceActivity::update(bool enabled, bool live, int64_t now_ns)
+{
+    bool detecting = enabled;
+    if (detecting) {
+        switch (get_mode()) {
+            case Mode::ALWAYS:       detecting = true; break;
+            case Mode::WHEN_SHOWING: detecting = showing_.load(std::memory_order_relaxed); break;
+            case Mode::WHEN_ACTIVE:  detecting = active_.load(std::memory_order_relaxed); break;
+            case Mode::WHEN_LIVE:    detecting = live; break;
+        }
+    }
+
+    if (detecting_ && !detecting) {
+        idle_since_ns_ = now_ns;
+    }
+    detecting_ = detecting;
+    return detecting;
+}
+
+bool SourceActivity::should_release(int64_t now_ns, int64_t delay_ns)
+{
+    if (detecting_ || is_released()) return false;
+    if (now_ns - idle_since_ns_ < delay_ns) return false;
+
+    released_.store(true, std::memory_order_release);
+    return true;
+}
+
+const char* SourceActivity::get_idle_reason(bool enabled, bool live) const
+{
+    if (!enabled) return "disabled";
+
+    switch (get_mode()) {
+        case Mode::WHEN_SHOWING:
+            return showing_.load(std::memory_order_relaxed) ? "" : "hidden";
+        case Mode::WHEN_ACTIVE:
+            return active_.load(std::memory_order_relaxed) ? "" : "inactive";
+        case Mode::WHEN_LIVE:
+            return live ? "" : "not streaming or recording";
+        default:
+            return "";
+    }
+}
+
+const char* SourceActivity::get_mode_name(Mode mode)
+{
+    switch (mode) {
+        case Mode::ALWAYS:       return "always";
+        case Mode::WHEN_SHOWING: return "when_showing";
+        case Mode::WHEN_ACTIVE:  return "when_active";
+        case Mode::WHEN_LIVE:    return "when_live";
+        default:                 return "unknown";
+    }
+}
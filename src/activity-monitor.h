@@ -0,0 +1,87 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+/**
+ * 配信・録画の状態の監視（プラグイン全体で1つ）
+ * フロントエンドのイベントで状態を更新し、ビデオスレッドからはロックなしで参照する
+ */
+class ActivityMonitor {
+public:
+    static ActivityMonitor& instance();
+
+    // フロントエンドのイベントコールバックの登録/解除
+    void start();
+    void stop();
+
+    bool is_streaming() const { return streaming_.load(std::memory_order_relaxed); }
+    bool is_recording() const { return recording_.load(std::memory_order_relaxed); }
+    bool is_live() const { return is_streaming() || is_recording(); }
+
+    // フロントエンドから現在の配信・録画状態を読み直す（イベントの取りこぼし対策）
+    void refresh();
+
+    // 休止してからキャプチャ用のバッファを解放するまでの猶予時間
+    void set_release_delay(double seconds);
+    int64_t get_release_delay_ns() const { return release_delay_ns_.load(std::memory_order_relaxed); }
+
+private:
+    ActivityMonitor();
+
+private:
+    std::atomic<bool> streaming_;
+    std::atomic<bool> recording_;
+    std::atomic<int64_t> release_delay_ns_;
+    bool started_;
+};
+
+/**
+ * ソースごとの検出の実行条件
+ * 表示/非表示・アクティブ/非アクティブはOBSのコールバックから、
+ * 実行するかどうかの判定と休止時間の計測はビデオティックから行う
+ */
+class SourceActivity {
+public:
+    enum class Mode {
+        ALWAYS,             // 常に検出する
+        WHEN_SHOWING,       // プレビューを含め、いずれかの画面に表示されているとき
+        WHEN_ACTIVE,        // 番組（プログラム）出力に含まれているとき
+        WHEN_LIVE           // 配信中または録画中
+    };
+
+public:
+    SourceActivity();
+
+    void set_mode(Mode mode) { mode_.store(static_cast<int>(mode), std::memory_order_relaxed); }
+    Mode get_mode() const { return static_cast<Mode>(mode_.load(std::memory_order_relaxed)); }
+
+    // OBSのコールバックから呼び出す
+    void set_showing(bool showing) { showing_.store(showing, std::memory_order_relaxed); }
+    void set_active(bool active) { active_.store(active, std::memory_order_relaxed); }
+
+    // ビデオティックから呼び出す。検出を行うかを返し、休止の開始時刻を記録する
+    bool update(bool enabled, bool live, int64_t now_ns);
+    bool is_detecting() const { return detecting_; }
+
+    // 休止が猶予時間を超えたとき一度だけtrueを返す（再開すると再び解放の対象になる）
+    bool should_release(int64_t now_ns, int64_t delay_ns);
+    // 設定の更新（UIスレッド）からも参照する
+    bool is_released() const { return released_.load(std::memory_order_acquire); }
+    void clear_released() { released_.store(false, std::memory_order_release); }
+
+    // 休止している理由（ログ用）
+    const char* get_idle_reason(bool enabled, bool live) const;
+
+    static const char* get_mode_name(Mode mode);
+
+private:
+    std::atomic<int> mode_;
+    std::atomic<bool> showing_;
+    std::atomic<bool> active_;
+    std::atomic<bool> released_;
+
+    // ビデオスレッドのみが触る
+    bool detecting_;
+    int64_t idle_since_ns_;
+};
@@ -0,0 +1,390 @@
+#include "audio-mixer.h"
+#include <obs-module.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+// 補間の入力バッファのフレーム数（historyの1フレームを含む）
+const uint32_t kInputFrames = 4096;
+
+// 入力の一時バッファに収まらない極端な変換比は制限する（速度3倍で16kHz→48kHzの逆など）
+const double kMaxStep = 64.0;
+
+// フェード命令: [63] 有効 [62] 終了後に停止 [32..61] フレーム数 [0..31] 目標ゲイン（floatのビット列）
+const uint64_t kFadeValid = 1ull << 63;
+const uint64_t kFadeStop = 1ull << 62;
+const uint64_t kFadeFramesMask = (1ull << 30) - 1;
+
+uint64_t encode_fade(float target_gain, uint32_t frames, bool stop)
+{
+    uint32_t gain_bits = 0;
+    memcpy(&gain_bits, &target_gain, sizeof(gain_bits));
+    return kFadeValid | (stop ? kFadeStop : 0) | ((static_cast<uint64_t>(frames) & kFadeFramesMask) << 32) |
+           gain_bits;
+}
+
+int64_t now_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+AudioMixer& AudioMixer::instance()
+{
+    static AudioMixer mixer;
+    return mixer;
+}
+
+AudioMixer::AudioMixer(int sample_rate)
+    : sample_rate_(std::max(1, sample_rate))
+    , next_generation_(1)
+    , voices_started_(0)
+    , voices_rejected_(0)
+    , mix_buffer_(kBlockFrames * kChannels)
+    , input_buffer_(kInputFrames * kChannels)
+    , rendered_frames_(0)
+    , active_voices_(0)
+    , peak_voices_(0)
+{
+}
+
+AudioMixer::VoiceId AudioMixer::make_id(size_t slot, uint32_t generation)
+{
+    return (static_cast<uint64_t>(generation) << 8) | static_cast<uint64_t>(slot);
+}
+
+AudioMixer::Voice* AudioMixer::find_voice(VoiceId id)
+{
+    const size_t slot = static_cast<size_t>(id & 0xff);
+    if (id == 0 || slot >= voices_.size()) return nullptr;
+    Voice& voice = voices_[slot];
+    return voice.generation.load(std::memory_order_acquire) == static_cast<uint32_t>(id >> 8) ? &voice : nullptr;
+}
+
+const AudioMixer::Voice* AudioMixer::find_voice(VoiceId id) const
+{
+    return const_cast<AudioMixer*>(this)->find_voice(id);
+}
+
+// ===== 制御側 =====
+
+AudioMixer::VoiceId AudioMixer::play(std::shared_ptr<AudioStream> stream, const VoiceParams& params)
+{
+    if (!stream || stream->get_sample_rate() <= 0) return 0;
+
+    std::lock_guard<std::mutex> lock(control_mutex_);
+    collect_locked();
+
+    for (size_t slot = 0; slot < voices_.size(); ++slot) {
+        Voice& voice = voices_[slot];
+        if (voice.state.load(std::memory_order_acquire) != VOICE_FREE) continue;
+
+        const uint32_t generation = next_generation_++;
+        if (next_generation_ == 0) next_generation_ = 1;
+
+        voice.stream = stream.get();
+        voice.params = params;
+        voice.step = std::min(kMaxStep, std::max(1.0 / kMaxStep,
+            static_cast<double>(std::max(0.01f, params.speed)) * stream->get_sample_rate() / sample_rate_));
+        voice.limit_frames = params.duration_seconds > 0.0f ?
+            std::max<uint64_t>(1, static_cast<uint64_t>(params.duration_seconds * sample_rate_)) : 0;
+        voice.volume.store(params.volume, std::memory_order_relaxed);
+        voice.fade_command.store(0, std::memory_order_relaxed);
+        voice.first_sample_ns.store(0, std::memory_order_relaxed);
+        voice.generation.store(generation, std::memory_order_relaxed);
+        streams_[slot] = std::move(stream);
+
+        // ここまでの書き込みをオーディオスレッドに公開する
+        voice.state.store(VOICE_STARTING, std::memory_order_release);
+        voices_started_.fetch_add(1, std::memory_order_relaxed);
+        return make_id(slot, generation);
+    }
+
+    voices_rejected_.fetch_add(1, std::memory_order_relaxed);
+    blog(LOG_WARNING, "[AudioMixer] No free voice (%zu voices playing)", voices_.size());
+    return 0;
+}
+
+void AudioMixer::send_fade(Voice& voice, float target_gain, float seconds, bool stop)
+{
+    const uint32_t frames = static_cast<uint32_t>(std::min<double>(
+        kFadeFramesMask, std::max(1.0, static_cast<double>(seconds) * sample_rate_)));
+    voice.fade_command.store(encode_fade(target_gain, frames, stop), std::memory_order_release);
+}
+
+void AudioMixer::stop(VoiceId id, float fade_seconds)
+{
+    std::lock_guard<std::mutex> lock(control_mutex_);
+    if (Voice* voice = find_voice(id)) {
+        send_fade(*voice, 0.0f, fade_seconds, true);
+    }
+}
+
+void AudioMixer::fade(VoiceId id, float target_gain, float seconds)
+{
+    std::lock_guard<std::mutex> lock(control_mutex_);
+    if (Voice* voice = find_voice(id)) {
+        send_fade(*voice, std::max(0.0f, target_gain), seconds, false);
+    }
+}
+
+void AudioMixer::set_volume(VoiceId id, float volume)
+{
+    std::lock_guard<std::mutex> lock(control_mutex_);
+    if (Voice* voice = find_voice(id)) {
+        voice->volume.store(std::max(0.0f, volume), std::memory_order_relaxed);
+    }
+}
+
+void AudioMixer::stop_all()
+{
+    std::lock_guard<std::mutex> lock(control_mutex_);
+    for (Voice& voice : voices_) {
+        const int state = voice.state.load(std::memory_order_acquire);
+        if (state == VOICE_STARTING || state == VOICE_PLAYING) {
+            send_fade(voice, 0.0f, kDefaultStopFade, true);
+        }
+    }
+    collect_locked();
+}
+
+bool AudioMixer::is_playing(VoiceId id) const
+{
+    const Voice* voice = find_voice(id);
+    if (!voice) return false;
+    const int state = voice->state.load(std::memory_order_acquire);
+    return state == VOICE_STARTING || state == VOICE_PLAYING;
+}
+
+int64_t AudioMixer::get_first_sample_time_ns(VoiceId id) const
+{
+    const Voice* voice = find_voice(id);
+    return voice ? voice->first_sample_ns.load(std::memory_order_acquire) : 0;
+}
+
+void AudioMixer::collect_locked()
+{
+    for (size_t slot = 0; slot < voices_.size(); ++slot) {
+        Voice& voice = voices_[slot];
+        if (voice.state.load(std::memory_order_acquire) == VOICE_FINISHED) {
+            voice.stream = nullptr;
+            streams_[slot].reset();
+            voice.state.store(VOICE_FREE, std::memory_order_release);
+        }
+    }
+}
+
+// ===== オーディオスレッド =====
+
+void AudioMixer::render(float* output, uint32_t frames)
+{
+    std::fill(output, output + static_cast<size_t>(frames) * kChannels, 0.0f);
+
+    uint32_t active = 0;
+    for (uint32_t offset = 0; offset < frames; offset += kBlockFrames) {
+        const uint32_t count = std::min(kBlockFrames, frames - offset);
+        active = 0;
+
+        for (Voice& voice : voices_) {
+            const int state = voice.state.load(std::memory_order_acquire);
+            if (state == VOICE_STARTING) {
+                start_voice(voice);
+            } else if (state != VOICE_PLAYING) {
+                continue;
+            }
+
+            if (voice.first_sample_ns.load(std::memory_order_relaxed) == 0) {
+                voice.first_sample_ns.store(now_ns(), std::memory_order_release);
+            }
+            if (mix_voice(voice, output + static_cast<size_t>(offset) * kChannels, count)) {
+                ++active;
+            } else {
+                voice.state.store(VOICE_FINISHED, std::memory_order_release);
+            }
+        }
+    }
+
+    rendered_frames_.fetch_add(frames, std::memory_order_relaxed);
+    active_voices_.store(active, std::memory_order_relaxed);
+    if (active > peak_voices_.load(std::memory_order_relaxed)) {
+        peak_voices_.store(active, std::memory_order_relaxed);
+    }
+}
+
+void AudioMixer::start_voice(Voice& voice)
+{
+    voice.resample = voice.step != 1.0;
+    voice.position = 0.0;
+    voice.output_frames = 0;
+    voice.gain = 1.0f;
+    voice.gain_target = 1.0f;
+    voice.gain_step = 0.0f;
+    voice.gain_frames = 0;
+    voice.stop_after_fade = false;
+
+    if (voice.params.fade_in_seconds > 0.0f) {
+        voice.gain = 0.0f;
+        voice.gain_frames = std::max<uint32_t>(1, static_cast<uint32_t>(voice.params.fade_in_seconds * sample_rate_));
+        voice.gain_step = 1.0f / voice.gain_frames;
+    }
+
+    // 補間は直前の入力フレームを起点にするため、先頭の1フレームを読んでおく
+    if (voice.resample && read_source(voice, voice.history, 1) == 0) {
+        voice.stop_after_fade = true;
+        voice.gain_target = 0.0f;
+    }
+    voice.state.store(VOICE_PLAYING, std::memory_order_relaxed);
+}
+
+void AudioMixer::apply_fade_command(Voice& voice)
+{
+    const uint64_t command = voice.fade_command.exchange(0, std::memory_order_acquire);
+    if (command == 0) return;
+
+    uint32_t gain_bits = static_cast<uint32_t>(command);
+    float target = 0.0f;
+    memcpy(&target, &gain_bits, sizeof(target));
+    const uint32_t frames = std::max<uint32_t>(1, static_cast<uint32_t>((command >> 32) & kFadeFramesMask));
+
+    voice.gain_target = target;
+    voice.gain_frames = frames;
+    voice.gain_step = (target - voice.gain) / frames;
+    voice.stop_after_fade = voice.stop_after_fade || (command & kFadeStop) != 0;
+}
+
+bool AudioMixer::mix_voice(Voice& voice, float* output, uint32_t frames)
+{
+    apply_fade_command(voice);
+
+    // 再生時間の上限に近づいたら停止のフェードを始める
+    const uint32_t stop_fade_frames = static_cast<uint32_t>(kDefaultStopFade * sample_rate_) + 1;
+    if (voice.limit_frames > 0 && !voice.stop_after_fade &&
+        voice.output_frames + stop_fade_frames >= voice.limit_frames) {
+        const uint32_t remaining = static_cast<uint32_t>(
+            voice.limit_frames > voice.output_frames ? voice.limit_frames - voice.output_frames : 1);
+        voice.gain_target = 0.0f;
+        voice.gain_frames = std::max<uint32_t>(1, remaining);
+        voice.gain_step = -voice.gain / voice.gain_frames;
+        voice.stop_after_fade = true;
+    }
+
+    // 停止のフェードを終えたボイスは読まずに終える
+    if (voice.stop_after_fade && voice.gain_frames == 0 && voice.gain <= 0.0f) {
+        return false;
+    }
+
+    float* source = mix_buffer_.data();
+    const uint32_t produced = render_source(voice, source, frames);
+    const float volume = voice.volume.load(std::memory_order_relaxed);
+
+    for (uint32_t i = 0; i < produced; ++i) {
+        if (voice.gain_frames > 0) {
+            voice.gain += voice.gain_step;
+            if (--voice.gain_frames == 0) voice.gain = voice.gain_target;
+        }
+        const float gain = voice.gain * volume;
+        output[i * kChannels] += source[i * kChannels] * gain;
+        output[i * kChannels + 1] += source[i * kChannels + 1] * gain;
+    }
+    voice.output_frames += produced;
+
+    if (produced < frames) return false;                                // 終端
+    if (voice.stop_after_fade && voice.gain_frames == 0) return false;  // フェードアウトを終えた
+    return true;
+}
+
+uint32_t AudioMixer::read_source(Voice& voice, float* stereo, uint32_t frames)
+{
+    uint32_t total = 0;
+    bool rewound = false;
+    while (total < frames) {
+        const uint32_t count = voice.stream->read(stereo + static_cast<size_t>(total) * kChannels, frames - total);
+        total += count;
+        if (total >= frames || !voice.params.looping) break;
+
+        // 空のストリームで回り続けないよう、巻き戻した直後に読めなければ終える
+        if (count == 0 && rewound) break;
+        voice.stream->rewind();
+        rewound = true;
+    }
+    return total;
+}
+
+uint32_t AudioMixer::render_source(Voice& voice, float* stereo, uint32_t frames)
+{
+    if (!voice.resample) {
+        // 変換比1: 入力をそのまま使う
+        return read_source(voice, stereo, frames);
+    }
+
+    float* input = input_buffer_.data();
+    const double step = voice.step;
+    uint32_t produced = 0;
+
+    while (produced < frames) {
+        // 入力バッファに収まる出力フレーム数
+        const uint32_t max_count = std::max<uint32_t>(1, static_cast<uint32_t>((kInputFrames - 2) / step));
+        const uint32_t count = std::min(frames - produced, max_count);
+
+        // input[0]はhistory。補間に使う最後のフレームと、次のhistoryになるフレームまで読む
+        const double end = voice.position + step * count;
+        const uint32_t last_used = static_cast<uint32_t>(voice.position + step * (count - 1)) + 1;
+        const uint32_t needed = std::min(kInputFrames - 1, std::max(last_used, static_cast<uint32_t>(end)));
+
+        input[0] = voice.history[0];
+        input[1] = voice.history[1];
+        const uint32_t available = read_source(voice, input + kChannels, needed) + 1;
+
+        double position = voice.position;
+        uint32_t written = 0;
+        for (; written < count; ++written) {
+            const uint32_t index = static_cast<uint32_t>(position);
+            if (index + 1 >= available) break;
+            const float t = static_cast<float>(position - index);
+            const float* a = input + static_cast<size_t>(index) * kChannels;
+            const float* b = a + kChannels;
+            float* out = stereo + static_cast<size_t>(produced + written) * kChannels;
+            out[0] = a[0] + (b[0] - a[0]) * t;
+            out[1] = a[1] + (b[1] - a[1]) * t;
+            position += step;
+        }
+        produced += written;
+
+        if (written < count) {
+            return produced;                            // 終端
+        }
+
+        const uint32_t next = std::min(static_cast<uint32_t>(end), available - 1);
+        voice.history[0] = input[static_cast<size_t>(next) * kChannels];
+        voice.history[1] = input[static_cast<size_t>(next) * kChannels + 1];
+        voice.position = end - next;
+    }
+    return produced;
+}
+
+// ===== 統計 =====
+
+AudioMixer::Stats AudioMixer::get_stats() const
+{
+    Stats stats;
+    stats.voices_started = voices_started_.load(std::memory_order_relaxed);
+    stats.voices_rejected = voices_rejected_.load(std::memory_order_relaxed);
+    stats.rendered_frames = rendered_frames_.load(std::memory_order_relaxed);
+    stats.active_voices = active_voices_.load(std::memory_order_relaxed);
+    stats.peak_voices = peak_voices_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void AudioMixer::log_summary() const
+{
+    const Stats stats = get_stats();
+    blog(LOG_INFO, "[AudioMixer] rate=%d started=%llu rejected=%llu active=%u peak=%u rendered=%.1fs",
+         sample_rate_, static_cast<unsigned long long>(stats.voices_started),
+         static_cast<unsigned long long>(stats.voices_rejected), stats.active_voices, stats.peak_voices,
+         static_cast<double>(stats.rendered_frames) / sample_rate_);
+}
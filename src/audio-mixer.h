@@ -0,0 +1,153 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/**
+ * ボイスが順に読み出す音声データ
+ * readとrewindはオーディオスレッドから呼ばれるため、メモリの確保・ロック・ブロックするI/Oをしてはならない
+ */
+class AudioStream {
+public:
+    virtual ~AudioStream() = default;
+
+    virtual int get_sample_rate() const = 0;
+
+    // ステレオのfloat（インターリーブ）で最大frames分を書き、書いたフレーム数を返す（終端では少なくなる）
+    virtual uint32_t read(float* stereo, uint32_t frames) = 0;
+
+    // 先頭に戻る（ループ再生）
+    virtual void rewind() = 0;
+};
+
+/**
+ * プラグイン全体のオーディオミキサー
+ * 固定数のボイスを出力のサンプルレートに合わせて（再生速度を含めて線形補間で）変換し、ステレオのfloatに
+ * 足し合わせる。renderはオーディオデバイスのコールバックから呼ばれ、メモリの確保もロックもしない
+ *
+ * - 制御側（play/stopなど）はどのスレッドから呼んでもよい（制御側どうしはミューテックスで排他する）
+ * - 制御側とオーディオスレッドの受け渡しはボイスごとのアトミック変数だけで行う
+ * - 再生が終わったボイスのAudioStreamは制御側で解放する（オーディオスレッドでは解放しない）
+ */
+class AudioMixer {
+public:
+    using VoiceId = uint64_t;                           // 0は無効
+
+    static constexpr int kChannels = 2;
+    static constexpr size_t kMaxVoices = 32;
+    static constexpr uint32_t kBlockFrames = 256;       // renderの内部処理単位
+    static constexpr float kDefaultStopFade = 0.005f;   // 停止時のクリック防止のフェード（秒）
+
+    struct VoiceParams {
+        float volume = 1.0f;
+        float speed = 1.0f;                             // 再生速度（ピッチも変わる）
+        bool looping = false;
+        float duration_seconds = -1.0f;                 // 出力する時間の上限（負で制限なし）
+        float fade_in_seconds = 0.0f;
+    };
+
+    struct Stats {
+        uint64_t voices_started;
+        uint64_t voices_rejected;                       // 空きボイスがなかった
+        uint64_t rendered_frames;
+        uint32_t active_voices;
+        uint32_t peak_voices;
+    };
+
+public:
+    static AudioMixer& instance();
+
+    // テスト・ベンチマーク用（通常はinstance()を使う）
+    explicit AudioMixer(int sample_rate = 48000);
+
+    AudioMixer(const AudioMixer&) = delete;
+    AudioMixer& operator=(const AudioMixer&) = delete;
+
+    int get_sample_rate() const { return sample_rate_; }
+
+    // 制御側: 空きボイスがなければ0
+    VoiceId play(std::shared_ptr<AudioStream> stream, const VoiceParams& params);
+    void stop(VoiceId id, float fade_seconds = kDefaultStopFade);
+    void fade(VoiceId id, float target_gain, float seconds);
+    void set_volume(VoiceId id, float volume);
+    void stop_all();
+
+    bool is_playing(VoiceId id) const;
+
+    // ボイスの最初のサンプルをミックスした時刻（steady_clockのns、未出力なら0）
+    int64_t get_first_sample_time_ns(VoiceId id) const;
+
+    // オーディオスレッド: framesフレーム分のステレオfloat（インターリーブ）を書く
+    void render(float* output, uint32_t frames);
+
+    Stats get_stats() const;
+    void log_summary() const;
+
+private:
+    enum VoiceState : int {
+        VOICE_FREE,                                     // 制御側が使える
+        VOICE_STARTING,                                 // 制御側が設定した（オーディオスレッドが開始する）
+        VOICE_PLAYING,
+        VOICE_FINISHED                                  // オーディオスレッドが終えた（制御側が解放する）
+    };
+
+    struct Voice {
+        std::atomic<int> state{VOICE_FREE};
+        std::atomic<uint32_t> generation{0};
+        std::atomic<float> volume{1.0f};
+        std::atomic<uint64_t> fade_command{0};          // 0で命令なし（encode_fadeを参照）
+        std::atomic<int64_t> first_sample_ns{0};
+
+        // VOICE_STARTINGにする前に制御側が書き、以降はオーディオスレッドだけが読む
+        AudioStream* stream = nullptr;
+        VoiceParams params;
+        double step = 1.0;                              // 出力1フレームあたりの入力フレーム数
+        uint64_t limit_frames = 0;                      // 0で制限なし
+
+        // オーディオスレッドのみが触る
+        bool resample = false;
+        double position = 0.0;                          // history（入力の直前のフレーム）からの位置
+        float history[kChannels] = {};
+        uint64_t output_frames = 0;
+        float gain = 1.0f;
+        float gain_target = 1.0f;
+        float gain_step = 0.0f;
+        uint32_t gain_frames = 0;                       // 目標に達するまでの残りフレーム数
+        bool stop_after_fade = false;
+    };
+
+    static VoiceId make_id(size_t slot, uint32_t generation);
+    Voice* find_voice(VoiceId id);
+    const Voice* find_voice(VoiceId id) const;
+    void collect_locked();
+    void send_fade(Voice& voice, float target_gain, float seconds, bool stop);
+
+    // オーディオスレッド
+    void start_voice(Voice& voice);
+    bool mix_voice(Voice& voice, float* output, uint32_t frames);
+    uint32_t read_source(Voice& voice, float* stereo, uint32_t frames);
+    uint32_t render_source(Voice& voice, float* stereo, uint32_t frames);
+    void apply_fade_command(Voice& voice);
+
+private:
+    const int sample_rate_;
+    std::array<Voice, kMaxVoices> voices_;
+
+    // 制御側
+    mutable std::mutex control_mutex_;
+    std::array<std::shared_ptr<AudioStream>, kMaxVoices> streams_;
+    uint32_t next_generation_;
+    std::atomic<uint64_t> voices_started_;
+    std::atomic<uint64_t> voices_rejected_;
+
+    // オーディオスレッド（コンストラクタで確保する作業バッファ）
+    std::vector<float> mix_buffer_;                     // ボイス1つ分の変換後のフレーム
+    std::vector<float> input_buffer_;                   // 補間の入力（historyを含む）
+    std::atomic<uint64_t> rendered_frames_;
+    std::atomic<uint32_t> active_voices_;
+    std::atomic<uint32_t> peak_voices_;
+};
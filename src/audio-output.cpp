@@ -0,0 +1,101 @@
+#include "audio-output.h"
+#include "audio-mixer.h"
+#include <obs-module.h>
+
+#if GAT_HAVE_MINIAUDIO
+#define MINIAUDIO_IMPLEMENTATION
+#include "miniaudio.h"
+
+namespace {
+
+void data_callback(ma_device* device, void* output, const void* input, ma_uint32 frame_count)
+{
+    (void)input;
+    static_cast<AudioMixer*>(device->pUserData)->render(static_cast<float*>(output), frame_count);
+}
+
+} // namespace
+
+struct AudioOutput::Device {
+    ma_device device;
+};
+#else
+struct AudioOutput::Device {
+};
+#endif
+
+AudioOutput& AudioOutput::instance()
+{
+    static AudioOutput output;
+    return output;
+}
+
+AudioOutput::AudioOutput()
+{
+    // コールバックが参照するミキサーを先に作り、こちらより後に破棄されるようにする
+    AudioMixer::instance();
+}
+
+AudioOutput::~AudioOutput()
+{
+    stop();
+}
+
+bool AudioOutput::start()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (device_) return true;
+
+#if !GAT_HAVE_MINIAUDIO
+    static bool warned = false;
+    if (!warned) {
+        blog(LOG_WARNING, "[AudioOutput] Built without miniaudio; using PlaySound for playback");
+        warned = true;
+    }
+    return false;
+#else
+    AudioMixer& mixer = AudioMixer::instance();
+    ma_device_config config = ma_device_config_init(ma_device_type_playback);
+    config.playback.format = ma_format_f32;
+    config.playback.channels = AudioMixer::kChannels;
+    config.sampleRate = static_cast<ma_uint32>(mixer.get_sample_rate());
+    config.performanceProfile = ma_performance_profile_low_latency;
+    config.dataCallback = data_callback;
+    config.pUserData = &mixer;
+
+    auto device = std::make_unique<Device>();
+    if (ma_device_init(nullptr, &config, &device->device) != MA_SUCCESS) {
+        blog(LOG_ERROR, "[AudioOutput] Failed to open the playback device");
+        return false;
+    }
+    if (ma_device_start(&device->device) != MA_SUCCESS) {
+        blog(LOG_ERROR, "[AudioOutput] Failed to start the playback device");
+        ma_device_uninit(&device->device);
+        return false;
+    }
+
+    blog(LOG_INFO, "[AudioOutput] Playback device started (%d Hz, %d channels)", mixer.get_sample_rate(),
+         AudioMixer::kChannels);
+    device_ = std::move(device);
+    return true;
+#endif
+}
+
+void AudioOutput::stop()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!device_) return;
+
+#if GAT_HAVE_MINIAUDIO
+    // ma_device_uninitはコールバックの終了を待つ
+    ma_device_uninit(&device_->device);
+#endif
+    device_.reset();
+    blog(LOG_INFO, "[AudioOutput] Playback device stopped");
+}
+
+bool AudioOutput::is_started() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return device_ != nullptr;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+
+// 実際のminiaudio.hでビルドしたか（CMakeが判定する。0ではデバイスを開かず、再生はPlaySoundだけになる）
+#ifndef GAT_HAVE_MINIAUDIO
+#define GAT_HAVE_MINIAUDIO 0
+#endif
+
+/**
+ * AudioMixerの出力先のオーディオデバイス（プラグイン全体で1つ）
+ * 既定の再生デバイスをステレオのfloat・ミキサーのサンプルレートで開き、デバイスのコールバックから
+ * AudioMixer::renderを呼ぶ（デバイスの形式が異なる場合の変換はminiaudioが行う）
+ */
+class AudioOutput {
+public:
+    static AudioOutput& instance();
+
+    // 開いていなければ開いて開始する（失敗した場合はfalse。次の呼び出しで再試行する）
+    bool start();
+
+    // プラグインのアンロード時
+    void stop();
+
+    bool is_started() const;
+
+private:
+    AudioOutput();
+    ~AudioOutput();
+
+    struct Device;
+
+private:
+    mutable std::mutex mutex_;
+    std::unique_ptr<Device> device_;
+};
@@ -1,20 +1,36 @@
 #include "audio-player.h"
+#include "audio-output.h"
+#include "profiler.h"
 #include <obs-module.h>
 #include <algorithm>
 #include <filesystem>
 
-// 簡易版AudioPlayer - Windows PlaySoundを使用
+// AudioPlayer - PCM WAVとMP3/OGGはAudioMixer、それ以外のWAVはWindows PlaySoundを使用
 
 const std::vector<std::string> AudioPlayer::supported_extensions_ = {
-    ".wav"  // 簡易版ではWAVのみサポート
+    ".wav", ".mp3", ".ogg"
 };
 
+namespace {
+
+int64_t now_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
 AudioPlayer::AudioPlayer()
     : is_playing_(false)
     , current_state_(PlaybackState::STOPPED)
+    , first_sample_time_ns_(0)
+    , voice_(0)
+    , using_play_sound_(false)
     , volume_(1.0f)
     , speed_(1.0f)
     , pitch_(1.0f)
+    , fade_in_seconds_(0.0f)
     , looping_(false)
 {
     audio_info_ = {};
@@ -22,7 +38,8 @@ AudioPlayer::AudioPlayer()
 
 AudioPlayer::~AudioPlayer()
 {
-    stop();
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_locked();
 }
 
 bool AudioPlayer::load_audio_file(const std::string& file_path)
@@ -42,34 +59,122 @@ bool AudioPlayer::load_audio_file(const std::string& file_path)
         return false;
     }
 
+    // PCM WAVはヘッダーを解析してマップしておく（再生時にファイルを開き直さない）。
+    // それ以外は先頭だけデコードしておき、続きは再生中にデコードする。
+    // ファイルを開くのはロックの外で行い、検出スレッドからの再生を待たせない
+    const std::string format = get_file_extension(file_path);
+    std::string error;
+    std::shared_ptr<const WavClip> clip;
+    std::shared_ptr<const StreamedClip> streamed_clip;
+    if (format == ".wav") {
+        clip = WavClip::open(file_path, error);
+    }
+    if (!clip) {
+        std::string stream_error;
+        streamed_clip = StreamedClip::open(file_path, stream_error);
+        if (!streamed_clip) {
+            error = error.empty() ? stream_error : error + ", " + stream_error;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_locked();
     current_file_ = file_path;
     audio_info_.file_path = file_path;
-    audio_info_.format = get_file_extension(file_path);
-    audio_info_.duration_seconds = 0.0f;  // 簡易版では取得しない
+    audio_info_.format = format;
+    audio_info_.duration_seconds = 0.0f;  // PlaySound・ストリーミングでは取得しない
     audio_info_.sample_rate = 44100;      // デフォルト値
     audio_info_.channels = 2;             // デフォルト値
+    clip_ = std::move(clip);
+    streamed_clip_ = std::move(streamed_clip);
+
+    if (clip_) {
+        audio_info_.duration_seconds = clip_->get_duration();
+        audio_info_.sample_rate = clip_->get_sample_rate();
+        audio_info_.channels = clip_->get_channels();
 
-    blog(LOG_INFO, "[AudioPlayer] Successfully loaded: %s", file_path.c_str());
+        // デバイスは最初に読み込んだときに開く（トリガー時に待たないように）
+        AudioOutput::instance().start();
+        blog(LOG_INFO, "[AudioPlayer] Successfully loaded: %s (%s, %d Hz, %d ch, %.2fs, mapped)", file_path.c_str(),
+             WavClip::get_sample_format_name(clip_->get_sample_format()), clip_->get_sample_rate(),
+             clip_->get_channels(), clip_->get_duration());
+    } else if (streamed_clip_) {
+        audio_info_.sample_rate = streamed_clip_->get_sample_rate();
+
+        AudioOutput::instance().start();
+        blog(LOG_INFO, "[AudioPlayer] Successfully loaded: %s (%d Hz, streamed, %zu bytes prefetched)",
+             file_path.c_str(), streamed_clip_->get_sample_rate(), streamed_clip_->get_prefetch_bytes());
+    } else {
+        blog(LOG_INFO, "[AudioPlayer] Successfully loaded: %s (PlaySound: %s)", file_path.c_str(), error.c_str());
+    }
     return true;
 }
 
+bool AudioPlayer::is_file_loaded() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return !current_file_.empty();
+}
+
+AudioPlayer::AudioInfo AudioPlayer::get_audio_info() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return audio_info_;
+}
+
+size_t AudioPlayer::get_memory_usage() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (clip_) {
+        return clip_->get_mapped_bytes();
+    }
+    if (streamed_clip_) {
+        return streamed_clip_->get_prefetch_bytes() + streamed_clip_->get_ring_bytes();
+    }
+    return 0;
+}
+
+float AudioPlayer::get_duration() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return audio_info_.duration_seconds;
+}
+
 bool AudioPlayer::play()
 {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return play_impl(-1.0f);
+}
+
+bool AudioPlayer::play_with_duration(float duration_seconds)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return play_impl(duration_seconds);
+}
+
+bool AudioPlayer::play_impl(float duration_seconds)
+{
+    PROFILE_ZONE("AudioPlayer::play");
     if (current_file_.empty()) {
         blog(LOG_WARNING, "[AudioPlayer] No audio file loaded");
         return false;
     }
 
-    // Windows PlaySound APIを使用（簡易実装）
-    std::wstring wide_path(current_file_.begin(), current_file_.end());
-    
-    DWORD flags = SND_FILENAME | SND_ASYNC;
-    if (looping_) {
-        flags |= SND_LOOP;
+    // 前の再生を止める（PlaySoundと同じく、再生中に再びトリガーした場合は最初から鳴らし直す）
+    if (voice_) {
+        AudioMixer::instance().stop(voice_);
+        voice_ = 0;
+    }
+    first_sample_time_ns_.store(0, std::memory_order_release);
+
+    bool result = false;
+    if ((clip_ || streamed_clip_) && AudioOutput::instance().start()) {
+        result = play_with_mixer(duration_seconds);
+    }
+    if (!result) {
+        result = play_with_play_sound();
     }
 
-    BOOL result = PlaySoundW(wide_path.c_str(), NULL, flags);
-    
     if (result) {
         is_playing_ = true;
         current_state_ = PlaybackState::PLAYING;
@@ -82,16 +187,160 @@ bool AudioPlayer::play()
     }
 }
 
+bool AudioPlayer::play_with_mixer(float duration_seconds)
+{
+    AudioMixer::VoiceParams params;
+    params.volume = volume_;
+    params.speed = speed_;
+    params.looping = looping_;
+    params.duration_seconds = duration_seconds;
+    params.fade_in_seconds = fade_in_seconds_;
+
+    voice_ = AudioMixer::instance().play(clip_ ? clip_->create_stream() : streamed_clip_->create_stream(looping_),
+                                         params);
+    return voice_ != 0;
+}
+
+bool AudioPlayer::play_with_play_sound()
+{
+    // PlaySoundが再生できるのはWAVだけ
+    if (audio_info_.format != ".wav") {
+        return false;
+    }
+
+    std::wstring wide_path(current_file_.begin(), current_file_.end());
+    
+    DWORD flags = SND_FILENAME | SND_ASYNC;
+    if (looping_) {
+        flags |= SND_LOOP;
+    }
+
+    if (!PlaySoundW(wide_path.c_str(), NULL, flags)) {
+        return false;
+    }
+
+    // PlaySoundは出力開始を通知しないため、非同期再生の受付完了時刻で近似する
+    first_sample_time_ns_.store(now_ns(), std::memory_order_release);
+    using_play_sound_ = true;
+    return true;
+}
+
 bool AudioPlayer::stop()
 {
-    // PlaySoundを停止
-    PlaySoundW(NULL, NULL, SND_PURGE);
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_locked();
+    return true;
+}
+
+void AudioPlayer::stop_locked()
+{
+    if (voice_) {
+        AudioMixer::instance().stop(voice_);
+        voice_ = 0;
+    }
+    if (using_play_sound_) {
+        // PlaySoundを停止
+        PlaySoundW(NULL, NULL, SND_PURGE);
+        using_play_sound_ = false;
+    }
     
     is_playing_ = false;
     current_state_ = PlaybackState::STOPPED;
     
     blog(LOG_INFO, "[AudioPlayer] Playback stopped");
-    return true;
+}
+
+bool AudioPlayer::is_playing() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (voice_) {
+        return AudioMixer::instance().is_playing(voice_);
+    }
+    return is_playing_;
+}
+
+AudioPlayer::PlaybackState AudioPlayer::get_state() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return current_state_;
+}
+
+void AudioPlayer::set_volume(float volume)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    volume_ = volume;
+    if (voice_) {
+        AudioMixer::instance().set_volume(voice_, volume);
+    }
+}
+
+void AudioPlayer::set_speed(float speed)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    speed_ = speed;
+}
+
+void AudioPlayer::set_pitch(float pitch)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    pitch_ = pitch;
+}
+
+float AudioPlayer::get_volume() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return volume_;
+}
+
+float AudioPlayer::get_speed() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return speed_;
+}
+
+float AudioPlayer::get_pitch() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return pitch_;
+}
+
+void AudioPlayer::set_looping(bool enable)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    looping_ = enable;
+}
+
+void AudioPlayer::fade_in(float duration_seconds)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    fade_in_seconds_ = duration_seconds;
+}
+
+void AudioPlayer::fade_out(float duration_seconds)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (voice_) {
+        AudioMixer::instance().stop(voice_, std::max(duration_seconds, AudioMixer::kDefaultStopFade));
+        voice_ = 0;
+        is_playing_ = false;
+        current_state_ = PlaybackState::STOPPED;
+    }
+}
+
+std::chrono::steady_clock::time_point AudioPlayer::get_first_sample_time() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    int64_t ns = first_sample_time_ns_.load(std::memory_order_acquire);
+    if (ns == 0 && voice_) {
+        // ミキサーが最初のサンプルをミックスした時刻（デバイスのバッファ分は含まない）
+        ns = AudioMixer::instance().get_first_sample_time_ns(voice_);
+        if (ns != 0) {
+            first_sample_time_ns_.store(ns, std::memory_order_release);
+        }
+    }
+    if (ns == 0) return std::chrono::steady_clock::time_point();
+    return std::chrono::steady_clock::time_point(
+        std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::nanoseconds(ns)));
 }
 
 std::vector<std::string> AudioPlayer::get_supported_formats() const
@@ -101,6 +350,7 @@ std::vector<std::string> AudioPlayer::get_supported_formats() const
 
 void AudioPlayer::log_audio_info() const
 {
+    std::lock_guard<std::mutex> lock(mutex_);
     if (current_file_.empty()) {
         blog(LOG_INFO, "[AudioPlayer] No file loaded");
         return;
@@ -109,6 +359,16 @@ void AudioPlayer::log_audio_info() const
     blog(LOG_INFO, "[AudioPlayer] Current file info:");
     blog(LOG_INFO, "  Path: %s", audio_info_.file_path.c_str());
     blog(LOG_INFO, "  Format: %s", audio_info_.format.c_str());
+    if (clip_) {
+        blog(LOG_INFO, "  Output: mixer (%s, %d Hz, %d ch, %.2fs, %zu bytes mapped)",
+             WavClip::get_sample_format_name(clip_->get_sample_format()), clip_->get_sample_rate(),
+             clip_->get_channels(), clip_->get_duration(), clip_->get_mapped_bytes());
+    } else if (streamed_clip_) {
+        blog(LOG_INFO, "  Output: mixer (%d Hz, streamed, %zu bytes prefetched)", streamed_clip_->get_sample_rate(),
+             streamed_clip_->get_prefetch_bytes());
+    } else {
+        blog(LOG_INFO, "  Output: PlaySound");
+    }
     blog(LOG_INFO, "  Volume: %.2f", volume_);
     blog(LOG_INFO, "  Looping: %s", looping_ ? "Yes" : "No");
 }
@@ -3,9 +3,17 @@
 #include <string>
 #include <memory>
 #include <vector>
+#include <atomic>
+#include <chrono>
+#include <mutex>
 #include <windows.h>
+#include "audio-mixer.h"
+#include "streamed-clip.h"
+#include "wav-clip.h"
 
-// 簡易版AudioPlayer - miniaudioを使わずにWindows APIで実装
+// AudioPlayer - PCM WAVはメモリマップして、MP3/OGG（と圧縮WAV）は再生しながらデコードしてAudioMixerで再生する。
+// デコードできないWAVやデバイスを開けない場合はWindows PlaySoundで再生する
+// 再生（検出スレッド）と設定の変更（設定の更新）は別のスレッドから呼ばれるため、状態はロックで保護する
 
 class AudioPlayer {
 public:
@@ -35,33 +43,37 @@ public:
     
     // 音声ファイルの読み込み
     bool load_audio_file(const std::string& file_path);
-    bool is_file_loaded() const { return !current_file_.empty(); }
-    AudioInfo get_audio_info() const { return audio_info_; }
+    bool is_file_loaded() const;
+    AudioInfo get_audio_info() const;
+    size_t get_memory_usage() const;  // WAVはマップしたサイズ、ストリーミングは先読み分と再生中のリングバッファ
     
-    // 再生制御（Windows PlaySoundを使用）
+    // 再生制御（前の再生は短いフェードで止めてから再生する）
     bool play();
-    bool play_with_duration(float duration_seconds) { return play(); }
+    bool play_with_duration(float duration_seconds);
     bool pause() { return true; }
     bool stop();
-    bool is_playing() const { return is_playing_; }
-    PlaybackState get_state() const { return current_state_; }
+    bool is_playing() const;
+    PlaybackState get_state() const;
     
-    // 再生パラメータ（簡易版では保存のみ）
-    void set_volume(float volume) { volume_ = volume; }
-    void set_speed(float speed) { speed_ = speed; }
-    void set_pitch(float pitch) { pitch_ = pitch; }
-    float get_volume() const { return volume_; }
-    float get_speed() const { return speed_; }
-    float get_pitch() const { return pitch_; }
+    // 直近の再生で最初のサンプルが出力された時刻（レイテンシ計測用）
+    std::chrono::steady_clock::time_point get_first_sample_time() const;
+    
+    // 再生パラメータ（音量は再生中の音にも反映する。速度は次の再生から。PlaySoundでは保存のみ）
+    void set_volume(float volume);
+    void set_speed(float speed);
+    void set_pitch(float pitch);
+    float get_volume() const;
+    float get_speed() const;
+    float get_pitch() const;
     
     // 再生位置（簡易版では未実装）
     void set_position(float seconds) {}
     float get_position() const { return 0.0f; }
-    float get_duration() const { return audio_info_.duration_seconds; }
+    float get_duration() const;
     
-    // フェード効果（簡易版では未実装）
-    void fade_in(float duration_seconds) {}
-    void fade_out(float duration_seconds) {}
+    // フェード効果（fade_inは次の再生から、fade_outは再生中の音をフェードして止める）
+    void fade_in(float duration_seconds);
+    void fade_out(float duration_seconds);
     
     // プレイリスト（簡易版では未実装）
     bool add_to_playlist(const std::string& file_path) { return true; }
@@ -70,7 +82,7 @@ public:
     bool play_random() { return true; }
     
     // 設定
-    void set_looping(bool enable) { looping_ = enable; }
+    void set_looping(bool enable);
     void set_auto_stop_duration(float seconds) {}
     
     // サポート形式
@@ -82,19 +94,33 @@ private:
     bool is_supported_format(const std::string& file_path) const;
     std::string get_file_extension(const std::string& file_path) const;
 
+    // 以下はmutex_を保持して呼ぶ
+    bool play_impl(float duration_seconds);
+    bool play_with_mixer(float duration_seconds);
+    bool play_with_play_sound();
+    void stop_locked();
+
 private:
+    mutable std::mutex mutex_;
+
     // 状態管理
     bool is_playing_;
     PlaybackState current_state_;
+    mutable std::atomic<int64_t> first_sample_time_ns_;
     
     // 音声ファイル情報
     std::string current_file_;
     AudioInfo audio_info_;
+    std::shared_ptr<const WavClip> clip_;       // ミキサーで再生できる場合（PCM WAV）
+    std::shared_ptr<const StreamedClip> streamed_clip_;  // ミキサーで再生できる場合（それ以外）
+    AudioMixer::VoiceId voice_;
+    bool using_play_sound_;
     
     // 再生パラメータ
     float volume_;
     float speed_;
     float pitch_;
+    float fade_in_seconds_;
     bool looping_;
     
     // サポートする形式
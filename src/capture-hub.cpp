@@ -0,0 +1,184 @@
+#include "capture-hub.h"
+#include "process-detector.h"
+#include "profiler.h"
+#include <obs-module.h>
+#include <algorithm>
+#include <cctype>
+#include <limits>
+
+namespace {
+
+// まだ一度も処理していないことを表すティック
+const uint64_t kNoTick = std::numeric_limits<uint64_t>::max();
+
+} // namespace
+
+// ===== CaptureTarget =====
+
+CaptureTarget::CaptureTarget(const std::string& process_name)
+    : process_name_(process_name)
+    , detector_(std::make_unique<ProcessDetector>())
+    , process_tick_(kNoTick)
+    , process_running_(false)
+    , capture_tick_(kNoTick)
+    , capture_ok_(false)
+    , frame_{cv::Mat(), 0, {}, {}, false}
+    , stats_{0, 0, 0, 0}
+{
+    detector_->set_target_process(process_name_);
+}
+
+CaptureTarget::~CaptureTarget() = default;
+
+bool CaptureTarget::poll_process(uint64_t tick)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (tick == process_tick_) {
+        return process_running_;
+    }
+
+    PROFILE_ZONE("process_check");
+    process_tick_ = tick;
+    ++stats_.process_checks;
+
+    process_running_ = detector_->is_process_running();
+    if (!process_running_) {
+        detector_->refresh_process_info();
+        process_running_ = detector_->is_process_running();
+    }
+    return process_running_;
+}
+
+bool CaptureTarget::acquire_frame(uint64_t tick, Frame& frame)
+{
+    // 他のソースがキャプチャ中なら、終わるのを待って同じフレームを受け取る
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (tick == capture_tick_) {
+        if (!capture_ok_) return false;
+        frame = frame_;
+        frame.shared = true;
+        ++stats_.frames_served;
+        return true;
+    }
+
+    PROFILE_ZONE("capture_window");
+    capture_tick_ = tick;
+
+    // 前のティックのフレームを参照しているソースがあるため、毎回新しいバッファに取得する
+    cv::Mat image;
+    auto start = std::chrono::steady_clock::now();
+    capture_ok_ = detector_->capture_window(image) && !image.empty();
+    auto end = std::chrono::steady_clock::now();
+
+    ++stats_.captures;
+    if (!capture_ok_) {
+        ++stats_.capture_failures;
+        frame_ = {cv::Mat(), tick, start, end, false};
+        return false;
+    }
+
+    frame_ = {image, tick, start, end, false};
+    frame = frame_;
+    ++stats_.frames_served;
+    return true;
+}
+
+CaptureTarget::Stats CaptureTarget::get_stats() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+// ===== CaptureHub =====
+
+CaptureHub& CaptureHub::instance()
+{
+    static CaptureHub hub;
+    return hub;
+}
+
+std::string CaptureHub::make_key(const std::string& process_name)
+{
+    std::string key = process_name;
+    std::transform(key.begin(), key.end(), key.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return key;
+}
+
+std::shared_ptr<CaptureTarget> CaptureHub::subscribe(const std::string& process_name)
+{
+    if (process_name.empty()) return nullptr;
+
+    const std::string key = make_key(process_name);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    remove_expired();
+
+    auto it = targets_.find(key);
+    if (it != targets_.end()) {
+        if (auto target = it->second.lock()) {
+            return target;
+        }
+    }
+
+    auto target = std::make_shared<CaptureTarget>(process_name);
+    targets_[key] = target;
+    blog(LOG_INFO, "[CaptureHub] Watching process '%s' (%zu targets)", process_name.c_str(), targets_.size());
+    return target;
+}
+
+void CaptureHub::unsubscribe(std::shared_ptr<CaptureTarget>& target)
+{
+    if (!target) return;
+
+    // 最後の購読者であればここでCaptureTargetが破棄される
+    target.reset();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    remove_expired();
+}
+
+size_t CaptureHub::get_target_count() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t count = 0;
+    for (const auto& entry : targets_) {
+        if (!entry.second.expired()) ++count;
+    }
+    return count;
+}
+
+void CaptureHub::log_summary() const
+{
+    std::vector<std::pair<std::shared_ptr<CaptureTarget>, long>> targets;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto& entry : targets_) {
+            if (auto target = entry.second.lock()) {
+                // ここで一時的に増やした分を除いた購読ソース数
+                targets.emplace_back(target, entry.second.use_count() - 1);
+            }
+        }
+    }
+
+    for (const auto& entry : targets) {
+        CaptureTarget::Stats stats = entry.first->get_stats();
+        blog(LOG_INFO, "[CaptureHub] %s: sources=%ld process_checks=%llu captures=%llu failures=%llu served=%llu",
+             entry.first->get_process_name().c_str(), entry.second,
+             static_cast<unsigned long long>(stats.process_checks),
+             static_cast<unsigned long long>(stats.captures),
+             static_cast<unsigned long long>(stats.capture_failures),
+             static_cast<unsigned long long>(stats.frames_served));
+    }
+}
+
+void CaptureHub::remove_expired()
+{
+    for (auto it = targets_.begin(); it != targets_.end();) {
+        if (it->second.expired()) {
+            it = targets_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
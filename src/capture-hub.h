@@ -0,0 +1,93 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class ProcessDetector;
+
+/**
+ * 対象プロセス1つ分のキャプチャ
+ * プロセスの監視とウィンドウキャプチャはティックごとに1回だけ行い、
+ * 同じティックで呼び出した他のソースには取得済みのフレームを渡す
+ */
+class CaptureTarget {
+public:
+    struct Frame {
+        cv::Mat image;                                      // 共有されるため読み取り専用として扱う
+        uint64_t tick;                                      // 取得したティック
+        std::chrono::steady_clock::time_point capture_start;
+        std::chrono::steady_clock::time_point capture_end;
+        bool shared;                                        // 他のソースが取得したフレームの再利用か
+    };
+
+    struct Stats {
+        uint64_t process_checks;        // プロセス状態の確認回数
+        uint64_t captures;              // 実際にキャプチャした回数
+        uint64_t capture_failures;
+        uint64_t frames_served;         // ソースに渡したフレーム数（再利用を含む）
+    };
+
+public:
+    explicit CaptureTarget(const std::string& process_name);
+    ~CaptureTarget();
+
+    CaptureTarget(const CaptureTarget&) = delete;
+    CaptureTarget& operator=(const CaptureTarget&) = delete;
+
+    const std::string& get_process_name() const { return process_name_; }
+
+    // ティックはOBSのビデオフレーム時刻など、同じフレームで共通の値を渡す
+    bool poll_process(uint64_t tick);
+    bool acquire_frame(uint64_t tick, Frame& frame);
+
+    Stats get_stats() const;
+
+private:
+    const std::string process_name_;
+
+    mutable std::mutex mutex_;
+    std::unique_ptr<ProcessDetector> detector_;
+
+    uint64_t process_tick_;
+    bool process_running_;
+
+    uint64_t capture_tick_;
+    bool capture_ok_;
+    Frame frame_;
+
+    Stats stats_;
+};
+
+/**
+ * プラグイン全体のキャプチャ共有ハブ
+ * 対象プロセス名（大文字小文字を区別しない）ごとにCaptureTargetを1つだけ持ち、
+ * 同じゲームを対象とする複数のソースで共有する。キャプチャのコストはソース数ではなく
+ * ゲーム数に比例する。購読するソースがなくなったCaptureTargetは破棄される
+ */
+class CaptureHub {
+public:
+    static CaptureHub& instance();
+
+    std::shared_ptr<CaptureTarget> subscribe(const std::string& process_name);
+    void unsubscribe(std::shared_ptr<CaptureTarget>& target);
+
+    size_t get_target_count() const;
+    void log_summary() const;
+
+    static std::string make_key(const std::string& process_name);
+
+private:
+    CaptureHub() = default;
+
+    void remove_expired();
+
+private:
+    mutable std::mutex mutex_;
+    std::map<std::string, std::weak_ptr<CaptureTarget>> targets_;
+};
@@ -0,0 +1,228 @@
+#include "cascade-filter.h"
+#include "profiler.h"
+#include <opencv2/imgproc.hpp>
+#include <algorithm>
+#include <chrono>
+
+namespace {
+
+// 1段目: 1チャンネルあたりの量子化段数（カラーは8^3、グレースケールは32段）
+const int kColorLevelsShift = 5;
+const int kGrayLevelsShift = 3;
+
+// テンプレートの色のうち探索領域に含まれている割合がこれ未満なら棄却する
+const float kMinCoverage = 0.5f;
+
+// 探索領域がテンプレートのこの倍数より広ければ縦横1画素おきに集計する
+const int kSubsampleAreaRatio = 16;
+
+// 2段目: 縮小後のテンプレートの短辺
+const float kCoarseTemplateSize = 16.0f;
+const float kMaxCoarseScale = 0.5f;
+const int kMinCoarseTemplateSize = 8;
+
+// 低解像度では位置ずれで一致度が下がるため、閾値からこの分だけ下げて判定する
+const float kCoarseMargin = 0.25f;
+
+uint64_t elapsed_ns(std::chrono::steady_clock::time_point start)
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count());
+}
+
+} // namespace
+
+CascadeFilter::CascadeFilter()
+    : channels_(0)
+    , template_pixels_(0)
+    , last_coverage_(0.0f)
+    , coarse_enabled_(true)
+    , coarse_scale_(1.0f)
+    , last_coarse_score_(0.0f)
+    , stats_{false, 0, -1, {}}
+{
+}
+
+bool CascadeFilter::set_template(const cv::Mat& template_image)
+{
+    reset();
+
+    if (template_image.empty() || template_image.depth() != CV_8U ||
+        (template_image.channels() != 1 && template_image.channels() != 3)) {
+        return false;
+    }
+
+    channels_ = template_image.channels();
+    compute_histogram(template_image, 1, template_histogram_);
+    template_pixels_ = static_cast<uint64_t>(template_image.total());
+
+    // 2段目用のテンプレート（縮小しても十分な大きさが残る場合のみ）
+    const int short_side = std::min(template_image.cols, template_image.rows);
+    coarse_scale_ = std::min(kMaxCoarseScale, kCoarseTemplateSize / short_side);
+    if (short_side * coarse_scale_ >= kMinCoarseTemplateSize) {
+        cv::Mat gray;
+        if (channels_ == 3) {
+            cv::cvtColor(template_image, gray, cv::COLOR_BGR2GRAY);
+        } else {
+            gray = template_image;
+        }
+        cv::resize(gray, coarse_template_, cv::Size(), coarse_scale_, coarse_scale_, cv::INTER_AREA);
+    }
+
+    return true;
+}
+
+void CascadeFilter::reset()
+{
+    channels_ = 0;
+    template_histogram_.clear();
+    template_pixels_ = 0;
+    coarse_scale_ = 1.0f;
+    coarse_template_.release();
+    coarse_image_.release();
+    coarse_gray_.release();
+    coarse_result_.release();
+    stats_ = {false, 0, -1, {}};
+}
+
+bool CascadeFilter::screen(const cv::Mat& image, float threshold)
+{
+    stats_ = {true, 0, -1, {}};
+
+    if (!is_ready() || image.empty() || image.depth() != CV_8U) {
+        stats_.evaluated = false;
+        return true;
+    }
+
+    PROFILE_ZONE("cascade_screen");
+
+    auto start = std::chrono::steady_clock::now();
+    bool passed = histogram_stage(image);
+    stats_.stage_ns[static_cast<size_t>(Stage::HISTOGRAM)] = elapsed_ns(start);
+    stats_.stages_run = 1;
+    if (!passed) {
+        stats_.rejected_stage = static_cast<int>(Stage::HISTOGRAM);
+        return false;
+    }
+
+    if (coarse_enabled_ && !coarse_template_.empty()) {
+        start = std::chrono::steady_clock::now();
+        passed = coarse_stage(image, threshold);
+        stats_.stage_ns[static_cast<size_t>(Stage::COARSE_NCC)] = elapsed_ns(start);
+        stats_.stages_run = 2;
+        if (!passed) {
+            stats_.rejected_stage = static_cast<int>(Stage::COARSE_NCC);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void CascadeFilter::record_verification(bool found, uint64_t nanoseconds)
+{
+    if (!stats_.evaluated || stats_.rejected_stage >= 0) return;
+
+    stats_.stage_ns[static_cast<size_t>(Stage::VERIFY)] = nanoseconds;
+    stats_.stages_run = static_cast<int>(kStageCount);
+    if (!found) {
+        stats_.rejected_stage = static_cast<int>(Stage::VERIFY);
+    }
+}
+
+size_t CascadeFilter::get_memory_usage() const
+{
+    auto mat_bytes = [](const cv::Mat& mat) { return mat.total() * mat.elemSize(); };
+    return (template_histogram_.size() + image_histogram_.size()) * sizeof(uint32_t) +
+           mat_bytes(coarse_template_) + mat_bytes(coarse_image_) + mat_bytes(coarse_gray_) +
+           mat_bytes(coarse_result_);
+}
+
+const char* CascadeFilter::get_stage_name(Stage stage)
+{
+    switch (stage) {
+        case Stage::HISTOGRAM:  return "histogram";
+        case Stage::COARSE_NCC: return "coarse_ncc";
+        case Stage::VERIFY:     return "verify";
+        default:                return "unknown";
+    }
+}
+
+bool CascadeFilter::histogram_stage(const cv::Mat& image)
+{
+    // テンプレートがカラーで対象がグレースケールの場合は判定できないので通す
+    if (image.channels() < channels_) {
+        last_coverage_ = 1.0f;
+        return true;
+    }
+
+    const uint64_t area = static_cast<uint64_t>(image.total());
+    const int step = (area > template_pixels_ * kSubsampleAreaRatio) ? 2 : 1;
+    compute_histogram(image, step, image_histogram_);
+
+    // テンプレートの各色について、探索領域に同じ色の画素がどれだけあるか
+    const uint64_t weight = static_cast<uint64_t>(step) * step;
+    uint64_t covered = 0;
+    for (size_t bin = 0; bin < template_histogram_.size(); ++bin) {
+        covered += std::min<uint64_t>(template_histogram_[bin], image_histogram_[bin] * weight);
+    }
+
+    last_coverage_ = static_cast<float>(covered) / static_cast<float>(template_pixels_);
+    return last_coverage_ >= kMinCoverage;
+}
+
+bool CascadeFilter::coarse_stage(const cv::Mat& image, float threshold)
+{
+    cv::resize(image, coarse_image_, cv::Size(), coarse_scale_, coarse_scale_, cv::INTER_AREA);
+    if (coarse_image_.channels() == 3) {
+        cv::cvtColor(coarse_image_, coarse_gray_, cv::COLOR_BGR2GRAY);
+    } else if (coarse_image_.channels() == 4) {
+        cv::cvtColor(coarse_image_, coarse_gray_, cv::COLOR_BGRA2GRAY);
+    } else {
+        coarse_gray_ = coarse_image_;
+    }
+
+    if (coarse_gray_.cols < coarse_template_.cols || coarse_gray_.rows < coarse_template_.rows) {
+        last_coarse_score_ = 0.0f;
+        return true;
+    }
+
+    cv::matchTemplate(coarse_gray_, coarse_template_, coarse_result_, cv::TM_CCOEFF_NORMED);
+
+    double max_val = 0.0;
+    cv::minMaxLoc(coarse_result_, nullptr, &max_val);
+    last_coarse_score_ = static_cast<float>(max_val);
+    return last_coarse_score_ >= threshold - kCoarseMargin;
+}
+
+void CascadeFilter::compute_histogram(const cv::Mat& image, int step, std::vector<uint32_t>& histogram) const
+{
+    const int cn = image.channels();
+
+    if (channels_ == 3) {
+        histogram.assign(size_t(1) << (3 * (8 - kColorLevelsShift)), 0);
+        const int bits = 8 - kColorLevelsShift;
+        for (int y = 0; y < image.rows; y += step) {
+            const uint8_t* row = image.ptr<uint8_t>(y);
+            for (int x = 0; x < image.cols; x += step) {
+                const uint8_t* pixel = row + x * cn;
+                size_t bin = (static_cast<size_t>(pixel[0] >> kColorLevelsShift) << (2 * bits)) |
+                             (static_cast<size_t>(pixel[1] >> kColorLevelsShift) << bits) |
+                             static_cast<size_t>(pixel[2] >> kColorLevelsShift);
+                ++histogram[bin];
+            }
+        }
+        return;
+    }
+
+    // グレースケールのテンプレートには輝度で比較する
+    histogram.assign(size_t(1) << (8 - kGrayLevelsShift), 0);
+    for (int y = 0; y < image.rows; y += step) {
+        const uint8_t* row = image.ptr<uint8_t>(y);
+        for (int x = 0; x < image.cols; x += step) {
+            const uint8_t* pixel = row + x * cn;
+            int luma = (cn >= 3) ? (pixel[0] * 29 + pixel[1] * 150 + pixel[2] * 77) >> 8 : pixel[0];
+            ++histogram[static_cast<size_t>(luma >> kGrayLevelsShift)];
+        }
+    }
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+/**
+ * 段階的な事前判定（カスケード）
+ * 1段目: 探索領域の色ヒストグラムがテンプレートの色をどれだけ含むか（間引いた画素で集計）
+ * 2段目: テンプレートの短辺を数十画素まで縮小した低解像度NCC
+ * 3段目: 通過したフレームだけを選択中の手法で等倍照合する（ImageMatcher側で実行）
+ * 大半のフレームは1〜2段目で棄却され、重い照合を行わずに済む
+ */
+class CascadeFilter {
+public:
+    enum class Stage {
+        HISTOGRAM,              // 色ヒストグラムの包含率
+        COARSE_NCC,             // 低解像度NCC
+        VERIFY,                 // 等倍での照合
+        COUNT
+    };
+
+    static constexpr size_t kStageCount = static_cast<size_t>(Stage::COUNT);
+
+    // 直近フレームの判定結果
+    struct FrameStats {
+        bool evaluated;                                 // カスケードを通したか
+        int stages_run;                                 // 実行した段数
+        int rejected_stage;                             // 棄却した段（-1は通過）
+        std::array<uint64_t, kStageCount> stage_ns;     // 各段の処理時間
+    };
+
+public:
+    CascadeFilter();
+
+    // テンプレート（BGRまたはグレースケール）から各段の判定用データを作る
+    bool set_template(const cv::Mat& template_image);
+    void reset();
+    bool is_ready() const { return template_pixels_ > 0; }
+
+    // 低解像度NCCの段を使うか（回転・拡大縮小を許す手法では無効にする）
+    void set_coarse_stage_enabled(bool enable) { coarse_enabled_ = enable; }
+
+    // 1〜2段目の判定。falseなら棄却（フレームにテンプレートはない）
+    bool screen(const cv::Mat& image, float threshold);
+
+    // 3段目の結果を記録する
+    void record_verification(bool found, uint64_t nanoseconds);
+
+    const FrameStats& get_last_stats() const { return stats_; }
+    float get_last_coverage() const { return last_coverage_; }
+    float get_last_coarse_score() const { return last_coarse_score_; }
+    float get_coarse_scale() const { return coarse_scale_; }
+    size_t get_memory_usage() const;
+
+    static const char* get_stage_name(Stage stage);
+
+private:
+    bool histogram_stage(const cv::Mat& image);
+    bool coarse_stage(const cv::Mat& image, float threshold);
+    void compute_histogram(const cv::Mat& image, int step, std::vector<uint32_t>& histogram) const;
+
+private:
+    // 1段目: 量子化した色のヒストグラム
+    int channels_;
+    std::vector<uint32_t> template_histogram_;
+    std::vector<uint32_t> image_histogram_;
+    uint64_t template_pixels_;
+    float last_coverage_;
+
+    // 2段目: 縮小したグレースケールのテンプレート
+    bool coarse_enabled_;
+    float coarse_scale_;
+    cv::Mat coarse_template_;
+    cv::Mat coarse_image_;
+    cv::Mat coarse_gray_;
+    cv::Mat coarse_result_;
+    float last_coarse_score_;
+
+    FrameStats stats_;
+};
@@ -0,0 +1,236 @@
+#include "debug-overlay.h"
+#include "profiler.h"
+#include <graphics/vec4.h>
+#include <algorithm>
+
+namespace {
+
+const double kDefaultMaxFps = 10.0;
+const int kDefaultMaxWidth = 640;
+const float kConfidenceBarHeight = 6.0f;
+
+} // namespace
+
+DebugOverlay::DebugOverlay()
+    : has_new_frame_(false)
+    , threshold_(0.0f)
+    , texture_(nullptr)
+    , texture_width_(0)
+    , texture_height_(0)
+    , max_width_(kDefaultMaxWidth)
+{
+    set_max_fps(kDefaultMaxFps);
+}
+
+DebugOverlay::~DebugOverlay()
+{
+    // テクスチャはrelease_graphics()で解放済みであること
+}
+
+void DebugOverlay::set_max_fps(double fps)
+{
+    fps = std::max(0.1, fps);
+    min_interval_ = std::chrono::nanoseconds(static_cast<int64_t>(1e9 / fps));
+}
+
+void DebugOverlay::set_max_width(int width)
+{
+    max_width_ = std::max(64, width);
+}
+
+void DebugOverlay::publish_matches(const std::vector<Box>& boxes, cv::Size frame_size, float threshold)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    boxes_ = boxes;
+    frame_size_ = frame_size;
+    threshold_ = threshold;
+}
+
+cv::Size DebugOverlay::get_frame_size() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return frame_size_;
+}
+
+bool DebugOverlay::wants_frame() const
+{
+    return std::chrono::steady_clock::now() - last_submit_time_ >= min_interval_;
+}
+
+void DebugOverlay::submit_frame(const cv::Mat& frame)
+{
+    if (frame.empty()) return;
+    PROFILE_ZONE("DebugOverlay::submit_frame");
+
+    last_submit_time_ = std::chrono::steady_clock::now();
+
+    // 縮小とBGRA変換はロック外で作業バッファに対して行う
+    const cv::Mat* source = &frame;
+    if (frame.cols > max_width_) {
+        double scale = static_cast<double>(max_width_) / frame.cols;
+        cv::resize(frame, resized_, cv::Size(), scale, scale, cv::INTER_AREA);
+        source = &resized_;
+    }
+
+    switch (source->channels()) {
+        case 1:
+            cv::cvtColor(*source, converted_, cv::COLOR_GRAY2BGRA);
+            break;
+        case 3:
+            cv::cvtColor(*source, converted_, cv::COLOR_BGR2BGRA);
+            break;
+        default:
+            source->copyTo(converted_);
+            break;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::swap(staging_frame_, converted_);
+    has_new_frame_ = true;
+}
+
+void DebugOverlay::clear()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    boxes_.clear();
+    staging_frame_.release();
+    has_new_frame_ = false;
+}
+
+void DebugOverlay::release_buffers()
+{
+    clear();
+    resized_.release();
+    converted_.release();
+}
+
+void DebugOverlay::render(uint32_t width, uint32_t height)
+{
+    upload_pending_frame();
+
+    if (texture_) {
+        gs_effect_t *default_effect = obs_get_base_effect(OBS_EFFECT_DEFAULT);
+        gs_technique_t *tech = gs_effect_get_technique(default_effect, "Draw");
+
+        gs_technique_begin(tech);
+        gs_technique_begin_pass(tech, 0);
+
+        gs_effect_set_texture(gs_effect_get_param_by_name(default_effect, "image"), texture_);
+        gs_draw_sprite(texture_, 0, width, height);
+
+        gs_technique_end_pass(tech);
+        gs_technique_end(tech);
+    }
+
+    draw_boxes(width, height);
+}
+
+void DebugOverlay::release_graphics()
+{
+    if (texture_) {
+        gs_texture_destroy(texture_);
+        texture_ = nullptr;
+        texture_width_ = 0;
+        texture_height_ = 0;
+    }
+}
+
+void DebugOverlay::upload_pending_frame()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!has_new_frame_ || staging_frame_.empty()) return;
+
+    uint32_t frame_width = static_cast<uint32_t>(staging_frame_.cols);
+    uint32_t frame_height = static_cast<uint32_t>(staging_frame_.rows);
+
+    // サイズが変わった時だけテクスチャを作り直す
+    if (!texture_ || texture_width_ != frame_width || texture_height_ != frame_height) {
+        release_graphics();
+        texture_ = gs_texture_create(frame_width, frame_height, GS_BGRA, 1, nullptr, GS_DYNAMIC);
+        if (!texture_) {
+            blog(LOG_WARNING, "[DebugOverlay] Failed to create overlay texture");
+            return;
+        }
+        texture_width_ = frame_width;
+        texture_height_ = frame_height;
+    }
+
+    gs_texture_set_image(texture_, staging_frame_.data, static_cast<uint32_t>(staging_frame_.step), false);
+    has_new_frame_ = false;
+}
+
+void DebugOverlay::draw_boxes(uint32_t width, uint32_t height)
+{
+    cv::Size frame_size;
+    float threshold;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        render_boxes_ = boxes_;
+        frame_size = frame_size_;
+        threshold = threshold_;
+    }
+
+    if (render_boxes_.empty() || frame_size.width <= 0 || frame_size.height <= 0) return;
+
+    float scale_x = static_cast<float>(width) / frame_size.width;
+    float scale_y = static_cast<float>(height) / frame_size.height;
+
+    gs_effect_t *solid = obs_get_base_effect(OBS_EFFECT_SOLID);
+    gs_eparam_t *color_param = gs_effect_get_param_by_name(solid, "color");
+    gs_technique_t *tech = gs_effect_get_technique(solid, "Solid");
+
+    struct vec4 box_color;
+    struct vec4 bar_back_color;
+    vec4_set(&bar_back_color, 0.0f, 0.0f, 0.0f, 0.6f);
+
+    gs_technique_begin(tech);
+    gs_technique_begin_pass(tech, 0);
+
+    for (const auto& box : render_boxes_) {
+        float x0 = box.rect.x * scale_x;
+        float y0 = box.rect.y * scale_y;
+        float x1 = (box.rect.x + box.rect.width) * scale_x;
+        float y1 = (box.rect.y + box.rect.height) * scale_y;
+
+        // 閾値以上は緑、未満は黄色
+        if (box.confidence >= threshold) {
+            vec4_set(&box_color, 0.0f, 1.0f, 0.0f, 1.0f);
+        } else {
+            vec4_set(&box_color, 1.0f, 0.8f, 0.0f, 1.0f);
+        }
+
+        // 枠
+        gs_effect_set_vec4(color_param, &box_color);
+        gs_render_start(true);
+        gs_vertex2f(x0, y0);
+        gs_vertex2f(x1, y0);
+        gs_vertex2f(x1, y1);
+        gs_vertex2f(x0, y1);
+        gs_vertex2f(x0, y0);
+        gs_render_stop(GS_LINESTRIP);
+
+        // 信頼度バー（枠の上辺に沿って表示）
+        float bar_y1 = std::max(0.0f, y0 - 2.0f);
+        float bar_y0 = std::max(0.0f, bar_y1 - kConfidenceBarHeight);
+        float bar_x1 = x0 + (x1 - x0) * std::clamp(box.confidence, 0.0f, 1.0f);
+
+        gs_effect_set_vec4(color_param, &bar_back_color);
+        gs_render_start(true);
+        gs_vertex2f(x0, bar_y0);
+        gs_vertex2f(x1, bar_y0);
+        gs_vertex2f(x0, bar_y1);
+        gs_vertex2f(x1, bar_y1);
+        gs_render_stop(GS_TRISTRIP);
+
+        gs_effect_set_vec4(color_param, &box_color);
+        gs_render_start(true);
+        gs_vertex2f(x0, bar_y0);
+        gs_vertex2f(bar_x1, bar_y0);
+        gs_vertex2f(x0, bar_y1);
+        gs_vertex2f(bar_x1, bar_y1);
+        gs_render_stop(GS_TRISTRIP);
+    }
+
+    gs_technique_end_pass(tech);
+    gs_technique_end(tech);
+}
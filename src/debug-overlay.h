@@ -0,0 +1,71 @@
+#pragma once
+
+#include <obs-module.h>
+#include <opencv2/opencv.hpp>
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+/**
+ * デバッグ表示用オーバーレイ
+ * 検出スレッドはマッチ結果の座標と、一定間隔ごとに縮小したフレームだけを渡し、
+ * 描画スレッドが再利用テクスチャへのアップロードと枠・信頼度の描画を行う
+ */
+class DebugOverlay {
+public:
+    struct Box {
+        cv::Rect2f rect;        // 元フレーム座標
+        float confidence;
+    };
+
+public:
+    DebugOverlay();
+    ~DebugOverlay();
+
+    // 設定
+    void set_max_fps(double fps);
+    void set_max_width(int width);
+
+    // 検出スレッドから呼び出す
+    void publish_matches(const std::vector<Box>& boxes, cv::Size frame_size, float threshold);
+    bool wants_frame() const;
+    void submit_frame(const cv::Mat& frame);
+    void clear();
+    void release_buffers();         // clearに加えて検出スレッド側の作業バッファも解放する
+
+    // 最後にpublish_matchesで渡されたフレームの大きさ（未受信は空）
+    cv::Size get_frame_size() const;
+
+    // 描画スレッドから呼び出す（グラフィックスコンテキスト内）
+    void render(uint32_t width, uint32_t height);
+    void release_graphics();
+
+private:
+    void upload_pending_frame();
+    void draw_boxes(uint32_t width, uint32_t height);
+
+private:
+    mutable std::mutex mutex_;
+
+    // 検出スレッド -> 描画スレッドへの受け渡しデータ
+    cv::Mat staging_frame_;         // BGRA、縮小済み
+    bool has_new_frame_;
+    std::vector<Box> boxes_;
+    cv::Size frame_size_;
+    float threshold_;
+
+    // 検出スレッド側の作業バッファ（再利用）
+    cv::Mat resized_;
+    cv::Mat converted_;
+    std::chrono::steady_clock::time_point last_submit_time_;
+
+    // 描画スレッド側
+    gs_texture_t *texture_;
+    uint32_t texture_width_;
+    uint32_t texture_height_;
+    std::vector<Box> render_boxes_;
+
+    // 設定
+    std::chrono::nanoseconds min_interval_;
+    int max_width_;
+};
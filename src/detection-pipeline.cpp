@@ -0,0 +1,352 @@
+#include "detection-pipeline.h"
+#include "profiler.h"
+#include <obs-module.h>
+#include <algorithm>
+#include <sstream>
+
+namespace {
+
+// 段の間のキューの既定の長さ（ソース数が多い場合はconfig.jsonで増やす）
+const size_t kDefaultQueueCapacity = 4;
+
+uint64_t elapsed_ns(DetectionPipeline::Clock::time_point from, DetectionPipeline::Clock::time_point to)
+{
+    return static_cast<uint64_t>(std::max<int64_t>(0,
+        std::chrono::duration_cast<std::chrono::nanoseconds>(to - from).count()));
+}
+
+} // namespace
+
+DetectionPipeline& DetectionPipeline::instance()
+{
+    static DetectionPipeline pipeline;
+    return pipeline;
+}
+
+DetectionPipeline::DetectionPipeline()
+    : next_id_(1)
+    , queue_capacity_(kDefaultQueueCapacity)
+    , started_(false)
+    , stopping_(false)
+{
+    reset_stats_locked();
+}
+
+DetectionPipeline::~DetectionPipeline()
+{
+    shutdown();
+}
+
+DetectionPipeline::SourceId DetectionPipeline::register_source(const Handlers& handlers)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    SourceId id = next_id_++;
+    sources_[id] = std::make_shared<Source>(Source{handlers, 0});
+    return id;
+}
+
+void DetectionPipeline::unregister_source(SourceId id)
+{
+    flush_source(id);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    sources_.erase(id);
+}
+
+void DetectionPipeline::flush_source(SourceId id)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto it = sources_.find(id);
+    if (it == sources_.end()) return;
+    std::shared_ptr<Source> source = it->second;
+
+    // 処理中のフレームは次の段のキューに入るため、空になるまで取り除きながら待つ
+    while (true) {
+        remove_queued_locked(id);
+        if (source->busy == 0) break;
+        idle_.wait(lock);
+    }
+}
+
+bool DetectionPipeline::submit(SourceId id, uint64_t tick, std::shared_ptr<CaptureTarget> target,
+                               const Settings& settings)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stopping_ || sources_.find(id) == sources_.end()) return false;
+
+    if (!started_) {
+        start_workers_locked();
+    }
+
+    Frame frame;
+    frame.source_id = id;
+    frame.tick = tick;
+    frame.target = std::move(target);
+    frame.settings = settings;
+    frame.capture = {cv::Mat(), tick, {}, {}, false};
+    frame.cost_ns = 0;
+    frame.submit_time = Clock::now();
+    push_locked(static_cast<size_t>(Stage::CAPTURE), std::move(frame));
+    return true;
+}
+
+void DetectionPipeline::set_queue_capacity(size_t capacity)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    queue_capacity_ = std::max<size_t>(1, capacity);
+}
+
+size_t DetectionPipeline::get_queue_capacity() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return queue_capacity_;
+}
+
+void DetectionPipeline::shutdown()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!started_ || stopping_) return;
+        stopping_ = true;
+
+        for (size_t stage = 0; stage < kStageCount; ++stage) {
+            while (!stages_[stage].queue.empty()) {
+                discard_locked(stages_[stage].queue.front(), stage, true);
+                stages_[stage].queue.pop_front();
+            }
+            stages_[stage].ready.notify_all();
+        }
+    }
+
+    for (auto& state : stages_) {
+        if (state.worker.joinable()) {
+            state.worker.join();
+        }
+    }
+    idle_.notify_all();
+}
+
+void DetectionPipeline::start_workers_locked()
+{
+    started_ = true;
+    for (size_t stage = 0; stage < kStageCount; ++stage) {
+        stages_[stage].worker = std::thread(&DetectionPipeline::worker_loop, this, stage);
+    }
+}
+
+void DetectionPipeline::worker_loop(size_t stage)
+{
+    StageState& state = stages_[stage];
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    while (true) {
+        state.ready.wait(lock, [&]() { return stopping_ || !state.queue.empty(); });
+        if (stopping_) break;
+
+        Frame frame = std::move(state.queue.front());
+        state.queue.pop_front();
+        sample_depth_locked(state);
+
+        const Clock::time_point start = Clock::now();
+        state.wait_ns += elapsed_ns(frame.enqueue_time, start);
+        ++state.dequeued;
+
+        auto it = sources_.find(frame.source_id);
+        if (it == sources_.end()) continue;
+        std::shared_ptr<Source> source = it->second;
+        ++source->busy;
+        lock.unlock();
+
+        bool ok = true;
+        {
+            PROFILE_ZONE(get_stage_name(static_cast<Stage>(stage)));
+            try {
+                switch (static_cast<Stage>(stage)) {
+                    case Stage::CAPTURE:
+                        ok = source->handlers.capture && source->handlers.capture(frame);
+                        break;
+                    case Stage::PREPROCESS:
+                        ok = source->handlers.preprocess && source->handlers.preprocess(frame);
+                        break;
+                    case Stage::MATCH:
+                        if (source->handlers.match) source->handlers.match(frame);
+                        break;
+                    default:
+                        break;
+                }
+            }
+            catch (const std::exception& e) {
+                blog(LOG_ERROR, "[DetectionPipeline] Exception in %s stage: %s",
+                     get_stage_name(static_cast<Stage>(stage)), e.what());
+                ok = false;
+            }
+        }
+        const uint64_t cost = elapsed_ns(start, Clock::now());
+        frame.cost_ns += cost;
+
+        lock.lock();
+        state.busy_ns += cost;
+        if (!ok) {
+            ++state.failed;
+            discard_locked(frame, stage, false);
+        } else {
+            ++state.processed;
+            if (stage + 1 < kStageCount) {
+                push_locked(stage + 1, std::move(frame));
+            }
+        }
+
+        // 次の段へ渡してから処理中の数を減らす（flush_sourceの取りこぼしを防ぐ）
+        --source->busy;
+        idle_.notify_all();
+    }
+}
+
+void DetectionPipeline::push_locked(size_t stage, Frame&& frame)
+{
+    StageState& state = stages_[stage];
+
+    // 同じソースのフレームが待っていれば、古い方を捨てて置き換える
+    auto same_source = std::find_if(state.queue.begin(), state.queue.end(),
+                                    [&](const Frame& queued) { return queued.source_id == frame.source_id; });
+    if (same_source != state.queue.end()) {
+        ++state.dropped;
+        discard_locked(*same_source, stage, true);
+        state.queue.erase(same_source);
+    } else if (state.queue.size() >= queue_capacity_) {
+        ++state.dropped;
+        discard_locked(state.queue.front(), stage, true);
+        state.queue.pop_front();
+    }
+
+    frame.enqueue_time = Clock::now();
+    state.queue.push_back(std::move(frame));
+    sample_depth_locked(state);
+    state.ready.notify_one();
+}
+
+void DetectionPipeline::discard_locked(const Frame& frame, size_t stage, bool dropped)
+{
+    auto it = sources_.find(frame.source_id);
+    if (it == sources_.end() || !it->second->handlers.discard) return;
+    it->second->handlers.discard(frame, static_cast<Stage>(stage), dropped);
+}
+
+void DetectionPipeline::remove_queued_locked(SourceId id)
+{
+    for (size_t stage = 0; stage < kStageCount; ++stage) {
+        auto& queue = stages_[stage].queue;
+        for (auto it = queue.begin(); it != queue.end();) {
+            if (it->source_id == id) {
+                discard_locked(*it, stage, true);
+                it = queue.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+}
+
+void DetectionPipeline::sample_depth_locked(StageState& state)
+{
+    ++state.depth_samples;
+    state.depth_sum += state.queue.size();
+    state.max_depth = std::max(state.max_depth, state.queue.size());
+}
+
+std::array<DetectionPipeline::StageStats, DetectionPipeline::kStageCount> DetectionPipeline::get_stats() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    const double elapsed = static_cast<double>(elapsed_ns(stats_start_, Clock::now()));
+
+    std::array<StageStats, kStageCount> stats = {};
+    for (size_t stage = 0; stage < kStageCount; ++stage) {
+        const StageState& state = stages_[stage];
+        StageStats& entry = stats[stage];
+        const uint64_t completed = state.processed + state.failed;
+
+        entry.processed = state.processed;
+        entry.dropped = state.dropped;
+        entry.failed = state.failed;
+        entry.throughput_fps = elapsed > 0.0 ? state.processed / (elapsed / 1e9) : 0.0;
+        entry.utilization = elapsed > 0.0 ? state.busy_ns / elapsed : 0.0;
+        entry.avg_queue_depth = state.depth_samples > 0 ?
+            static_cast<double>(state.depth_sum) / state.depth_samples : 0.0;
+        entry.max_queue_depth = state.max_depth;
+        entry.avg_wait_ms = state.dequeued > 0 ? state.wait_ns / 1e6 / state.dequeued : 0.0;
+        entry.avg_process_ms = completed > 0 ? state.busy_ns / 1e6 / completed : 0.0;
+    }
+    return stats;
+}
+
+std::string DetectionPipeline::to_json() const
+{
+    std::array<StageStats, kStageCount> stats = get_stats();
+
+    std::ostringstream json;
+    json << "{\"queue_capacity\": " << get_queue_capacity() << ", \"stages\": [";
+    for (size_t stage = 0; stage < kStageCount; ++stage) {
+        const StageStats& entry = stats[stage];
+        json << (stage == 0 ? "" : ", ")
+             << "{\"stage\": \"" << get_stage_name(static_cast<Stage>(stage)) << "\""
+             << ", \"processed\": " << entry.processed
+             << ", \"dropped\": " << entry.dropped
+             << ", \"failed\": " << entry.failed
+             << ", \"throughput_fps\": " << entry.throughput_fps
+             << ", \"utilization\": " << entry.utilization
+             << ", \"avg_queue_depth\": " << entry.avg_queue_depth
+             << ", \"max_queue_depth\": " << entry.max_queue_depth
+             << ", \"avg_wait_ms\": " << entry.avg_wait_ms
+             << ", \"avg_process_ms\": " << entry.avg_process_ms << "}";
+    }
+    json << "]}";
+    return json.str();
+}
+
+void DetectionPipeline::log_summary() const
+{
+    std::array<StageStats, kStageCount> stats = get_stats();
+    for (size_t stage = 0; stage < kStageCount; ++stage) {
+        const StageStats& entry = stats[stage];
+        blog(LOG_INFO, "[DetectionPipeline] %s: processed=%llu dropped=%llu failed=%llu %.1ffps busy=%.0f%% "
+                       "queue=%.2f (max %zu) wait=%.2fms process=%.2fms",
+             get_stage_name(static_cast<Stage>(stage)),
+             static_cast<unsigned long long>(entry.processed),
+             static_cast<unsigned long long>(entry.dropped),
+             static_cast<unsigned long long>(entry.failed),
+             entry.throughput_fps, entry.utilization * 100.0, entry.avg_queue_depth, entry.max_queue_depth,
+             entry.avg_wait_ms, entry.avg_process_ms);
+    }
+}
+
+void DetectionPipeline::reset_stats()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    reset_stats_locked();
+}
+
+void DetectionPipeline::reset_stats_locked()
+{
+    for (auto& state : stages_) {
+        state.processed = 0;
+        state.dropped = 0;
+        state.failed = 0;
+        state.busy_ns = 0;
+        state.wait_ns = 0;
+        state.dequeued = 0;
+        state.depth_samples = 0;
+        state.depth_sum = 0;
+        state.max_depth = 0;
+    }
+    stats_start_ = Clock::now();
+}
+
+const char* DetectionPipeline::get_stage_name(Stage stage)
+{
+    switch (stage) {
+        case Stage::CAPTURE:    return "capture";
+        case Stage::PREPROCESS: return "preprocess";
+        case Stage::MATCH:      return "match";
+        default:                return "unknown";
+    }
+}
@@ -0,0 +1,160 @@
+#pragma once
+
+#include "capture-hub.h"
+#include "image-matcher.h"
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+/**
+ * 検出の3段パイプライン（キャプチャ → 前処理 → 照合）
+ * 段ごとに1つのワーカースレッドを持ち、全ソースで共有する。フレームNを照合している間に
+ * フレームN+1の前処理とキャプチャを進めるため、検出レートは各段の処理時間の和ではなく
+ * 最も遅い段で決まる
+ *
+ * - 段の間のキューは長さに上限があり、あふれた場合は最も古いフレームを捨てる。
+ *   同じソースのフレームが既に待っている場合はそちらを捨てる（遅れたフレームは処理しない）
+ * - 照合段はソースのImageMatcherの状態を更新するため、1つのスレッドだけで実行する。
+ *   前処理段はImageMatcher::prepare_frameを使う。照合段が書き換える縮小倍率などは
+ *   照合器が公開するスナップショットから読み、それ以外の照合器の設定は
+ *   flush_sourceでソースのフレームを片付けてから変更する
+ * - 捨てた・失敗したフレームはdiscardで通知する。discardはパイプラインのロック中に
+ *   呼ばれるため、その中からパイプラインを操作してはならない
+ */
+class DetectionPipeline {
+public:
+    enum class Stage {
+        CAPTURE,
+        PREPROCESS,
+        MATCH,
+        COUNT
+    };
+    static constexpr size_t kStageCount = static_cast<size_t>(Stage::COUNT);
+
+    using Clock = std::chrono::steady_clock;
+    using SourceId = uint64_t;
+
+    // 投入時点の検出設定（照合段は設定の更新と並行して動くため、ソースの設定値ではなくこちらを読む）
+    struct Settings {
+        float match_threshold = 0.8f;
+        int cooldown_ms = 0;
+        float audio_duration = -1.0f;               // 再生時間(秒) (0以下で全体)
+        bool learn_reference_size = false;          // 照合器が記録した基準の解像度を設定に保存するか
+    };
+
+    struct Frame {
+        SourceId source_id;
+        uint64_t tick;                              // 投入したビデオフレーム時刻
+        std::shared_ptr<CaptureTarget> target;      // 投入時点のキャプチャ対象
+        Settings settings;
+        CaptureTarget::Frame capture;
+        ImageMatcher::PreparedFrame prepared;
+        uint64_t cost_ns;                           // 各段の処理時間の合計
+        Clock::time_point submit_time;
+        Clock::time_point enqueue_time;             // 現在のキューに入った時刻
+    };
+
+    // ソースごとの各段の処理（ワーカースレッドから呼ばれる）
+    struct Handlers {
+        std::function<bool(Frame&)> capture;
+        std::function<bool(Frame&)> preprocess;
+        std::function<void(Frame&)> match;
+        std::function<void(const Frame&, Stage stage, bool dropped)> discard;   // 捨てた（dropped）・失敗したフレーム
+    };
+
+    struct StageStats {
+        uint64_t processed;             // 次の段へ渡した（照合段では完了した）フレーム数
+        uint64_t dropped;               // 入力キューがあふれて捨てたフレーム数
+        uint64_t failed;                // 処理に失敗したフレーム数（キャプチャ失敗など）
+        double throughput_fps;          // 計測開始からの平均処理レート
+        double utilization;             // ワーカーが処理していた時間の割合
+        double avg_queue_depth;         // 入力キューの平均の長さ（投入・取り出しのたびに標本化）
+        size_t max_queue_depth;
+        double avg_wait_ms;             // 入力キューで待った平均時間
+        double avg_process_ms;
+    };
+
+public:
+    static DetectionPipeline& instance();
+
+    // テスト・ベンチマーク用（通常はinstance()を使う）
+    DetectionPipeline();
+    ~DetectionPipeline();
+
+    DetectionPipeline(const DetectionPipeline&) = delete;
+    DetectionPipeline& operator=(const DetectionPipeline&) = delete;
+
+    // ソースの登録。unregister_sourceはそのソースの処理中のフレームが終わるまで待つ
+    SourceId register_source(const Handlers& handlers);
+    void unregister_source(SourceId id);
+
+    // 待機中のフレームを捨て、処理中のフレームが終わるまで待つ（設定変更の前などに呼ぶ）
+    void flush_source(SourceId id);
+
+    // フレームをキャプチャ段に投入する（ブロックしない）
+    bool submit(SourceId id, uint64_t tick, std::shared_ptr<CaptureTarget> target, const Settings& settings);
+
+    // 段の間のキューの長さの上限
+    void set_queue_capacity(size_t capacity);
+    size_t get_queue_capacity() const;
+
+    // ワーカースレッドの停止（プラグインのアンロード時）
+    void shutdown();
+
+    // 統計
+    std::array<StageStats, kStageCount> get_stats() const;
+    std::string to_json() const;
+    void log_summary() const;
+    void reset_stats();
+
+    static const char* get_stage_name(Stage stage);
+
+private:
+    struct Source {
+        Handlers handlers;
+        int busy;                       // ワーカーが処理中のフレーム数
+    };
+
+    struct StageState {
+        std::deque<Frame> queue;        // この段の入力キュー
+        std::condition_variable ready;
+        std::thread worker;
+
+        uint64_t processed;
+        uint64_t dropped;
+        uint64_t failed;
+        uint64_t busy_ns;
+        uint64_t wait_ns;
+        uint64_t dequeued;
+        uint64_t depth_samples;
+        uint64_t depth_sum;
+        size_t max_depth;
+    };
+
+    void start_workers_locked();
+    void worker_loop(size_t stage);
+    void push_locked(size_t stage, Frame&& frame);
+    void discard_locked(const Frame& frame, size_t stage, bool dropped);
+    void remove_queued_locked(SourceId id);
+    void sample_depth_locked(StageState& state);
+    void reset_stats_locked();
+
+private:
+    mutable std::mutex mutex_;
+    std::condition_variable idle_;      // ソースの処理中フレームが減ったとき
+    std::array<StageState, kStageCount> stages_;
+    std::map<SourceId, std::shared_ptr<Source>> sources_;
+    SourceId next_id_;
+    size_t queue_capacity_;
+    bool started_;
+    bool stopping_;
+    Clock::time_point stats_start_;
+};
@@ -0,0 +1,389 @@
+#include "detection-scheduler.h"
+#include "json-util.h"
+#include <obs-module.h>
+#include <algorithm>
+#include <limits>
+#include <sstream>
+
+namespace {
+
+const int64_t kNoTime = -1;
+const int64_t kNoDeadline = std::numeric_limits<int64_t>::max();
+
+// 予算の繰り越し上限（この秒数分まで貯められる）と、1フレームで補充する時間の上限
+const double kBurstSeconds = 0.1;
+const int64_t kMaxRefillNs = 100000000;
+
+// 実測コストの指数移動平均の重みと、まだ実行していないソースの推定コスト
+const double kCostSmoothing = 0.2;
+const double kInitialCostNs = 5000000.0;
+
+// 要求の間隔がこれより空いた期間は、達成レートの計算に含めない（クールダウン中など）
+const int64_t kMaxActiveGapNs = 250000000;
+
+// 達成レートを更新する計測期間
+const int64_t kRateWindowNs = 2000000000;
+
+// エージング: 周期が来てからこの時間待つごとに優先度を1段上げる（上限はHIGHより上の段まで）
+const int64_t kAgingStepNs = 1000000000;
+const int kMaxAgingLevel = 3;
+
+struct Candidate {
+    size_t index;
+    int64_t soft_deadline;      // 要求レートを守るための締め切り
+    int64_t hard_deadline;      // 最低レートを守るための締め切り
+    int level;                  // 優先度に待ち時間の分を足した段
+};
+
+} // namespace
+
+DetectionScheduler& DetectionScheduler::instance()
+{
+    static DetectionScheduler scheduler;
+    return scheduler;
+}
+
+DetectionScheduler::DetectionScheduler()
+    : next_id_(1)
+    , budget_ns_per_second_(0.0)
+    , bucket_ns_(0.0)
+    , last_tick_ns_(kNoTime)
+    , window_start_ns_(kNoTime)
+    , window_cost_ns_(0.0)
+    , cpu_ms_per_second_(0.0)
+{
+}
+
+void DetectionScheduler::set_budget(double cpu_ms_per_second)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    budget_ns_per_second_ = std::max(0.0, cpu_ms_per_second) * 1e6;
+    bucket_ns_ = budget_ns_per_second_ * kBurstSeconds;
+}
+
+double DetectionScheduler::get_budget() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return budget_ns_per_second_ / 1e6;
+}
+
+DetectionScheduler::ClientId DetectionScheduler::register_client(const std::string& name, const Request& request)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    Client client = {};
+    client.id = next_id_++;
+    client.name = name;
+    client.request = request;
+    client.next_due_ns = kNoTime;
+    client.last_run_ns = kNoTime;
+    client.last_request_ns = kNoTime;
+    client.estimated_cost_ns = kInitialCostNs;
+    clients_.push_back(client);
+    return client.id;
+}
+
+void DetectionScheduler::unregister_client(ClientId id)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = std::find_if(clients_.begin(), clients_.end(), [id](const Client& c) { return c.id == id; });
+    if (it == clients_.end()) return;
+
+    // 許可済みで使われなかった分は予算に戻す
+    if (it->granted && budget_ns_per_second_ > 0.0) {
+        bucket_ns_ += it->reserved_ns;
+    }
+    clients_.erase(it);
+}
+
+void DetectionScheduler::update_client(ClientId id, const std::string& name, const Request& request)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    Client* client = find_client(id);
+    if (!client) return;
+
+    client->name = name;
+    client->request = request;
+}
+
+bool DetectionScheduler::acquire_slot(ClientId id, int64_t now_ns)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (now_ns != last_tick_ns_) {
+        plan_tick(now_ns);
+    }
+
+    Client* client = find_client(id);
+    if (!client) return true;
+
+    if (client->last_request_ns != kNoTime && now_ns - client->last_request_ns <= kMaxActiveGapNs) {
+        client->active_ns += now_ns - client->last_request_ns;
+    }
+    client->last_request_ns = now_ns;
+    update_rate_window(*client);
+
+    // 初めて要求したソースは次のフレームから割り当ての対象になる
+    if (client->next_due_ns == kNoTime) {
+        client->next_due_ns = now_ns;
+        return false;
+    }
+
+    if (!client->granted) {
+        return false;
+    }
+
+    client->granted = false;
+    client->in_flight_ns.push_back(client->reserved_ns);
+    client->reserved_ns = 0.0;
+    const int64_t period = period_ns(client->request.rate_hz);
+    client->next_due_ns = std::max(client->next_due_ns + period, now_ns + period / 2);
+    client->last_run_ns = now_ns;
+    ++client->runs;
+    ++client->window_runs;
+    return true;
+}
+
+void DetectionScheduler::report_cost(ClientId id, uint64_t nanoseconds)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    Client* client = find_client(id);
+    if (!client) return;
+
+    const double cost = static_cast<double>(nanoseconds);
+    client->estimated_cost_ns = (client->runs <= 1) ? cost :
+        client->estimated_cost_ns + kCostSmoothing * (cost - client->estimated_cost_ns);
+    client->total_cost_ns += cost;
+    window_cost_ns_ += cost;
+
+    // 最も古い許可の確保分と実測コストの差を精算する
+    double reserved = 0.0;
+    if (!client->in_flight_ns.empty()) {
+        reserved = client->in_flight_ns.front();
+        client->in_flight_ns.pop_front();
+    }
+    if (budget_ns_per_second_ > 0.0) {
+        bucket_ns_ += reserved - cost;
+    }
+}
+
+void DetectionScheduler::plan_tick(int64_t now_ns)
+{
+    // 予算の補充
+    const int64_t elapsed = (last_tick_ns_ == kNoTime) ? 0 : std::clamp<int64_t>(now_ns - last_tick_ns_, 0, kMaxRefillNs);
+    const double burst_ns = budget_ns_per_second_ * kBurstSeconds;
+    bucket_ns_ = std::min(bucket_ns_ + budget_ns_per_second_ * elapsed / 1e9, burst_ns);
+
+    // 使用CPU時間の計測
+    if (window_start_ns_ == kNoTime) {
+        window_start_ns_ = now_ns;
+    } else if (now_ns - window_start_ns_ >= 1000000000) {
+        cpu_ms_per_second_ = window_cost_ns_ / 1e6 / ((now_ns - window_start_ns_) / 1e9);
+        window_start_ns_ = now_ns;
+        window_cost_ns_ = 0.0;
+    }
+
+    // 最近検出を要求したソースのうち、周期が来ているものが候補
+    last_tick_ns_ = now_ns;
+
+    std::vector<Candidate> forced;
+    std::vector<Candidate> candidates;
+    for (size_t i = 0; i < clients_.size(); ++i) {
+        Client& client = clients_[i];
+
+        // 許可したが使われなかった分は予算に戻す
+        if (client.granted) {
+            client.granted = false;
+            if (budget_ns_per_second_ > 0.0) bucket_ns_ += client.reserved_ns;
+            client.reserved_ns = 0.0;
+        }
+
+        if (client.next_due_ns == kNoTime || now_ns < client.next_due_ns ||
+            now_ns - client.last_request_ns > kMaxActiveGapNs) {
+            continue;
+        }
+
+        Candidate candidate;
+        candidate.index = i;
+        candidate.soft_deadline = client.next_due_ns + period_ns(client.request.rate_hz);
+        candidate.hard_deadline = kNoDeadline;
+        candidate.level = static_cast<int>(client.request.priority) +
+            static_cast<int>(std::min<int64_t>((now_ns - client.next_due_ns) / kAgingStepNs, kMaxAgingLevel));
+        if (client.request.min_rate_hz > 0.0) {
+            int64_t last_run = (client.last_run_ns == kNoTime) ? client.next_due_ns : client.last_run_ns;
+            candidate.hard_deadline = last_run + period_ns(client.request.min_rate_hz);
+        }
+
+        // 次のフレームまでに締め切りが来るものは今のフレームで実行する
+        if (budget_ns_per_second_ > 0.0 && candidate.hard_deadline <= now_ns + elapsed) {
+            forced.push_back(candidate);
+        } else {
+            candidates.push_back(candidate);
+        }
+    }
+
+    auto grant = [this](Client& client) {
+        client.granted = true;
+        client.reserved_ns = (budget_ns_per_second_ > 0.0) ? client.estimated_cost_ns : 0.0;
+        bucket_ns_ -= client.reserved_ns;
+    };
+
+    // 予算が無制限なら周期が来たソースをすべて実行する
+    if (budget_ns_per_second_ <= 0.0) {
+        for (const auto& candidate : candidates) grant(clients_[candidate.index]);
+        return;
+    }
+
+    // 最低レートの締め切りを過ぎたソースは予算を前借りしてでも実行する
+    std::sort(forced.begin(), forced.end(),
+              [](const Candidate& a, const Candidate& b) { return a.hard_deadline < b.hard_deadline; });
+    for (const auto& candidate : forced) {
+        Client& client = clients_[candidate.index];
+        grant(client);
+        ++client.forced;
+    }
+
+    // 優先度（エージング込み）、締め切りの順に予算の残りに収まるだけ実行する
+    std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) {
+        if (a.level != b.level) return a.level > b.level;
+        return a.soft_deadline < b.soft_deadline;
+    });
+    const int max_level = static_cast<int>(Priority::HIGH) + 1;
+    for (const auto& candidate : candidates) {
+        Client& client = clients_[candidate.index];
+        // HIGHより上の段まで待ったソースは、推定コストが予算の残りを超えていても前借りして実行する
+        // （推定コストが繰り越し上限より大きいソースが永久に実行されないのを防ぐ）
+        const bool starving = candidate.level >= max_level;
+        if (bucket_ns_ > 0.0 && (client.estimated_cost_ns <= bucket_ns_ || starving)) {
+            grant(client);
+        } else {
+            ++client.deferred;
+        }
+    }
+}
+
+void DetectionScheduler::update_rate_window(Client& client)
+{
+    if (client.active_ns < kRateWindowNs) return;
+
+    client.achieved_hz = client.window_runs / (client.active_ns / 1e9);
+    client.window_runs = 0;
+    client.active_ns = 0;
+}
+
+std::vector<DetectionScheduler::ClientStats> DetectionScheduler::get_stats() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<ClientStats> stats;
+    stats.reserve(clients_.size());
+    for (const auto& client : clients_) {
+        ClientStats entry;
+        entry.name = client.name;
+        entry.request = client.request;
+        // 計測期間が一度も終わっていなければ途中までの値を使う
+        entry.achieved_hz = client.achieved_hz;
+        if (entry.achieved_hz == 0.0 && client.active_ns > 0) {
+            entry.achieved_hz = client.window_runs / (client.active_ns / 1e9);
+        }
+        entry.runs = client.runs;
+        entry.deferred = client.deferred;
+        entry.forced = client.forced;
+        entry.avg_cost_ms = client.runs > 0 ? client.total_cost_ns / client.runs / 1e6 : 0.0;
+        stats.push_back(entry);
+    }
+    return stats;
+}
+
+double DetectionScheduler::get_cpu_ms_per_second() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return cpu_ms_per_second_;
+}
+
+std::string DetectionScheduler::to_json() const
+{
+    std::vector<ClientStats> stats = get_stats();
+
+    std::ostringstream json;
+    json << "{\"budget_ms_per_sec\": " << get_budget()
+         << ", \"cpu_ms_per_sec\": " << get_cpu_ms_per_second()
+         << ", \"sources\": [";
+    for (size_t i = 0; i < stats.size(); ++i) {
+        const ClientStats& entry = stats[i];
+        json << (i == 0 ? "" : ", ")
+             << "{\"source\": \"" << json_util::escape(entry.name) << "\""
+             << ", \"priority\": \"" << get_priority_name(entry.request.priority) << "\""
+             << ", \"requested_hz\": " << entry.request.rate_hz
+             << ", \"min_hz\": " << entry.request.min_rate_hz
+             << ", \"achieved_hz\": " << entry.achieved_hz
+             << ", \"runs\": " << entry.runs
+             << ", \"deferred\": " << entry.deferred
+             << ", \"forced\": " << entry.forced
+             << ", \"avg_cost_ms\": " << entry.avg_cost_ms << "}";
+    }
+    json << "]}";
+    return json.str();
+}
+
+void DetectionScheduler::log_summary() const
+{
+    std::vector<ClientStats> stats = get_stats();
+    blog(LOG_INFO, "[DetectionScheduler] budget=%.0fms/s used=%.1fms/s sources=%zu",
+         get_budget(), get_cpu_ms_per_second(), stats.size());
+    for (const auto& entry : stats) {
+        blog(LOG_INFO, "[DetectionScheduler] %s: %s requested=%.1fHz min=%.1fHz achieved=%.1fHz "
+                       "deferred=%llu forced=%llu cost=%.2fms",
+             entry.name.c_str(), get_priority_name(entry.request.priority),
+             entry.request.rate_hz, entry.request.min_rate_hz, entry.achieved_hz,
+             static_cast<unsigned long long>(entry.deferred),
+             static_cast<unsigned long long>(entry.forced), entry.avg_cost_ms);
+    }
+}
+
+void DetectionScheduler::reset_stats()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& client : clients_) {
+        client.runs = 0;
+        client.deferred = 0;
+        client.forced = 0;
+        client.active_ns = 0;
+        client.window_runs = 0;
+        client.achieved_hz = 0.0;
+        client.total_cost_ns = 0.0;
+    }
+    window_cost_ns_ = 0.0;
+    cpu_ms_per_second_ = 0.0;
+}
+
+const char* DetectionScheduler::get_priority_name(Priority priority)
+{
+    switch (priority) {
+        case Priority::LOW:    return "low";
+        case Priority::NORMAL: return "normal";
+        case Priority::HIGH:   return "high";
+        default:               return "unknown";
+    }
+}
+
+DetectionScheduler::Client* DetectionScheduler::find_client(ClientId id)
+{
+    for (auto& client : clients_) {
+        if (client.id == id) return &client;
+    }
+    return nullptr;
+}
+
+const DetectionScheduler::Client* DetectionScheduler::find_client(ClientId id) const
+{
+    for (const auto& client : clients_) {
+        if (client.id == id) return &client;
+    }
+    return nullptr;
+}
+
+int64_t DetectionScheduler::period_ns(double rate_hz)
+{
+    if (rate_hz <= 0.0) return 0;
+    return static_cast<int64_t>(1e9 / rate_hz);
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * プラグイン全体の検出スケジューラ
+ * 全ソースの検出処理に使うCPU時間の予算（1秒あたりのミリ秒）を、
+ * 優先度と締め切り（EDF）に基づいてビデオフレームごとに割り当てる
+ *
+ * - 各ソースは要求レート（Hz）と最低レートを持つ。要求レートの周期が来たソースが候補になる
+ * - 最低レートの締め切りを過ぎたソースは予算を超えても実行する（締め切り順）
+ * - 残りは優先度の高い順、同じ優先度では要求レートの締め切りが早い順に、
+ *   推定コスト（実測の指数移動平均）が予算の残りに収まる限り実行する
+ * - 実行できなかったソースは次のフレームで締め切りが近い候補として再評価される。
+ *   見送りが続いたソースは待った時間に応じて優先度を上げる（エージング）ため、
+ *   最低レートが0のソースも高い優先度のソースに予算を使い切られて止まることはない
+ * - 予算はacquire_slotで許可を使った時点の推定コストで確保し、report_costが
+ *   1回につき1件ずつ古い順に実測コストと精算する（パイプラインで報告が遅れても、次の許可の分は崩れない）
+ *
+ * 時刻はOBSのビデオフレーム時刻（ナノ秒）を渡す。同じ時刻での最初の呼び出しで
+ * そのフレームの割り当てを決める
+ */
+class DetectionScheduler {
+public:
+    enum class Priority {
+        LOW,
+        NORMAL,
+        HIGH
+    };
+
+    struct Request {
+        double rate_hz;                 // 要求レート
+        double min_rate_hz;             // 過負荷時にも保証したい最低レート
+        Priority priority;
+    };
+
+    struct ClientStats {
+        std::string name;
+        Request request;
+        double achieved_hz;             // 直近の計測期間に実際に実行できたレート
+        uint64_t runs;
+        uint64_t deferred;              // 周期が来ていたが予算不足で見送った回数
+        uint64_t forced;                // 最低レートの締め切りで予算を超えて実行した回数
+        double avg_cost_ms;
+    };
+
+    using ClientId = uint64_t;
+
+public:
+    static DetectionScheduler& instance();
+
+    // 予算（1秒あたりのCPUミリ秒、0で無制限）
+    void set_budget(double cpu_ms_per_second);
+    double get_budget() const;
+
+    // ソースの登録
+    ClientId register_client(const std::string& name, const Request& request);
+    void unregister_client(ClientId id);
+    void update_client(ClientId id, const std::string& name, const Request& request);
+
+    // 検出してよいか。trueを返した場合は処理後にreport_costを呼ぶ
+    bool acquire_slot(ClientId id, int64_t now_ns);
+    void report_cost(ClientId id, uint64_t nanoseconds);
+
+    // 統計
+    std::vector<ClientStats> get_stats() const;
+    double get_cpu_ms_per_second() const;   // 直近1秒間に検出処理で使ったCPU時間
+    std::string to_json() const;
+    void log_summary() const;
+    void reset_stats();
+
+    static const char* get_priority_name(Priority priority);
+
+    // テスト・ベンチマーク用（通常はinstance()を使う）
+    DetectionScheduler();
+
+private:
+    struct Client {
+        ClientId id;
+        std::string name;
+        Request request;
+
+        int64_t next_due_ns;            // 要求レートで次に実行する時刻
+        int64_t last_run_ns;            // 最後に実行した時刻（未実行は負）
+        double estimated_cost_ns;       // 実測コストの指数移動平均
+        bool granted;                   // 現在のフレームで実行を許可したか
+        double reserved_ns;             // 許可時に予算から差し引いた推定コスト（まだ使われていない分）
+        std::deque<double> in_flight_ns;  // 使われた許可ごとの確保分（report_costで古い順に精算する）
+
+        // 統計
+        uint64_t runs;
+        uint64_t deferred;
+        uint64_t forced;
+        int64_t last_request_ns;
+        int64_t active_ns;              // 計測期間中に検出を要求していた時間
+        uint64_t window_runs;
+        double achieved_hz;
+        double total_cost_ns;
+    };
+
+    Client* find_client(ClientId id);
+    const Client* find_client(ClientId id) const;
+    void plan_tick(int64_t now_ns);
+    void update_rate_window(Client& client);
+
+    static int64_t period_ns(double rate_hz);
+
+private:
+    mutable std::mutex mutex_;
+    std::vector<Client> clients_;
+    ClientId next_id_;
+
+    double budget_ns_per_second_;
+    double bucket_ns_;                  // 使用可能なCPU時間（負は前借り）
+    int64_t last_tick_ns_;
+
+    // 使用CPU時間の計測
+    int64_t window_start_ns_;
+    double window_cost_ns_;
+    double cpu_ms_per_second_;
+};
@@ -0,0 +1,273 @@
+#include "fft-correlator.h"
+#include "profiler.h"
+#include <obs-module.h>
+#include <opencv2/imgproc.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <mutex>
+
+namespace {
+
+// 窓内の画素分散がこれ未満（ほぼ単色）の位置は相関0とする
+const double kMinWindowVariance = 0.01;
+
+// 異なる探索サイズが混在してもメモリが増え続けないようにする
+const size_t kMaxCachedSpectra = 4;
+
+// 較正前の既定値（Core i7クラスでの実測値）
+const FftCorrelator::CostModel kDefaultCostModel = {0.08, 4.0, 6.0};
+
+std::mutex g_cost_model_mutex;
+bool g_cost_model_ready = false;
+FftCorrelator::CostModel g_cost_model = kDefaultCostModel;
+
+template <typename Func>
+double measure_min_ns(Func&& func, int repeat)
+{
+    double best = 0.0;
+    for (int i = 0; i < repeat; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        func();
+        auto end = std::chrono::steady_clock::now();
+        double elapsed = static_cast<double>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+        best = (i == 0) ? elapsed : std::min(best, elapsed);
+    }
+    return best;
+}
+
+} // namespace
+
+FftCorrelator::FftCorrelator()
+    : template_norm_(0.0)
+{
+}
+
+bool FftCorrelator::set_template(const cv::Mat& template_image)
+{
+    reset();
+
+    if (template_image.empty() || template_image.channels() != 1) {
+        return false;
+    }
+
+    template_image.convertTo(template_, CV_32F);
+    template_ -= cv::mean(template_)[0];
+    template_norm_ = cv::norm(template_, cv::NORM_L2);
+
+    // 単色のテンプレートは正規化できない
+    if (template_norm_ < 1e-3) {
+        template_.release();
+        return false;
+    }
+
+    template_size_ = template_.size();
+    return true;
+}
+
+void FftCorrelator::reset()
+{
+    template_.release();
+    template_size_ = cv::Size();
+    template_norm_ = 0.0;
+    spectra_.clear();
+}
+
+void FftCorrelator::prepare(cv::Size image_size)
+{
+    if (!is_ready() || image_size.width < template_size_.width || image_size.height < template_size_.height) {
+        return;
+    }
+    get_template_spectrum(get_dft_size(image_size));
+}
+
+bool FftCorrelator::correlate(const cv::Mat& image, cv::Mat& result)
+{
+    if (!is_ready() || image.empty() || image.channels() != 1 ||
+        image.cols < template_size_.width || image.rows < template_size_.height) {
+        return false;
+    }
+
+    PROFILE_ZONE("fft_correlate");
+
+    cv::Size result_size(image.cols - template_size_.width + 1, image.rows - template_size_.height + 1);
+    cv::Size dft_size = get_dft_size(image.size());
+    const cv::Mat& template_spectrum = get_template_spectrum(dft_size);
+
+    // 対象画像を作業バッファに配置（余白は0）
+    padded_.create(dft_size, CV_32F);
+    image.convertTo(padded_(cv::Rect(0, 0, image.cols, image.rows)), CV_32F);
+    if (dft_size.width > image.cols) {
+        padded_(cv::Rect(image.cols, 0, dft_size.width - image.cols, image.rows)).setTo(0);
+    }
+    if (dft_size.height > image.rows) {
+        padded_(cv::Rect(0, image.rows, dft_size.width, dft_size.height - image.rows)).setTo(0);
+    }
+
+    // 相関 = IDFT(F(画像) × conj(F(テンプレート)))
+    // 有効領域は循環しないため、DFTサイズは画像サイズ以上であればよい
+    cv::dft(padded_, image_spectrum_, 0, image.rows);
+    cv::mulSpectrums(image_spectrum_, template_spectrum, product_, 0, true);
+    cv::dft(product_, correlation_, cv::DFT_INVERSE | cv::DFT_SCALE | cv::DFT_REAL_OUTPUT, result_size.height);
+
+    result.create(result_size, CV_32F);
+    normalize(image, result);
+    return true;
+}
+
+size_t FftCorrelator::get_memory_usage() const
+{
+    auto mat_bytes = [](const cv::Mat& mat) { return mat.total() * mat.elemSize(); };
+
+    size_t bytes = mat_bytes(template_) + mat_bytes(padded_) + mat_bytes(image_spectrum_) +
+                   mat_bytes(product_) + mat_bytes(correlation_) + mat_bytes(sum_) + mat_bytes(sqsum_);
+    for (const auto& entry : spectra_) {
+        bytes += mat_bytes(entry.second);
+    }
+    return bytes;
+}
+
+FftCorrelator::CostModel FftCorrelator::get_cost_model()
+{
+    std::lock_guard<std::mutex> lock(g_cost_model_mutex);
+    if (!g_cost_model_ready) {
+        g_cost_model = calibrate();
+        g_cost_model_ready = true;
+    }
+    return g_cost_model;
+}
+
+void FftCorrelator::set_cost_model(const CostModel& model)
+{
+    std::lock_guard<std::mutex> lock(g_cost_model_mutex);
+    g_cost_model = model;
+    g_cost_model_ready = true;
+}
+
+FftCorrelator::CostModel FftCorrelator::calibrate()
+{
+    CostModel model = kDefaultCostModel;
+
+    try {
+        // HUD程度の探索範囲と中程度のテンプレートで両方式を実測する
+        cv::Mat image(360, 640, CV_8U);
+        cv::randu(image, 0, 256);
+        cv::Mat template_image = image(cv::Rect(200, 120, 128, 48)).clone();
+        cv::Mat result;
+
+        double spatial_ns = measure_min_ns([&]() {
+            cv::matchTemplate(image, template_image, result, cv::TM_CCOEFF_NORMED);
+        }, 3);
+
+        double integral_ns = measure_min_ns([&]() {
+            cv::Mat sum, sqsum;
+            cv::integral(image, sum, sqsum, CV_64F, CV_64F);
+        }, 3);
+
+        FftCorrelator correlator;
+        correlator.set_template(template_image);
+        correlator.prepare(image.size());
+        double fft_ns = measure_min_ns([&]() { correlator.correlate(image, result); }, 3);
+
+        double pixels = static_cast<double>(image.total());
+        double dft_pixels = static_cast<double>(get_dft_size(image.size()).area());
+
+        // 正規化は積分画像の計算と同程度の走査2回分とみなす
+        model.pixel_ns = 2.0 * integral_ns / pixels;
+        model.spatial_ns_per_op = spatial_ns / estimate_spatial_cost(image.size(), template_image.size(),
+                                                                     {1.0, 0.0, 0.0});
+        model.fft_ns_per_op = std::max(0.0, fft_ns - model.pixel_ns * pixels) /
+                              (2.0 * dft_pixels * std::log2(dft_pixels));
+
+        blog(LOG_INFO, "[FftCorrelator] Cost model calibrated - spatial: %.4f ns/op, fft: %.4f ns/op, pixel: %.3f ns",
+             model.spatial_ns_per_op, model.fft_ns_per_op, model.pixel_ns);
+    }
+    catch (const cv::Exception& e) {
+        blog(LOG_WARNING, "[FftCorrelator] Calibration failed, using default cost model: %s", e.what());
+        model = kDefaultCostModel;
+    }
+
+    return model;
+}
+
+double FftCorrelator::estimate_spatial_cost(cv::Size image_size, cv::Size template_size, const CostModel& model)
+{
+    double result_pixels = static_cast<double>(image_size.width - template_size.width + 1) *
+                           static_cast<double>(image_size.height - template_size.height + 1);
+    return model.spatial_ns_per_op * std::max(0.0, result_pixels) * template_size.area();
+}
+
+double FftCorrelator::estimate_fft_cost(cv::Size image_size, const CostModel& model)
+{
+    // 順変換と逆変換の2回分
+    double dft_pixels = static_cast<double>(get_dft_size(image_size).area());
+    return model.fft_ns_per_op * 2.0 * dft_pixels * std::log2(std::max(2.0, dft_pixels)) +
+           model.pixel_ns * image_size.area();
+}
+
+bool FftCorrelator::prefers_fft(cv::Size image_size, cv::Size template_size)
+{
+    CostModel model = get_cost_model();
+    return estimate_fft_cost(image_size, model) < estimate_spatial_cost(image_size, template_size, model);
+}
+
+cv::Size FftCorrelator::get_dft_size(cv::Size image_size)
+{
+    return cv::Size(cv::getOptimalDFTSize(image_size.width), cv::getOptimalDFTSize(image_size.height));
+}
+
+const cv::Mat& FftCorrelator::get_template_spectrum(cv::Size dft_size)
+{
+    auto key = std::make_pair(dft_size.width, dft_size.height);
+    auto it = spectra_.find(key);
+    if (it != spectra_.end()) {
+        return it->second;
+    }
+
+    if (spectra_.size() >= kMaxCachedSpectra) {
+        spectra_.clear();
+    }
+
+    PROFILE_ZONE("fft_template_spectrum");
+    cv::Mat padded = cv::Mat::zeros(dft_size, CV_32F);
+    template_.copyTo(padded(cv::Rect(cv::Point(0, 0), template_size_)));
+
+    cv::Mat& spectrum = spectra_[key];
+    cv::dft(padded, spectrum, 0, template_size_.height);
+    return spectrum;
+}
+
+void FftCorrelator::normalize(const cv::Mat& image, cv::Mat& result)
+{
+    // テンプレートは平均0なので、分子は生の相関そのままでよい
+    // 分母の窓内の分散は積分画像から求める
+    cv::integral(image, sum_, sqsum_, CV_64F, CV_64F);
+
+    const int tw = template_size_.width;
+    const int th = template_size_.height;
+    const double inv_area = 1.0 / (static_cast<double>(tw) * th);
+    const double min_variance = kMinWindowVariance * tw * th;
+
+    for (int y = 0; y < result.rows; ++y) {
+        const double* sum_top = sum_.ptr<double>(y);
+        const double* sum_bottom = sum_.ptr<double>(y + th);
+        const double* sq_top = sqsum_.ptr<double>(y);
+        const double* sq_bottom = sqsum_.ptr<double>(y + th);
+        const float* correlation = correlation_.ptr<float>(y);
+        float* out = result.ptr<float>(y);
+
+        for (int x = 0; x < result.cols; ++x) {
+            double window_sum = sum_bottom[x + tw] - sum_bottom[x] - sum_top[x + tw] + sum_top[x];
+            double window_sq = sq_bottom[x + tw] - sq_bottom[x] - sq_top[x + tw] + sq_top[x];
+            double variance = window_sq - window_sum * window_sum * inv_area;
+
+            if (variance < min_variance) {
+                out[x] = 0.0f;
+            } else {
+                double value = correlation[x] / (std::sqrt(variance) * template_norm_);
+                out[x] = static_cast<float>(std::clamp(value, -1.0, 1.0));
+            }
+        }
+    }
+}
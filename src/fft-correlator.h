@@ -0,0 +1,72 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <map>
+#include <utility>
+
+/**
+ * FFTによる正規化相互相関（TM_CCOEFF_NORMED相当）
+ * 平均を引いたテンプレートのスペクトルをDFTサイズごとにキャッシュし、
+ * フレームごとの処理は対象画像の順変換・逆変換と積分画像による正規化のみで行う
+ * 単一チャンネル画像のみ対応
+ */
+class FftCorrelator {
+public:
+    /**
+     * 空間法（cv::matchTemplate）とFFT法の処理時間の推定モデル
+     * 空間法: 結果画素数 × テンプレート画素数 に比例
+     * FFT法: N・log2(N)（NはDFTサイズの画素数）と画素数に比例
+     */
+    struct CostModel {
+        double spatial_ns_per_op;
+        double fft_ns_per_op;
+        double pixel_ns;
+    };
+
+public:
+    FftCorrelator();
+
+    // テンプレートの設定（平均を引いて保持する）
+    bool set_template(const cv::Mat& template_image);
+    void reset();
+    bool is_ready() const { return !template_.empty(); }
+    cv::Size get_template_size() const { return template_size_; }
+
+    // 指定サイズの画像用のスペクトルを事前に計算する
+    void prepare(cv::Size image_size);
+
+    // 相関の計算（結果はcv::matchTemplateと同じサイズ・形式）
+    bool correlate(const cv::Mat& image, cv::Mat& result);
+
+    size_t get_memory_usage() const;
+
+    // コストモデル（初回呼び出し時に一度だけ実測で較正する）
+    static CostModel get_cost_model();
+    static void set_cost_model(const CostModel& model);
+    static CostModel calibrate();
+    static double estimate_spatial_cost(cv::Size image_size, cv::Size template_size, const CostModel& model);
+    static double estimate_fft_cost(cv::Size image_size, const CostModel& model);
+    static bool prefers_fft(cv::Size image_size, cv::Size template_size);
+
+private:
+    static cv::Size get_dft_size(cv::Size image_size);
+    const cv::Mat& get_template_spectrum(cv::Size dft_size);
+    void normalize(const cv::Mat& image, cv::Mat& result);
+
+private:
+    // 平均を引いたテンプレート（CV_32F）とそのノルム
+    cv::Mat template_;
+    cv::Size template_size_;
+    double template_norm_;
+
+    // DFTサイズごとのテンプレートスペクトル
+    std::map<std::pair<int, int>, cv::Mat> spectra_;
+
+    // フレーム間で再利用する作業バッファ
+    cv::Mat padded_;
+    cv::Mat image_spectrum_;
+    cv::Mat product_;
+    cv::Mat correlation_;
+    cv::Mat sum_;
+    cv::Mat sqsum_;
+};
@@ -1,10 +1,23 @@
 #include "game-audio-trigger.h"
+#include "activity-monitor.h"
 #include "image-matcher.h"
 #include "audio-player.h"
-#include "process-detector.h"
+#include "capture-hub.h"
+#include "detection-pipeline.h"
+#include "detection-scheduler.h"
+#include "latency-tracer.h"
+#include "metrics.h"
+#include "profiler.h"
+#include "template-bundle.h"
+#include "template-cache.h"
+#include "debug-overlay.h"
 #include <obs-module.h>
 #include <util/platform.h>
+#include <algorithm>
 #include <cstdarg>
+#include <tuple>
+
+static DetectionPipeline::Handlers make_pipeline_handlers(game_audio_trigger_data *context);
 
 // ソース名の取得
 const char *game_audio_trigger_get_name(void *unused)
@@ -26,16 +39,26 @@ void *game_audio_trigger_create(obs_data_t *settings, obs_source_t *source)
     context->source = source;
     context->frame_width = 1920;
     context->frame_height = 1080;
-    context->output_texture = nullptr;
     context->is_process_running = false;
     context->is_template_loaded = false;
+    context->settings_applied = false;
     context->last_trigger_time = std::chrono::steady_clock::now();
+    context->learned_reference_size = 0;
 
     // コンポーネントの初期化
     try {
         context->image_matcher = std::make_unique<ImageMatcher>();
         context->audio_player = std::make_unique<AudioPlayer>();
-        context->process_detector = std::make_unique<ProcessDetector>();
+        context->latency_tracer = std::make_unique<LatencyTracer>();
+        context->debug_overlay = std::make_unique<DebugOverlay>();
+        context->activity = std::make_unique<SourceActivity>();
+        context->activity->set_showing(obs_source_showing(source));
+        context->activity->set_active(obs_source_active(source));
+        context->metrics = MetricsRegistry::instance().register_source(obs_source_get_name(source));
+        context->scheduler_id = DetectionScheduler::instance().register_client(
+            obs_source_get_name(source), {DEFAULT_DETECTION_RATE, DEFAULT_MIN_DETECTION_RATE,
+                                          DetectionScheduler::Priority::NORMAL});
+        context->pipeline_id = DetectionPipeline::instance().register_source(make_pipeline_handlers(context));
 
         if (!context->audio_player->initialize()) {
             blog(LOG_WARNING, "[Game Audio Trigger] Failed to initialize audio player");
@@ -60,13 +83,15 @@ void game_audio_trigger_destroy(void *data)
     auto *context = static_cast<game_audio_trigger_data*>(data);
     if (!context) return;
 
-    // OpenGLテクスチャの解放
-    obs_enter_graphics();
-    if (context->output_texture) {
-        gs_texture_destroy(context->output_texture);
-        context->output_texture = nullptr;
+    // パイプラインで処理中のフレームが終わるのを待つ（以降はワーカーからcontextに触れない）
+    DetectionPipeline::instance().unregister_source(context->pipeline_id);
+
+    // デバッグ表示用テクスチャの解放
+    if (context->debug_overlay) {
+        obs_enter_graphics();
+        context->debug_overlay->release_graphics();
+        obs_leave_graphics();
     }
-    obs_leave_graphics();
 
     // オーディオプレイヤーの停止
     if (context->audio_player) {
@@ -74,24 +99,57 @@ void game_audio_trigger_destroy(void *data)
         context->audio_player->shutdown();
     }
 
+    // 読み込み中のテンプレートは完了を待って捨てる
+    if (context->pending_matcher.valid()) {
+        context->pending_matcher.wait();
+    }
+
     // コンポーネントの破棄
     context->image_matcher.reset();
     context->audio_player.reset();
-    context->process_detector.reset();
+    CaptureHub::instance().unsubscribe(context->capture_target);
+    DetectionScheduler::instance().unregister_client(context->scheduler_id);
+    context->latency_tracer.reset();
+    context->debug_overlay.reset();
+    context->activity.reset();
+    MetricsRegistry::instance().unregister_source(context->metrics);
+    context->metrics.reset();
 
     blog(LOG_INFO, "[Game Audio Trigger] Source destroyed");
     delete context;
 }
 
-// 設定の更新
+// ImageMatcherに反映するマッチング設定（変更の検出用）
+static auto get_matcher_settings(const game_audio_trigger_data *context)
+{
+    return std::make_tuple(context->match_method, context->feature_detector, context->max_keypoints,
+                           context->correlation_backend, context->presence_only, context->working_scale,
+                           context->max_matches, context->cascade_filter, context->auto_scale,
+                           context->reference_width, context->reference_height, context->rotation_tolerance,
+                           context->search_x, context->search_y, context->search_width, context->search_height);
+}
+
+// 設定の更新（変わった項目だけを反映し、テンプレートの読み込みは別スレッドで行う）
 void game_audio_trigger_update(void *data, obs_data_t *settings)
 {
     auto *context = static_cast<game_audio_trigger_data*>(data);
     if (!context) return;
 
+    // 変更前の値
+    const bool first_update = !context->settings_applied;
+    const auto previous_matcher_settings = get_matcher_settings(context);
+    const std::string previous_audio_file = context->audio_file_path;
+    const bool previous_pipeline_enabled = context->pipeline_enabled;
+
     // 設定値の読み込み
     context->target_process_name = obs_data_get_string(settings, SETTING_PROCESS_NAME);
     context->template_image_path = obs_data_get_string(settings, SETTING_TEMPLATE_IMAGE);
+    const std::string template_name = obs_data_get_string(settings, SETTING_TEMPLATE_NAME);
+    std::string bundle_file, bundle_entry;
+    if (!template_name.empty() && TemplateBundle::split_path(context->template_image_path, bundle_file, bundle_entry)) {
+        // バンドル内のテンプレート（"bundle.gatb#name"）
+        context->template_image_path = bundle_file + "#" + template_name;
+    }
     context->audio_file_path = obs_data_get_string(settings, SETTING_AUDIO_FILE);
     
     context->match_threshold = static_cast<float>(obs_data_get_double(settings, SETTING_MATCH_THRESHOLD));
@@ -102,41 +160,169 @@ void game_audio_trigger_update(void *data, obs_data_t *settings)
     
     context->is_enabled = obs_data_get_bool(settings, SETTING_ENABLED);
     context->debug_mode = obs_data_get_bool(settings, SETTING_DEBUG_MODE);
+    context->activity_mode = static_cast<int>(obs_data_get_int(settings, SETTING_ACTIVITY_MODE));
+
+    context->match_method = static_cast<int>(obs_data_get_int(settings, SETTING_MATCH_METHOD));
+    context->feature_detector = static_cast<int>(obs_data_get_int(settings, SETTING_FEATURE_DETECTOR));
+    context->max_keypoints = static_cast<int>(obs_data_get_int(settings, SETTING_MAX_KEYPOINTS));
+    context->correlation_backend = static_cast<int>(obs_data_get_int(settings, SETTING_CORRELATION_BACKEND));
+    context->presence_only = obs_data_get_bool(settings, SETTING_PRESENCE_ONLY);
+    context->working_scale = static_cast<float>(obs_data_get_double(settings, SETTING_WORKING_SCALE));
+    context->max_matches = static_cast<int>(obs_data_get_int(settings, SETTING_MAX_MATCHES));
+    context->cascade_filter = obs_data_get_bool(settings, SETTING_CASCADE_FILTER);
+    context->auto_scale = obs_data_get_bool(settings, SETTING_AUTO_SCALE);
+    context->reference_width = static_cast<int>(obs_data_get_int(settings, SETTING_REFERENCE_WIDTH));
+    context->reference_height = static_cast<int>(obs_data_get_int(settings, SETTING_REFERENCE_HEIGHT));
+    context->rotation_tolerance = static_cast<float>(obs_data_get_double(settings, SETTING_ROTATION_TOLERANCE));
+    context->detection_rate = static_cast<int>(obs_data_get_int(settings, SETTING_DETECTION_RATE));
+    context->min_detection_rate = static_cast<int>(obs_data_get_int(settings, SETTING_MIN_DETECTION_RATE));
+    context->detection_priority = static_cast<int>(obs_data_get_int(settings, SETTING_DETECTION_PRIORITY));
+    context->pipeline_enabled = obs_data_get_bool(settings, SETTING_PIPELINE_ENABLED);
+    context->search_x = static_cast<int>(obs_data_get_int(settings, SETTING_SEARCH_X));
+    context->search_y = static_cast<int>(obs_data_get_int(settings, SETTING_SEARCH_Y));
+    context->search_width = static_cast<int>(obs_data_get_int(settings, SETTING_SEARCH_WIDTH));
+    context->search_height = static_cast<int>(obs_data_get_int(settings, SETTING_SEARCH_HEIGHT));
 
-    // プロセス設定の更新
-    if (!context->target_process_name.empty() && context->process_detector) {
-        context->process_detector->set_target_process(context->target_process_name);
-        log_debug(context, "Target process set to: %s", context->target_process_name.c_str());
+    const bool matcher_changed = first_update || get_matcher_settings(context) != previous_matcher_settings;
+    const bool audio_changed = first_update || context->audio_file_path != previous_audio_file ||
+                               (!context->audio_file_path.empty() && context->audio_player &&
+                                !context->audio_player->is_file_loaded());
+    const bool pipeline_toggled = context->pipeline_enabled != previous_pipeline_enabled;
+
+    // 照合スレッドが使っている照合器・音声を変更する場合と、同期処理との切り替え（残ったフレームと
+    // 同期処理が照合器・レイテンシトレーサーを同時に使わないように）だけ、パイプラインのフレームを片付ける
+    // （閾値・クールダウン・再生時間は投入時にフレームへ写し、音量・速度はAudioPlayerがロックで保護する）
+    if (matcher_changed || audio_changed || pipeline_toggled) {
+        DetectionPipeline::instance().flush_source(context->pipeline_id);
     }
 
-    // テンプレート画像の読み込み
-    if (!context->template_image_path.empty() && context->image_matcher) {
-        if (context->image_matcher->load_template(context->template_image_path)) {
-            context->is_template_loaded = true;
-            log_debug(context, "Template image loaded: %s", context->template_image_path.c_str());
-        } else {
-            context->is_template_loaded = false;
-            blog(LOG_WARNING, "[Game Audio Trigger] Failed to load template image: %s", 
-                 context->template_image_path.c_str());
+    if (!context->debug_mode && context->debug_overlay) {
+        context->debug_overlay->clear();
+    }
+
+    if (context->activity) {
+        context->activity->set_mode(static_cast<SourceActivity::Mode>(
+            std::clamp(context->activity_mode, 0, static_cast<int>(SourceActivity::Mode::WHEN_LIVE))));
+    }
+
+    // プロセス設定の更新（監視とキャプチャは同じプロセスを対象とするソースで共有する）
+    // 休止してキャプチャを解放している間は購読せず、再開時にtarget_process_nameで購読する
+    const std::string process_key = CaptureHub::make_key(context->target_process_name);
+    const bool capture_released = context->activity && context->activity->is_released();
+    if (!capture_released && (!context->capture_target ||
+        CaptureHub::make_key(context->capture_target->get_process_name()) != process_key)) {
+        CaptureHub::instance().unsubscribe(context->capture_target);
+        context->capture_target = CaptureHub::instance().subscribe(context->target_process_name);
+        if (context->capture_target) {
+            log_debug(context, "Target process set to: %s", context->target_process_name.c_str());
         }
     }
 
-    // オーディオファイルの読み込み
-    if (!context->audio_file_path.empty() && context->audio_player) {
-        if (context->audio_player->load_audio_file(context->audio_file_path)) {
-            context->audio_player->set_volume(context->audio_volume);
-            context->audio_player->set_speed(context->audio_speed);
-            log_debug(context, "Audio file loaded: %s", context->audio_file_path.c_str());
-        } else {
-            blog(LOG_WARNING, "[Game Audio Trigger] Failed to load audio file: %s",
-                 context->audio_file_path.c_str());
+    // マッチング設定の適用（読み込み済みのテンプレートから反映する）
+    if (matcher_changed && context->image_matcher) {
+        apply_matcher_settings(context, *context->image_matcher);
+    }
+
+    // テンプレート画像（パスかファイルが変わった場合だけ読み込む。読み込み中は現在の照合器で検出を続ける）
+    if (!context->template_image_path.empty() && context->image_matcher &&
+        context->pending_template_path != context->template_image_path &&
+        !context->image_matcher->is_template_current(context->template_image_path)) {
+        if (!context->pending_matcher.valid()) {
+            start_template_load(context);
+        }
+        // 別のファイルを読み込み中であれば、完了時にpoll_template_loadが読み直す
+    }
+
+    // オーディオファイルの読み込み（パスが変わった場合のみ。音量と速度は毎回反映する）
+    if (context->audio_player) {
+        if (audio_changed && !context->audio_file_path.empty()) {
+            if (context->audio_player->load_audio_file(context->audio_file_path)) {
+                log_debug(context, "Audio file loaded: %s", context->audio_file_path.c_str());
+            } else {
+                blog(LOG_WARNING, "[Game Audio Trigger] Failed to load audio file: %s",
+                     context->audio_file_path.c_str());
+            }
         }
+        context->audio_player->set_volume(context->audio_volume);
+        context->audio_player->set_speed(context->audio_speed);
     }
 
-    log_debug(context, "Settings updated - Enabled: %s, Threshold: %.2f, Volume: %.2f",
+    if (context->metrics) {
+        context->metrics->set_name(obs_source_get_name(context->source));
+    }
+
+    // 検出スケジューラへの要求（最低レートは要求レートを超えない）
+    DetectionScheduler::Request request;
+    request.rate_hz = std::max(1, context->detection_rate);
+    request.min_rate_hz = std::clamp(context->min_detection_rate, 0, static_cast<int>(request.rate_hz));
+    request.priority = static_cast<DetectionScheduler::Priority>(
+        std::clamp(context->detection_priority, 0, static_cast<int>(DetectionScheduler::Priority::HIGH)));
+    DetectionScheduler::instance().update_client(context->scheduler_id, obs_source_get_name(context->source), request);
+    update_memory_metrics(context);
+    context->settings_applied = true;
+
+    log_debug(context, "Settings updated - Enabled: %s, Threshold: %.2f, Volume: %.2f, Matcher: %s, Audio: %s",
               context->is_enabled ? "true" : "false",
               context->match_threshold,
-              context->audio_volume);
+              context->audio_volume,
+              matcher_changed ? "changed" : "unchanged",
+              audio_changed ? "changed" : "unchanged");
+}
+
+// テンプレートを別スレッドで読み込む（デコード・特徴点抽出・相関テンプレートの準備を含む）
+void start_template_load(game_audio_trigger_data *context)
+{
+    if (!context || context->template_image_path.empty() || context->pending_matcher.valid()) return;
+
+    // 照合器の作成と設定の反映は軽いため、ここで行ってから読み込みだけを任せる
+    auto matcher = std::make_unique<ImageMatcher>();
+    apply_matcher_settings(context, *matcher);
+
+    const std::string path = context->template_image_path;
+    context->pending_template_path = path;
+    context->pending_matcher = std::async(std::launch::async,
+        [path, matcher = std::move(matcher)]() mutable {
+            PROFILE_ZONE("template_load");
+            matcher->load_template(path);
+            return std::move(matcher);
+        });
+}
+
+// 読み込みが終わっていれば照合器を差し替える（ビデオスレッドから呼ぶ）
+void poll_template_load(game_audio_trigger_data *context)
+{
+    if (!context || !context->pending_matcher.valid() ||
+        context->pending_matcher.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+        return;
+    }
+
+    std::unique_ptr<ImageMatcher> matcher = context->pending_matcher.get();
+    const std::string path = context->pending_template_path;
+    context->pending_template_path.clear();
+
+    // 読み込み中に別のファイルが指定された場合は、結果を捨てて読み直す
+    if (path != context->template_image_path) {
+        if (!context->template_image_path.empty() && context->image_matcher &&
+            !context->image_matcher->is_template_current(context->template_image_path)) {
+            start_template_load(context);
+        }
+        return;
+    }
+
+    if (!matcher || !matcher->is_template_loaded()) {
+        context->is_template_loaded = false;
+        blog(LOG_WARNING, "[Game Audio Trigger] Failed to load template image: %s", path.c_str());
+        return;
+    }
+
+    // 読み込み中に変わったマッチング設定を反映し、照合中のフレームが終わってから差し替える
+    apply_matcher_settings(context, *matcher);
+    DetectionPipeline::instance().flush_source(context->pipeline_id);
+    context->image_matcher = std::move(matcher);
+    context->is_template_loaded = true;
+    update_memory_metrics(context);
+
+    log_debug(context, "Template image loaded: %s", path.c_str());
 }
 
 // デフォルト設定
@@ -144,6 +330,7 @@ void game_audio_trigger_get_defaults(obs_data_t *settings)
 {
     obs_data_set_string(settings, SETTING_PROCESS_NAME, "");
     obs_data_set_string(settings, SETTING_TEMPLATE_IMAGE, "");
+    obs_data_set_string(settings, SETTING_TEMPLATE_NAME, "");
     obs_data_set_string(settings, SETTING_AUDIO_FILE, "");
     
     obs_data_set_double(settings, SETTING_MATCH_THRESHOLD, DEFAULT_MATCH_THRESHOLD);
@@ -153,7 +340,29 @@ void game_audio_trigger_get_defaults(obs_data_t *settings)
     obs_data_set_int(settings, SETTING_COOLDOWN_MS, DEFAULT_COOLDOWN_MS);
     
     obs_data_set_bool(settings, SETTING_ENABLED, DEFAULT_ENABLED);
+    obs_data_set_int(settings, SETTING_ACTIVITY_MODE, DEFAULT_ACTIVITY_MODE);
     obs_data_set_bool(settings, SETTING_DEBUG_MODE, DEFAULT_DEBUG_MODE);
+
+    obs_data_set_int(settings, SETTING_MATCH_METHOD, DEFAULT_MATCH_METHOD);
+    obs_data_set_int(settings, SETTING_FEATURE_DETECTOR, DEFAULT_FEATURE_DETECTOR);
+    obs_data_set_int(settings, SETTING_MAX_KEYPOINTS, DEFAULT_MAX_KEYPOINTS);
+    obs_data_set_int(settings, SETTING_CORRELATION_BACKEND, DEFAULT_CORRELATION_BACKEND);
+    obs_data_set_bool(settings, SETTING_PRESENCE_ONLY, DEFAULT_PRESENCE_ONLY);
+    obs_data_set_double(settings, SETTING_WORKING_SCALE, DEFAULT_WORKING_SCALE);
+    obs_data_set_int(settings, SETTING_MAX_MATCHES, DEFAULT_MAX_MATCHES);
+    obs_data_set_bool(settings, SETTING_CASCADE_FILTER, DEFAULT_CASCADE_FILTER);
+    obs_data_set_bool(settings, SETTING_AUTO_SCALE, DEFAULT_AUTO_SCALE);
+    obs_data_set_int(settings, SETTING_REFERENCE_WIDTH, 0);
+    obs_data_set_int(settings, SETTING_REFERENCE_HEIGHT, 0);
+    obs_data_set_double(settings, SETTING_ROTATION_TOLERANCE, DEFAULT_ROTATION_TOLERANCE);
+    obs_data_set_int(settings, SETTING_DETECTION_RATE, DEFAULT_DETECTION_RATE);
+    obs_data_set_int(settings, SETTING_MIN_DETECTION_RATE, DEFAULT_MIN_DETECTION_RATE);
+    obs_data_set_int(settings, SETTING_DETECTION_PRIORITY, DEFAULT_DETECTION_PRIORITY);
+    obs_data_set_bool(settings, SETTING_PIPELINE_ENABLED, DEFAULT_PIPELINE_ENABLED);
+    obs_data_set_int(settings, SETTING_SEARCH_X, 0);
+    obs_data_set_int(settings, SETTING_SEARCH_Y, 0);
+    obs_data_set_int(settings, SETTING_SEARCH_WIDTH, 0);
+    obs_data_set_int(settings, SETTING_SEARCH_HEIGHT, 0);
 }
 
 // プロパティの取得（UI設定画面）
@@ -172,6 +381,19 @@ obs_properties_t *game_audio_trigger_get_properties(void *data)
     // 有効/無効
     obs_properties_add_bool(basic_props, SETTING_ENABLED, obs_module_text("Enabled"));
 
+    // 検出を行う条件
+    obs_property_t *activity_list = obs_properties_add_list(basic_props, SETTING_ACTIVITY_MODE,
+                                                             obs_module_text("ActivityMode"),
+                                                             OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_INT);
+    obs_property_list_add_int(activity_list, obs_module_text("ActivityMode.Always"),
+                              static_cast<long long>(SourceActivity::Mode::ALWAYS));
+    obs_property_list_add_int(activity_list, obs_module_text("ActivityMode.WhenShowing"),
+                              static_cast<long long>(SourceActivity::Mode::WHEN_SHOWING));
+    obs_property_list_add_int(activity_list, obs_module_text("ActivityMode.WhenActive"),
+                              static_cast<long long>(SourceActivity::Mode::WHEN_ACTIVE));
+    obs_property_list_add_int(activity_list, obs_module_text("ActivityMode.WhenLive"),
+                              static_cast<long long>(SourceActivity::Mode::WHEN_LIVE));
+
     // プロセス名
     obs_properties_add_text(basic_props, SETTING_PROCESS_NAME, 
                            obs_module_text("ProcessName"), OBS_TEXT_DEFAULT);
@@ -179,7 +401,11 @@ obs_properties_t *game_audio_trigger_get_properties(void *data)
     // テンプレート画像
     obs_properties_add_path(basic_props, SETTING_TEMPLATE_IMAGE, 
                            obs_module_text("TemplateImage"), OBS_PATH_FILE, 
-                           "Image files (*.png *.jpg *.jpeg *.bmp);;All files (*.*)");
+                           "Image files (*.png *.jpg *.jpeg *.bmp *.gatb);;All files (*.*)");
+
+    // バンドル内のテンプレート名（空欄で先頭のテンプレート）
+    obs_properties_add_text(basic_props, SETTING_TEMPLATE_NAME,
+                           obs_module_text("TemplateName"), OBS_TEXT_DEFAULT);
 
     // オーディオファイル
     obs_properties_add_path(basic_props, SETTING_AUDIO_FILE, 
@@ -201,6 +427,95 @@ obs_properties_t *game_audio_trigger_get_properties(void *data)
     obs_properties_add_int(matching_props, SETTING_COOLDOWN_MS, 
                           obs_module_text("CooldownMs"), 0, 10000, 100);
 
+    // マッチング手法
+    obs_property_t *method_list = obs_properties_add_list(matching_props, SETTING_MATCH_METHOD,
+                                                          obs_module_text("MatchMethod"),
+                                                          OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_INT);
+    obs_property_list_add_int(method_list, obs_module_text("MatchMethod.Template"),
+                              static_cast<long long>(ImageMatcher::MatchMethod::TEMPLATE_MATCHING));
+    obs_property_list_add_int(method_list, obs_module_text("MatchMethod.Feature"),
+                              static_cast<long long>(ImageMatcher::MatchMethod::FEATURE_MATCHING));
+    obs_property_list_add_int(method_list, obs_module_text("MatchMethod.MultiScale"),
+                              static_cast<long long>(ImageMatcher::MatchMethod::MULTI_SCALE));
+    obs_property_list_add_int(method_list, obs_module_text("MatchMethod.SimdNcc"),
+                              static_cast<long long>(ImageMatcher::MatchMethod::SIMD_NCC));
+    obs_property_list_add_int(method_list, obs_module_text("MatchMethod.Rotated"),
+                              static_cast<long long>(ImageMatcher::MatchMethod::ROTATED));
+
+    // 回転を許す照合の許容角度（広いほど回転済みテンプレートが増え、照合が遅くなる）
+    obs_properties_add_float_slider(matching_props, SETTING_ROTATION_TOLERANCE,
+                                   obs_module_text("RotationTolerance"), 0.0, 180.0, 1.0);
+
+    // 特徴点検出器
+    obs_property_t *detector_list = obs_properties_add_list(matching_props, SETTING_FEATURE_DETECTOR,
+                                                            obs_module_text("FeatureDetector"),
+                                                            OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_INT);
+    obs_property_list_add_int(detector_list, "ORB",
+                              static_cast<long long>(ImageMatcher::FeatureDetector::ORB));
+    obs_property_list_add_int(detector_list, "AKAZE",
+                              static_cast<long long>(ImageMatcher::FeatureDetector::AKAZE));
+    obs_property_list_add_int(detector_list, "SIFT",
+                              static_cast<long long>(ImageMatcher::FeatureDetector::SIFT));
+
+    obs_properties_add_int(matching_props, SETTING_MAX_KEYPOINTS,
+                          obs_module_text("MaxKeypoints"), 50, 10000, 50);
+
+    // 相関計算方式（大きいテンプレートではFFTが速い）
+    obs_property_t *backend_list = obs_properties_add_list(matching_props, SETTING_CORRELATION_BACKEND,
+                                                           obs_module_text("CorrelationBackend"),
+                                                           OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_INT);
+    obs_property_list_add_int(backend_list, obs_module_text("CorrelationBackend.Auto"),
+                              static_cast<long long>(ImageMatcher::CorrelationBackend::AUTO));
+    obs_property_list_add_int(backend_list, obs_module_text("CorrelationBackend.Spatial"),
+                              static_cast<long long>(ImageMatcher::CorrelationBackend::SPATIAL));
+    obs_property_list_add_int(backend_list, obs_module_text("CorrelationBackend.FFT"),
+                              static_cast<long long>(ImageMatcher::CorrelationBackend::FFT));
+
+    // 在否判定のみ（テンプレートマッチング時、閾値を超える位置が見つかった時点で打ち切る）
+    obs_properties_add_bool(matching_props, SETTING_PRESENCE_ONLY, obs_module_text("PresenceOnly"));
+
+    // 縮小照合（0で自動。縮小画像で探した後、等倍で位置を補正する）
+    obs_properties_add_float_slider(matching_props, SETTING_WORKING_SCALE,
+                                   obs_module_text("WorkingScale"), 0.0, 1.0, 0.05);
+
+    // 同時に検出する最大数（テンプレートマッチング時）
+    obs_properties_add_int(matching_props, SETTING_MAX_MATCHES,
+                          obs_module_text("MaxMatches"), 1, 32, 1);
+
+    // カスケード（ヒストグラム・低解像度NCCを通過したフレームだけを照合する）
+    obs_properties_add_bool(matching_props, SETTING_CASCADE_FILTER, obs_module_text("CascadeFilter"));
+
+    // 解像度に合わせたテンプレートの自動スケーリング（基準の解像度が0なら最初の検出時に記録する）
+    obs_properties_add_bool(matching_props, SETTING_AUTO_SCALE, obs_module_text("AutoScale"));
+    obs_properties_add_int(matching_props, SETTING_REFERENCE_WIDTH,
+                          obs_module_text("ReferenceWidth"), 0, 7680, 1);
+    obs_properties_add_int(matching_props, SETTING_REFERENCE_HEIGHT,
+                          obs_module_text("ReferenceHeight"), 0, 4320, 1);
+
+    // 検出レートと優先度（全ソースで共有するCPU予算の配分に使う）
+    obs_properties_add_int(matching_props, SETTING_DETECTION_RATE,
+                          obs_module_text("DetectionRate"), 1, 120, 1);
+    obs_properties_add_int(matching_props, SETTING_MIN_DETECTION_RATE,
+                          obs_module_text("MinDetectionRate"), 0, 60, 1);
+    obs_property_t *priority_list = obs_properties_add_list(matching_props, SETTING_DETECTION_PRIORITY,
+                                                             obs_module_text("DetectionPriority"),
+                                                             OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_INT);
+    obs_property_list_add_int(priority_list, obs_module_text("DetectionPriority.Low"),
+                              static_cast<long long>(DetectionScheduler::Priority::LOW));
+    obs_property_list_add_int(priority_list, obs_module_text("DetectionPriority.Normal"),
+                              static_cast<long long>(DetectionScheduler::Priority::NORMAL));
+    obs_property_list_add_int(priority_list, obs_module_text("DetectionPriority.High"),
+                              static_cast<long long>(DetectionScheduler::Priority::HIGH));
+
+    // パイプライン（キャプチャ・前処理・照合を別スレッドで重ねて実行する）
+    obs_properties_add_bool(matching_props, SETTING_PIPELINE_ENABLED, obs_module_text("PipelineEnabled"));
+
+    // 探索領域
+    obs_properties_add_int(matching_props, SETTING_SEARCH_X, obs_module_text("SearchX"), 0, 16384, 1);
+    obs_properties_add_int(matching_props, SETTING_SEARCH_Y, obs_module_text("SearchY"), 0, 16384, 1);
+    obs_properties_add_int(matching_props, SETTING_SEARCH_WIDTH, obs_module_text("SearchWidth"), 0, 16384, 1);
+    obs_properties_add_int(matching_props, SETTING_SEARCH_HEIGHT, obs_module_text("SearchHeight"), 0, 16384, 1);
+
     // オーディオ設定グループ
     obs_property_t *group_audio = obs_properties_add_group(props, "audio_group", 
                                                           obs_module_text("AudioSettings"), 
@@ -221,6 +536,14 @@ obs_properties_t *game_audio_trigger_get_properties(void *data)
 
     // デバッグ設定
     obs_properties_add_bool(props, SETTING_DEBUG_MODE, obs_module_text("DebugMode"));
+    obs_properties_add_button(props, SETTING_EXPORT_LATENCY, obs_module_text("ExportLatencyReport"),
+                              export_latency_report_clicked);
+    obs_properties_add_button(props, SETTING_DUMP_METRICS, obs_module_text("DumpMetrics"),
+                              dump_metrics_clicked);
+    obs_properties_add_button(props, SETTING_TOGGLE_PROFILER, obs_module_text("ToggleProfiler"),
+                              toggle_profiler_clicked);
+    obs_properties_add_button(props, SETTING_EXPORT_TRACE, obs_module_text("ExportTrace"),
+                              export_trace_clicked);
 
     return props;
 }
@@ -230,9 +553,62 @@ void game_audio_trigger_video_tick(void *data, float seconds)
 {
     UNUSED_PARAMETER(seconds);
     auto *context = static_cast<game_audio_trigger_data*>(data);
-    if (!context || !context->is_enabled) return;
+    if (!context || !context->activity) return;
+
+    // 別スレッドで読み込んだテンプレートの差し替え
+    poll_template_load(context);
+
+    // デバッグ表示に渡したフレームの大きさをソースの大きさにする（照合スレッドからは書き換えない）
+    if (context->debug_overlay) {
+        const cv::Size frame_size = context->debug_overlay->get_frame_size();
+        if (!frame_size.empty()) {
+            context->frame_width = static_cast<uint32_t>(frame_size.width);
+            context->frame_height = static_cast<uint32_t>(frame_size.height);
+        }
+    }
+
+    // 照合器が記録した基準の解像度を設定に保存する（次回の起動から最初のフレームで倍率が決まる）
+    const uint32_t learned = context->learned_reference_size.exchange(0);
+    if (learned != 0) {
+        save_reference_size(context, static_cast<int>(learned >> 16), static_cast<int>(learned & 0xFFFF));
+    }
+
+    // 無効・非表示・非アクティブ・配信/録画していない間は検出を休止する
+    ActivityMonitor& monitor = ActivityMonitor::instance();
+    const int64_t now = static_cast<int64_t>(obs_get_video_frame_time());
+    const bool live = monitor.is_live();
+    const bool was_detecting = context->activity->is_detecting();
+    const bool detecting = context->activity->update(context->is_enabled, live, now);
+    if (detecting != was_detecting) {
+        if (detecting) {
+            log_debug(context, "Detection resumed");
+        } else {
+            log_debug(context, "Detection suspended (%s)", context->activity->get_idle_reason(context->is_enabled, live));
+        }
+    }
+
+    if (!detecting) {
+        // 休止が猶予時間を超えたらキャプチャと作業バッファを解放する
+        if (context->activity->should_release(now, monitor.get_release_delay_ns())) {
+            release_idle_resources(context);
+        }
+        if (context->is_enabled && context->metrics && MetricsRegistry::instance().is_enabled()) {
+            context->metrics->increment(SourceMetrics::Counter::FRAMES_IDLE);
+        }
+        MetricsRegistry::instance().maybe_log_periodic();
+        return;
+    }
+
+    // 解放後の再開では、キャプチャを購読し直す
+    if (context->activity->is_released()) {
+        context->activity->clear_released();
+        if (!context->capture_target) {
+            context->capture_target = CaptureHub::instance().subscribe(context->target_process_name);
+        }
+    }
 
     check_process_and_match(context);
+    MetricsRegistry::instance().maybe_log_periodic();
 }
 
 // ビデオレンダリング（表示用）
@@ -243,20 +619,8 @@ void game_audio_trigger_video_render(void *data, gs_effect_t *effect)
     if (!context) return;
 
     // デバッグモードの場合、マッチング結果を可視化
-    if (context->debug_mode && context->output_texture) {
-        gs_effect_t *default_effect = obs_get_base_effect(OBS_EFFECT_DEFAULT);
-        gs_technique_t *tech = gs_effect_get_technique(default_effect, "Draw");
-        
-        gs_technique_begin(tech);
-        gs_technique_begin_pass(tech, 0);
-        
-        gs_effect_set_texture(gs_effect_get_param_by_name(default_effect, "image"), 
-                             context->output_texture);
-        
-        gs_draw_sprite(context->output_texture, 0, context->frame_width, context->frame_height);
-        
-        gs_technique_end_pass(tech);
-        gs_technique_end(tech);
+    if (context->debug_mode && context->debug_overlay) {
+        context->debug_overlay->render(context->frame_width, context->frame_height);
     }
 }
 
@@ -274,66 +638,294 @@ uint32_t game_audio_trigger_get_height(void *data)
     return context ? context->frame_height : 0;
 }
 
+// 表示状態（プレビューを含むいずれかの画面に表示されているか）
+void game_audio_trigger_show(void *data)
+{
+    auto *context = static_cast<game_audio_trigger_data*>(data);
+    if (context && context->activity) context->activity->set_showing(true);
+}
+
+void game_audio_trigger_hide(void *data)
+{
+    auto *context = static_cast<game_audio_trigger_data*>(data);
+    if (context && context->activity) context->activity->set_showing(false);
+}
+
+// アクティブ状態（番組出力に含まれているか）
+void game_audio_trigger_activate(void *data)
+{
+    auto *context = static_cast<game_audio_trigger_data*>(data);
+    if (context && context->activity) context->activity->set_active(true);
+}
+
+void game_audio_trigger_deactivate(void *data)
+{
+    auto *context = static_cast<game_audio_trigger_data*>(data);
+    if (context && context->activity) context->activity->set_active(false);
+}
+
+// 休止が続いたソースのキャプチャと作業バッファの解放
+void release_idle_resources(game_audio_trigger_data *context)
+{
+    if (!context) return;
+
+    DetectionPipeline::instance().flush_source(context->pipeline_id);
+
+    // 同じプロセスを対象とする他のソースが検出中であれば、CaptureTarget自体は残る
+    CaptureHub::instance().unsubscribe(context->capture_target);
+    if (context->image_matcher) context->image_matcher->release_frame_buffers();
+    if (context->debug_overlay) context->debug_overlay->release_buffers();
+    update_memory_metrics(context);
+
+    log_debug(context, "Released capture buffers after idle period");
+}
+
+// 検出時点の設定（パイプラインでは投入時に写し、照合スレッドはソースの設定値を読まない）
+static DetectionPipeline::Settings get_detection_settings(const game_audio_trigger_data *context)
+{
+    DetectionPipeline::Settings settings;
+    settings.match_threshold = context->match_threshold;
+    settings.cooldown_ms = context->cooldown_ms;
+    settings.audio_duration = context->audio_duration;
+    settings.learn_reference_size = context->auto_scale && context->reference_width <= 0;
+    return settings;
+}
+
+// 照合結果の記録とトリガー（同期実行とパイプラインの照合段で共通）
+static void finish_detection(game_audio_trigger_data *context, const DetectionPipeline::Settings& settings,
+                             const CaptureTarget::Frame& frame,
+                             const ImageMatcher::MatchResult& match_result,
+                             std::chrono::steady_clock::time_point match_start,
+                             std::chrono::steady_clock::time_point match_end)
+{
+    LatencyTracer *tracer = context->latency_tracer.get();
+    SourceMetrics *metrics = MetricsRegistry::instance().is_enabled() ? context->metrics.get() : nullptr;
+
+    if (metrics) {
+        if (frame.shared) {
+            metrics->increment(SourceMetrics::Counter::FRAMES_SHARED);
+        } else {
+            metrics->record_capture_time(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                frame.capture_end - frame.capture_start).count()));
+        }
+        metrics->record_match_time(static_cast<size_t>(context->image_matcher->get_match_method()),
+            static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(match_end - match_start).count()));
+        metrics->increment(SourceMetrics::Counter::FRAMES_PROCESSED);
+
+        const PresenceScanner::Stats& scan_stats = context->image_matcher->get_last_scan_stats();
+        if (scan_stats.positions_total > 0) {
+            metrics->increment(SourceMetrics::Counter::PRESENCE_FRAMES);
+            metrics->increment(SourceMetrics::Counter::POSITIONS_EVALUATED, scan_stats.positions_evaluated);
+            metrics->increment(SourceMetrics::Counter::ROWS_EVALUATED, scan_stats.rows_evaluated);
+        }
+
+        const CascadeFilter::FrameStats& cascade_stats = context->image_matcher->get_last_cascade_stats();
+        for (int stage = 0; cascade_stats.evaluated && stage < cascade_stats.stages_run; ++stage) {
+            metrics->record_cascade_stage(static_cast<size_t>(stage), cascade_stats.stage_ns[stage],
+                                          stage == cascade_stats.rejected_stage);
+        }
+    }
+
+    if (tracer) {
+        tracer->mark(LatencyTracer::Stage::PREPROCESS_END, context->image_matcher->get_last_preprocess_end());
+        tracer->mark(LatencyTracer::Stage::MATCH_END);
+        tracer->mark(LatencyTracer::Stage::TRIGGER_DECISION);
+    }
+
+    if (context->debug_mode) {
+        publish_debug_overlay(context, frame.image, settings.match_threshold);
+    }
+    
+    // 基準の解像度を記録した場合は、ビデオティックで設定に保存する
+    if (match_result.found && settings.learn_reference_size) {
+        const cv::Size reference = context->image_matcher->get_reference_size();
+        if (!reference.empty()) {
+            context->learned_reference_size = (static_cast<uint32_t>(reference.width) << 16) |
+                                              static_cast<uint32_t>(reference.height & 0xFFFF);
+        }
+    }
+
+    if (match_result.found) {
+        log_debug(context, "Match found! Confidence: %.3f at (%.1f, %.1f), rotation: %.1f, instances: %zu", 
+                 match_result.confidence, match_result.center.x, match_result.center.y,
+                 match_result.rotation, context->image_matcher->get_match_count());
+        trigger_audio_playback(context, settings.audio_duration);
+    }
+
+    if (tracer) {
+        tracer->end_event(match_result.found);
+        if (match_result.found && context->audio_player) {
+            tracer->complete_pending(context->audio_player->get_first_sample_time());
+        }
+    }
+}
+
 // プロセス検出とマッチング処理
 void check_process_and_match(game_audio_trigger_data *context)
 {
-    if (!context || !context->process_detector || !context->image_matcher) return;
+    if (!context || !context->capture_target || !context->image_matcher) return;
+    PROFILE_ZONE("check_process_and_match");
 
-    // プロセスの状態を更新
-    bool process_running = context->process_detector->is_process_running();
-    if (!process_running) {
-        context->process_detector->refresh_process_info();
-        process_running = context->process_detector->is_process_running();
+    // パイプライン使用時、レイテンシの記録は照合スレッドだけが行う
+    LatencyTracer *tracer = context->pipeline_enabled ? nullptr : context->latency_tracer.get();
+    if (tracer && tracer->has_pending() && context->audio_player) {
+        tracer->complete_pending(context->audio_player->get_first_sample_time());
     }
 
+    // プロセスの状態を更新（同じビデオフレーム内では他のソースの確認結果を再利用する）
+    const uint64_t tick = obs_get_video_frame_time();
+    bool process_running = context->capture_target->poll_process(tick);
+
     context->is_process_running = process_running;
 
+    SourceMetrics *metrics = MetricsRegistry::instance().is_enabled() ? context->metrics.get() : nullptr;
+
     if (!process_running || !context->is_template_loaded) {
+        if (metrics) metrics->increment(SourceMetrics::Counter::FRAMES_SKIPPED);
         return;
     }
 
     // クールダウン確認
-    if (is_cooldown_active(context)) {
+    const DetectionPipeline::Settings settings = get_detection_settings(context);
+    if (is_cooldown_active(context, settings.cooldown_ms)) {
+        if (metrics) metrics->increment(SourceMetrics::Counter::COOLDOWN_SUPPRESSED);
         return;
     }
 
-    // ウィンドウキャプチャ
-    cv::Mat captured_image;
-    if (!context->process_detector->capture_window(captured_image)) {
-        log_debug(context, "Failed to capture window");
+    // 検出スケジューラ（要求レートの周期が来ていない、またはCPU予算が足りなければ見送る）
+    DetectionScheduler& scheduler = DetectionScheduler::instance();
+    if (!scheduler.acquire_slot(context->scheduler_id, static_cast<int64_t>(tick))) {
+        if (metrics) metrics->increment(SourceMetrics::Counter::FRAMES_NOT_SCHEDULED);
         return;
     }
 
-    if (captured_image.empty()) {
+    // パイプライン: キャプチャ以降はワーカースレッドで行う（コストは照合段の完了時に報告する）
+    if (context->pipeline_enabled) {
+        if (!DetectionPipeline::instance().submit(context->pipeline_id, tick, context->capture_target, settings)) {
+            scheduler.report_cost(context->scheduler_id, 0);
+        }
         return;
     }
 
+    auto detection_start = std::chrono::steady_clock::now();
+    auto report_detection_cost = [&]() {
+        scheduler.report_cost(context->scheduler_id, static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - detection_start).count()));
+    };
+
+    // ウィンドウキャプチャ（同じビデオフレーム内では最初のソースだけが取得し、他は共有する）
+    if (tracer) tracer->begin_event();
+
+    CaptureTarget::Frame frame;
+    if (!context->capture_target->acquire_frame(tick, frame)) {
+        report_detection_cost();
+        log_debug(context, "Failed to capture window");
+        if (tracer) tracer->cancel_event();
+        if (metrics) metrics->increment(SourceMetrics::Counter::FRAMES_SKIPPED);
+        return;
+    }
+
+    if (tracer) {
+        tracer->mark(LatencyTracer::Stage::CAPTURE_START, frame.capture_start);
+        tracer->mark(LatencyTracer::Stage::CAPTURE_END, frame.capture_end);
+    }
+
     // 画像マッチング実行
-    auto match_result = context->image_matcher->match(captured_image, context->match_threshold);
-    
-    if (match_result.found) {
-        log_debug(context, "Match found! Confidence: %.3f at (%.1f, %.1f)", 
-                 match_result.confidence, match_result.center.x, match_result.center.y);
-        trigger_audio_playback(context);
+    auto match_start = std::chrono::steady_clock::now();
+    auto match_result = context->image_matcher->match(frame.image, settings.match_threshold);
+    auto match_end = std::chrono::steady_clock::now();
+    report_detection_cost();
+
+    finish_detection(context, settings, frame, match_result, match_start, match_end);
+}
+
+// パイプラインの照合段（照合スレッドから呼ばれる）
+static void run_pipeline_match(game_audio_trigger_data *context, DetectionPipeline::Frame& job)
+{
+    LatencyTracer *tracer = context->latency_tracer.get();
+    if (tracer && tracer->has_pending() && context->audio_player) {
+        tracer->complete_pending(context->audio_player->get_first_sample_time());
+    }
+
+    // キューで待っている間に他のフレームでトリガーした場合
+    if (is_cooldown_active(context, job.settings.cooldown_ms)) {
+        DetectionScheduler::instance().report_cost(context->scheduler_id, job.cost_ns);
+        if (context->metrics && MetricsRegistry::instance().is_enabled()) {
+            context->metrics->increment(SourceMetrics::Counter::COOLDOWN_SUPPRESSED);
+        }
+        return;
+    }
+
+    if (tracer) {
+        tracer->begin_event();
+        tracer->mark(LatencyTracer::Stage::CAPTURE_START, job.capture.capture_start);
+        tracer->mark(LatencyTracer::Stage::CAPTURE_END, job.capture.capture_end);
     }
+
+    auto match_start = std::chrono::steady_clock::now();
+    auto match_result = context->image_matcher->match_prepared(job.prepared, job.settings.match_threshold);
+    auto match_end = std::chrono::steady_clock::now();
+    DetectionScheduler::instance().report_cost(context->scheduler_id, job.cost_ns + static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(match_end - match_start).count()));
+
+    finish_detection(context, job.settings, job.capture, match_result, match_start, match_end);
+}
+
+// パイプラインの各段の処理
+static DetectionPipeline::Handlers make_pipeline_handlers(game_audio_trigger_data *context)
+{
+    DetectionPipeline::Handlers handlers;
+    handlers.capture = [context](DetectionPipeline::Frame& job) {
+        if (!job.target || !job.target->acquire_frame(job.tick, job.capture)) {
+            log_debug(context, "Failed to capture window");
+            return false;
+        }
+        return true;
+    };
+    handlers.preprocess = [context](DetectionPipeline::Frame& job) {
+        return context->image_matcher && context->image_matcher->prepare_frame(job.capture.image, job.prepared);
+    };
+    handlers.match = [context](DetectionPipeline::Frame& job) {
+        if (context->image_matcher) run_pipeline_match(context, job);
+    };
+    handlers.discard = [context](const DetectionPipeline::Frame& job, DetectionPipeline::Stage stage, bool dropped) {
+        UNUSED_PARAMETER(stage);
+        DetectionScheduler::instance().report_cost(context->scheduler_id, job.cost_ns);
+        if (context->metrics && MetricsRegistry::instance().is_enabled()) {
+            context->metrics->increment(dropped ? SourceMetrics::Counter::FRAMES_DROPPED
+                                                : SourceMetrics::Counter::FRAMES_SKIPPED);
+        }
+    };
+    return handlers;
 }
 
 // オーディオ再生トリガー
-void trigger_audio_playback(game_audio_trigger_data *context)
+void trigger_audio_playback(game_audio_trigger_data *context, float duration_seconds)
 {
     if (!context || !context->audio_player) return;
+    PROFILE_ZONE("trigger_audio_playback");
 
     // クールダウン時間を更新
     context->last_trigger_time = std::chrono::steady_clock::now();
 
     // オーディオ再生
+    if (context->latency_tracer) {
+        context->latency_tracer->mark(LatencyTracer::Stage::COMMAND_ENQUEUE);
+    }
+
     bool play_result = false;
-    if (context->audio_duration > 0) {
-        play_result = context->audio_player->play_with_duration(context->audio_duration);
+    if (duration_seconds > 0) {
+        play_result = context->audio_player->play_with_duration(duration_seconds);
     } else {
         play_result = context->audio_player->play();
     }
 
+    if (context->metrics && MetricsRegistry::instance().is_enabled()) {
+        context->metrics->increment(SourceMetrics::Counter::TRIGGERS_FIRED);
+    }
+
     if (play_result) {
         log_debug(context, "Audio playback triggered successfully");
     } else {
@@ -342,15 +934,15 @@ void trigger_audio_playback(game_audio_trigger_data *context)
 }
 
 // クールダウン状態確認
-bool is_cooldown_active(game_audio_trigger_data *context)
+bool is_cooldown_active(game_audio_trigger_data *context, int cooldown_ms)
 {
-    if (!context || context->cooldown_ms <= 0) return false;
+    if (!context || cooldown_ms <= 0) return false;
 
     auto now = std::chrono::steady_clock::now();
     auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
-        now - context->last_trigger_time).count();
+        now - context->last_trigger_time.load()).count();
     
-    return elapsed < context->cooldown_ms;
+    return elapsed < cooldown_ms;
 }
 
 // デバッグログ出力
@@ -367,4 +959,223 @@ void log_debug(game_audio_trigger_data *context, const char *format, ...)
     blog(LOG_INFO, "[Game Audio Trigger Debug] %s", buffer);
     
     va_end(args);
-}
\ No newline at end of file
+}
+
+// レポート出力先パスの生成（プラグイン設定ディレクトリ配下）
+std::string get_report_path(game_audio_trigger_data *context, const char *suffix)
+{
+    std::string file_name = context && context->source ? obs_source_get_name(context->source) : "source";
+    for (char& c : file_name) {
+        if (c == '/' || c == '\\' || c == ':' || c == '*' || c == '?' ||
+            c == '"' || c == '<' || c == '>' || c == '|') {
+            c = '_';
+        }
+    }
+    file_name += suffix;
+
+    char *config_dir = obs_module_config_path("");
+    if (config_dir) {
+        os_mkdirs(config_dir);
+        bfree(config_dir);
+    }
+
+    char *path = obs_module_config_path(file_name.c_str());
+    std::string result = path ? path : "";
+    bfree(path);
+    return result;
+}
+
+// レイテンシレポートのエクスポート
+bool export_latency_report_clicked(obs_properties_t *props, obs_property_t *property, void *data)
+{
+    UNUSED_PARAMETER(props);
+    UNUSED_PARAMETER(property);
+    auto *context = static_cast<game_audio_trigger_data*>(data);
+    if (!context || !context->latency_tracer) return false;
+
+    std::string path = get_report_path(context, "-latency.json");
+    if (context->latency_tracer->export_json(path, obs_source_get_name(context->source))) {
+        blog(LOG_INFO, "[Game Audio Trigger] Latency report exported: %s", path.c_str());
+    } else {
+        blog(LOG_WARNING, "[Game Audio Trigger] Failed to export latency report: %s", path.c_str());
+    }
+    return false;
+}
+
+// メトリクスのダンプ（全ソース分）
+bool dump_metrics_clicked(obs_properties_t *props, obs_property_t *property, void *data)
+{
+    UNUSED_PARAMETER(props);
+    UNUSED_PARAMETER(property);
+    UNUSED_PARAMETER(data);
+
+    char *config_dir = obs_module_config_path("");
+    if (config_dir) {
+        os_mkdirs(config_dir);
+        bfree(config_dir);
+    }
+
+    char *path = obs_module_config_path("metrics.json");
+    if (!path) return false;
+
+    if (MetricsRegistry::instance().dump_to_file(path)) {
+        blog(LOG_INFO, "[Game Audio Trigger] Metrics dumped: %s", path);
+    } else {
+        blog(LOG_WARNING, "[Game Audio Trigger] Failed to dump metrics: %s", path);
+    }
+    MetricsRegistry::instance().log_summary();
+    CaptureHub::instance().log_summary();
+    DetectionScheduler::instance().log_summary();
+    DetectionPipeline::instance().log_summary();
+    TemplateCache::instance().log_summary();
+    AudioMixer::instance().log_summary();
+    AudioStreamer::instance().log_summary();
+
+    bfree(path);
+    return false;
+}
+
+// プロファイラの開始/停止
+bool toggle_profiler_clicked(obs_properties_t *props, obs_property_t *property, void *data)
+{
+    UNUSED_PARAMETER(props);
+    UNUSED_PARAMETER(property);
+    UNUSED_PARAMETER(data);
+
+    bool enable = !Profiler::instance().is_enabled();
+    if (enable) {
+        Profiler::instance().clear();
+    }
+    Profiler::instance().set_enabled(enable);
+    blog(LOG_INFO, "[Game Audio Trigger] Profiler %s", enable ? "started" : "stopped");
+    return false;
+}
+
+// Chrome trace形式でのトレース出力
+bool export_trace_clicked(obs_properties_t *props, obs_property_t *property, void *data)
+{
+    UNUSED_PARAMETER(props);
+    UNUSED_PARAMETER(property);
+    UNUSED_PARAMETER(data);
+
+    char *config_dir = obs_module_config_path("");
+    if (config_dir) {
+        os_mkdirs(config_dir);
+        bfree(config_dir);
+    }
+
+    char *path = obs_module_config_path("trace.json");
+    if (!path) return false;
+
+    if (Profiler::instance().export_chrome_trace(path)) {
+        blog(LOG_INFO, "[Game Audio Trigger] Trace exported: %s", path);
+    } else {
+        blog(LOG_WARNING, "[Game Audio Trigger] Failed to export trace: %s", path);
+    }
+
+    bfree(path);
+    return false;
+}
+
+// デバッグ表示へマッチ結果の座標と縮小フレームを渡す
+void publish_debug_overlay(game_audio_trigger_data *context, const cv::Mat& frame, float threshold)
+{
+    if (!context || !context->debug_overlay || !context->image_matcher) return;
+
+    std::vector<DebugOverlay::Box> boxes;
+    for (const auto& match : context->image_matcher->get_last_matches()) {
+        boxes.push_back({cv::Rect2f(match.bounding_box), match.confidence});
+    }
+
+    context->debug_overlay->publish_matches(boxes, frame.size(), threshold);
+
+    if (context->debug_overlay->wants_frame()) {
+        context->debug_overlay->submit_frame(frame);
+    }
+}
+
+// マッチング関連の設定をImageMatcherへ反映
+void apply_matcher_settings(game_audio_trigger_data *context, ImageMatcher& target)
+{
+    if (!context) return;
+
+    ImageMatcher *matcher = &target;
+    matcher->set_feature_detector(static_cast<ImageMatcher::FeatureDetector>(context->feature_detector));
+    matcher->set_match_method(static_cast<ImageMatcher::MatchMethod>(context->match_method));
+    matcher->set_rotation_tolerance(context->rotation_tolerance);
+    matcher->set_max_target_keypoints(context->max_keypoints);
+    matcher->set_correlation_backend(static_cast<ImageMatcher::CorrelationBackend>(context->correlation_backend));
+    matcher->set_presence_only(context->presence_only);
+    matcher->set_working_scale(context->working_scale);
+    matcher->set_max_matches(context->max_matches);
+    matcher->set_cascade_enabled(context->cascade_filter);
+    matcher->set_reference_size(cv::Size(context->reference_width, context->reference_height));
+    matcher->set_auto_scale(context->auto_scale);
+    matcher->set_search_region(cv::Rect(context->search_x, context->search_y,
+                                        context->search_width, context->search_height));
+}
+
+// 照合器が記録した基準の解像度を設定に書き込む（照合器には反映済みなので作り直さない）
+void save_reference_size(game_audio_trigger_data *context, int width, int height)
+{
+    if (!context || (width == context->reference_width && height == context->reference_height)) return;
+
+    context->reference_width = width;
+    context->reference_height = height;
+
+    obs_data_t *settings = obs_source_get_settings(context->source);
+    obs_data_set_int(settings, SETTING_REFERENCE_WIDTH, width);
+    obs_data_set_int(settings, SETTING_REFERENCE_HEIGHT, height);
+    obs_data_release(settings);
+
+    blog(LOG_INFO, "[Game Audio Trigger] Saved reference resolution %dx%d for '%s'", width, height,
+         obs_source_get_name(context->source));
+}
+
+// テンプレート・音声のメモリ使用量をメトリクスに反映
+void update_memory_metrics(game_audio_trigger_data *context)
+{
+    if (!context || !context->metrics) return;
+
+    if (context->image_matcher) {
+        context->metrics->set_gauge(SourceMetrics::Gauge::TEMPLATE_BYTES,
+                                    static_cast<int64_t>(context->image_matcher->get_memory_usage()));
+    }
+    if (context->audio_player) {
+        context->metrics->set_gauge(SourceMetrics::Gauge::AUDIO_BYTES,
+                                    static_cast<int64_t>(context->audio_player->get_memory_usage()));
+    }
+}
+
+// プラグイン全体の設定を読み込む
+void load_plugin_config()
+{
+    char *path = obs_module_config_path(CONFIG_FILE_NAME);
+    obs_data_t *config = path ? obs_data_create_from_json_file_safe(path, "bak") : nullptr;
+    if (!config) {
+        config = obs_data_create();
+    }
+
+    obs_data_set_default_bool(config, CONFIG_METRICS_ENABLED, DEFAULT_METRICS_ENABLED);
+    obs_data_set_default_int(config, CONFIG_METRICS_LOG_INTERVAL, DEFAULT_METRICS_LOG_INTERVAL);
+
+    MetricsRegistry::instance().set_enabled(obs_data_get_bool(config, CONFIG_METRICS_ENABLED));
+    MetricsRegistry::instance().set_log_interval(
+        static_cast<int>(obs_data_get_int(config, CONFIG_METRICS_LOG_INTERVAL)));
+
+    obs_data_set_default_bool(config, CONFIG_PROFILER_ENABLED, DEFAULT_PROFILER_ENABLED);
+    Profiler::instance().set_enabled(obs_data_get_bool(config, CONFIG_PROFILER_ENABLED));
+
+    obs_data_set_default_int(config, CONFIG_SCHEDULER_BUDGET, DEFAULT_SCHEDULER_BUDGET);
+    DetectionScheduler::instance().set_budget(static_cast<double>(obs_data_get_int(config, CONFIG_SCHEDULER_BUDGET)));
+
+    obs_data_set_default_double(config, CONFIG_IDLE_RELEASE_DELAY, DEFAULT_IDLE_RELEASE_DELAY);
+    ActivityMonitor::instance().set_release_delay(obs_data_get_double(config, CONFIG_IDLE_RELEASE_DELAY));
+
+    obs_data_set_default_int(config, CONFIG_PIPELINE_QUEUE, DEFAULT_PIPELINE_QUEUE);
+    DetectionPipeline::instance().set_queue_capacity(
+        static_cast<size_t>(std::max<long long>(1, obs_data_get_int(config, CONFIG_PIPELINE_QUEUE))));
+
+    obs_data_release(config);
+    bfree(path);
+}
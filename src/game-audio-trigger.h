@@ -4,11 +4,18 @@
 #include <string>
 #include <chrono>
 #include <memory>
+#include <opencv2/core.hpp>
+#include <atomic>
+#include <future>
 
 // 前方宣言
 class ImageMatcher;
 class AudioPlayer;
-class ProcessDetector;
+class CaptureTarget;
+class LatencyTracer;
+class SourceMetrics;
+class DebugOverlay;
+class SourceActivity;
 
 // プラグインのデータ構造体
 struct game_audio_trigger_data {
@@ -26,22 +33,57 @@ struct game_audio_trigger_data {
     float audio_duration;               // 再生時間(秒) (-1で全体)
     int cooldown_ms;                    // クールダウン時間(ミリ秒)
     
+    int match_method;                   // マッチング手法 (ImageMatcher::MatchMethod)
+    int feature_detector;               // 特徴点検出器 (ImageMatcher::FeatureDetector)
+    int max_keypoints;                  // 対象画像の特徴点数上限
+    int correlation_backend;            // 相関計算方式 (ImageMatcher::CorrelationBackend)
+    bool presence_only;                 // 在否判定のみ（閾値を超えた時点で打ち切る）
+    float working_scale;                // 縮小照合の倍率 (0で自動、1で等倍)
+    int max_matches;                    // 同時に検出する最大数
+    bool cascade_filter;                // 事前判定（ヒストグラム・低解像度NCC）で大半のフレームを棄却する
+    bool auto_scale;                    // ウィンドウの解像度に合わせてテンプレートを拡大縮小する
+    int reference_width;                // テンプレートを切り出したときのウィンドウサイズ (0で最初の検出時に記録)
+    int reference_height;
+    float rotation_tolerance;           // 回転を許す照合で許容する角度（度）
+    int detection_rate;                 // 要求する検出レート(Hz)
+    int min_detection_rate;             // 過負荷時にも保証する最低レート(Hz)
+    int detection_priority;             // スケジューラでの優先度 (DetectionScheduler::Priority)
+    bool pipeline_enabled;              // キャプチャ・前処理・照合を別スレッドで重ねて実行する
+    int search_x;                       // 探索領域 (幅・高さ0で画面全体)
+    int search_y;
+    int search_width;
+    int search_height;
+    
     bool is_enabled;                    // 有効/無効
-    bool debug_mode;                    // デバッグモード
+    int activity_mode;                  // 検出を行う条件 (SourceActivity::Mode)
+    std::atomic<bool> debug_mode;       // デバッグモード（ワーカースレッドのログ出力からも読む）
     
     // 実行時データ
     std::unique_ptr<ImageMatcher> image_matcher;
     std::unique_ptr<AudioPlayer> audio_player;
-    std::unique_ptr<ProcessDetector> process_detector;
+    std::shared_ptr<CaptureTarget> capture_target;     // 同じプロセスを対象とするソースで共有
+    std::unique_ptr<LatencyTracer> latency_tracer;
+    std::shared_ptr<SourceMetrics> metrics;
+    std::unique_ptr<DebugOverlay> debug_overlay;
+    std::unique_ptr<SourceActivity> activity;          // 表示・アクティブ状態と休止時間
+
+    // 別スレッドで読み込み中のテンプレート（完了後にビデオティックでimage_matcherと差し替える）
+    std::future<std::unique_ptr<ImageMatcher>> pending_matcher;
+    std::string pending_template_path;
+    bool settings_applied;              // 初回の設定反映が済んだか（初回は全項目を反映する）
+    
+    uint64_t scheduler_id;              // DetectionSchedulerでのID
+    uint64_t pipeline_id;               // DetectionPipelineでのID
     
-    std::chrono::steady_clock::time_point last_trigger_time;
+    // パイプラインの照合スレッドからも更新する
+    std::atomic<std::chrono::steady_clock::time_point> last_trigger_time;
+    std::atomic<uint32_t> learned_reference_size;      // 照合器が記録した基準の解像度 ((幅 << 16) | 高さ、0で未記録)
     bool is_process_running;
     bool is_template_loaded;
     
-    // フレーム関連
+    // フレーム関連（ビデオティックでデバッグ表示に渡したフレームの大きさから更新する）
     uint32_t frame_width;
     uint32_t frame_height;
-    gs_texture_t *output_texture;
 };
 
 // プラグイン関数の宣言
@@ -59,17 +101,39 @@ extern "C" {
     void game_audio_trigger_video_render(void *data, gs_effect_t *effect);
     uint32_t game_audio_trigger_get_width(void *data);
     uint32_t game_audio_trigger_get_height(void *data);
+
+    // 表示・アクティブ状態の通知
+    void game_audio_trigger_show(void *data);
+    void game_audio_trigger_hide(void *data);
+    void game_audio_trigger_activate(void *data);
+    void game_audio_trigger_deactivate(void *data);
 }
 
 // 内部ヘルパー関数
 void check_process_and_match(game_audio_trigger_data *context);
-void trigger_audio_playback(game_audio_trigger_data *context);
-bool is_cooldown_active(game_audio_trigger_data *context);
+void trigger_audio_playback(game_audio_trigger_data *context, float duration_seconds);
+bool is_cooldown_active(game_audio_trigger_data *context, int cooldown_ms);
 void log_debug(game_audio_trigger_data *context, const char *format, ...);
+std::string get_report_path(game_audio_trigger_data *context, const char *suffix);
+bool export_latency_report_clicked(obs_properties_t *props, obs_property_t *property, void *data);
+bool dump_metrics_clicked(obs_properties_t *props, obs_property_t *property, void *data);
+bool toggle_profiler_clicked(obs_properties_t *props, obs_property_t *property, void *data);
+bool export_trace_clicked(obs_properties_t *props, obs_property_t *property, void *data);
+void update_memory_metrics(game_audio_trigger_data *context);
+void apply_matcher_settings(game_audio_trigger_data *context, ImageMatcher& matcher);
+void save_reference_size(game_audio_trigger_data *context, int width, int height);
+void start_template_load(game_audio_trigger_data *context);
+void poll_template_load(game_audio_trigger_data *context);
+void release_idle_resources(game_audio_trigger_data *context);
+void publish_debug_overlay(game_audio_trigger_data *context, const cv::Mat& frame, float threshold);
+
+// プラグイン全体の設定（plugin_config/obs-game-audio-trigger/config.json）
+void load_plugin_config();
 
 // 設定キー定義
 #define SETTING_PROCESS_NAME        "process_name"
 #define SETTING_TEMPLATE_IMAGE      "template_image"
+#define SETTING_TEMPLATE_NAME       "template_name"
 #define SETTING_AUDIO_FILE          "audio_file"
 #define SETTING_MATCH_THRESHOLD     "match_threshold"
 #define SETTING_AUDIO_VOLUME        "audio_volume"
@@ -77,7 +141,41 @@ void log_debug(game_audio_trigger_data *context, const char *format, ...);
 #define SETTING_AUDIO_DURATION      "audio_duration"
 #define SETTING_COOLDOWN_MS         "cooldown_ms"
 #define SETTING_ENABLED             "enabled"
+#define SETTING_ACTIVITY_MODE       "activity_mode"
 #define SETTING_DEBUG_MODE          "debug_mode"
+#define SETTING_MATCH_METHOD        "match_method"
+#define SETTING_FEATURE_DETECTOR    "feature_detector"
+#define SETTING_MAX_KEYPOINTS       "max_keypoints"
+#define SETTING_CORRELATION_BACKEND "correlation_backend"
+#define SETTING_PRESENCE_ONLY       "presence_only"
+#define SETTING_WORKING_SCALE       "working_scale"
+#define SETTING_MAX_MATCHES         "max_matches"
+#define SETTING_CASCADE_FILTER      "cascade_filter"
+#define SETTING_AUTO_SCALE          "auto_scale"
+#define SETTING_REFERENCE_WIDTH     "reference_width"
+#define SETTING_REFERENCE_HEIGHT    "reference_height"
+#define SETTING_ROTATION_TOLERANCE  "rotation_tolerance"
+#define SETTING_DETECTION_RATE      "detection_rate"
+#define SETTING_MIN_DETECTION_RATE  "min_detection_rate"
+#define SETTING_DETECTION_PRIORITY  "detection_priority"
+#define SETTING_PIPELINE_ENABLED    "pipeline_enabled"
+#define SETTING_SEARCH_X            "search_x"
+#define SETTING_SEARCH_Y            "search_y"
+#define SETTING_SEARCH_WIDTH        "search_width"
+#define SETTING_SEARCH_HEIGHT       "search_height"
+#define SETTING_EXPORT_LATENCY      "export_latency"
+#define SETTING_DUMP_METRICS        "dump_metrics"
+#define SETTING_TOGGLE_PROFILER     "toggle_profiler"
+#define SETTING_EXPORT_TRACE        "export_trace"
+
+// プラグイン全体設定キー定義
+#define CONFIG_FILE_NAME            "config.json"
+#define CONFIG_METRICS_ENABLED      "metrics_enabled"
+#define CONFIG_METRICS_LOG_INTERVAL "metrics_log_interval_sec"
+#define CONFIG_PROFILER_ENABLED     "profiler_enabled"
+#define CONFIG_SCHEDULER_BUDGET     "scheduler_cpu_budget_ms"
+#define CONFIG_IDLE_RELEASE_DELAY   "idle_release_delay_sec"
+#define CONFIG_PIPELINE_QUEUE       "pipeline_queue_capacity"
 
 // デフォルト値
 #define DEFAULT_MATCH_THRESHOLD     0.8f
@@ -86,4 +184,25 @@ void log_debug(game_audio_trigger_data *context, const char *format, ...);
 #define DEFAULT_AUDIO_DURATION      -1.0f
 #define DEFAULT_COOLDOWN_MS         1000
 #define DEFAULT_ENABLED             true
-#define DEFAULT_DEBUG_MODE          false
\ No newline at end of file
+#define DEFAULT_ACTIVITY_MODE       0       // ALWAYS
+#define DEFAULT_DEBUG_MODE          false
+#define DEFAULT_MATCH_METHOD        0       // TEMPLATE_MATCHING
+#define DEFAULT_FEATURE_DETECTOR    0       // SIFT
+#define DEFAULT_MAX_KEYPOINTS       1000
+#define DEFAULT_CORRELATION_BACKEND 0       // AUTO
+#define DEFAULT_PRESENCE_ONLY       false
+#define DEFAULT_WORKING_SCALE       1.0f
+#define DEFAULT_MAX_MATCHES         1
+#define DEFAULT_CASCADE_FILTER      false
+#define DEFAULT_AUTO_SCALE          false
+#define DEFAULT_ROTATION_TOLERANCE  15.0f
+#define DEFAULT_DETECTION_RATE      60
+#define DEFAULT_MIN_DETECTION_RATE  2
+#define DEFAULT_DETECTION_PRIORITY  1       // NORMAL
+#define DEFAULT_PIPELINE_ENABLED    false
+#define DEFAULT_METRICS_ENABLED     true
+#define DEFAULT_METRICS_LOG_INTERVAL 300
+#define DEFAULT_PROFILER_ENABLED    false
+#define DEFAULT_SCHEDULER_BUDGET    1000    // 全ソース合計で1秒あたり1000ms（1コア分）
+#define DEFAULT_IDLE_RELEASE_DELAY  10      // 休止してからバッファを解放するまでの秒数
+#define DEFAULT_PIPELINE_QUEUE      4       // パイプラインの段の間のキューの長さ
\ No newline at end of file
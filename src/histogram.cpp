@@ -0,0 +1,132 @@
+#include "histogram.h"
+#include <algorithm>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace {
+
+int highest_bit(uint64_t value)
+{
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanReverse64(&index, value);
+    return static_cast<int>(index);
+#else
+    return 63 - __builtin_clzll(value);
+#endif
+}
+
+} // namespace
+
+Histogram::Histogram()
+    : count_(0)
+    , sum_(0)
+    , max_(0)
+{
+    for (auto& bucket : buckets_) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+}
+
+void Histogram::record(uint64_t value)
+{
+    buckets_[bucket_index(value)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(value, std::memory_order_relaxed);
+
+    uint64_t current_max = max_.load(std::memory_order_relaxed);
+    while (value > current_max &&
+           !max_.compare_exchange_weak(current_max, value, std::memory_order_relaxed)) {
+    }
+}
+
+void Histogram::reset()
+{
+    for (auto& bucket : buckets_) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    count_.store(0, std::memory_order_relaxed);
+    sum_.store(0, std::memory_order_relaxed);
+    max_.store(0, std::memory_order_relaxed);
+}
+
+uint64_t Histogram::get_count() const
+{
+    return count_.load(std::memory_order_relaxed);
+}
+
+uint64_t Histogram::get_max() const
+{
+    return max_.load(std::memory_order_relaxed);
+}
+
+double Histogram::get_mean() const
+{
+    uint64_t count = get_count();
+    if (count == 0) return 0.0;
+    return static_cast<double>(sum_.load(std::memory_order_relaxed)) / static_cast<double>(count);
+}
+
+uint64_t Histogram::get_percentile(double percentile) const
+{
+    // 記録中の値も含めてバケットのスナップショットから計算する
+    uint64_t total = 0;
+    for (const auto& bucket : buckets_) {
+        total += bucket.load(std::memory_order_relaxed);
+    }
+    if (total == 0) return 0;
+
+    percentile = std::clamp(percentile, 0.0, 100.0);
+    uint64_t rank = static_cast<uint64_t>(percentile / 100.0 * static_cast<double>(total) + 0.5);
+    rank = std::clamp<uint64_t>(rank, 1, total);
+
+    uint64_t accumulated = 0;
+    for (int i = 0; i < kBucketCount; ++i) {
+        accumulated += buckets_[i].load(std::memory_order_relaxed);
+        if (accumulated >= rank) {
+            return std::min(bucket_upper_bound(i), get_max());
+        }
+    }
+    return get_max();
+}
+
+Histogram::Summary Histogram::get_summary() const
+{
+    Summary summary = {};
+    summary.count = get_count();
+    summary.mean = get_mean();
+    summary.p50 = get_percentile(50.0);
+    summary.p95 = get_percentile(95.0);
+    summary.p99 = get_percentile(99.0);
+    summary.max = get_max();
+    return summary;
+}
+
+int Histogram::bucket_index(uint64_t value)
+{
+    if (value < static_cast<uint64_t>(kSubBucketCount)) {
+        return static_cast<int>(value);
+    }
+
+    int exponent = std::min(highest_bit(value), kMaxExponent);
+    if (exponent == kMaxExponent && highest_bit(value) > kMaxExponent) {
+        return kBucketCount - 1;
+    }
+
+    int shift = exponent - kSubBucketBits;
+    int sub_bucket = static_cast<int>(value >> shift) - kSubBucketCount;
+    return (exponent - kSubBucketBits + 1) * kSubBucketCount + sub_bucket;
+}
+
+uint64_t Histogram::bucket_upper_bound(int index)
+{
+    if (index < kSubBucketCount) {
+        return static_cast<uint64_t>(index);
+    }
+
+    int exponent = index / kSubBucketCount + kSubBucketBits - 1;
+    uint64_t top = static_cast<uint64_t>(index % kSubBucketCount + kSubBucketCount);
+    return ((top + 1) << (exponent - kSubBucketBits)) - 1;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+/**
+ * ロックフリーなHDR風ヒストグラム
+ * 2の冪ごとに32分割した対数線形バケットで、相対誤差約3%で値を記録する
+ * record()はアトミック加算のみで、複数スレッドから同時に呼び出し可能
+ */
+class Histogram {
+public:
+    struct Summary {
+        uint64_t count;
+        double mean;
+        uint64_t p50;
+        uint64_t p95;
+        uint64_t p99;
+        uint64_t max;
+    };
+
+public:
+    Histogram();
+
+    // 値の記録（単位は呼び出し側で統一する。通常はナノ秒）
+    void record(uint64_t value);
+    void reset();
+
+    // 統計値の取得
+    uint64_t get_count() const;
+    uint64_t get_max() const;
+    double get_mean() const;
+    uint64_t get_percentile(double percentile) const;
+    Summary get_summary() const;
+
+private:
+    static constexpr int kSubBucketBits = 5;
+    static constexpr int kSubBucketCount = 1 << kSubBucketBits;
+    static constexpr int kMaxExponent = 47;     // 約39時間(ns)まで
+    static constexpr int kBucketCount = (kMaxExponent - kSubBucketBits + 2) * kSubBucketCount;
+
+    static int bucket_index(uint64_t value);
+    static uint64_t bucket_upper_bound(int index);
+
+private:
+    std::array<std::atomic<uint64_t>, kBucketCount> buckets_;
+    std::atomic<uint64_t> count_;
+    std::atomic<uint64_t> sum_;
+    std::atomic<uint64_t> max_;
+};
@@ -1,31 +1,137 @@
 #include "image-matcher.h"
+#include "peak-finder.h"
+#include "profiler.h"
 #include <obs-module.h>
 #include <opencv2/imgproc.hpp>
 #include <opencv2/imgcodecs.hpp>
+#include <array>
 #include <chrono>
 #include <algorithm>
+#include <cmath>
+#include <mutex>
+
+namespace {
+
+// マルチスケールマッチングのスケール段数
+const int kScaleSteps = 5;
+
+// 自動スケーリング: 求めた倍率の前後この割合の範囲だけを探す（基準の解像度が分かっている場合）
+const float kAutoScaleBand = 0.05f;
+
+// 自動スケーリング: 倍率の変化がこの割合より小さければテンプレートを作り直さない
+const float kMinTemplateScaleChange = 0.01f;
+
+// 縮小照合の自動設定: テンプレートの短辺をこの画素数程度まで縮小する
+const float kAutoWorkingTemplateSize = 32.0f;
+const float kMinWorkingScale = 0.125f;
+const float kMinWorkingTemplateSize = 16.0f;
+
+// 縮小画像での一致度がこの分だけ閾値を下回っていても等倍で再評価する
+const float kRefineMargin = 0.1f;
+
+// 放物線補間によるピーク位置の小数部（-0.5〜0.5）
+float quadratic_peak_offset(float left, float center, float right)
+{
+    float denominator = left - 2.0f * center + right;
+    if (std::abs(denominator) < 1e-6f) return 0.0f;
+    return std::clamp(0.5f * (left - right) / denominator, -0.5f, 0.5f);
+}
+
+// 複数検出時に同一とみなす矩形の重なり（IoU）
+const float kMaxPeakOverlap = 0.3f;
+
+void set_match_geometry(ImageMatcher::MatchResult& result, cv::Point2f peak, cv::Point location,
+                        cv::Size template_size)
+{
+    result.center = cv::Point2f(peak.x + template_size.width * 0.5f,
+                               peak.y + template_size.height * 0.5f);
+    result.bounding_box = cv::Rect(location, template_size);
+    result.scale = 1.0f;
+    result.rotation = 0.0f;
+}
+
+cv::Point2f subpixel_peak_offset(const cv::Mat& map, cv::Point peak)
+{
+    cv::Point2f offset(0.0f, 0.0f);
+    float center = map.at<float>(peak);
+    if (peak.x > 0 && peak.x < map.cols - 1) {
+        offset.x = quadratic_peak_offset(map.at<float>(peak.y, peak.x - 1), center,
+                                         map.at<float>(peak.y, peak.x + 1));
+    }
+    if (peak.y > 0 && peak.y < map.rows - 1) {
+        offset.y = quadratic_peak_offset(map.at<float>(peak.y - 1, peak.x), center,
+                                         map.at<float>(peak.y + 1, peak.x));
+    }
+    return offset;
+}
+
+} // namespace
+
+// 特徴点検出器はパラメータしか持たず、detect/computeは呼び出しごとの状態を内部に残さないため、
+// 種類ごとに1つだけ作って全インスタンス（スレッドをまたいでも）で共有する
+cv::Ptr<cv::Feature2D> ImageMatcher::get_shared_detector(FeatureDetector type)
+{
+    static std::mutex mutex;
+    static std::array<cv::Ptr<cv::Feature2D>, 3> detectors;
+    static std::array<bool, 3> failed = {};
+
+    const size_t index = static_cast<size_t>(type);
+    if (index >= detectors.size()) return cv::Ptr<cv::Feature2D>();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!detectors[index] && !failed[index]) {
+        try {
+            switch (type) {
+                case FeatureDetector::ORB:
+                    // 小さいHUDテンプレートでも特徴点が取れるようにパッチサイズを小さくする
+                    detectors[index] = cv::ORB::create(1000, 1.2f, 8, 15, 0, 2, cv::ORB::HARRIS_SCORE, 15);
+                    break;
+                case FeatureDetector::AKAZE:
+                    detectors[index] = cv::AKAZE::create();
+                    break;
+                default:
+                    detectors[index] = cv::SIFT::create();
+                    break;
+            }
+        }
+        catch (const cv::Exception& e) {
+            blog(LOG_WARNING, "[ImageMatcher] Failed to create feature detector (%s): %s",
+                 get_detector_name(type), e.what());
+            failed[index] = true;
+        }
+    }
+    return detectors[index];
+}
 
 ImageMatcher::ImageMatcher()
-    : match_method_(MatchMethod::TEMPLATE_MATCHING)
+    : template_channels_(0)
+    , match_method_(MatchMethod::TEMPLATE_MATCHING)
     , min_scale_(0.8f)
     , max_scale_(1.2f)
     , rotation_tolerance_(5.0f)
     , max_matches_(1)
+    , feature_detector_(FeatureDetector::SIFT)
+    , max_target_keypoints_(1000)
+    , correlation_backend_(CorrelationBackend::AUTO)
+    , correlation_levels_dirty_(true)
+    , last_correlation_backend_(CorrelationBackend::SPATIAL)
+    , auto_scale_(false)
+    , template_scale_(1.0f)
+    , working_scale_setting_(1.0f)
+    , working_scale_(1.0f)
+    , presence_only_(false)
+    , last_presence_hit_(-1, -1)
+    , last_scan_stats_{0, 0, 0}
+    , cascade_enabled_(false)
+    , last_cascade_stats_{false, 0, -1, {}}
     , use_grayscale_(true)
     , use_edge_detection_(false)
     , blur_kernel_size_(0)
     , blur_sigma_(0.0)
+    , debug_enabled_(false)
     , last_processing_time_(0.0)
     , is_template_loaded_(false)
 {
-    try {
-        sift_detector_ = cv::SIFT::create();
-        orb_detector_ = cv::ORB::create();
-        matcher_ = cv::BFMatcher::create();
-    }
-    catch (const cv::Exception& e) {
-        blog(LOG_WARNING, "[ImageMatcher] Failed to create feature detectors: %s", e.what());
-    }
 }
 
 ImageMatcher::~ImageMatcher() = default;
@@ -38,12 +144,12 @@ bool ImageMatcher::load_template(const std::string& image_path)
     }
 
     try {
-        cv::Mat loaded_image = cv::imread(image_path, cv::IMREAD_COLOR);
-        if (loaded_image.empty()) {
+        std::shared_ptr<const TemplateAsset> asset = TemplateCache::instance().acquire(image_path);
+        if (!asset) {
             blog(LOG_ERROR, "[ImageMatcher] Failed to load template image: %s", image_path.c_str());
             return false;
         }
-        return load_template(loaded_image);
+        return load_template(asset);
     }
     catch (const cv::Exception& e) {
         blog(LOG_ERROR, "[ImageMatcher] OpenCV exception while loading template: %s", e.what());
@@ -58,32 +164,45 @@ bool ImageMatcher::load_template(const cv::Mat& template_image)
         return false;
     }
 
-    try {
-        template_image_ = template_image.clone();
-        
-        if (template_image_.channels() == 3) {
-            cv::cvtColor(template_image_, template_gray_, cv::COLOR_BGR2GRAY);
-        } else {
-            template_gray_ = template_image_.clone();
-        }
+    template_asset_.reset();
+    template_image_ = template_image.clone();
+    return finish_template_load();
+}
 
-        if (use_edge_detection_) {
-            cv::Canny(template_gray_, template_edges_, 50, 150);
-        }
+bool ImageMatcher::load_template(const std::shared_ptr<const TemplateAsset>& asset)
+{
+    if (!asset || asset->get_image().empty()) {
+        blog(LOG_WARNING, "[ImageMatcher] Empty template asset provided");
+        return false;
+    }
 
-        if (match_method_ == MatchMethod::FEATURE_MATCHING && sift_detector_) {
-            template_keypoints_.clear();
-            sift_detector_->detectAndCompute(template_gray_, cv::noArray(), 
-                                           template_keypoints_, template_descriptors_);
-            
-            blog(LOG_INFO, "[ImageMatcher] Extracted %zu keypoints from template", 
-                 template_keypoints_.size());
+    template_asset_ = asset;
+    template_image_ = asset->get_image();
+    return finish_template_load();
+}
+
+bool ImageMatcher::finish_template_load()
+{
+    try {
+        template_size_ = template_image_.size();
+        template_channels_ = template_image_.channels();
+        template_gray_.release();
+        template_edges_.release();
+        ensure_template_images();
+        cascade_.set_template(template_image_);
+
+        if (match_method_ == MatchMethod::FEATURE_MATCHING) {
+            extract_template_features();
         }
 
+        // 相関用テンプレートとスペクトルはフレーム処理前に用意しておく（使わない表現はここで外す）
+        prepare_correlation_levels();
+        last_presence_hit_ = cv::Point(-1, -1);
+
         is_template_loaded_ = true;
         
         blog(LOG_INFO, "[ImageMatcher] Template loaded successfully - Size: %dx%d, Channels: %d",
-             template_image_.cols, template_image_.rows, template_image_.channels());
+             template_size_.width, template_size_.height, template_channels_);
         
         return true;
     }
@@ -96,39 +215,178 @@ bool ImageMatcher::load_template(const cv::Mat& template_image)
 
 bool ImageMatcher::is_template_loaded() const
 {
-    return is_template_loaded_ && !template_image_.empty();
+    return is_template_loaded_ && !template_size_.empty();
+}
+
+bool ImageMatcher::is_template_current(const std::string& image_path) const
+{
+    return is_template_loaded_ && template_asset_ && template_asset_->get_path() == image_path &&
+           TemplateCache::is_current(*template_asset_);
 }
 
 ImageMatcher::MatchResult ImageMatcher::match(const cv::Mat& target_image, float threshold)
 {
+    return match_impl(target_image, threshold, nullptr);
+}
+
+bool ImageMatcher::prepare_frame(const cv::Mat& target_image, PreparedFrame& prepared) const
+{
+    PROFILE_ZONE("ImageMatcher::prepare_frame");
+    prepared = PreparedFrame();
+    if (!is_template_loaded_ || target_image.empty()) {
+        return false;
+    }
+
+    // 照合スレッドが書き換える値はスナップショットから読む
+    PrepareParams params;
+    {
+        std::lock_guard<std::mutex> lock(prepare_mutex_);
+        params = prepare_params_;
+    }
+
+    try {
+        prepared.image = target_image;
+        prepared.search_region = clip_search_region(params.search_region, target_image.size());
+        prepared.method = params.method;
+        cv::Mat search_image = target_image(prepared.search_region);
+
+        // 縮小照合はテンプレートマッチング系の手法のみ（template_matchingと同じ順序で処理する）
+        const bool template_method = params.method == MatchMethod::TEMPLATE_MATCHING ||
+                                     params.method == MatchMethod::SIMD_NCC;
+        if (template_method && params.scale < 1.0f) {
+            cv::Mat downscaled;
+            {
+                PROFILE_ZONE("downscale");
+                cv::resize(search_image, downscaled, cv::Size(), params.scale, params.scale, cv::INTER_AREA);
+            }
+            prepared.scale = params.scale;
+            prepared.processed = preprocess_image(downscaled);
+        } else {
+            prepared.scale = 1.0f;
+            prepared.processed = preprocess_image(search_image);
+        }
+    }
+    catch (const cv::Exception& e) {
+        blog(LOG_ERROR, "[ImageMatcher] OpenCV exception during preprocessing: %s", e.what());
+        prepared = PreparedFrame();
+        return false;
+    }
+
+    prepared.preprocess_end = std::chrono::steady_clock::now();
+    return true;
+}
+
+ImageMatcher::MatchResult ImageMatcher::match_prepared(const PreparedFrame& prepared, float threshold)
+{
+    return match_impl(prepared.image, threshold, &prepared);
+}
+
+bool ImageMatcher::is_prepared_usable(const PreparedFrame* prepared, float scale) const
+{
+    return prepared && !prepared->processed.empty() && prepared->method == match_method_ &&
+           prepared->scale == scale &&
+           prepared->search_region == get_effective_search_region(prepared->image.size());
+}
+
+ImageMatcher::MatchResult ImageMatcher::match_impl(const cv::Mat& target_image, float threshold,
+                                                   const PreparedFrame* prepared)
+{
+    PROFILE_ZONE("ImageMatcher::match");
     auto start_time = std::chrono::high_resolution_clock::now();
     
     MatchResult result = {};
     result.found = false;
     result.confidence = 0.0f;
+    last_scan_stats_ = {0, 0, 0};
+    last_cascade_stats_ = {false, 0, -1, {}};
+    all_matches_.clear();
 
     if (!is_template_loaded_ || target_image.empty()) {
         return result;
     }
 
-    if (!validate_images(target_image)) {
+    // ウィンドウの大きさが変わっていればテンプレートの倍率を求め直す（変わらなければ比較だけ）
+    if (auto_scale_ && match_method_ != MatchMethod::FEATURE_MATCHING) {
+        update_template_scale(target_image.size());
+    }
+
+    // 探索領域の切り出し（コピーせずに参照する）
+    cv::Rect search_region = get_effective_search_region(target_image.size());
+    cv::Mat search_image = target_image(search_region);
+
+    if (!validate_images(search_image)) {
         return result;
     }
+    last_target_size_ = search_image.size();
+
+    // 前処理の後で探索範囲が変わっていれば、前処理済みの画像は使わない
+    if (prepared && prepared->search_region != search_region) {
+        prepared = nullptr;
+    }
 
     try {
+        // カスケード: 事前判定で棄却したフレームは照合しない
+        const bool use_cascade = cascade_enabled_ && cascade_.is_ready();
+        if (use_cascade && !cascade_.screen(search_image, threshold)) {
+            last_cascade_stats_ = cascade_.get_last_stats();
+            last_preprocess_end_ = std::chrono::steady_clock::now();
+            record_matches(target_image, result);
+
+            auto end_time = std::chrono::high_resolution_clock::now();
+            last_processing_time_ = std::chrono::duration<double, std::milli>(end_time - start_time).count();
+            return result;
+        }
+
+        auto verify_start = std::chrono::steady_clock::now();
         switch (match_method_) {
             case MatchMethod::TEMPLATE_MATCHING:
-                result = template_matching(target_image, threshold);
+            case MatchMethod::SIMD_NCC:
+                result = template_matching(search_image, threshold, prepared);
                 break;
             case MatchMethod::FEATURE_MATCHING:
-                result = feature_matching(target_image, threshold);
+                result = feature_matching(search_image, threshold, prepared);
                 break;
             case MatchMethod::MULTI_SCALE:
-                result = multi_scale_matching(target_image, threshold);
+                result = multi_scale_matching(search_image, threshold, prepared);
+                break;
+            case MatchMethod::ROTATED:
+                result = rotated_matching(search_image, threshold, prepared);
                 break;
         }
 
-        update_debug_image(target_image, result);
+        if (use_cascade) {
+            cascade_.record_verification(result.found, static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - verify_start).count()));
+            last_cascade_stats_ = cascade_.get_last_stats();
+        }
+
+        // テンプレートマッチング系の倍率は自動スケーリングの倍率
+        if (match_method_ == MatchMethod::TEMPLATE_MATCHING || match_method_ == MatchMethod::SIMD_NCC ||
+            match_method_ == MatchMethod::ROTATED) {
+            result.scale = result.found ? template_scale_ : result.scale;
+            for (auto& match : all_matches_) {
+                match.scale = template_scale_;
+            }
+        }
+
+        // 基準の解像度が未設定なら、検出したときのフレームの大きさと倍率から記録する
+        if (result.found && auto_scale_ && reference_size_.empty() &&
+            match_method_ != MatchMethod::FEATURE_MATCHING) {
+            learn_reference_size(target_image.size(), result.scale);
+        }
+
+        // 探索領域の座標から元画像の座標に戻す
+        if (result.found) {
+            result.center += cv::Point2f(search_region.tl());
+            result.bounding_box += search_region.tl();
+        }
+        for (auto& match : all_matches_) {
+            match.center += cv::Point2f(search_region.tl());
+            match.bounding_box += search_region.tl();
+        }
+
+        record_matches(target_image, result);
     }
     catch (const cv::Exception& e) {
         blog(LOG_ERROR, "[ImageMatcher] OpenCV exception during matching: %s", e.what());
@@ -144,11 +402,15 @@ void ImageMatcher::set_match_method(MatchMethod method)
 {
     if (match_method_ != method) {
         match_method_ = method;
+        correlation_levels_dirty_ = true;
+        publish_prepare_params();
+
+        // 回転・拡大縮小を許す手法では低解像度NCCで棄却しない
+        cascade_.set_coarse_stage_enabled(method == MatchMethod::TEMPLATE_MATCHING ||
+                                          method == MatchMethod::SIMD_NCC);
         
-        if (method == MatchMethod::FEATURE_MATCHING && is_template_loaded_ && sift_detector_) {
-            template_keypoints_.clear();
-            sift_detector_->detectAndCompute(template_gray_, cv::noArray(),
-                                           template_keypoints_, template_descriptors_);
+        if (method == MatchMethod::FEATURE_MATCHING && is_template_loaded_) {
+            extract_template_features();
         }
     }
 }
@@ -161,31 +423,118 @@ void ImageMatcher::set_scale_range(float min_scale, float max_scale)
     if (min_scale_ > max_scale_) {
         std::swap(min_scale_, max_scale_);
     }
+    correlation_levels_dirty_ = true;
 }
 
 void ImageMatcher::set_rotation_tolerance(float degrees)
 {
-    rotation_tolerance_ = std::clamp(degrees, 0.0f, 180.0f);
+    const float tolerance = std::clamp(degrees, 0.0f, 180.0f);
+    if (rotation_tolerance_ != tolerance) {
+        rotation_tolerance_ = tolerance;
+        correlation_levels_dirty_ = true;
+    }
 }
 
 void ImageMatcher::set_max_matches(int max_matches)
 {
-    max_matches_ = std::max(1, max_matches);
+    max_matches_ = std::clamp(max_matches, 1, 64);
+}
+
+void ImageMatcher::set_feature_detector(FeatureDetector detector)
+{
+    if (feature_detector_ != detector) {
+        feature_detector_ = detector;
+        active_detector_.release();
+
+        if (match_method_ == MatchMethod::FEATURE_MATCHING && is_template_loaded_) {
+            extract_template_features();
+        }
+    }
+}
+
+void ImageMatcher::set_max_target_keypoints(int max_keypoints)
+{
+    max_target_keypoints_ = std::max(0, max_keypoints);
+}
+
+void ImageMatcher::set_search_region(const cv::Rect& region)
+{
+    if (search_region_ != region) {
+        search_region_ = region;
+        last_presence_hit_ = cv::Point(-1, -1);
+        publish_prepare_params();
+    }
+}
+
+void ImageMatcher::set_correlation_backend(CorrelationBackend backend)
+{
+    if (correlation_backend_ != backend) {
+        correlation_backend_ = backend;
+        correlation_levels_dirty_ = true;
+    }
+}
+
+void ImageMatcher::set_presence_only(bool enable)
+{
+    if (presence_only_ != enable) {
+        presence_only_ = enable;
+        correlation_levels_dirty_ = true;
+    }
+}
+
+void ImageMatcher::set_working_scale(float scale)
+{
+    scale = (scale <= 0.0f) ? 0.0f : std::clamp(scale, kMinWorkingScale, 1.0f);
+    if (working_scale_setting_ != scale) {
+        working_scale_setting_ = scale;
+        correlation_levels_dirty_ = true;
+    }
+}
+
+void ImageMatcher::set_cascade_enabled(bool enable)
+{
+    cascade_enabled_ = enable;
+}
+
+void ImageMatcher::set_auto_scale(bool enable)
+{
+    if (auto_scale_ == enable) return;
+    auto_scale_ = enable;
+
+    // 無効にした場合は等倍に戻し、有効にした場合は次のフレームで倍率を求める
+    window_size_ = cv::Size();
+    if (!enable && template_scale_ != 1.0f) {
+        template_scale_ = 1.0f;
+        correlation_levels_dirty_ = true;
+        if (is_template_loaded_) {
+            cascade_.set_template(template_asset_ ? template_asset_->get_image() : template_image_);
+        }
+    }
+}
+
+void ImageMatcher::set_reference_size(cv::Size size)
+{
+    if (size.width <= 0 || size.height <= 0) {
+        size = cv::Size();
+    }
+    if (reference_size_ == size) return;
+    reference_size_ = size;
+    window_size_ = cv::Size();      // 次のフレームで倍率を求め直す
 }
 
 void ImageMatcher::enable_grayscale_conversion(bool enable)
 {
-    use_grayscale_ = enable;
+    if (use_grayscale_ != enable) {
+        use_grayscale_ = enable;
+        correlation_levels_dirty_ = true;
+    }
 }
 
 void ImageMatcher::enable_edge_detection(bool enable)
 {
     if (use_edge_detection_ != enable) {
         use_edge_detection_ = enable;
-        
-        if (enable && is_template_loaded_) {
-            cv::Canny(template_gray_, template_edges_, 50, 150);
-        }
+        correlation_levels_dirty_ = true;
     }
 }
 
@@ -195,15 +544,53 @@ void ImageMatcher::set_gaussian_blur(int kernel_size, double sigma_x)
     blur_sigma_ = std::max(0.0, sigma_x);
 }
 
+void ImageMatcher::enable_debug(bool enable)
+{
+    debug_enabled_ = enable;
+    if (!enable) {
+        debug_target_.release();
+    }
+}
+
+void ImageMatcher::release_frame_buffers()
+{
+    // debug_target_はキャプチャしたフレームを参照しているため、ここで手放す
+    working_target_.release();
+    rotation_bank_.release_buffers();
+    debug_target_.release();
+    all_matches_.clear();
+    all_matches_.shrink_to_fit();
+}
+
 cv::Mat ImageMatcher::get_debug_image() const
 {
-    return debug_image_.clone();
+    if (debug_target_.empty()) return cv::Mat();
+
+    cv::Mat debug_image;
+    if (debug_target_.channels() == 1) {
+        cv::cvtColor(debug_target_, debug_image, cv::COLOR_GRAY2BGR);
+    } else {
+        debug_image = debug_target_.clone();
+    }
+
+    for (const auto& result : all_matches_) {
+        cv::rectangle(debug_image, result.bounding_box, cv::Scalar(0, 255, 0), 2);
+        cv::circle(debug_image, result.center, 5, cv::Scalar(0, 0, 255), -1);
+
+        std::string confidence_text = "Confidence: " + std::to_string(result.confidence);
+        cv::putText(debug_image, confidence_text,
+                   cv::Point(result.bounding_box.x, result.bounding_box.y - 10),
+                   cv::FONT_HERSHEY_SIMPLEX, 0.5, cv::Scalar(255, 255, 255), 1);
+    }
+
+    return debug_image;
 }
 
 void ImageMatcher::save_debug_image(const std::string& path) const
 {
-    if (!debug_image_.empty()) {
-        cv::imwrite(path, debug_image_);
+    cv::Mat debug_image = get_debug_image();
+    if (!debug_image.empty()) {
+        cv::imwrite(path, debug_image);
     }
 }
 
@@ -217,92 +604,349 @@ double ImageMatcher::get_last_processing_time() const
     return last_processing_time_;
 }
 
+std::chrono::steady_clock::time_point ImageMatcher::get_last_preprocess_end() const
+{
+    return last_preprocess_end_;
+}
+
 size_t ImageMatcher::get_template_size() const
 {
-    if (template_image_.empty()) return 0;
-    return template_image_.rows * template_image_.cols * template_image_.channels();
+    return static_cast<size_t>(template_size_.area()) * template_channels_;
+}
+
+size_t ImageMatcher::get_memory_usage() const
+{
+    auto mat_bytes = [](const cv::Mat& mat) { return mat.total() * mat.elemSize(); };
+
+    // 共有テンプレートの画像と記述子はTemplateCache側で数える
+    size_t bytes = template_keypoints_.size() * sizeof(cv::KeyPoint);
+    if (!template_asset_) {
+        bytes += mat_bytes(template_image_) + mat_bytes(template_gray_) + mat_bytes(template_edges_) +
+                 mat_bytes(template_descriptors_);
+    }
+
+    bytes += mat_bytes(template_level_.template_image) + template_level_.fft.get_memory_usage() +
+             template_level_.ncc.get_memory_usage() +
+             presence_scanner_.get_memory_usage() + mat_bytes(working_target_) +
+             cascade_.get_memory_usage() + rotation_bank_.get_memory_usage();
+    for (const auto& level : scale_levels_) {
+        bytes += mat_bytes(level.template_image) + level.fft.get_memory_usage();
+    }
+    return bytes;
+}
+
+const char* ImageMatcher::get_backend_name(CorrelationBackend backend)
+{
+    switch (backend) {
+        case CorrelationBackend::AUTO:    return "auto";
+        case CorrelationBackend::SPATIAL: return "spatial";
+        case CorrelationBackend::FFT:     return "fft";
+        case CorrelationBackend::SIMD:    return "simd";
+        default:                          return "unknown";
+    }
 }
 
-ImageMatcher::MatchResult ImageMatcher::template_matching(const cv::Mat& target, float threshold)
+const char* ImageMatcher::get_detector_name(FeatureDetector detector)
+{
+    switch (detector) {
+        case FeatureDetector::SIFT:  return "sift";
+        case FeatureDetector::ORB:   return "orb";
+        case FeatureDetector::AKAZE: return "akaze";
+        default:                     return "unknown";
+    }
+}
+
+const char* ImageMatcher::get_method_name(MatchMethod method)
+{
+    switch (method) {
+        case MatchMethod::TEMPLATE_MATCHING: return "template";
+        case MatchMethod::FEATURE_MATCHING:  return "feature";
+        case MatchMethod::MULTI_SCALE:       return "multi_scale";
+        case MatchMethod::SIMD_NCC:          return "simd_ncc";
+        case MatchMethod::ROTATED:           return "rotated";
+        default:                             return "unknown";
+    }
+}
+
+ImageMatcher::MatchResult ImageMatcher::template_matching(const cv::Mat& target, float threshold,
+                                                        const PreparedFrame* prepared)
 {
     MatchResult result = {};
-    
-    cv::Mat target_processed = preprocess_image(target);
-    cv::Mat template_processed = use_edge_detection_ ? template_edges_ : 
-                                (use_grayscale_ ? template_gray_ : template_image_);
+
+    if (correlation_levels_dirty_) {
+        prepare_correlation_levels();
+    }
+
+    // 縮小照合時は前処理の前に縮小する
+    cv::Mat target_processed;
+    if (is_prepared_usable(prepared, working_scale_)) {
+        target_processed = prepared->processed;
+        last_preprocess_end_ = prepared->preprocess_end;
+    } else {
+        if (working_scale_ < 1.0f) {
+            {
+                PROFILE_ZONE("downscale");
+                cv::resize(target, working_target_, cv::Size(), working_scale_, working_scale_, cv::INTER_AREA);
+            }
+            target_processed = preprocess_image(working_target_);
+        } else {
+            target_processed = preprocess_image(target);
+        }
+        last_preprocess_end_ = std::chrono::steady_clock::now();
+    }
+
+    const cv::Mat& template_processed = template_level_.template_image;
+    if (template_processed.cols > target_processed.cols || template_processed.rows > target_processed.rows) {
+        return result;
+    }
+
+    if (presence_only_ && presence_scanner_.is_ready() && target_processed.channels() == 1) {
+        return presence_matching(target, target_processed, threshold);
+    }
 
     cv::Mat match_result;
-    cv::matchTemplate(target_processed, template_processed, match_result, cv::TM_CCOEFF_NORMED);
+    correlate(target_processed, template_level_, match_result);
+
+    if (max_matches_ > 1) {
+        return collect_peaks(target, match_result, threshold);
+    }
 
     double min_val, max_val;
     cv::Point min_loc, max_loc;
-    cv::minMaxLoc(match_result, &min_val, &max_val, &min_loc, &max_loc);
+    {
+        PROFILE_ZONE("minMaxLoc");
+        cv::minMaxLoc(match_result, &min_val, &max_val, &min_loc, &max_loc);
+    }
 
     result.confidence = static_cast<float>(max_val);
+
+    // 縮小画像でのピークを等倍で再探索して位置と信頼度を確定する
+    if (working_scale_ < 1.0f) {
+        if (result.confidence >= threshold - kRefineMargin) {
+            refine_at_full_resolution(target, max_loc, threshold, result);
+        }
+        return result;
+    }
+
     result.found = result.confidence >= threshold;
 
     if (result.found) {
-        cv::Size template_size = template_processed.size();
-        result.center = cv::Point2f(max_loc.x + template_size.width * 0.5f,
-                                   max_loc.y + template_size.height * 0.5f);
-        result.bounding_box = cv::Rect(max_loc, template_size);
-        result.scale = 1.0f;
-        result.rotation = 0.0f;
+        cv::Point2f peak = cv::Point2f(max_loc) + subpixel_peak_offset(match_result, max_loc);
+        set_match_geometry(result, peak, max_loc, template_processed.size());
     }
 
     return result;
 }
 
-ImageMatcher::MatchResult ImageMatcher::feature_matching(const cv::Mat& target, float threshold)
+ImageMatcher::MatchResult ImageMatcher::collect_peaks(const cv::Mat& target, const cv::Mat& match_result,
+                                                      float threshold)
+{
+    const bool refine = working_scale_ < 1.0f;
+    const cv::Size template_size = template_level_.template_image.size();
+
+    std::vector<peak_finder::Peak> peaks = peak_finder::find_peaks(
+        match_result, refine ? threshold - kRefineMargin : threshold, max_matches_,
+        template_size, kMaxPeakOverlap);
+
+    for (const auto& peak : peaks) {
+        MatchResult match = {};
+        match.confidence = peak.score;
+
+        if (refine) {
+            refine_at_full_resolution(target, peak.location, threshold, match);
+            if (!match.found) continue;
+        } else {
+            match.found = true;
+            cv::Point2f position = cv::Point2f(peak.location) + subpixel_peak_offset(match_result, peak.location);
+            set_match_geometry(match, position, peak.location, template_size);
+        }
+        all_matches_.push_back(match);
+    }
+
+    // 等倍での再評価で順位が入れ替わることがある
+    std::stable_sort(all_matches_.begin(), all_matches_.end(),
+                     [](const MatchResult& a, const MatchResult& b) { return a.confidence > b.confidence; });
+
+    // 縮小マップで離れていた候補が等倍で同じ位置に寄ることがあるため、等倍の矩形でもう一度抑制する
+    if (refine && all_matches_.size() > 1) {
+        std::vector<MatchResult> kept;
+        kept.reserve(all_matches_.size());
+        for (const auto& match : all_matches_) {
+            bool suppressed = false;
+            for (const auto& selected : kept) {
+                if (peak_finder::box_overlap(match.bounding_box.tl(), selected.bounding_box.tl(),
+                                             match.bounding_box.size()) > kMaxPeakOverlap) {
+                    suppressed = true;
+                    break;
+                }
+            }
+            if (!suppressed) {
+                kept.push_back(match);
+            }
+        }
+        all_matches_.swap(kept);
+    }
+
+    if (all_matches_.empty()) {
+        MatchResult result = {};
+        result.confidence = peaks.empty() ? 0.0f : peaks.front().score;
+        return result;
+    }
+    return all_matches_.front();
+}
+
+void ImageMatcher::refine_at_full_resolution(const cv::Mat& target, cv::Point working_location,
+                                             float threshold, MatchResult& result)
+{
+    PROFILE_ZONE("refine_peak");
+
+    // 縮小による位置の誤差（1/scale画素）を覆う範囲だけを等倍で照合する
+    const cv::Size template_size = full_template_.size();
+    const int radius = static_cast<int>(std::ceil(1.0f / working_scale_)) + 1;
+    cv::Point approx(cvRound(working_location.x / working_scale_), cvRound(working_location.y / working_scale_));
+
+    cv::Rect window(approx.x - radius, approx.y - radius,
+                    template_size.width + 2 * radius, template_size.height + 2 * radius);
+    window &= cv::Rect(0, 0, target.cols, target.rows);
+    if (window.width < template_size.width || window.height < template_size.height) {
+        result.found = false;
+        return;
+    }
+
+    cv::Mat local_processed = preprocess_image(target(window));
+    cv::Mat local_result;
+    cv::matchTemplate(local_processed, full_template_, local_result, cv::TM_CCOEFF_NORMED);
+
+    double min_val, max_val;
+    cv::Point min_loc, max_loc;
+    cv::minMaxLoc(local_result, &min_val, &max_val, &min_loc, &max_loc);
+
+    result.confidence = static_cast<float>(max_val);
+    result.found = result.confidence >= threshold;
+
+    if (result.found) {
+        cv::Point2f peak = cv::Point2f(window.tl() + max_loc) + subpixel_peak_offset(local_result, max_loc);
+        set_match_geometry(result, peak, window.tl() + max_loc, template_size);
+    }
+}
+
+ImageMatcher::MatchResult ImageMatcher::presence_matching(const cv::Mat& target, const cv::Mat& target_processed,
+                                                          float threshold)
+{
+    MatchResult result = {};
+    cv::Size template_size = presence_scanner_.get_template_size();
+
+    // 前回の検出位置、なければ探索領域の中央から調べる
+    cv::Point seed = last_presence_hit_;
+    if (seed.x < 0 || seed.y < 0) {
+        seed = cv::Point((target_processed.cols - template_size.width) / 2,
+                         (target_processed.rows - template_size.height) / 2);
+    }
+
+    // 縮小照合時は最初に見つかった候補だけを等倍で確認する
+    const bool refine = working_scale_ < 1.0f;
+    const float scan_threshold = refine ? threshold - kRefineMargin : threshold;
+
+    cv::Point location;
+    float score = 0.0f;
+    result.found = presence_scanner_.scan(target_processed, scan_threshold, seed, location, score);
+    last_scan_stats_ = presence_scanner_.get_last_stats();
+
+    if (result.found && refine) {
+        result.confidence = score;
+        refine_at_full_resolution(target, location, threshold, result);
+        // 等倍で否定された候補からは次のフレームを始めない
+        if (result.found) {
+            last_presence_hit_ = location;
+        }
+    } else if (result.found) {
+        result.confidence = score;
+        set_match_geometry(result, cv::Point2f(location), location, template_size);
+        last_presence_hit_ = location;
+    }
+
+    return result;
+}
+
+ImageMatcher::MatchResult ImageMatcher::feature_matching(const cv::Mat& target, float threshold,
+                                                       const PreparedFrame* prepared)
 {
     MatchResult result = {};
     
-    if (!sift_detector_ || template_keypoints_.empty()) {
+    cv::Ptr<cv::Feature2D> detector = get_active_detector();
+    if (!detector || !descriptor_index_ || template_keypoints_.empty()) {
         return result;
     }
 
-    cv::Mat target_gray = preprocess_image(target);
+    const bool use_prepared = is_prepared_usable(prepared, 1.0f);
+    cv::Mat target_gray = use_prepared ? prepared->processed : preprocess_image(target);
+    last_preprocess_end_ = use_prepared ? prepared->preprocess_end : std::chrono::steady_clock::now();
     
     std::vector<cv::KeyPoint> target_keypoints;
     cv::Mat target_descriptors;
     
-    sift_detector_->detectAndCompute(target_gray, cv::noArray(), target_keypoints, target_descriptors);
+    {
+        PROFILE_ZONE("feature_detect");
+        detector->detect(target_gray, target_keypoints);
+
+        // 応答の強い特徴点だけに絞ってから記述子を計算する
+        if (max_target_keypoints_ > 0 &&
+            target_keypoints.size() > static_cast<size_t>(max_target_keypoints_)) {
+            cv::KeyPointsFilter::retainBest(target_keypoints, max_target_keypoints_);
+        }
+
+        if (!target_keypoints.empty()) {
+            detector->compute(target_gray, target_keypoints, target_descriptors);
+        }
+    }
 
     if (target_keypoints.empty() || target_descriptors.empty()) {
         return result;
     }
 
+    // テンプレート側のインデックスに対して対象の記述子を問い合わせる
     std::vector<std::vector<cv::DMatch>> knn_matches;
-    matcher_->knnMatch(template_descriptors_, target_descriptors, knn_matches, 2);
+    {
+        PROFILE_ZONE("knn_match");
+        descriptor_index_->knnMatch(target_descriptors, knn_matches, 2);
+    }
 
     std::vector<cv::DMatch> good_matches;
-    const float ratio_threshold = 0.7f;
+    const float ratio_threshold = (template_descriptors_.type() == CV_8U) ? 0.8f : 0.7f;
+    std::vector<bool> template_matched(template_keypoints_.size(), false);
+    size_t unique_template_matches = 0;
     
     for (const auto& match_pair : knn_matches) {
         if (match_pair.size() == 2 && 
             match_pair[0].distance < ratio_threshold * match_pair[1].distance) {
             good_matches.push_back(match_pair[0]);
+
+            int template_index = match_pair[0].trainIdx;
+            if (template_index >= 0 && !template_matched[template_index]) {
+                template_matched[template_index] = true;
+                ++unique_template_matches;
+            }
         }
     }
 
-    const int min_matches = 10;
+    const size_t min_matches = std::min<size_t>(10, std::max<size_t>(4, template_keypoints_.size() / 2));
     if (good_matches.size() < min_matches) {
         return result;
     }
 
-    result.confidence = static_cast<float>(good_matches.size()) / 
+    result.confidence = static_cast<float>(unique_template_matches) / 
                        static_cast<float>(template_keypoints_.size());
     result.found = result.confidence >= threshold;
 
     if (result.found) {
         cv::Point2f center(0, 0);
         for (const auto& match : good_matches) {
-            center += target_keypoints[match.trainIdx].pt;
+            center += target_keypoints[match.queryIdx].pt;
         }
         center /= static_cast<float>(good_matches.size());
         result.center = center;
         
-        cv::Size template_size = template_image_.size();
+        cv::Size template_size = template_size_;
         result.bounding_box = calculate_bounding_box(cv::Point(center), template_size);
         result.scale = 1.0f;
         result.rotation = 0.0f;
@@ -311,27 +955,42 @@ ImageMatcher::MatchResult ImageMatcher::feature_matching(const cv::Mat& target,
     return result;
 }
 
-ImageMatcher::MatchResult ImageMatcher::multi_scale_matching(const cv::Mat& target, float threshold)
+ImageMatcher::MatchResult ImageMatcher::multi_scale_matching(const cv::Mat& target, float threshold,
+                                                           const PreparedFrame* prepared)
 {
     MatchResult best_result = {};
     
-    cv::Mat target_processed = preprocess_image(target);
-    cv::Mat template_processed = use_grayscale_ ? template_gray_ : template_image_;
+    const bool use_prepared = is_prepared_usable(prepared, 1.0f);
+    cv::Mat target_processed = use_prepared ? prepared->processed : preprocess_image(target);
+    last_preprocess_end_ = use_prepared ? prepared->preprocess_end : std::chrono::steady_clock::now();
 
-    const int scale_steps = 5;
-    for (int i = 0; i < scale_steps; ++i) {
-        float scale = min_scale_ + (max_scale_ - min_scale_) * i / (scale_steps - 1);
-        
-        cv::Mat scaled_template;
-        cv::resize(template_processed, scaled_template, cv::Size(), scale, scale);
+    if (correlation_levels_dirty_) {
+        prepare_correlation_levels();
+    }
+
+    const bool auto_scaled = is_auto_scaled();
+    for (size_t index = 0; index < scale_levels_.size(); ++index) {
+        CorrelationLevel& level = scale_levels_[index];
 
-        if (scaled_template.cols > target_processed.cols || 
+        // 自動スケーリング中は求めた倍率（先頭）だけを探し、閾値をわずかに下回った場合だけ前後の倍率も探す。
+        // 対象が映っていないフレームでは等倍のテンプレートマッチングと同じコストになる
+        if (auto_scaled && index > 0 &&
+            (best_result.found || best_result.confidence < threshold - kRefineMargin)) {
+            break;
+        }
+
+        PROFILE_ZONE("multi_scale_level");
+        const float scale = level.scale;
+        const cv::Mat& scaled_template = level.template_image;
+
+        if (scaled_template.empty() ||
+            scaled_template.cols > target_processed.cols || 
             scaled_template.rows > target_processed.rows) {
             continue;
         }
 
         cv::Mat match_result;
-        cv::matchTemplate(target_processed, scaled_template, match_result, cv::TM_CCOEFF_NORMED);
+        correlate(target_processed, level, match_result);
 
         double min_val, max_val;
         cv::Point min_loc, max_loc;
@@ -355,8 +1014,44 @@ ImageMatcher::MatchResult ImageMatcher::multi_scale_matching(const cv::Mat& targ
     return best_result;
 }
 
+ImageMatcher::MatchResult ImageMatcher::rotated_matching(const cv::Mat& target, float threshold,
+                                                       const PreparedFrame* prepared)
+{
+    MatchResult result = {};
+
+    const bool use_prepared = is_prepared_usable(prepared, 1.0f);
+    cv::Mat target_processed = use_prepared ? prepared->processed : preprocess_image(target);
+    last_preprocess_end_ = use_prepared ? prepared->preprocess_end : std::chrono::steady_clock::now();
+
+    if (correlation_levels_dirty_) {
+        prepare_correlation_levels();
+    }
+    if (!rotation_bank_.is_ready()) {
+        return result;
+    }
+
+    // 回転済みテンプレートはグレースケール（前処理済みの画像は共有なので別のMatに変換する）
+    cv::Mat target_gray = target_processed;
+    if (target_gray.channels() == 3) {
+        cv::cvtColor(target_processed, target_gray, cv::COLOR_BGR2GRAY);
+    }
+
+    RotationBank::Match match = rotation_bank_.match(target_gray, threshold);
+    result.found = match.found;
+    result.confidence = match.confidence;
+    if (match.found) {
+        result.center = match.center;
+        result.bounding_box = match.bounding_box;
+        result.scale = 1.0f;
+        result.rotation = match.angle;
+    }
+
+    return result;
+}
+
 cv::Mat ImageMatcher::preprocess_image(const cv::Mat& image) const
 {
+    PROFILE_ZONE("preprocess");
     cv::Mat processed = image.clone();
 
     if (use_grayscale_ && processed.channels() > 1) {
@@ -398,20 +1093,370 @@ cv::Rect ImageMatcher::calculate_bounding_box(cv::Point center, cv::Size templat
     return cv::Rect(top_left, scaled_size);
 }
 
+cv::Ptr<cv::Feature2D> ImageMatcher::get_active_detector()
+{
+    if (!active_detector_) {
+        active_detector_ = get_shared_detector(feature_detector_);
+    }
+    return active_detector_;
+}
+
+void ImageMatcher::extract_template_features()
+{
+    template_keypoints_.clear();
+    template_descriptors_.release();
+    descriptor_index_.release();
+
+    cv::Ptr<cv::Feature2D> detector = get_active_detector();
+    if (!detector || !ensure_template_images()) return;
+
+    if (template_asset_) {
+        // 同じファイル・同じ検出器の特徴点は一度だけ抽出して共有する
+        std::shared_ptr<const TemplateAsset::Features> features =
+            template_asset_->get_features(static_cast<int>(feature_detector_), detector);
+        template_keypoints_ = features->keypoints;
+        template_descriptors_ = features->descriptors;
+    } else {
+        detector->detectAndCompute(template_gray_, cv::noArray(), template_keypoints_, template_descriptors_);
+    }
+    if (template_descriptors_.empty()) {
+        blog(LOG_WARNING, "[ImageMatcher] No keypoints found in template (%s)",
+             get_detector_name(feature_detector_));
+        return;
+    }
+
+    // バイナリ記述子はLSH、浮動小数記述子はKD木でインデックスを構築する
+    if (template_descriptors_.type() == CV_8U) {
+        descriptor_index_ = cv::makePtr<cv::FlannBasedMatcher>(
+            cv::makePtr<cv::flann::LshIndexParams>(12, 20, 2));
+    } else {
+        descriptor_index_ = cv::makePtr<cv::FlannBasedMatcher>(
+            cv::makePtr<cv::flann::KDTreeIndexParams>(4), cv::makePtr<cv::flann::SearchParams>(32));
+    }
+    descriptor_index_->add(std::vector<cv::Mat>{template_descriptors_});
+    descriptor_index_->train();
+
+    blog(LOG_INFO, "[ImageMatcher] Extracted %zu keypoints from template (%s)",
+         template_keypoints_.size(), get_detector_name(feature_detector_));
+}
+
+bool ImageMatcher::needs_template_gray() const
+{
+    return use_grayscale_ || use_edge_detection_ || match_method_ == MatchMethod::FEATURE_MATCHING;
+}
+
+bool ImageMatcher::ensure_template_images()
+{
+    // 共有テンプレートは変換済みの画像を参照するだけで、手元でコピー・変換しない
+    if (template_asset_) {
+        if (template_image_.empty() && !use_grayscale_) {
+            template_image_ = template_asset_->get_image();
+        }
+        if (template_gray_.empty() && needs_template_gray()) {
+            template_gray_ = template_asset_->get_gray();
+        }
+        if (template_edges_.empty() && use_edge_detection_) {
+            template_edges_ = template_asset_->get_edges();
+        }
+        return !(use_grayscale_ ? template_gray_ : template_image_).empty();
+    }
+
+    if (template_image_.empty()) return false;
+
+    if (needs_template_gray() && template_gray_.empty()) {
+        if (template_image_.channels() == 3) {
+            cv::cvtColor(template_image_, template_gray_, cv::COLOR_BGR2GRAY);
+        } else {
+            template_gray_ = template_image_;   // 単一チャンネルはカラー画像とデータを共有する
+        }
+    }
+
+    if (use_edge_detection_ && template_edges_.empty() && !template_gray_.empty()) {
+        cv::Canny(template_gray_, template_edges_, 50, 150);
+    }
+
+    return !(use_grayscale_ ? template_gray_ : template_image_).empty();
+}
+
+void ImageMatcher::trim_template_images()
+{
+    if (!use_edge_detection_) {
+        template_edges_.release();
+    }
+
+    // グレーはカラーから作り直せる。カラーは共有テンプレートから再び参照できる場合だけ外す
+    if (!needs_template_gray() && !template_image_.empty()) {
+        template_gray_.release();
+    }
+    if (use_grayscale_ && template_asset_ && !template_gray_.empty()) {
+        template_image_.release();
+    }
+}
+
+void ImageMatcher::prepare_correlation_levels()
+{
+    correlation_levels_dirty_ = false;
+    template_level_ = CorrelationLevel();
+    scale_levels_.clear();
+    presence_scanner_.reset();
+    rotation_bank_.reset();
+    full_template_.release();
+    last_presence_hit_ = cv::Point(-1, -1);
+
+    if (!ensure_template_images()) return;
+
+    const bool use_edges = use_edge_detection_ && !template_edges_.empty();
+    const cv::Mat& original_template = use_grayscale_ ? template_gray_ : template_image_;
+
+    // 自動スケーリング: 現在のウィンドウの解像度に合わせたテンプレート（等倍なら元の画像を参照する）
+    cv::Mat base_template = original_template;
+    cv::Mat edge_source = template_gray_;
+    if (template_scale_ != 1.0f) {
+        const int interpolation = template_scale_ < 1.0f ? cv::INTER_AREA : cv::INTER_LINEAR;
+        cv::resize(original_template, base_template, cv::Size(), template_scale_, template_scale_, interpolation);
+        if (use_edges) {
+            cv::resize(template_gray_, edge_source, cv::Size(), template_scale_, template_scale_, interpolation);
+        }
+    }
+    if (!use_edges) {
+        full_template_ = base_template;
+    } else if (template_scale_ != 1.0f) {
+        cv::Canny(edge_source, full_template_, 50, 150);
+    } else {
+        full_template_ = template_edges_;
+    }
+
+    // 縮小照合用のテンプレート（対象画像と同じく縮小してから前処理する）
+    working_scale_ = compute_working_scale(full_template_.size());
+    publish_prepare_params();
+    cv::Mat working_template = full_template_;
+    if (working_scale_ < 1.0f) {
+        cv::resize(use_edges ? edge_source : base_template, working_template, cv::Size(),
+                   working_scale_, working_scale_, cv::INTER_AREA);
+        if (use_edges) {
+            cv::Canny(working_template, working_template, 50, 150);
+        }
+    }
+
+    cv::Size expected_size = search_region_.empty() ? last_target_size_ : search_region_.size();
+    cv::Size working_size(static_cast<int>(expected_size.width * working_scale_),
+                          static_cast<int>(expected_size.height * working_scale_));
+    init_correlation_level(template_level_, working_template, 1.0f,
+                           (match_method_ == MatchMethod::TEMPLATE_MATCHING && !presence_only_) ?
+                           working_size : cv::Size());
+
+    if (presence_only_) {
+        presence_scanner_.set_template(template_level_.template_image);
+    }
+
+    // 回転済みのテンプレートは等倍の前処理済みテンプレートから作る（照合のたびに回転しない）
+    if (match_method_ == MatchMethod::ROTATED) {
+        cv::Mat rotation_source = full_template_;
+        if (rotation_source.channels() == 3) {
+            cv::cvtColor(rotation_source, rotation_source, cv::COLOR_BGR2GRAY);
+        }
+        if (rotation_bank_.set_template(rotation_source, rotation_tolerance_)) {
+            blog(LOG_INFO, "[ImageMatcher] Rotation bank: %zu angles (step %.2f deg, %zu coarse) within +/-%.1f deg",
+                 rotation_bank_.get_angle_count(), rotation_bank_.get_angle_step(),
+                 rotation_bank_.get_coarse_angle_count(), rotation_tolerance_);
+        } else {
+            blog(LOG_WARNING, "[ImageMatcher] Failed to build rotated templates (template too small or flat)");
+        }
+    }
+
+    // スケールごとのテンプレートはマルチスケールでのみ使う（手法を変えると作り直される）。
+    // 基準の解像度が分かっていれば、求めた倍率とその前後の狭い範囲だけを探す（先頭が求めた倍率）
+    std::vector<float> scales;
+    if (match_method_ == MatchMethod::MULTI_SCALE && is_auto_scaled()) {
+        scales = {template_scale_, template_scale_ * (1.0f - kAutoScaleBand), template_scale_ * (1.0f + kAutoScaleBand)};
+    } else if (match_method_ == MatchMethod::MULTI_SCALE) {
+        for (int i = 0; i < kScaleSteps; ++i) {
+            scales.push_back(min_scale_ + (max_scale_ - min_scale_) * i / (kScaleSteps - 1));
+        }
+    }
+    for (float scale : scales) {
+        cv::Mat scaled_template = base_template;
+        if (scale != template_scale_) {
+            cv::resize(original_template, scaled_template, cv::Size(), scale, scale);
+        }
+
+        CorrelationLevel level;
+        init_correlation_level(level, scaled_template, scale, expected_size);
+        scale_levels_.push_back(std::move(level));
+    }
+
+    trim_template_images();
+}
+
+void ImageMatcher::init_correlation_level(CorrelationLevel& level, const cv::Mat& template_image,
+                                          float scale, cv::Size expected_size)
+{
+    level.scale = scale;
+    level.template_image = template_image;
+
+    // SIMD_NCCではFFT用のスペクトルは不要
+    if (match_method_ == MatchMethod::SIMD_NCC && template_image.type() == CV_8UC1 &&
+        level.ncc.set_template(template_image.data, template_image.cols, template_image.rows,
+                               template_image.step)) {
+        return;
+    }
+
+    if (correlation_backend_ == CorrelationBackend::SPATIAL || !level.fft.set_template(template_image)) {
+        return;
+    }
+
+    // 探索サイズが分かっていれば、FFTを使う場合のスペクトルをここで計算しておく
+    if (!expected_size.empty() && select_fft(level, expected_size)) {
+        level.fft.prepare(expected_size);
+    }
+}
+
+bool ImageMatcher::is_auto_scaled() const
+{
+    return auto_scale_ && !reference_size_.empty();
+}
+
+void ImageMatcher::update_template_scale(cv::Size window_size)
+{
+    if (window_size == window_size_ || window_size.empty()) return;
+    window_size_ = window_size;
+
+    // UIは縦横の短い方に合わせて拡大縮小されることが多い（横長のモニタでは高さの比になる）
+    float scale = 1.0f;
+    if (!reference_size_.empty()) {
+        scale = std::min(static_cast<float>(window_size.width) / reference_size_.width,
+                         static_cast<float>(window_size.height) / reference_size_.height);
+        scale = std::clamp(scale, 0.1f, 5.0f);
+    }
+    if (std::abs(scale - template_scale_) < kMinTemplateScaleChange * template_scale_) return;
+
+    template_scale_ = scale;
+    correlation_levels_dirty_ = true;
+
+    // カスケードの低解像度NCCも同じ倍率のテンプレートで判定する
+    if (is_template_loaded_) {
+        const cv::Mat& color = template_asset_ ? template_asset_->get_image() : template_image_;
+        cv::Mat scaled = color;
+        if (scale != 1.0f && !color.empty()) {
+            cv::resize(color, scaled, cv::Size(), scale, scale, scale < 1.0f ? cv::INTER_AREA : cv::INTER_LINEAR);
+        }
+        cascade_.set_template(scaled);
+    }
+
+    blog(LOG_INFO, "[ImageMatcher] Window %dx%d (reference %dx%d): template scale %.3f",
+         window_size.width, window_size.height, reference_size_.width, reference_size_.height, scale);
+}
+
+void ImageMatcher::learn_reference_size(cv::Size window_size, float scale)
+{
+    if (scale <= 0.0f) return;
+
+    // 倍率scaleで見つかった = 基準の解像度ではwindow_size / scaleの大きさだったことになる
+    reference_size_ = cv::Size(cvRound(window_size.width / scale), cvRound(window_size.height / scale));
+    window_size_ = cv::Size();
+    blog(LOG_INFO, "[ImageMatcher] Recorded reference resolution %dx%d (detected at scale %.3f in %dx%d)",
+         reference_size_.width, reference_size_.height, scale, window_size.width, window_size.height);
+}
+
+float ImageMatcher::compute_working_scale(cv::Size template_size) const
+{
+    const float short_side = static_cast<float>(std::min(template_size.width, template_size.height));
+    if (short_side <= 0.0f) return 1.0f;
+
+    float scale = working_scale_setting_;
+    if (scale <= 0.0f) {
+        scale = kAutoWorkingTemplateSize / short_side;
+    }
+
+    // 縮小後のテンプレートが小さくなりすぎないようにする
+    scale = std::max(scale, kMinWorkingTemplateSize / short_side);
+    return std::clamp(scale, kMinWorkingScale, 1.0f);
+}
+
+bool ImageMatcher::select_fft(CorrelationLevel& level, cv::Size image_size)
+{
+    if (!level.fft.is_ready()) return false;
+
+    switch (correlation_backend_) {
+        case CorrelationBackend::SPATIAL:
+            return false;
+        case CorrelationBackend::FFT:
+            return true;
+        default:
+            break;
+    }
+
+    // 判定はテンプレートと探索サイズの組み合わせごとに一度だけ行う
+    if (level.decided_size != image_size) {
+        level.decided_size = image_size;
+        level.use_fft = FftCorrelator::prefers_fft(image_size, level.template_image.size());
+
+        blog(LOG_DEBUG, "[ImageMatcher] Correlation backend for %dx%d template in %dx%d: %s",
+             level.template_image.cols, level.template_image.rows, image_size.width, image_size.height,
+             level.use_fft ? "fft" : "spatial");
+    }
+    return level.use_fft;
+}
+
+void ImageMatcher::correlate(const cv::Mat& target, CorrelationLevel& level, cv::Mat& result)
+{
+    if (level.ncc.is_ready() && target.type() == CV_8UC1) {
+        result.create(target.rows - level.ncc.get_template_height() + 1,
+                      target.cols - level.ncc.get_template_width() + 1, CV_32F);
+        if (level.ncc.match(target.data, target.cols, target.rows, target.step,
+                            result.ptr<float>(), result.step1())) {
+            last_correlation_backend_ = CorrelationBackend::SIMD;
+            return;
+        }
+    }
+
+    if (select_fft(level, target.size()) && level.fft.correlate(target, result)) {
+        last_correlation_backend_ = CorrelationBackend::FFT;
+        return;
+    }
+
+    PROFILE_ZONE("matchTemplate");
+    cv::matchTemplate(target, level.template_image, result, cv::TM_CCOEFF_NORMED);
+    last_correlation_backend_ = CorrelationBackend::SPATIAL;
+}
+
+void ImageMatcher::publish_prepare_params()
+{
+    std::lock_guard<std::mutex> lock(prepare_mutex_);
+    prepare_params_.method = match_method_;
+    prepare_params_.scale = working_scale_;
+    prepare_params_.search_region = search_region_;
+}
+
+cv::Rect ImageMatcher::get_effective_search_region(cv::Size target_size) const
+{
+    return clip_search_region(search_region_, target_size);
+}
+
+cv::Rect ImageMatcher::clip_search_region(const cv::Rect& region, cv::Size target_size)
+{
+    cv::Rect full_frame(cv::Point(0, 0), target_size);
+    cv::Rect clipped = region & full_frame;
+    return clipped.empty() ? full_frame : clipped;
+}
+
 bool ImageMatcher::validate_images(const cv::Mat& target) const
 {
-    if (template_image_.empty() || target.empty()) {
+    if (template_size_.empty() || target.empty()) {
         blog(LOG_WARNING, "[ImageMatcher] Empty template or target image");
         return false;
     }
 
-    if (template_image_.cols > target.cols || template_image_.rows > target.rows) {
+    // 自動スケーリング中は現在の倍率での大きさで比べる
+    const cv::Size scaled_size(cvRound(template_size_.width * template_scale_),
+                               cvRound(template_size_.height * template_scale_));
+    if (scaled_size.width > target.cols || scaled_size.height > target.rows) {
         blog(LOG_WARNING, "[ImageMatcher] Template larger than target image");
         return false;
     }
 
     const int min_size = 10;
-    if (template_image_.cols < min_size || template_image_.rows < min_size ||
+    if (template_size_.width < min_size || template_size_.height < min_size ||
         target.cols < min_size || target.rows < min_size) {
         blog(LOG_WARNING, "[ImageMatcher] Image too small for reliable matching");
         return false;
@@ -420,28 +1465,15 @@ bool ImageMatcher::validate_images(const cv::Mat& target) const
     return true;
 }
 
-void ImageMatcher::update_debug_image(const cv::Mat& target, const MatchResult& result)
+void ImageMatcher::record_matches(const cv::Mat& target, const MatchResult& result)
 {
-    if (target.empty()) return;
-
-    if (target.channels() == 1) {
-        cv::cvtColor(target, debug_image_, cv::COLOR_GRAY2BGR);
-    } else {
-        debug_image_ = target.clone();
-    }
-
-    if (result.found) {
-        cv::rectangle(debug_image_, result.bounding_box, cv::Scalar(0, 255, 0), 2);
-        cv::circle(debug_image_, result.center, 5, cv::Scalar(0, 0, 255), -1);
-        
-        std::string confidence_text = "Confidence: " + std::to_string(result.confidence);
-        cv::putText(debug_image_, confidence_text, 
-                   cv::Point(result.bounding_box.x, result.bounding_box.y - 10),
-                   cv::FONT_HERSHEY_SIMPLEX, 0.5, cv::Scalar(255, 255, 255), 1);
+    // 描画用の画像は保持せず、参照カウントのみで対象画像を保持する
+    if (debug_enabled_) {
+        debug_target_ = target;
     }
 
-    all_matches_.clear();
-    if (result.found) {
+    // 複数検出の結果は各手法が格納済み
+    if (all_matches_.empty() && result.found) {
         all_matches_.push_back(result);
     }
-}
\ No newline at end of file
+}
@@ -1,8 +1,17 @@
 #pragma once
 
+#include "cascade-filter.h"
+#include "fft-correlator.h"
+#include "ncc-kernel.h"
+#include "presence-scanner.h"
+#include "rotation-bank.h"
+#include "template-cache.h"
 #include <opencv2/opencv.hpp>
 #include <string>
 #include <vector>
+#include <chrono>
+#include <memory>
+#include <mutex>
 
 /**
  * 画像マッチングクラス
@@ -13,7 +22,22 @@ public:
     enum class MatchMethod {
         TEMPLATE_MATCHING,      // テンプレートマッチング（高速）
         FEATURE_MATCHING,       // 特徴点マッチング（回転・スケールに対応）
-        MULTI_SCALE            // マルチスケールマッチング
+        MULTI_SCALE,           // マルチスケールマッチング
+        SIMD_NCC,              // SIMD版の正規化相互相関（小さいグレースケールテンプレート向け）
+        ROTATED                // 回転を許すテンプレートマッチング（回転済みテンプレートを事前に用意）
+    };
+    
+    enum class FeatureDetector {
+        SIFT,                   // 高精度・低速（浮動小数記述子）
+        ORB,                    // 高速（バイナリ記述子）
+        AKAZE                   // ORBとSIFTの中間（バイナリ記述子）
+    };
+    
+    enum class CorrelationBackend {
+        AUTO,                   // コストモデルで自動選択
+        SPATIAL,                // cv::matchTemplate
+        FFT,                    // キャッシュしたテンプレートスペクトルによるFFT相関
+        SIMD                    // NccKernel（MatchMethod::SIMD_NCC選択時）
     };
     
     struct MatchResult {
@@ -25,70 +49,179 @@ public:
         float rotation;        // 検出された回転角度（度）
     };
 
+    // パイプライン用の前処理済みフレーム（prepare_frameで作り、match_preparedに渡す）
+    struct PreparedFrame {
+        cv::Mat image;                  // 元のフレーム（参照のみ）
+        cv::Rect search_region;
+        cv::Mat processed;              // 前処理済みの探索画像（縮小照合では縮小後）
+        float scale = 1.0f;             // processedを作ったときの縮小倍率
+        MatchMethod method = MatchMethod::TEMPLATE_MATCHING;
+        std::chrono::steady_clock::time_point preprocess_end;
+    };
+
 public:
     ImageMatcher();
     ~ImageMatcher();
     
-    // テンプレート画像の設定
+    // テンプレート画像の設定（ファイルはTemplateCache経由で読み込み、同じファイルを使う他のインスタンスと共有する）
     bool load_template(const std::string& image_path);
     bool load_template(const cv::Mat& template_image);
+    bool load_template(const std::shared_ptr<const TemplateAsset>& asset);
     bool is_template_loaded() const;
+
+    // 指定のファイルを読み込み済みで、読み込んだ後にファイルが更新されていないか
+    bool is_template_current(const std::string& image_path) const;
     
     // マッチング実行
     MatchResult match(const cv::Mat& target_image, float threshold = 0.8f);
+
+    // 前処理と照合を別のスレッドで行う場合に使う。prepare_frameは照合の状態を変更せず、手法・縮小倍率・
+    // 探索領域は照合側が公開したスナップショット（ロックで保護）から読む。前処理の他の設定
+    // （グレースケール・ぼかし等）は照合中のフレームがない間に変更すること。
+    // 前処理後に手法や倍率が変わっていた場合、match_preparedは前処理をやり直す
+    bool prepare_frame(const cv::Mat& target_image, PreparedFrame& prepared) const;
+    MatchResult match_prepared(const PreparedFrame& prepared, float threshold = 0.8f);
     
     // 設定
     void set_match_method(MatchMethod method);
     void set_scale_range(float min_scale, float max_scale);
-    void set_rotation_tolerance(float degrees);
-    void set_max_matches(int max_matches);
+    void set_rotation_tolerance(float degrees);         // ROTATEDで許容する角度（0〜180度）
+    void set_max_matches(int max_matches);              // 2以上で同時に表示されている複数の位置を検出する
+    void set_feature_detector(FeatureDetector detector);
+    void set_max_target_keypoints(int max_keypoints);
+    void set_search_region(const cv::Rect& region);     // 空の矩形で画面全体
+    void set_correlation_backend(CorrelationBackend backend);
+    void set_presence_only(bool enable);                // 閾値を超える位置が一つ見つかれば終了する
+    void set_working_scale(float scale);                // 縮小して照合する倍率（0で自動、1で等倍）
+    void set_cascade_enabled(bool enable);              // 安価な事前判定で大半のフレームを棄却する
+
+    // 解像度に合わせたテンプレートの自動スケーリング。基準の解像度（テンプレートを切り出したときの
+    // ウィンドウサイズ）と照合するフレームの大きさから倍率を求め、大きさが変わったときだけテンプレートを
+    // 作り直す。基準が空の場合は最初に検出したときのフレームの大きさを基準として記録する
+    void set_auto_scale(bool enable);
+    void set_reference_size(cv::Size size);
+    cv::Size get_reference_size() const { return reference_size_; }
+    float get_template_scale() const { return template_scale_; }
+
+    // フレームの大きさに比例する作業バッファを解放する（検出の休止中。次の照合で再確保される）
+    void release_frame_buffers();
     
     // 前処理設定
     void enable_grayscale_conversion(bool enable);
     void enable_edge_detection(bool enable);
     void set_gaussian_blur(int kernel_size, double sigma_x = 0);
     
-    // デバッグ用
+    // デバッグ用（描画は取得時に行い、マッチング中は結果の座標のみ保持する）
+    void enable_debug(bool enable);
     cv::Mat get_debug_image() const;
     void save_debug_image(const std::string& path) const;
     std::vector<MatchResult> get_all_matches() const;
+    const std::vector<MatchResult>& get_last_matches() const { return all_matches_; }
+    size_t get_match_count() const { return all_matches_.size(); }
     
     // 統計情報
     double get_last_processing_time() const;
+    std::chrono::steady_clock::time_point get_last_preprocess_end() const;
     size_t get_template_size() const;
+    size_t get_memory_usage() const;
+    MatchMethod get_match_method() const { return match_method_; }
+    FeatureDetector get_feature_detector() const { return feature_detector_; }
+    size_t get_template_keypoint_count() const { return template_keypoints_.size(); }
+    static const char* get_method_name(MatchMethod method);
+    CorrelationBackend get_correlation_backend() const { return correlation_backend_; }
+    CorrelationBackend get_last_correlation_backend() const { return last_correlation_backend_; }
+    bool is_presence_only() const { return presence_only_; }
+    float get_working_scale() const { return working_scale_; }
+    const PresenceScanner::Stats& get_last_scan_stats() const { return last_scan_stats_; }
+    bool is_cascade_enabled() const { return cascade_enabled_; }
+    const CascadeFilter::FrameStats& get_last_cascade_stats() const { return last_cascade_stats_; }
+    float get_rotation_tolerance() const { return rotation_tolerance_; }
+    size_t get_rotation_angle_count() const { return rotation_bank_.get_angle_count(); }
+    size_t get_rotation_coarse_angle_count() const { return rotation_bank_.get_coarse_angle_count(); }
+    const RotationBank::Stats& get_last_rotation_stats() const { return rotation_bank_.get_last_stats(); }
+    static const char* get_detector_name(FeatureDetector detector);
+
+    // 種類ごとに1つだけ作る共有の検出器（作れなければ空）。バンドルの特徴点も同じものから作る
+    static cv::Ptr<cv::Feature2D> get_shared_detector(FeatureDetector type);
+    static const char* get_backend_name(CorrelationBackend backend);
 
 private:
-    // マッチング手法の実装
-    MatchResult template_matching(const cv::Mat& target, float threshold);
-    MatchResult feature_matching(const cv::Mat& target, float threshold);
-    MatchResult multi_scale_matching(const cv::Mat& target, float threshold);
+    // マッチング手法の実装（preparedがあれば前処理済みの画像を使う）
+    MatchResult match_impl(const cv::Mat& target_image, float threshold, const PreparedFrame* prepared);
+    MatchResult template_matching(const cv::Mat& target, float threshold, const PreparedFrame* prepared);
+    MatchResult presence_matching(const cv::Mat& target, const cv::Mat& target_processed, float threshold);
+    MatchResult collect_peaks(const cv::Mat& target, const cv::Mat& match_result, float threshold);
+    void refine_at_full_resolution(const cv::Mat& target, cv::Point working_location,
+                                   float threshold, MatchResult& result);
+    MatchResult feature_matching(const cv::Mat& target, float threshold, const PreparedFrame* prepared);
+    MatchResult multi_scale_matching(const cv::Mat& target, float threshold, const PreparedFrame* prepared);
+    MatchResult rotated_matching(const cv::Mat& target, float threshold, const PreparedFrame* prepared);
     
     // 前処理
     cv::Mat preprocess_image(const cv::Mat& image) const;
+    bool is_prepared_usable(const PreparedFrame* prepared, float scale) const;
     void apply_filters(cv::Mat& image) const;
     
     // 後処理
     float calculate_confidence(const cv::Mat& match_result, cv::Point max_loc) const;
     cv::Rect calculate_bounding_box(cv::Point center, cv::Size template_size, float scale = 1.0f) const;
+
+    // 自動スケーリング
+    bool is_auto_scaled() const;
+    void update_template_scale(cv::Size window_size);
+    void learn_reference_size(cv::Size window_size, float scale);
     
+    // 特徴点関連
+    cv::Ptr<cv::Feature2D> get_active_detector();
+    void extract_template_features();
+
+    // テンプレートの表現（カラー・グレー・エッジ）は現在の設定で使うものだけを保持する
+    bool needs_template_gray() const;
+    bool ensure_template_images();
+    void trim_template_images();
+    bool finish_template_load();
+    
+    // 相関計算（テンプレートの前処理結果とFFT用スペクトルはスケールごとに保持する）
+    struct CorrelationLevel {
+        float scale = 1.0f;
+        cv::Mat template_image;         // 前処理・スケール済みテンプレート
+        FftCorrelator fft;
+        NccKernel ncc;                  // SIMD_NCC用（8bit単一チャンネルのみ）
+        cv::Size decided_size;          // バックエンドを判定した探索画像サイズ
+        bool use_fft = false;
+    };
+    void prepare_correlation_levels();
+    void init_correlation_level(CorrelationLevel& level, const cv::Mat& template_image,
+                                float scale, cv::Size expected_size);
+    float compute_working_scale(cv::Size template_size) const;
+    bool select_fft(CorrelationLevel& level, cv::Size image_size);
+    void correlate(const cv::Mat& target, CorrelationLevel& level, cv::Mat& result);
+    
+    // prepare_frameに渡す設定の公開（照合スレッド・設定変更側から呼ぶ）
+    void publish_prepare_params();
+
     // ヘルパー関数
+    cv::Rect get_effective_search_region(cv::Size target_size) const;
+    static cv::Rect clip_search_region(const cv::Rect& region, cv::Size target_size);
     bool validate_images(const cv::Mat& target) const;
-    void update_debug_image(const cv::Mat& target, const MatchResult& result);
+    void record_matches(const cv::Mat& target, const MatchResult& result);
 
 private:
-    // テンプレート画像
+    // テンプレート画像（共有テンプレートを使う場合はその画像を参照するだけで、使わない表現は参照も外す）
     cv::Mat template_image_;
     cv::Mat template_gray_;
     cv::Mat template_edges_;
+    std::shared_ptr<const TemplateAsset> template_asset_;
+    cv::Size template_size_;
+    int template_channels_;
     
-    // 特徴点検出器（SIFT/ORB用）
-    cv::Ptr<cv::SIFT> sift_detector_;
-    cv::Ptr<cv::ORB> orb_detector_;
-    cv::Ptr<cv::BFMatcher> matcher_;
+    // 特徴点検出器（SIFT/ORB/AKAZE用。全インスタンスで共有し、特徴点マッチングで初めて使うときに作る）
+    cv::Ptr<cv::Feature2D> active_detector_;
     
-    // テンプレートの特徴点
+    // テンプレートの特徴点と、その記述子から一度だけ構築する検索インデックス
     std::vector<cv::KeyPoint> template_keypoints_;
     cv::Mat template_descriptors_;
+    cv::Ptr<cv::DescriptorMatcher> descriptor_index_;
     
     // 設定
     MatchMethod match_method_;
@@ -96,6 +229,53 @@ private:
     float max_scale_;
     float rotation_tolerance_;
     int max_matches_;
+    FeatureDetector feature_detector_;
+    int max_target_keypoints_;
+    cv::Rect search_region_;
+    CorrelationBackend correlation_backend_;
+    
+    // 相関計算用のテンプレート（設定変更時に作り直す）
+    CorrelationLevel template_level_;
+    std::vector<CorrelationLevel> scale_levels_;
+    bool correlation_levels_dirty_;
+    CorrelationBackend last_correlation_backend_;
+    cv::Size last_target_size_;
+    
+    // 自動スケーリング（template_scale_は基準の解像度に対する現在のフレームの倍率）
+    bool auto_scale_;
+    cv::Size reference_size_;
+    cv::Size window_size_;              // template_scale_を求めたときのフレームの大きさ
+    float template_scale_;
+
+    // 縮小照合（working_scale_setting_は設定値、working_scale_は実際に使う倍率）
+    float working_scale_setting_;
+    float working_scale_;
+    cv::Mat full_template_;             // 等倍での再探索用テンプレート（前処理済み）
+    cv::Mat working_target_;
+
+    // 回転を許す照合（ROTATED選択時だけ、等倍のテンプレートから許容角度の範囲で作る）
+    RotationBank rotation_bank_;
+
+    // prepare_frame用のスナップショット（working_scale_は照合スレッドが書き換えるため、前処理スレッドは
+    // メンバーを直接読まずにこちらを読む）
+    struct PrepareParams {
+        MatchMethod method = MatchMethod::TEMPLATE_MATCHING;
+        float scale = 1.0f;
+        cv::Rect search_region;
+    };
+    mutable std::mutex prepare_mutex_;
+    PrepareParams prepare_params_;
+    
+    // 在否判定モード
+    bool presence_only_;
+    PresenceScanner presence_scanner_;
+    cv::Point last_presence_hit_;       // 前回の検出位置（探索領域内の座標、未検出は負）
+    PresenceScanner::Stats last_scan_stats_;
+    
+    // カスケード（事前判定を通過したフレームだけを選択中の手法で照合する）
+    bool cascade_enabled_;
+    CascadeFilter cascade_;
+    CascadeFilter::FrameStats last_cascade_stats_;
     
     // 前処理設定
     bool use_grayscale_;
@@ -104,11 +284,13 @@ private:
     double blur_sigma_;
     
     // デバッグ用
-    cv::Mat debug_image_;
+    bool debug_enabled_;
+    cv::Mat debug_target_;          // 最後の対象画像（参照のみ、コピーしない）
     std::vector<MatchResult> all_matches_;
     
     // パフォーマンス測定
     double last_processing_time_;
+    std::chrono::steady_clock::time_point last_preprocess_end_;
     
     // 状態
     bool is_template_loaded_;
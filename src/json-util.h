@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+// JSON出力用の簡易ヘルパー（レポート出力で共有）
+namespace json_util {
+
+inline std::string escape(const std::string& text)
+{
+    std::string escaped;
+    escaped.reserve(text.size());
+    for (char c : text) {
+        switch (c) {
+            case '"':  escaped += "\\\""; break;
+            case '\\': escaped += "\\\\"; break;
+            case '\n': escaped += "\\n"; break;
+            case '\r': escaped += "\\r"; break;
+            case '\t': escaped += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char buffer[8];
+                    snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+                    escaped += buffer;
+                } else {
+                    escaped += c;
+                }
+                break;
+        }
+    }
+    return escaped;
+}
+
+// ナノ秒をミリ秒表記の文字列に変換
+inline std::string format_ms(uint64_t nanoseconds)
+{
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%.3f", static_cast<double>(nanoseconds) / 1e6);
+    return buffer;
+}
+
+// ヒストグラム要約をJSONオブジェクトに変換（ナノ秒 -> ミリ秒）
+template <typename Summary>
+std::string summary_to_json(const Summary& summary)
+{
+    return "{\"count\": " + std::to_string(summary.count) +
+           ", \"mean_ms\": " + format_ms(static_cast<uint64_t>(summary.mean)) +
+           ", \"p50_ms\": " + format_ms(summary.p50) +
+           ", \"p95_ms\": " + format_ms(summary.p95) +
+           ", \"p99_ms\": " + format_ms(summary.p99) +
+           ", \"max_ms\": " + format_ms(summary.max) + "}";
+}
+
+} // namespace json_util
@@ -0,0 +1,167 @@
+#include "latency-tracer.h"
+#include "json-util.h"
+#include <fstream>
+#include <sstream>
+
+namespace {
+
+constexpr size_t stage_index(LatencyTracer::Stage stage)
+{
+    return static_cast<size_t>(stage);
+}
+
+} // namespace
+
+LatencyTracer::LatencyTracer()
+    : is_active_(false)
+    , has_pending_(false)
+    , event_count_(0)
+    , triggered_count_(0)
+{
+    current_.fill(Clock::time_point());
+    pending_.fill(Clock::time_point());
+}
+
+void LatencyTracer::begin_event()
+{
+    current_.fill(Clock::time_point());
+    current_[stage_index(Stage::CAPTURE_START)] = Clock::now();
+    is_active_ = true;
+}
+
+void LatencyTracer::mark(Stage stage)
+{
+    mark(stage, Clock::now());
+}
+
+void LatencyTracer::mark(Stage stage, Clock::time_point time)
+{
+    if (!is_active_ || stage == Stage::COUNT) return;
+    current_[stage_index(stage)] = time;
+}
+
+void LatencyTracer::cancel_event()
+{
+    is_active_ = false;
+}
+
+void LatencyTracer::end_event(bool triggered)
+{
+    if (!is_active_) return;
+    is_active_ = false;
+
+    if (current_[stage_index(Stage::TRIGGER_DECISION)] == Clock::time_point()) {
+        current_[stage_index(Stage::TRIGGER_DECISION)] = Clock::now();
+    }
+
+    record_span(current_, Span::CAPTURE, Stage::CAPTURE_START, Stage::CAPTURE_END);
+    record_span(current_, Span::PREPROCESS, Stage::CAPTURE_END, Stage::PREPROCESS_END);
+    record_span(current_, Span::MATCH, Stage::PREPROCESS_END, Stage::MATCH_END);
+    record_span(current_, Span::DECISION, Stage::MATCH_END, Stage::TRIGGER_DECISION);
+    record_span(current_, Span::DETECTION_TOTAL, Stage::CAPTURE_START, Stage::TRIGGER_DECISION);
+    event_count_.fetch_add(1, std::memory_order_relaxed);
+
+    if (triggered) {
+        record_span(current_, Span::ENQUEUE, Stage::TRIGGER_DECISION, Stage::COMMAND_ENQUEUE);
+        triggered_count_.fetch_add(1, std::memory_order_relaxed);
+
+        // 音声スレッドから最初のサンプル出力が報告されるまで保留する
+        pending_ = current_;
+        has_pending_ = true;
+    }
+}
+
+void LatencyTracer::complete_pending(Clock::time_point first_sample_time)
+{
+    if (!has_pending_) return;
+
+    Clock::time_point enqueue_time = pending_[stage_index(Stage::COMMAND_ENQUEUE)];
+    if (first_sample_time == Clock::time_point() || first_sample_time < enqueue_time) {
+        return;
+    }
+
+    pending_[stage_index(Stage::FIRST_SAMPLE)] = first_sample_time;
+    record_span(pending_, Span::AUDIO_START, Stage::COMMAND_ENQUEUE, Stage::FIRST_SAMPLE);
+    record_span(pending_, Span::END_TO_END, Stage::CAPTURE_START, Stage::FIRST_SAMPLE);
+    has_pending_ = false;
+}
+
+const Histogram& LatencyTracer::get_histogram(Span span) const
+{
+    return histograms_[static_cast<size_t>(span)];
+}
+
+uint64_t LatencyTracer::get_event_count() const
+{
+    return event_count_.load(std::memory_order_relaxed);
+}
+
+uint64_t LatencyTracer::get_triggered_count() const
+{
+    return triggered_count_.load(std::memory_order_relaxed);
+}
+
+void LatencyTracer::reset()
+{
+    for (auto& histogram : histograms_) {
+        histogram.reset();
+    }
+    event_count_.store(0, std::memory_order_relaxed);
+    triggered_count_.store(0, std::memory_order_relaxed);
+}
+
+std::string LatencyTracer::to_json(const std::string& source_name) const
+{
+    std::ostringstream json;
+    json << "{\n";
+    json << "  \"source\": \"" << json_util::escape(source_name) << "\",\n";
+    json << "  \"events\": " << get_event_count() << ",\n";
+    json << "  \"triggered\": " << get_triggered_count() << ",\n";
+    json << "  \"spans\": {\n";
+
+    for (size_t i = 0; i < histograms_.size(); ++i) {
+        json << "    \"" << get_span_name(static_cast<Span>(i)) << "\": "
+             << json_util::summary_to_json(histograms_[i].get_summary())
+             << (i + 1 < histograms_.size() ? "," : "") << "\n";
+    }
+
+    json << "  }\n";
+    json << "}\n";
+    return json.str();
+}
+
+bool LatencyTracer::export_json(const std::string& path, const std::string& source_name) const
+{
+    std::ofstream file(path, std::ios::out | std::ios::trunc);
+    if (!file) return false;
+
+    file << to_json(source_name);
+    return file.good();
+}
+
+const char* LatencyTracer::get_span_name(Span span)
+{
+    switch (span) {
+        case Span::CAPTURE:         return "capture";
+        case Span::PREPROCESS:      return "preprocess";
+        case Span::MATCH:           return "match";
+        case Span::DECISION:        return "decision";
+        case Span::ENQUEUE:         return "enqueue";
+        case Span::AUDIO_START:     return "audio_start";
+        case Span::DETECTION_TOTAL: return "detection_total";
+        case Span::END_TO_END:      return "end_to_end";
+        default:                    return "unknown";
+    }
+}
+
+void LatencyTracer::record_span(const Timestamps& timestamps, Span span, Stage from, Stage to)
+{
+    Clock::time_point start = timestamps[stage_index(from)];
+    Clock::time_point end = timestamps[stage_index(to)];
+    if (start == Clock::time_point() || end == Clock::time_point() || end < start) {
+        return;
+    }
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+    histograms_[static_cast<size_t>(span)].record(static_cast<uint64_t>(elapsed));
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "histogram.h"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <string>
+
+/**
+ * 検出から音声出力までのレイテンシ計測クラス
+ * 1回の検出（イベント）ごとに各段階の単調時刻を記録し、
+ * 区間ごとのヒストグラムに集計してJSONで出力する
+ */
+class LatencyTracer {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // イベント内の計測点
+    enum class Stage {
+        CAPTURE_START,          // キャプチャ開始
+        CAPTURE_END,            // キャプチャ完了
+        PREPROCESS_END,         // 前処理完了
+        MATCH_END,              // マッチング完了
+        TRIGGER_DECISION,       // トリガー判定
+        COMMAND_ENQUEUE,        // 再生コマンド発行
+        FIRST_SAMPLE,           // 最初のサンプル出力
+        COUNT
+    };
+
+    // 集計する区間
+    enum class Span {
+        CAPTURE,                // CAPTURE_START -> CAPTURE_END
+        PREPROCESS,             // CAPTURE_END -> PREPROCESS_END
+        MATCH,                  // PREPROCESS_END -> MATCH_END
+        DECISION,               // MATCH_END -> TRIGGER_DECISION
+        ENQUEUE,                // TRIGGER_DECISION -> COMMAND_ENQUEUE
+        AUDIO_START,            // COMMAND_ENQUEUE -> FIRST_SAMPLE
+        DETECTION_TOTAL,        // CAPTURE_START -> TRIGGER_DECISION
+        END_TO_END,             // CAPTURE_START -> FIRST_SAMPLE
+        COUNT
+    };
+
+public:
+    LatencyTracer();
+
+    // イベントの記録（検出スレッドから呼び出す）
+    void begin_event();
+    void mark(Stage stage);
+    void mark(Stage stage, Clock::time_point time);
+    void cancel_event();
+    void end_event(bool triggered);
+
+    // 再生開始待ちのイベントを完了させる
+    void complete_pending(Clock::time_point first_sample_time);
+    bool has_pending() const { return has_pending_; }
+
+    // 集計結果
+    const Histogram& get_histogram(Span span) const;
+    uint64_t get_event_count() const;
+    uint64_t get_triggered_count() const;
+    void reset();
+
+    // JSON出力
+    std::string to_json(const std::string& source_name) const;
+    bool export_json(const std::string& path, const std::string& source_name) const;
+
+    static const char* get_span_name(Span span);
+
+private:
+    using Timestamps = std::array<Clock::time_point, static_cast<size_t>(Stage::COUNT)>;
+
+    void record_span(const Timestamps& timestamps, Span span, Stage from, Stage to);
+
+private:
+    std::array<Histogram, static_cast<size_t>(Span::COUNT)> histograms_;
+
+    // 計測中のイベント
+    Timestamps current_;
+    bool is_active_;
+
+    // 再生開始待ちのイベント
+    Timestamps pending_;
+    bool has_pending_;
+
+    std::atomic<uint64_t> event_count_;
+    std::atomic<uint64_t> triggered_count_;
+};
@@ -0,0 +1,143 @@
+#include "mapped-file.h"
+#include <algorithm>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const size_t kPageSize = 4096;
+
+} // namespace
+
+MappedFile::MappedFile()
+    : data_(nullptr)
+    , size_(0)
+#if defined(_WIN32)
+    , file_(INVALID_HANDLE_VALUE)
+    , mapping_(nullptr)
+#endif
+{
+}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+bool MappedFile::open(const std::string& path, bool copy_on_write, std::string& error)
+{
+    close();
+
+#if defined(_WIN32)
+    const int length = MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, nullptr, 0);
+    std::wstring wide_path(length > 0 ? length : 0, L'\0');
+    if (length <= 0 || !MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, &wide_path[0], length)) {
+        error = "invalid path";
+        return false;
+    }
+
+    // マップ中でもファイルの置き換え（名前の変更）ができるようFILE_SHARE_DELETEで開く
+    file_ = CreateFileW(wide_path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr,
+                        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file_ == INVALID_HANDLE_VALUE) {
+        error = "cannot open file";
+        return false;
+    }
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file_, &file_size) || file_size.QuadPart <= 0) {
+        error = "empty file";
+        close();
+        return false;
+    }
+
+    mapping_ = CreateFileMappingW(file_, nullptr, copy_on_write ? PAGE_WRITECOPY : PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping_) {
+        error = "CreateFileMapping failed";
+        close();
+        return false;
+    }
+    data_ = static_cast<uint8_t*>(MapViewOfFile(mapping_, copy_on_write ? FILE_MAP_COPY : FILE_MAP_READ, 0, 0, 0));
+    if (!data_) {
+        error = "MapViewOfFile failed";
+        close();
+        return false;
+    }
+    size_ = static_cast<size_t>(file_size.QuadPart);
+#else
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        error = "cannot open file";
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+        ::close(fd);
+        error = "empty file";
+        return false;
+    }
+
+    const size_t size = static_cast<size_t>(info.st_size);
+    void* mapped = mmap(nullptr, size, copy_on_write ? (PROT_READ | PROT_WRITE) : PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        error = "mmap failed";
+        return false;
+    }
+    data_ = static_cast<uint8_t*>(mapped);
+    size_ = size;
+#endif
+    return true;
+}
+
+void MappedFile::close()
+{
+#if defined(_WIN32)
+    if (data_) UnmapViewOfFile(data_);
+    if (mapping_) CloseHandle(mapping_);
+    if (file_ != INVALID_HANDLE_VALUE) CloseHandle(file_);
+    mapping_ = nullptr;
+    file_ = INVALID_HANDLE_VALUE;
+#else
+    if (data_) munmap(data_, size_);
+#endif
+    data_ = nullptr;
+    size_ = 0;
+}
+
+void MappedFile::prefetch(size_t offset, size_t length) const
+{
+    if (!data_ || offset >= size_) return;
+    length = std::min(length, size_ - offset);
+
+    // ページ境界に揃える
+    const size_t begin = offset / kPageSize * kPageSize;
+    const size_t end = offset + length;
+#if defined(_WIN32)
+    WIN32_MEMORY_RANGE_ENTRY range;
+    range.VirtualAddress = data_ + begin;
+    range.NumberOfBytes = end - begin;
+    PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#else
+    madvise(data_ + begin, end - begin, MADV_WILLNEED);
+#endif
+}
+
+void MappedFile::touch(size_t offset, size_t length) const
+{
+    if (!data_ || offset >= size_) return;
+    length = std::min(length, size_ - offset);
+
+    volatile uint8_t sink = 0;
+    for (size_t position = offset; position < offset + length; position += kPageSize) {
+        sink = sink + data_[position];
+    }
+    (void)sink;
+}
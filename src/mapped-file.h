@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * ファイル全体の読み取り用メモリマップ
+ * ページは初めて触れたときに読み込まれ、OSのファイルキャッシュと共有される（同じファイルを
+ * 複数回マップしても常駐メモリは増えない）。パスはUTF-8
+ */
+class MappedFile {
+public:
+    MappedFile();
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // copy_on_writeを指定すると書き込めるマップにする（書き込んだページだけ複製され、ファイルは変わらない）。
+    // 失敗した場合は理由をerrorに入れてfalse
+    bool open(const std::string& path, bool copy_on_write, std::string& error);
+    void close();
+
+    bool is_open() const { return data_ != nullptr; }
+    uint8_t* data() const { return data_; }
+    size_t size() const { return size_; }
+
+    // 範囲を先読みするようOSに伝える（ブロックしない）
+    void prefetch(size_t offset, size_t length) const;
+
+    // 範囲のページに触れて読み込む（読み込みが終わるまでブロックする）
+    void touch(size_t offset, size_t length) const;
+
+private:
+    uint8_t* data_;
+    size_t size_;
+#if defined(_WIN32)
+    void* file_;
+    void* mapping_;
+#endif
+};
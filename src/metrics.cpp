@@ -0,0 +1,320 @@
+#include "metrics.h"
+#include "image-matcher.h"
+#include "json-util.h"
+#include <obs-module.h>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+static_assert(SourceMetrics::kCascadeStages == CascadeFilter::kStageCount,
+              "cascade stage count mismatch");
+
+namespace {
+
+int64_t steady_now_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+// ===== SourceMetrics =====
+
+SourceMetrics::SourceMetrics(const std::string& name)
+    : name_(name)
+{
+    for (auto& counter : counters_) {
+        counter.store(0, std::memory_order_relaxed);
+    }
+    for (auto& gauge : gauges_) {
+        gauge.store(0, std::memory_order_relaxed);
+    }
+    for (auto& rejects : cascade_rejects_) {
+        rejects.store(0, std::memory_order_relaxed);
+    }
+}
+
+void SourceMetrics::set_name(const std::string& name)
+{
+    std::lock_guard<std::mutex> lock(name_mutex_);
+    name_ = name;
+}
+
+std::string SourceMetrics::get_name() const
+{
+    std::lock_guard<std::mutex> lock(name_mutex_);
+    return name_;
+}
+
+void SourceMetrics::increment(Counter counter, uint64_t amount)
+{
+    counters_[static_cast<size_t>(counter)].fetch_add(amount, std::memory_order_relaxed);
+}
+
+void SourceMetrics::set_gauge(Gauge gauge, int64_t value)
+{
+    gauges_[static_cast<size_t>(gauge)].store(value, std::memory_order_relaxed);
+}
+
+void SourceMetrics::record_capture_time(uint64_t nanoseconds)
+{
+    capture_time_.record(nanoseconds);
+}
+
+void SourceMetrics::record_match_time(size_t method_index, uint64_t nanoseconds)
+{
+    if (method_index >= kMaxMatchMethods) return;
+    match_time_[method_index].record(nanoseconds);
+}
+
+void SourceMetrics::record_cascade_stage(size_t stage, uint64_t nanoseconds, bool rejected)
+{
+    if (stage >= kCascadeStages) return;
+    cascade_time_[stage].record(nanoseconds);
+    if (rejected) {
+        cascade_rejects_[stage].fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+uint64_t SourceMetrics::get_counter(Counter counter) const
+{
+    return counters_[static_cast<size_t>(counter)].load(std::memory_order_relaxed);
+}
+
+int64_t SourceMetrics::get_gauge(Gauge gauge) const
+{
+    return gauges_[static_cast<size_t>(gauge)].load(std::memory_order_relaxed);
+}
+
+const Histogram& SourceMetrics::get_match_histogram(size_t method_index) const
+{
+    return match_time_[std::min(method_index, kMaxMatchMethods - 1)];
+}
+
+const Histogram& SourceMetrics::get_cascade_histogram(size_t stage) const
+{
+    return cascade_time_[std::min(stage, kCascadeStages - 1)];
+}
+
+uint64_t SourceMetrics::get_cascade_rejects(size_t stage) const
+{
+    if (stage >= kCascadeStages) return 0;
+    return cascade_rejects_[stage].load(std::memory_order_relaxed);
+}
+
+std::string SourceMetrics::to_json() const
+{
+    std::ostringstream json;
+    json << "{\"source\": \"" << json_util::escape(get_name()) << "\"";
+
+    for (size_t i = 0; i < counters_.size(); ++i) {
+        json << ", \"" << get_counter_name(static_cast<Counter>(i)) << "\": "
+             << counters_[i].load(std::memory_order_relaxed);
+    }
+    for (size_t i = 0; i < gauges_.size(); ++i) {
+        json << ", \"" << get_gauge_name(static_cast<Gauge>(i)) << "\": "
+             << gauges_[i].load(std::memory_order_relaxed);
+    }
+
+    uint64_t presence_frames = get_counter(Counter::PRESENCE_FRAMES);
+    if (presence_frames > 0) {
+        json << ", \"avg_positions_per_frame\": "
+             << static_cast<double>(get_counter(Counter::POSITIONS_EVALUATED)) / presence_frames;
+    }
+
+    json << ", \"capture_time\": " << json_util::summary_to_json(capture_time_.get_summary());
+    json << ", \"match_time\": {";
+    bool first = true;
+    for (size_t i = 0; i < match_time_.size(); ++i) {
+        if (match_time_[i].get_count() == 0) continue;
+        json << (first ? "" : ", ") << "\""
+             << ImageMatcher::get_method_name(static_cast<ImageMatcher::MatchMethod>(i)) << "\": "
+             << json_util::summary_to_json(match_time_[i].get_summary());
+        first = false;
+    }
+    json << "}";
+
+    // カスケード: 段ごとの実行回数・棄却率・処理時間
+    if (cascade_time_[0].get_count() > 0) {
+        json << ", \"cascade\": {";
+        for (size_t i = 0; i < kCascadeStages; ++i) {
+            uint64_t entered = cascade_time_[i].get_count();
+            uint64_t rejected = get_cascade_rejects(i);
+            json << (i == 0 ? "" : ", ") << "\""
+                 << CascadeFilter::get_stage_name(static_cast<CascadeFilter::Stage>(i)) << "\": {"
+                 << "\"entered\": " << entered << ", \"rejected\": " << rejected
+                 << ", \"reject_rate\": " << (entered > 0 ? static_cast<double>(rejected) / entered : 0.0)
+                 << ", \"time\": " << json_util::summary_to_json(cascade_time_[i].get_summary()) << "}";
+        }
+        json << "}";
+    }
+
+    json << "}";
+    return json.str();
+}
+
+std::string SourceMetrics::to_log_line() const
+{
+    Histogram::Summary capture = capture_time_.get_summary();
+
+    // 最も使われている手法のマッチング時間を表示する
+    size_t busiest = 0;
+    for (size_t i = 1; i < match_time_.size(); ++i) {
+        if (match_time_[i].get_count() > match_time_[busiest].get_count()) busiest = i;
+    }
+    Histogram::Summary match = match_time_[busiest].get_summary();
+
+    char buffer[512];
+    snprintf(buffer, sizeof(buffer),
+             "%s: frames=%llu skipped=%llu triggers=%llu suppressed=%llu "
+             "capture p50/p99=%.2f/%.2fms match(%s) p50/p99=%.2f/%.2fms "
+             "template=%lldKB audio=%lldKB",
+             get_name().c_str(),
+             static_cast<unsigned long long>(get_counter(Counter::FRAMES_PROCESSED)),
+             static_cast<unsigned long long>(get_counter(Counter::FRAMES_SKIPPED)),
+             static_cast<unsigned long long>(get_counter(Counter::TRIGGERS_FIRED)),
+             static_cast<unsigned long long>(get_counter(Counter::COOLDOWN_SUPPRESSED)),
+             capture.p50 / 1e6, capture.p99 / 1e6,
+             ImageMatcher::get_method_name(static_cast<ImageMatcher::MatchMethod>(busiest)),
+             match.p50 / 1e6, match.p99 / 1e6,
+             static_cast<long long>(get_gauge(Gauge::TEMPLATE_BYTES) / 1024),
+             static_cast<long long>(get_gauge(Gauge::AUDIO_BYTES) / 1024));
+
+    std::string line = buffer;
+    uint64_t presence_frames = get_counter(Counter::PRESENCE_FRAMES);
+    if (presence_frames > 0) {
+        snprintf(buffer, sizeof(buffer), " positions/frame=%.0f",
+                 static_cast<double>(get_counter(Counter::POSITIONS_EVALUATED)) / presence_frames);
+        line += buffer;
+    }
+
+    // カスケード: 段ごとの棄却率と平均処理時間
+    for (size_t i = 0; i < kCascadeStages; ++i) {
+        uint64_t entered = cascade_time_[i].get_count();
+        if (entered == 0) continue;
+        snprintf(buffer, sizeof(buffer), " %s=%.0f%%/%.2fms",
+                 CascadeFilter::get_stage_name(static_cast<CascadeFilter::Stage>(i)),
+                 100.0 * get_cascade_rejects(i) / entered, cascade_time_[i].get_mean() / 1e6);
+        line += buffer;
+    }
+    return line;
+}
+
+const char* SourceMetrics::get_counter_name(Counter counter)
+{
+    switch (counter) {
+        case Counter::FRAMES_PROCESSED:    return "frames_processed";
+        case Counter::FRAMES_SKIPPED:      return "frames_skipped";
+        case Counter::TRIGGERS_FIRED:      return "triggers_fired";
+        case Counter::COOLDOWN_SUPPRESSED: return "cooldown_suppressed";
+        case Counter::PRESENCE_FRAMES:     return "presence_frames";
+        case Counter::POSITIONS_EVALUATED: return "positions_evaluated";
+        case Counter::ROWS_EVALUATED:      return "rows_evaluated";
+        case Counter::FRAMES_SHARED:       return "frames_shared";
+        case Counter::FRAMES_NOT_SCHEDULED: return "frames_not_scheduled";
+        case Counter::FRAMES_IDLE:         return "frames_idle";
+        case Counter::FRAMES_DROPPED:      return "frames_dropped";
+        default:                           return "unknown";
+    }
+}
+
+const char* SourceMetrics::get_gauge_name(Gauge gauge)
+{
+    switch (gauge) {
+        case Gauge::TEMPLATE_BYTES: return "template_bytes";
+        case Gauge::AUDIO_BYTES:    return "audio_bytes";
+        default:                    return "unknown";
+    }
+}
+
+// ===== MetricsRegistry =====
+
+MetricsRegistry& MetricsRegistry::instance()
+{
+    static MetricsRegistry registry;
+    return registry;
+}
+
+MetricsRegistry::MetricsRegistry()
+    : enabled_(true)
+    , log_interval_ns_(0)
+    , next_log_time_ns_(0)
+{
+}
+
+std::shared_ptr<SourceMetrics> MetricsRegistry::register_source(const std::string& name)
+{
+    auto metrics = std::make_shared<SourceMetrics>(name);
+    std::lock_guard<std::mutex> lock(mutex_);
+    sources_.push_back(metrics);
+    return metrics;
+}
+
+void MetricsRegistry::unregister_source(const std::shared_ptr<SourceMetrics>& metrics)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    sources_.erase(std::remove(sources_.begin(), sources_.end(), metrics), sources_.end());
+}
+
+std::string MetricsRegistry::to_json() const
+{
+    auto sources = snapshot_sources();
+
+    std::ostringstream json;
+    json << "{\n  \"sources\": [\n";
+    for (size_t i = 0; i < sources.size(); ++i) {
+        json << "    " << sources[i]->to_json() << (i + 1 < sources.size() ? "," : "") << "\n";
+    }
+    json << "  ]\n}\n";
+    return json.str();
+}
+
+bool MetricsRegistry::dump_to_file(const std::string& path) const
+{
+    std::ofstream file(path, std::ios::out | std::ios::trunc);
+    if (!file) return false;
+
+    file << to_json();
+    return file.good();
+}
+
+void MetricsRegistry::log_summary() const
+{
+    auto sources = snapshot_sources();
+    if (sources.empty()) return;
+
+    blog(LOG_INFO, "[Game Audio Trigger] Metrics (%zu sources):", sources.size());
+    for (const auto& source : sources) {
+        blog(LOG_INFO, "  %s", source->to_log_line().c_str());
+    }
+}
+
+void MetricsRegistry::set_log_interval(int seconds)
+{
+    int64_t interval_ns = std::max(0, seconds) * 1000000000LL;
+    log_interval_ns_.store(interval_ns, std::memory_order_relaxed);
+    next_log_time_ns_.store(interval_ns > 0 ? steady_now_ns() + interval_ns : 0,
+                            std::memory_order_relaxed);
+}
+
+void MetricsRegistry::maybe_log_periodic()
+{
+    int64_t interval_ns = log_interval_ns_.load(std::memory_order_relaxed);
+    if (interval_ns <= 0) return;
+
+    int64_t now = steady_now_ns();
+    int64_t next = next_log_time_ns_.load(std::memory_order_relaxed);
+    if (now < next) return;
+
+    // 複数ソースから同時に呼ばれても出力は1回だけにする
+    if (next_log_time_ns_.compare_exchange_strong(next, now + interval_ns, std::memory_order_relaxed)) {
+        log_summary();
+    }
+}
+
+std::vector<std::shared_ptr<SourceMetrics>> MetricsRegistry::snapshot_sources() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return sources_;
+}
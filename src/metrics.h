@@ -0,0 +1,120 @@
+#pragma once
+
+#include "histogram.h"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * ソース単位のメトリクス
+ * カウンタ・ゲージ・ヒストグラムはすべてアトミック操作のみで更新する
+ */
+class SourceMetrics {
+public:
+    enum class Counter {
+        FRAMES_PROCESSED,       // マッチングを実行したフレーム数
+        FRAMES_SKIPPED,         // プロセス未検出・キャプチャ失敗などで処理しなかったフレーム数
+        TRIGGERS_FIRED,         // 音声再生を発行した回数
+        COOLDOWN_SUPPRESSED,    // クールダウンにより抑制した検出機会の数
+        PRESENCE_FRAMES,        // 在否判定モードで処理したフレーム数
+        POSITIONS_EVALUATED,    // 在否判定モードで相関を計算し始めた候補位置の数
+        ROWS_EVALUATED,         // 在否判定モードで計算したテンプレート行の数
+        FRAMES_SHARED,          // 同じプロセスを対象とする他のソースがキャプチャしたフレームを使った数
+        FRAMES_NOT_SCHEDULED,   // 検出スケジューラが実行を見送ったフレーム数（レートの間引き・予算不足）
+        FRAMES_IDLE,            // 非表示・非アクティブ・配信/録画していないため検出を休止したフレーム数
+        FRAMES_DROPPED,         // パイプラインで新しいフレームに押し出されて捨てたフレーム数
+        COUNT
+    };
+
+    enum class Gauge {
+        TEMPLATE_BYTES,         // テンプレート関連のメモリ使用量
+        AUDIO_BYTES,            // 音声データのメモリ使用量
+        COUNT
+    };
+
+    static constexpr size_t kMaxMatchMethods = 8;
+    static constexpr size_t kCascadeStages = 3;     // CascadeFilter::Stage
+
+public:
+    explicit SourceMetrics(const std::string& name);
+
+    void set_name(const std::string& name);
+    std::string get_name() const;
+
+    // 記録（検出スレッドから呼び出す）
+    void increment(Counter counter, uint64_t amount = 1);
+    void set_gauge(Gauge gauge, int64_t value);
+    void record_capture_time(uint64_t nanoseconds);
+    void record_match_time(size_t method_index, uint64_t nanoseconds);
+    void record_cascade_stage(size_t stage, uint64_t nanoseconds, bool rejected);
+
+    // 取得
+    uint64_t get_counter(Counter counter) const;
+    int64_t get_gauge(Gauge gauge) const;
+    const Histogram& get_capture_histogram() const { return capture_time_; }
+    const Histogram& get_match_histogram(size_t method_index) const;
+    const Histogram& get_cascade_histogram(size_t stage) const;
+    uint64_t get_cascade_rejects(size_t stage) const;
+
+    std::string to_json() const;
+    std::string to_log_line() const;
+
+    static const char* get_counter_name(Counter counter);
+    static const char* get_gauge_name(Gauge gauge);
+
+private:
+    mutable std::mutex name_mutex_;
+    std::string name_;
+
+    std::array<std::atomic<uint64_t>, static_cast<size_t>(Counter::COUNT)> counters_;
+    std::array<std::atomic<int64_t>, static_cast<size_t>(Gauge::COUNT)> gauges_;
+    Histogram capture_time_;
+    std::array<Histogram, kMaxMatchMethods> match_time_;
+
+    // カスケードの段ごとの処理時間（件数がその段に入ったフレーム数）と棄却数
+    std::array<Histogram, kCascadeStages> cascade_time_;
+    std::array<std::atomic<uint64_t>, kCascadeStages> cascade_rejects_;
+};
+
+/**
+ * プラグイン全体のメトリクスレジストリ
+ * ソースの登録・一覧出力・OBSログへの定期出力を担当する
+ */
+class MetricsRegistry {
+public:
+    static MetricsRegistry& instance();
+
+    // ソースの登録・解除
+    std::shared_ptr<SourceMetrics> register_source(const std::string& name);
+    void unregister_source(const std::shared_ptr<SourceMetrics>& metrics);
+
+    // 有効/無効（無効時は記録側で計測自体を省略する）
+    void set_enabled(bool enable) { enabled_.store(enable, std::memory_order_relaxed); }
+    bool is_enabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+    // 出力
+    std::string to_json() const;
+    bool dump_to_file(const std::string& path) const;
+    void log_summary() const;
+
+    // 定期ログ出力（0で無効）。video_tickなどから頻繁に呼び出してよい
+    void set_log_interval(int seconds);
+    void maybe_log_periodic();
+
+private:
+    MetricsRegistry();
+
+    std::vector<std::shared_ptr<SourceMetrics>> snapshot_sources() const;
+
+private:
+    mutable std::mutex mutex_;
+    std::vector<std::shared_ptr<SourceMetrics>> sources_;
+
+    std::atomic<bool> enabled_;
+    std::atomic<int64_t> log_interval_ns_;
+    std::atomic<int64_t> next_log_time_ns_;
+};
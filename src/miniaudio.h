@@ -114,6 +114,61 @@ ma_result ma_sound_get_cursor_in_pcm_frames(ma_sound* sound, ma_uint64* cursor);
 ma_result ma_sound_seek_to_pcm_frame(ma_sound* sound, ma_uint64 frameIndex);
 ma_result ma_sound_get_data_format(ma_sound* sound, void* format, ma_uint32* channels, ma_uint32* sampleRate, void* channelMap, size_t channelMapCap);
 
+// Low level device API (subset of the real declarations)
+typedef struct ma_context ma_context;
+typedef struct ma_device ma_device;
+
+typedef enum { ma_format_unknown = 0, ma_format_u8 = 1, ma_format_s16 = 2, ma_format_s24 = 3, ma_format_s32 = 4, ma_format_f32 = 5 } ma_format;
+typedef enum { ma_device_type_playback = 1, ma_device_type_capture = 2, ma_device_type_duplex = 3, ma_device_type_loopback = 4 } ma_device_type;
+typedef enum { ma_performance_profile_low_latency = 0, ma_performance_profile_conservative = 1 } ma_performance_profile;
+
+typedef void (* ma_device_data_proc)(ma_device* pDevice, void* pOutput, const void* pInput, ma_uint32 frameCount);
+
+typedef struct {
+    ma_device_type deviceType;
+    ma_uint32 sampleRate;
+    ma_uint32 periodSizeInFrames;
+    ma_uint32 periodSizeInMilliseconds;
+    ma_performance_profile performanceProfile;
+    ma_device_data_proc dataCallback;
+    void* pUserData;
+    struct {
+        ma_format format;
+        ma_uint32 channels;
+    } playback;
+} ma_device_config;
+
+struct ma_device {
+    void* pUserData;
+    ma_uint32 sampleRate;
+};
+
+ma_device_config ma_device_config_init(ma_device_type deviceType);
+ma_result ma_device_init(ma_context* pContext, const ma_device_config* pConfig, ma_device* pDevice);
+void ma_device_uninit(ma_device* pDevice);
+ma_result ma_device_start(ma_device* pDevice);
+ma_result ma_device_stop(ma_device* pDevice);
+
+// Decoder API (subset of the real declarations)
+typedef struct {
+    ma_format format;
+    ma_uint32 channels;
+    ma_uint32 sampleRate;
+} ma_decoder_config;
+
+typedef struct ma_decoder {
+    ma_format outputFormat;
+    ma_uint32 outputChannels;
+    ma_uint32 outputSampleRate;
+} ma_decoder;
+
+ma_decoder_config ma_decoder_config_init(ma_format outputFormat, ma_uint32 outputChannels, ma_uint32 outputSampleRate);
+ma_result ma_decoder_init_file(const char* pFilePath, const ma_decoder_config* pConfig, ma_decoder* pDecoder);
+ma_result ma_decoder_init_file_w(const wchar_t* pFilePath, const ma_decoder_config* pConfig, ma_decoder* pDecoder);
+ma_result ma_decoder_uninit(ma_decoder* pDecoder);
+ma_result ma_decoder_read_pcm_frames(ma_decoder* pDecoder, void* pFramesOut, ma_uint64 frameCount, ma_uint64* pFramesRead);
+ma_result ma_decoder_seek_to_pcm_frame(ma_decoder* pDecoder, ma_uint64 frameIndex);
+
 #ifdef __cplusplus
 }
 #endif
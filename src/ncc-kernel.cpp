@@ -0,0 +1,385 @@
+#include "ncc-kernel.h"
+#include "profiler.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define GAT_NCC_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+#if defined(__aarch64__) || defined(_M_ARM64)
+#define GAT_NCC_NEON 1
+#include <arm_neon.h>
+#endif
+
+// GCC/ClangではAVX2の関数だけを個別にコンパイルする（MSVCは指定不要）
+#if defined(GAT_NCC_X86) && (defined(__GNUC__) || defined(__clang__))
+#define GAT_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define GAT_TARGET_AVX2
+#endif
+
+namespace {
+
+// 窓 (image, stride) とテンプレートの積和 Σ I・T
+using DotFunction = int32_t (*)(const uint8_t* image, size_t stride,
+                                const int16_t* templ, int width, int height);
+
+int32_t dot_scalar(const uint8_t* image, size_t stride, const int16_t* templ, int width, int height)
+{
+    int32_t sum = 0;
+    for (int row = 0; row < height; ++row) {
+        const uint8_t* pixels = image + row * stride;
+        const int16_t* values = templ + row * width;
+        for (int col = 0; col < width; ++col) {
+            sum += pixels[col] * values[col];
+        }
+    }
+    return sum;
+}
+
+#if defined(GAT_NCC_X86)
+
+int32_t dot_sse2(const uint8_t* image, size_t stride, const int16_t* templ, int width, int height)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i acc = _mm_setzero_si128();
+    int32_t tail = 0;
+
+    for (int row = 0; row < height; ++row) {
+        const uint8_t* pixels = image + row * stride;
+        const int16_t* values = templ + row * width;
+
+        int col = 0;
+        for (; col + 16 <= width; col += 16) {
+            __m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels + col));
+            __m128i t0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values + col));
+            __m128i t1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values + col + 8));
+            acc = _mm_add_epi32(acc, _mm_madd_epi16(_mm_unpacklo_epi8(p, zero), t0));
+            acc = _mm_add_epi32(acc, _mm_madd_epi16(_mm_unpackhi_epi8(p, zero), t1));
+        }
+        for (; col + 8 <= width; col += 8) {
+            __m128i p = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(pixels + col));
+            __m128i t = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values + col));
+            acc = _mm_add_epi32(acc, _mm_madd_epi16(_mm_unpacklo_epi8(p, zero), t));
+        }
+        for (; col < width; ++col) {
+            tail += pixels[col] * values[col];
+        }
+    }
+
+    acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(1, 0, 3, 2)));
+    acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(acc) + tail;
+}
+
+GAT_TARGET_AVX2
+int32_t dot_avx2(const uint8_t* image, size_t stride, const int16_t* templ, int width, int height)
+{
+    __m256i acc = _mm256_setzero_si256();
+    int32_t tail = 0;
+
+    for (int row = 0; row < height; ++row) {
+        const uint8_t* pixels = image + row * stride;
+        const int16_t* values = templ + row * width;
+
+        int col = 0;
+        for (; col + 32 <= width; col += 32) {
+            __m256i p0 = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels + col)));
+            __m256i p1 = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels + col + 16)));
+            __m256i t0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + col));
+            __m256i t1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + col + 16));
+            acc = _mm256_add_epi32(acc, _mm256_madd_epi16(p0, t0));
+            acc = _mm256_add_epi32(acc, _mm256_madd_epi16(p1, t1));
+        }
+        for (; col + 16 <= width; col += 16) {
+            __m256i p = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels + col)));
+            __m256i t = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + col));
+            acc = _mm256_add_epi32(acc, _mm256_madd_epi16(p, t));
+        }
+        for (; col < width; ++col) {
+            tail += pixels[col] * values[col];
+        }
+    }
+
+    __m128i sum = _mm_add_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(sum) + tail;
+}
+
+void cpuid(int info[4], int function, int subfunction)
+{
+#if defined(_MSC_VER)
+    __cpuidex(info, function, subfunction);
+#else
+    unsigned int a, b, c, d;
+    __cpuid_count(function, subfunction, a, b, c, d);
+    info[0] = static_cast<int>(a);
+    info[1] = static_cast<int>(b);
+    info[2] = static_cast<int>(c);
+    info[3] = static_cast<int>(d);
+#endif
+}
+
+uint64_t read_xcr0()
+{
+#if defined(_MSC_VER)
+    return _xgetbv(0);
+#else
+    unsigned int eax, edx;
+    __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return (static_cast<uint64_t>(edx) << 32) | eax;
+#endif
+}
+
+bool detect_avx2()
+{
+    int info[4];
+    cpuid(info, 0, 0);
+    if (info[0] < 7) return false;
+
+    // OSがYMMレジスタを保存するか（OSXSAVE + XCR0）も確認する
+    cpuid(info, 1, 0);
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    const bool avx = (info[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx || (read_xcr0() & 0x6) != 0x6) return false;
+
+    cpuid(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+}
+
+#endif // GAT_NCC_X86
+
+#if defined(GAT_NCC_NEON)
+
+int32_t dot_neon(const uint8_t* image, size_t stride, const int16_t* templ, int width, int height)
+{
+    int32x4_t acc0 = vdupq_n_s32(0);
+    int32x4_t acc1 = vdupq_n_s32(0);
+    int32_t tail = 0;
+
+    for (int row = 0; row < height; ++row) {
+        const uint8_t* pixels = image + row * stride;
+        const int16_t* values = templ + row * width;
+
+        int col = 0;
+        for (; col + 8 <= width; col += 8) {
+            int16x8_t p = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(pixels + col)));
+            int16x8_t t = vld1q_s16(values + col);
+            acc0 = vmlal_s16(acc0, vget_low_s16(p), vget_low_s16(t));
+            acc1 = vmlal_s16(acc1, vget_high_s16(p), vget_high_s16(t));
+        }
+        for (; col < width; ++col) {
+            tail += pixels[col] * values[col];
+        }
+    }
+
+    return vaddvq_s32(vaddq_s32(acc0, acc1)) + tail;
+}
+
+#endif // GAT_NCC_NEON
+
+DotFunction get_dot_function(NccKernel::Isa isa)
+{
+    switch (isa) {
+#if defined(GAT_NCC_X86)
+        case NccKernel::Isa::AVX2: return dot_avx2;
+        case NccKernel::Isa::SSE2: return dot_sse2;
+#endif
+#if defined(GAT_NCC_NEON)
+        case NccKernel::Isa::NEON: return dot_neon;
+#endif
+        default:                   return dot_scalar;
+    }
+}
+
+// cv::matchTemplate (TM_CCOEFF_NORMED) と同じ規則で正規化する
+inline float normalize_correlation(double numerator, double denominator)
+{
+    if (std::abs(numerator) < denominator) {
+        return static_cast<float>(numerator / denominator);
+    }
+    if (std::abs(numerator) < denominator * 1.125) {
+        return numerator > 0 ? 1.0f : -1.0f;
+    }
+    return 0.0f;
+}
+
+} // namespace
+
+NccKernel::NccKernel()
+    : width_(0)
+    , height_(0)
+    , template_sum_(0)
+    , template_mean_(0.0)
+    , template_norm_(0.0)
+{
+}
+
+bool NccKernel::set_template(const uint8_t* data, int width, int height, size_t stride)
+{
+    reset();
+
+    if (!data || width <= 0 || height <= 0 || width * height > kMaxTemplateArea) {
+        return false;
+    }
+
+    template_.resize(static_cast<size_t>(width) * height);
+    int64_t sum = 0;
+    int64_t sum_sq = 0;
+    for (int row = 0; row < height; ++row) {
+        const uint8_t* pixels = data + row * stride;
+        for (int col = 0; col < width; ++col) {
+            template_[row * width + col] = pixels[col];
+            sum += pixels[col];
+            sum_sq += pixels[col] * pixels[col];
+        }
+    }
+
+    const double area = static_cast<double>(width) * height;
+    template_sum_ = sum;
+    template_mean_ = sum / area;
+    template_norm_ = std::sqrt(std::max(0.0, sum_sq - sum * template_mean_));
+    width_ = width;
+    height_ = height;
+    return true;
+}
+
+void NccKernel::reset()
+{
+    template_.clear();
+    width_ = 0;
+    height_ = 0;
+    template_sum_ = 0;
+    template_mean_ = 0.0;
+    template_norm_ = 0.0;
+}
+
+bool NccKernel::match(const uint8_t* image, int width, int height, size_t stride,
+                      float* result, size_t result_stride)
+{
+    return match(image, width, height, stride, result, result_stride, get_best_isa());
+}
+
+bool NccKernel::match(const uint8_t* image, int width, int height, size_t stride,
+                      float* result, size_t result_stride, Isa isa)
+{
+    if (!is_ready() || !image || !result || width < width_ || height < height_) {
+        return false;
+    }
+
+    PROFILE_ZONE("ncc_kernel");
+
+    const DotFunction dot = get_dot_function(is_isa_supported(isa) ? isa : Isa::SCALAR);
+    const int result_width = width - width_ + 1;
+    const int result_height = height - height_ + 1;
+    const double area = static_cast<double>(width_) * height_;
+
+    // 列方向の移動和（各列の縦height_画素分の和・二乗和）
+    column_sum_.assign(width, 0);
+    column_sq_.assign(width, 0);
+    for (int row = 0; row < height_; ++row) {
+        const uint8_t* pixels = image + row * stride;
+        for (int x = 0; x < width; ++x) {
+            column_sum_[x] += pixels[x];
+            column_sq_[x] += pixels[x] * pixels[x];
+        }
+    }
+
+    for (int y = 0; y < result_height; ++y) {
+        if (y > 0) {
+            const uint8_t* removed = image + (y - 1) * stride;
+            const uint8_t* added = image + (y + height_ - 1) * stride;
+            for (int x = 0; x < width; ++x) {
+                column_sum_[x] += added[x] - removed[x];
+                column_sq_[x] += added[x] * added[x] - removed[x] * removed[x];
+            }
+        }
+
+        // 行方向の移動和で窓内の和・二乗和を求める
+        int64_t window_sum = 0;
+        int64_t window_sq = 0;
+        for (int x = 0; x < width_; ++x) {
+            window_sum += column_sum_[x];
+            window_sq += column_sq_[x];
+        }
+
+        const uint8_t* window_row = image + y * stride;
+        float* out = result + y * result_stride;
+
+        for (int x = 0; x < result_width; ++x) {
+            if (x > 0) {
+                window_sum += column_sum_[x + width_ - 1] - column_sum_[x - 1];
+                window_sq += column_sq_[x + width_ - 1] - column_sq_[x - 1];
+            }
+
+            // 分子: Σ(I - Ī)(T - T̄) = Σ I・T - Σ I・T̄
+            const int32_t products = dot(window_row + x, stride, template_.data(), width_, height_);
+            const double numerator = products - window_sum * template_mean_;
+            const double variance = static_cast<double>(window_sq) -
+                                    static_cast<double>(window_sum) * window_sum / area;
+            const double denominator = std::sqrt(std::max(0.0, variance)) * template_norm_;
+
+            out[x] = normalize_correlation(numerator, denominator);
+        }
+    }
+
+    return true;
+}
+
+size_t NccKernel::get_memory_usage() const
+{
+    return template_.size() * sizeof(int16_t) + column_sum_.size() * sizeof(int32_t) +
+           column_sq_.size() * sizeof(int64_t);
+}
+
+NccKernel::Isa NccKernel::get_best_isa()
+{
+    static const Isa best = []() {
+        if (is_isa_supported(Isa::AVX2)) return Isa::AVX2;
+        if (is_isa_supported(Isa::NEON)) return Isa::NEON;
+        if (is_isa_supported(Isa::SSE2)) return Isa::SSE2;
+        return Isa::SCALAR;
+    }();
+    return best;
+}
+
+bool NccKernel::is_isa_supported(Isa isa)
+{
+    switch (isa) {
+        case Isa::SCALAR:
+            return true;
+#if defined(GAT_NCC_X86)
+        case Isa::SSE2:
+            return true;
+        case Isa::AVX2: {
+            static const bool supported = detect_avx2();
+            return supported;
+        }
+#endif
+#if defined(GAT_NCC_NEON)
+        case Isa::NEON:
+            return true;
+#endif
+        default:
+            return false;
+    }
+}
+
+const char* NccKernel::get_isa_name(Isa isa)
+{
+    switch (isa) {
+        case Isa::SCALAR: return "scalar";
+        case Isa::SSE2:   return "sse2";
+        case Isa::AVX2:   return "avx2";
+        case Isa::NEON:   return "neon";
+        default:          return "unknown";
+    }
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * 8bitグレースケール用の正規化相互相関カーネル（TM_CCOEFF_NORMED相当）
+ * 32〜96px程度の小さいテンプレート向けに、整数の積和（AVX2/SSE2/NEON）と
+ * 列方向の移動和による窓内の和・二乗和で相関マップを直接計算する
+ * 使用する命令セットは実行時にCPUを判定して選択する
+ */
+class NccKernel {
+public:
+    enum class Isa {
+        SCALAR,
+        SSE2,
+        AVX2,
+        NEON
+    };
+
+    // 積和をint32で誤差なく累積できるテンプレート画素数の上限（255 * 255 * N < 2^31）
+    static constexpr int kMaxTemplateArea = 32768;
+
+public:
+    NccKernel();
+
+    bool set_template(const uint8_t* data, int width, int height, size_t stride);
+    void reset();
+    bool is_ready() const { return width_ > 0; }
+    int get_template_width() const { return width_; }
+    int get_template_height() const { return height_; }
+
+    // 相関マップの計算。resultは (width - tw + 1) x (height - th + 1) のfloat配列
+    bool match(const uint8_t* image, int width, int height, size_t stride,
+               float* result, size_t result_stride);
+    bool match(const uint8_t* image, int width, int height, size_t stride,
+               float* result, size_t result_stride, Isa isa);
+
+    size_t get_memory_usage() const;
+
+    // 命令セット
+    static Isa get_best_isa();
+    static bool is_isa_supported(Isa isa);
+    static const char* get_isa_name(Isa isa);
+
+private:
+    // テンプレート（int16に拡張して保持）
+    std::vector<int16_t> template_;
+    int width_;
+    int height_;
+    int64_t template_sum_;
+    double template_mean_;
+    double template_norm_;          // sqrt(Σ(T - mean)^2)
+
+    // フレーム間で再利用する列方向の移動和
+    std::vector<int32_t> column_sum_;
+    std::vector<int64_t> column_sq_;
+};
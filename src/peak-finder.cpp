@@ -0,0 +1,97 @@
+#include "peak-finder.h"
+#include "profiler.h"
+#include <algorithm>
+#include <cstdlib>
+
+namespace peak_finder {
+
+float box_overlap(cv::Point a, cv::Point b, cv::Size box_size)
+{
+    int overlap_width = box_size.width - std::abs(a.x - b.x);
+    int overlap_height = box_size.height - std::abs(a.y - b.y);
+    if (overlap_width <= 0 || overlap_height <= 0) return 0.0f;
+
+    float intersection = static_cast<float>(overlap_width) * overlap_height;
+    float box_area = static_cast<float>(box_size.width) * box_size.height;
+    return intersection / (2.0f * box_area - intersection);
+}
+
+namespace {
+
+// 8近傍の局所最大か（平坦なピークはラスタ順で最初の画素だけを残す）
+bool is_local_maximum(const cv::Mat& map, int x, int y, float value)
+{
+    for (int dy = -1; dy <= 1; ++dy) {
+        int ny = y + dy;
+        if (ny < 0 || ny >= map.rows) continue;
+        const float* row = map.ptr<float>(ny);
+
+        for (int dx = -1; dx <= 1; ++dx) {
+            int nx = x + dx;
+            if ((dx == 0 && dy == 0) || nx < 0 || nx >= map.cols) continue;
+
+            bool before = (dy < 0) || (dy == 0 && dx < 0);
+            if (before ? row[nx] >= value : row[nx] > value) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+std::vector<Peak> find_peaks(const cv::Mat& map, float threshold, int max_peaks,
+                             cv::Size box_size, float max_overlap)
+{
+    std::vector<Peak> peaks;
+    if (map.empty() || map.type() != CV_32F || max_peaks <= 0) {
+        return peaks;
+    }
+
+    PROFILE_ZONE("find_peaks");
+
+    // 閾値以上の局所最大を集める（ほとんどの画素は閾値の比較だけで済む）
+    std::vector<Peak> candidates;
+    for (int y = 0; y < map.rows; ++y) {
+        const float* row = map.ptr<float>(y);
+        for (int x = 0; x < map.cols; ++x) {
+            float value = row[x];
+            if (value >= threshold && is_local_maximum(map, x, y, value)) {
+                candidates.push_back({cv::Point(x, y), value});
+            }
+        }
+    }
+
+    auto higher_score = [](const Peak& a, const Peak& b) { return a.score > b.score; };
+
+    // 候補全体は整列せず、必要な分だけ上位から部分整列してNMSにかける
+    const size_t batch_size = std::max<size_t>(16, static_cast<size_t>(max_peaks) * 4);
+    size_t processed = 0;
+    peaks.reserve(static_cast<size_t>(max_peaks));
+
+    while (peaks.size() < static_cast<size_t>(max_peaks) && processed < candidates.size()) {
+        size_t batch_end = std::min(candidates.size(), processed + batch_size);
+        std::partial_sort(candidates.begin() + processed, candidates.begin() + batch_end,
+                          candidates.end(), higher_score);
+
+        for (size_t i = processed; i < batch_end && peaks.size() < static_cast<size_t>(max_peaks); ++i) {
+            const Peak& candidate = candidates[i];
+            bool suppressed = false;
+            for (const Peak& peak : peaks) {
+                if (box_overlap(candidate.location, peak.location, box_size) > max_overlap) {
+                    suppressed = true;
+                    break;
+                }
+            }
+            if (!suppressed) {
+                peaks.push_back(candidate);
+            }
+        }
+        processed = batch_end;
+    }
+
+    return peaks;
+}
+
+} // namespace peak_finder
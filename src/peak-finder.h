@@ -0,0 +1,24 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <vector>
+
+// 相関マップからの複数ピーク抽出
+// 閾値以上の局所最大だけを候補として一度の走査で集め、スコア順の部分整列と
+// 貪欲な非最大値抑制（NMS）で上位K件を選ぶ
+namespace peak_finder {
+
+struct Peak {
+    cv::Point location;     // マップ上の位置（テンプレート左上）
+    float score;
+};
+
+// 同じ大きさ（box_size）の矩形同士のIoU。aとbは左上の位置
+float box_overlap(cv::Point a, cv::Point b, cv::Size box_size);
+
+// mapはCV_32F。box_sizeは各ピークが表す矩形の大きさ（テンプレートサイズ）で、
+// 選択済みの矩形とのIoUがmax_overlapを超える候補は捨てる
+std::vector<Peak> find_peaks(const cv::Mat& map, float threshold, int max_peaks,
+                             cv::Size box_size, float max_overlap = 0.3f);
+
+} // namespace peak_finder
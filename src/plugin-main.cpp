@@ -1,6 +1,10 @@
 #include <obs-module.h>
 #include <obs-frontend-api.h>
 #include "game-audio-trigger.h"
+#include "activity-monitor.h"
+#include "detection-pipeline.h"
+#include "audio-output.h"
+#include "streamed-clip.h"
 
 // プラグイン情報の定義
 OBS_DECLARE_MODULE()
@@ -17,6 +21,9 @@ bool obs_module_load(void)
 {
     blog(LOG_INFO, "[Game Audio Trigger] Plugin loaded successfully");
     
+    // プラグイン全体設定の読み込み
+    load_plugin_config();
+    
     // ソースタイプの登録
     obs_source_info game_audio_trigger_info = {};
     game_audio_trigger_info.id = "game_audio_trigger";
@@ -34,9 +41,16 @@ bool obs_module_load(void)
     game_audio_trigger_info.video_render = game_audio_trigger_video_render;
     game_audio_trigger_info.get_width = game_audio_trigger_get_width;
     game_audio_trigger_info.get_height = game_audio_trigger_get_height;
+    game_audio_trigger_info.show = game_audio_trigger_show;
+    game_audio_trigger_info.hide = game_audio_trigger_hide;
+    game_audio_trigger_info.activate = game_audio_trigger_activate;
+    game_audio_trigger_info.deactivate = game_audio_trigger_deactivate;
     
     // ソースの登録
     obs_register_source(&game_audio_trigger_info);
+
+    // 配信・録画状態の監視（検出の休止条件に使う）
+    ActivityMonitor::instance().start();
     
     return true;
 }
@@ -44,6 +58,10 @@ bool obs_module_load(void)
 // プラグインアンロード時の処理
 void obs_module_unload(void)
 {
+    ActivityMonitor::instance().stop();
+    DetectionPipeline::instance().shutdown();
+    AudioOutput::instance().stop();
+    AudioStreamer::instance().shutdown();
     blog(LOG_INFO, "[Game Audio Trigger] Plugin unloaded");
 }
 
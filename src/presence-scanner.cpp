@@ -0,0 +1,199 @@
+#include "presence-scanner.h"
+#include "profiler.h"
+#include <opencv2/imgproc.hpp>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// 窓内の画素分散がこれ未満（ほぼ単色）の位置は候補にしない
+const double kMinWindowVariance = 0.01;
+
+// 浮動小数の丸め誤差で閾値ちょうどの位置を取りこぼさないための余裕
+const double kBoundSlack = 1e-4;
+
+inline double rect_sum(const cv::Mat& integral, int x, int y, int width, int height)
+{
+    const double* top = integral.ptr<double>(y);
+    const double* bottom = integral.ptr<double>(y + height);
+    return bottom[x + width] - bottom[x] - top[x + width] + top[x];
+}
+
+} // namespace
+
+PresenceScanner::PresenceScanner()
+    : template_norm_(0.0)
+    , stats_{0, 0, 0}
+{
+}
+
+bool PresenceScanner::set_template(const cv::Mat& template_image)
+{
+    reset();
+
+    if (template_image.empty() || template_image.channels() != 1) {
+        return false;
+    }
+
+    template_image.convertTo(template_, CV_32F);
+    template_ -= cv::mean(template_)[0];
+    template_norm_ = cv::norm(template_, cv::NORM_L2);
+
+    if (template_norm_ < 1e-3) {
+        template_.release();
+        return false;
+    }
+
+    template_size_ = template_.size();
+
+    // 行単位の後方累積和
+    suffix_sum_.assign(template_size_.height + 1, 0.0);
+    suffix_sq_.assign(template_size_.height + 1, 0.0);
+    for (int row = template_size_.height - 1; row >= 0; --row) {
+        const float* values = template_.ptr<float>(row);
+        double row_sum = 0.0;
+        double row_sq = 0.0;
+        for (int col = 0; col < template_size_.width; ++col) {
+            row_sum += values[col];
+            row_sq += static_cast<double>(values[col]) * values[col];
+        }
+        suffix_sum_[row] = suffix_sum_[row + 1] + row_sum;
+        suffix_sq_[row] = suffix_sq_[row + 1] + row_sq;
+    }
+
+    return true;
+}
+
+void PresenceScanner::reset()
+{
+    template_.release();
+    template_size_ = cv::Size();
+    template_norm_ = 0.0;
+    suffix_sum_.clear();
+    suffix_sq_.clear();
+}
+
+bool PresenceScanner::scan(const cv::Mat& image, float threshold, cv::Point seed,
+                           cv::Point& hit_location, float& hit_score)
+{
+    stats_ = {0, 0, 0};
+
+    if (!is_ready() || image.empty() || image.channels() != 1 ||
+        image.cols < template_size_.width || image.rows < template_size_.height) {
+        return false;
+    }
+
+    PROFILE_ZONE("presence_scan");
+
+    image.convertTo(image_f_, CV_32F);
+    cv::integral(image, sum_, sqsum_, CV_64F, CV_64F);
+
+    const int result_width = image.cols - template_size_.width + 1;
+    const int result_height = image.rows - template_size_.height + 1;
+    stats_.positions_total = static_cast<uint64_t>(result_width) * result_height;
+
+    seed.x = std::clamp(seed.x, 0, result_width - 1);
+    seed.y = std::clamp(seed.y, 0, result_height - 1);
+
+    auto visit = [&](int x, int y) {
+        if (evaluate(x, y, threshold, hit_score)) {
+            hit_location = cv::Point(x, y);
+            return true;
+        }
+        return false;
+    };
+
+    if (visit(seed.x, seed.y)) return true;
+
+    // 起点を中心とした正方形の輪を外側へ広げながら走査する
+    const int max_radius = std::max({seed.x, result_width - 1 - seed.x, seed.y, result_height - 1 - seed.y});
+    for (int radius = 1; radius <= max_radius; ++radius) {
+        const int x_begin = std::max(0, seed.x - radius);
+        const int x_end = std::min(result_width - 1, seed.x + radius);
+        const int y_begin = std::max(0, seed.y - radius + 1);
+        const int y_end = std::min(result_height - 1, seed.y + radius - 1);
+
+        if (seed.y - radius >= 0) {
+            for (int x = x_begin; x <= x_end; ++x) {
+                if (visit(x, seed.y - radius)) return true;
+            }
+        }
+        if (seed.y + radius < result_height) {
+            for (int x = x_begin; x <= x_end; ++x) {
+                if (visit(x, seed.y + radius)) return true;
+            }
+        }
+        if (seed.x - radius >= 0) {
+            for (int y = y_begin; y <= y_end; ++y) {
+                if (visit(seed.x - radius, y)) return true;
+            }
+        }
+        if (seed.x + radius < result_width) {
+            for (int y = y_begin; y <= y_end; ++y) {
+                if (visit(seed.x + radius, y)) return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+size_t PresenceScanner::get_memory_usage() const
+{
+    auto mat_bytes = [](const cv::Mat& mat) { return mat.total() * mat.elemSize(); };
+    return mat_bytes(template_) + mat_bytes(image_f_) + mat_bytes(sum_) + mat_bytes(sqsum_) +
+           (suffix_sum_.size() + suffix_sq_.size()) * sizeof(double);
+}
+
+bool PresenceScanner::evaluate(int x, int y, float threshold, float& score)
+{
+    const int tw = template_size_.width;
+    const int th = template_size_.height;
+    const double area = static_cast<double>(tw) * th;
+
+    const double window_sum = rect_sum(sum_, x, y, tw, th);
+    const double window_sq = rect_sum(sqsum_, x, y, tw, th);
+    const double mean = window_sum / area;
+    const double variance = window_sq - window_sum * mean;
+    if (variance < kMinWindowVariance * area) {
+        return false;
+    }
+
+    // テンプレートは平均0なので、分子は Σ I・T' そのもの
+    const double denominator = std::sqrt(variance) * template_norm_;
+    const double required = (threshold - kBoundSlack) * denominator;
+
+    ++stats_.positions_evaluated;
+
+    double partial = 0.0;
+    for (int row = 0; row < th; ++row) {
+        const float* image_row = image_f_.ptr<float>(y + row) + x;
+        const float* template_row = template_.ptr<float>(row);
+        float row_sum = 0.0f;
+        for (int col = 0; col < tw; ++col) {
+            row_sum += image_row[col] * template_row[col];
+        }
+        partial += row_sum;
+        ++stats_.rows_evaluated;
+
+        const int next = row + 1;
+        if (next == th) break;
+
+        // 残りの行の寄与の上限:
+        //   Σ_rem I・T' = Σ_rem (I - μ)・T' + μ・Σ_rem T'
+        //              <= sqrt(Σ_rem (I - μ)^2 ・ Σ_rem T'^2) + μ・Σ_rem T'
+        const double remaining_area = static_cast<double>(tw) * (th - next);
+        const double remaining_sum = rect_sum(sum_, x, y + next, tw, th - next);
+        const double remaining_sq = rect_sum(sqsum_, x, y + next, tw, th - next);
+        const double remaining_energy = std::max(0.0,
+            remaining_sq - 2.0 * mean * remaining_sum + remaining_area * mean * mean);
+        const double bound = partial + mean * suffix_sum_[next] + std::sqrt(remaining_energy * suffix_sq_[next]);
+
+        if (bound < required) {
+            return false;
+        }
+    }
+
+    score = static_cast<float>(partial / denominator);
+    return score >= threshold;
+}
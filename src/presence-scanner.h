@@ -0,0 +1,56 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <cstdint>
+#include <vector>
+
+/**
+ * 在否判定専用の早期終了付き正規化相互相関（TM_CCOEFF_NORMED相当）
+ * 候補位置を起点（前回の検出位置など）から近い順に調べ、行ごとの部分和と
+ * 残りの行のCauchy-Schwarz上限から閾値に届かないと確定した位置は途中で打ち切る
+ * 閾値を超える位置が見つかった時点で走査を終える
+ * 単一チャンネル画像のみ対応
+ */
+class PresenceScanner {
+public:
+    struct Stats {
+        uint64_t positions_total;       // 候補位置の総数
+        uint64_t positions_evaluated;   // 相関の計算を始めた位置の数
+        uint64_t rows_evaluated;        // 計算したテンプレート行の総数
+    };
+
+public:
+    PresenceScanner();
+
+    bool set_template(const cv::Mat& template_image);
+    void reset();
+    bool is_ready() const { return !template_.empty(); }
+    cv::Size get_template_size() const { return template_size_; }
+
+    // 閾値以上の位置を探す。seedは結果座標系（テンプレート左上）での起点
+    bool scan(const cv::Mat& image, float threshold, cv::Point seed,
+              cv::Point& hit_location, float& hit_score);
+
+    const Stats& get_last_stats() const { return stats_; }
+    size_t get_memory_usage() const;
+
+private:
+    bool evaluate(int x, int y, float threshold, float& score);
+
+private:
+    // 平均を引いたテンプレート（CV_32F）とそのノルム
+    cv::Mat template_;
+    cv::Size template_size_;
+    double template_norm_;
+
+    // k行目以降のテンプレートの和・二乗和（上限の計算用）
+    std::vector<double> suffix_sum_;
+    std::vector<double> suffix_sq_;
+
+    // フレーム間で再利用する作業バッファ
+    cv::Mat image_f_;
+    cv::Mat sum_;
+    cv::Mat sqsum_;
+
+    Stats stats_;
+};
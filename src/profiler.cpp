@@ -0,0 +1,127 @@
+#include "profiler.h"
+#include "json-util.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+
+Profiler& Profiler::instance()
+{
+    static Profiler profiler;
+    return profiler;
+}
+
+Profiler::Profiler()
+    : enabled_(false)
+    , origin_ns_(now_ns())
+{
+}
+
+int64_t Profiler::now_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+Profiler::ThreadBuffer* Profiler::get_thread_buffer()
+{
+    thread_local ThreadBuffer* buffer = nullptr;
+    if (buffer) return buffer;
+
+    // 初回のみロックしてバッファを登録する
+    auto new_buffer = std::make_unique<ThreadBuffer>();
+    new_buffer->thread_name.store(nullptr, std::memory_order_relaxed);
+    new_buffer->head.store(0, std::memory_order_relaxed);
+    for (auto& event : new_buffer->events) {
+        event.name.store(nullptr, std::memory_order_relaxed);
+        event.start_ns.store(0, std::memory_order_relaxed);
+        event.duration_ns.store(0, std::memory_order_relaxed);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    new_buffer->thread_id = static_cast<uint32_t>(buffers_.size() + 1);
+    buffer = new_buffer.get();
+    buffers_.push_back(std::move(new_buffer));
+    return buffer;
+}
+
+void Profiler::record(const char* name, int64_t start_ns, int64_t end_ns)
+{
+    ThreadBuffer* buffer = get_thread_buffer();
+    uint64_t index = buffer->head.load(std::memory_order_relaxed);
+    Event& event = buffer->events[index % kEventsPerThread];
+
+    event.name.store(name, std::memory_order_relaxed);
+    event.start_ns.store(start_ns, std::memory_order_relaxed);
+    event.duration_ns.store(end_ns - start_ns, std::memory_order_relaxed);
+    buffer->head.store(index + 1, std::memory_order_release);
+}
+
+void Profiler::set_thread_name(const char* name)
+{
+    get_thread_buffer()->thread_name.store(name, std::memory_order_relaxed);
+}
+
+std::string Profiler::to_chrome_json() const
+{
+    std::ostringstream json;
+    json << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+    bool first = true;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& buffer : buffers_) {
+        const char* thread_name = buffer->thread_name.load(std::memory_order_relaxed);
+        if (thread_name) {
+            json << (first ? "" : ",\n")
+                 << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << buffer->thread_id
+                 << ", \"args\": {\"name\": \"" << json_util::escape(thread_name) << "\"}}";
+            first = false;
+        }
+
+        uint64_t head = buffer->head.load(std::memory_order_acquire);
+        uint64_t begin = head > kEventsPerThread ? head - kEventsPerThread : 0;
+
+        for (uint64_t i = begin; i < head; ++i) {
+            const Event& event = buffer->events[i % kEventsPerThread];
+            const char* name = event.name.load(std::memory_order_relaxed);
+            int64_t start_ns = event.start_ns.load(std::memory_order_relaxed);
+            int64_t duration_ns = event.duration_ns.load(std::memory_order_relaxed);
+
+            // 読み出し中に書き込みスレッドが周回したスロットは破棄する
+            uint64_t current_head = buffer->head.load(std::memory_order_acquire);
+            if (!name || current_head >= i + kEventsPerThread) continue;
+
+            char timing[96];
+            snprintf(timing, sizeof(timing), "\"ts\": %.3f, \"dur\": %.3f",
+                     static_cast<double>(start_ns - origin_ns_) / 1000.0,
+                     static_cast<double>(duration_ns) / 1000.0);
+
+            json << (first ? "" : ",\n")
+                 << "{\"name\": \"" << json_util::escape(name) << "\", \"ph\": \"X\", " << timing
+                 << ", \"pid\": 1, \"tid\": " << buffer->thread_id << "}";
+            first = false;
+        }
+    }
+
+    json << "\n]}\n";
+    return json.str();
+}
+
+bool Profiler::export_chrome_trace(const std::string& path) const
+{
+    std::ofstream file(path, std::ios::out | std::ios::trunc);
+    if (!file) return false;
+
+    file << to_chrome_json();
+    return file.good();
+}
+
+void Profiler::clear()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& buffer : buffers_) {
+        for (auto& event : buffer->events) {
+            event.name.store(nullptr, std::memory_order_relaxed);
+        }
+    }
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * 検出パイプライン用の軽量プロファイラ
+ * スコープ単位の計測区間をスレッドごとのリングバッファに記録し、
+ * Chrome trace-event形式（chrome://tracing / Perfetto）のJSONで出力する
+ *
+ * 無効時のコストはアトミック変数の読み込み1回のみ。
+ * GAT_ENABLE_PROFILER=0でビルドするとPROFILE_ZONEは完全に消える。
+ */
+class Profiler {
+public:
+    static constexpr size_t kEventsPerThread = 8192;
+
+public:
+    static Profiler& instance();
+
+    // 実行時の有効/無効
+    void set_enabled(bool enable) { enabled_.store(enable, std::memory_order_relaxed); }
+    bool is_enabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+    // 区間の記録（呼び出しスレッドのバッファに書き込む）
+    void record(const char* name, int64_t start_ns, int64_t end_ns);
+    void set_thread_name(const char* name);
+
+    // 出力
+    std::string to_chrome_json() const;
+    bool export_chrome_trace(const std::string& path) const;
+    void clear();
+
+    static int64_t now_ns();
+
+private:
+    struct Event {
+        std::atomic<const char*> name;
+        std::atomic<int64_t> start_ns;
+        std::atomic<int64_t> duration_ns;
+    };
+
+    struct ThreadBuffer {
+        uint32_t thread_id;
+        std::atomic<const char*> thread_name;
+        std::atomic<uint64_t> head;
+        std::array<Event, kEventsPerThread> events;
+    };
+
+    Profiler();
+    ThreadBuffer* get_thread_buffer();
+
+private:
+    std::atomic<bool> enabled_;
+    int64_t origin_ns_;
+
+    // スレッド終了後もバッファはプロセス終了まで保持する（thread_localの参照を無効にしないため）
+    mutable std::mutex mutex_;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers_;
+};
+
+/**
+ * スコープ計測用RAIIヘルパー
+ */
+class TraceZone {
+public:
+    explicit TraceZone(const char* name)
+        : name_(Profiler::instance().is_enabled() ? name : nullptr)
+        , start_ns_(name_ ? Profiler::now_ns() : 0)
+    {
+    }
+
+    ~TraceZone()
+    {
+        if (name_) {
+            Profiler::instance().record(name_, start_ns_, Profiler::now_ns());
+        }
+    }
+
+    TraceZone(const TraceZone&) = delete;
+    TraceZone& operator=(const TraceZone&) = delete;
+
+private:
+    const char* name_;
+    int64_t start_ns_;
+};
+
+#ifndef GAT_ENABLE_PROFILER
+#define GAT_ENABLE_PROFILER 1
+#endif
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#if GAT_ENABLE_PROFILER
+// nameは文字列リテラルなど、プロセス終了まで有効な文字列を渡すこと
+#define PROFILE_ZONE(name) TraceZone PROFILE_CONCAT(trace_zone_, __LINE__)(name)
+#else
+#define PROFILE_ZONE(name) ((void)0)
+#endif
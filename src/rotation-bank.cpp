@@ -0,0 +1,422 @@
+#include "rotation-bank.h"
+#include "peak-finder.h"
+#include "profiler.h"
+#include <opencv2/imgproc.hpp>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// 等倍の角度の刻み: テンプレートの角がこの画素数だけ動く角度
+const float kCornerShift = 1.5f;
+const int kMaxAnglesPerSide = 360;
+
+// 1段目: 縮小後のテンプレートの短辺（CascadeFilterの低解像度NCCと同じ）
+const float kCoarseTemplateSize = 16.0f;
+const float kMaxCoarseScale = 0.5f;
+const int kMinCoarseTemplateSize = 8;
+
+// 1段目の角度の刻み: 縮小したテンプレートの角がこの画素数だけ動く角度
+const float kCoarseCornerShift = 0.75f;
+
+// 共通部分がこれより小さいと1段目で区別できない（細長いテンプレートを大きく回転する場合）
+const int kMinCommonPixels = 16;
+
+// 窓内の画素分散がこれ未満（ほぼ単色）の位置は相関0とする
+const double kMinWindowVariance = 0.01;
+
+// 縮小画像では位置と角度のずれで一致度が下がるため、閾値からこの分だけ下げて候補にする
+const float kCoarseMargin = 0.25f;
+const int kMaxCandidates = 3;
+const float kMaxCandidateOverlap = 0.3f;
+
+float to_degrees(float radians)
+{
+    return radians * 180.0f / static_cast<float>(CV_PI);
+}
+
+// 回転後の外接矩形の大きさ
+cv::Size rotated_bounds(cv::Size size, float angle)
+{
+    const double radians = angle * CV_PI / 180.0;
+    const double c = std::abs(std::cos(radians));
+    const double s = std::abs(std::sin(radians));
+    return cv::Size(static_cast<int>(std::ceil(size.width * c + size.height * s - 1e-3)),
+                    static_cast<int>(std::ceil(size.width * s + size.height * c - 1e-3)));
+}
+
+// canvasの中央に回転する。maskは回転したテンプレートの内側で、補間で背景が混ざる縁の1画素は除く
+// （0度でも同じだけ除き、角度による一致度の差を縁の扱いの違いで生じさせない）
+void rotate_template(const cv::Mat& source, float angle, cv::Size canvas, cv::Mat& rotated, cv::Mat& mask)
+{
+    const cv::Point2f center((source.cols - 1) * 0.5f, (source.rows - 1) * 0.5f);
+    cv::Mat transform = cv::getRotationMatrix2D(center, angle, 1.0);
+    transform.at<double>(0, 2) += (canvas.width - source.cols) * 0.5;
+    transform.at<double>(1, 2) += (canvas.height - source.rows) * 0.5;
+
+    cv::warpAffine(source, rotated, transform, canvas, cv::INTER_LINEAR, cv::BORDER_REPLICATE);
+
+    cv::Mat filled(source.size(), CV_8UC1, cv::Scalar(255));
+    cv::warpAffine(filled, mask, transform, canvas, cv::INTER_NEAREST, cv::BORDER_CONSTANT, cv::Scalar(0));
+    cv::erode(mask, mask, cv::Mat(), cv::Point(-1, -1), 1, cv::BORDER_CONSTANT, cv::Scalar(0));
+}
+
+} // namespace
+
+RotationBank::RotationBank()
+    : angle_step_(0.0f)
+    , angle_stride_(1)
+    , coarse_scale_(1.0f)
+    , common_pixels_(0.0)
+    , stats_{0, 0, 0}
+{
+}
+
+bool RotationBank::set_template(const cv::Mat& template_image, float tolerance_degrees)
+{
+    reset();
+
+    if (template_image.empty() || template_image.type() != CV_8UC1) {
+        return false;
+    }
+
+    // 等倍の角度: -tolerance〜+toleranceを等間隔に（0度を必ず含む）
+    const float tolerance = std::clamp(tolerance_degrees, 0.0f, 180.0f);
+    const float half_diagonal = 0.5f * std::hypot(static_cast<float>(template_image.cols),
+                                                  static_cast<float>(template_image.rows));
+    int steps = 0;
+    if (tolerance > 0.0f) {
+        steps = static_cast<int>(std::ceil(tolerance / to_degrees(kCornerShift / half_diagonal)));
+        steps = std::clamp(steps, 1, kMaxAnglesPerSide);
+        angle_step_ = tolerance / steps;
+    }
+
+    entries_.reserve(2 * steps + 1);
+    for (int i = -steps; i <= steps; ++i) {
+        Entry entry;
+        entry.angle = steps > 0 ? tolerance * i / steps : 0.0f;
+        if (steps == 0) {
+            entry.image = template_image;
+        } else {
+            rotate_template(template_image, entry.angle, rotated_bounds(template_image.size(), entry.angle),
+                            entry.image, entry.mask);
+        }
+        entries_.push_back(std::move(entry));
+    }
+
+    if (!build_coarse_entries(template_image)) {
+        reset();
+        return false;
+    }
+    return true;
+}
+
+bool RotationBank::build_coarse_entries(const cv::Mat& template_image)
+{
+    // 縮小しても十分な大きさが残る倍率（小さいテンプレートは縮小しない）
+    const int short_side = std::min(template_image.cols, template_image.rows);
+    coarse_scale_ = std::min(kMaxCoarseScale, kCoarseTemplateSize / short_side);
+    if (short_side * coarse_scale_ < kMinCoarseTemplateSize) {
+        coarse_scale_ = std::min(1.0f, static_cast<float>(kMinCoarseTemplateSize) / short_side);
+    }
+
+    cv::Mat coarse_template = template_image;
+    if (coarse_scale_ < 1.0f) {
+        cv::resize(template_image, coarse_template, cv::Size(), coarse_scale_, coarse_scale_, cv::INTER_AREA);
+    }
+    coarse_size_ = coarse_template.size();
+
+    // 1段目で照合する角度（中央の0度から等倍の角度を間引き、両端も含める）
+    const size_t middle = entries_.size() / 2;
+    if (middle > 0) {
+        const float coarse_half_diagonal = 0.5f * std::hypot(static_cast<float>(coarse_size_.width),
+                                                             static_cast<float>(coarse_size_.height));
+        const float coarse_step = to_degrees(kCoarseCornerShift / coarse_half_diagonal);
+        angle_stride_ = std::max<size_t>(1, static_cast<size_t>(coarse_step / angle_step_));
+    }
+
+    std::vector<size_t> indices = {middle};
+    for (size_t offset = angle_stride_; offset <= middle; offset += angle_stride_) {
+        indices.push_back(middle - offset);
+        indices.push_back(middle + offset);
+    }
+    if (middle % angle_stride_ != 0) {
+        indices.push_back(0);
+        indices.push_back(entries_.size() - 1);
+    }
+    std::sort(indices.begin(), indices.end());
+
+    // 縮小したテンプレートを同じ大きさのまま回転し、すべての角度で内側になる共通部分を求める
+    std::vector<cv::Mat> rotated(indices.size());
+    cv::Mat common(coarse_size_, CV_8UC1, cv::Scalar(255));
+    for (size_t k = 0; k < indices.size(); ++k) {
+        const float angle = entries_[indices[k]].angle;
+        if (angle == 0.0f) {
+            rotated[k] = coarse_template;
+            continue;
+        }
+
+        cv::Mat mask;
+        rotate_template(coarse_template, angle, coarse_size_, rotated[k], mask);
+        cv::bitwise_and(common, mask, common);
+    }
+
+    if (cv::countNonZero(common) < kMinCommonPixels) {
+        return false;
+    }
+    const cv::Rect bounds = cv::boundingRect(common);
+    common_offset_ = bounds.tl();
+    common(bounds).convertTo(common_mask_, CV_32F, 1.0 / 255.0);
+    common_pixels_ = cv::sum(common_mask_)[0];
+
+    // 共通部分で平均を引いてノルムを1にしておくと、1段目の相関の分子が角度ごとに相関1回で求まる
+    for (size_t k = 0; k < indices.size(); ++k) {
+        cv::Mat kernel;
+        rotated[k](bounds).convertTo(kernel, CV_32F);
+
+        const double mean = cv::sum(kernel.mul(common_mask_))[0] / common_pixels_;
+        kernel -= mean;
+        kernel = kernel.mul(common_mask_);
+
+        const double norm = cv::norm(kernel);
+        if (norm < 1e-3) continue;  // 共通部分が単色
+        kernel /= norm;
+        coarse_entries_.push_back({indices[k], kernel});
+    }
+
+    return !coarse_entries_.empty();
+}
+
+void RotationBank::reset()
+{
+    entries_.clear();
+    coarse_entries_.clear();
+    angle_step_ = 0.0f;
+    angle_stride_ = 1;
+    coarse_scale_ = 1.0f;
+    coarse_size_ = cv::Size();
+    common_offset_ = cv::Point();
+    common_mask_.release();
+    common_pixels_ = 0.0;
+    release_buffers();
+    stats_ = {0, 0, 0};
+}
+
+void RotationBank::release_buffers()
+{
+    coarse_image_.release();
+    coarse_squared_.release();
+    window_sum_.release();
+    window_sqsum_.release();
+    correlation_.release();
+    best_score_.release();
+    best_index_.release();
+    update_mask_.release();
+    verify_result_.release();
+}
+
+RotationBank::Match RotationBank::match(const cv::Mat& image, float threshold)
+{
+    Match result = {};
+    stats_ = {0, 0, 0};
+
+    if (!is_ready() || image.empty() || image.type() != CV_8UC1) {
+        return result;
+    }
+
+    PROFILE_ZONE("rotation_bank");
+
+    // 1段目: 縮小画像で全角度の相関の最大値と、その角度を画素ごとに求める
+    {
+        PROFILE_ZONE("rotation_coarse");
+        cv::Mat resized = image;
+        if (coarse_scale_ < 1.0f) {
+            cv::resize(image, resized, cv::Size(), coarse_scale_, coarse_scale_, cv::INTER_AREA);
+        }
+        if (resized.cols < common_mask_.cols || resized.rows < common_mask_.rows) {
+            return result;
+        }
+
+        // 128を引いておき、二乗和の桁落ちを抑える（相関の分子は平均0のカーネルなので変わらない）
+        resized.convertTo(coarse_image_, CV_32F, 1.0, -128.0);
+        cv::multiply(coarse_image_, coarse_image_, coarse_squared_);
+        cv::matchTemplate(coarse_image_, common_mask_, window_sum_, cv::TM_CCORR);
+        cv::matchTemplate(coarse_squared_, common_mask_, window_sqsum_, cv::TM_CCORR);
+
+        for (size_t k = 0; k < coarse_entries_.size(); ++k) {
+            cv::matchTemplate(coarse_image_, coarse_entries_[k].kernel, correlation_, cv::TM_CCORR);
+            if (k == 0) {
+                correlation_.copyTo(best_score_);
+                best_index_.create(correlation_.size(), CV_16U);
+                best_index_.setTo(cv::Scalar(0));
+                continue;
+            }
+            cv::compare(correlation_, best_score_, update_mask_, cv::CMP_GT);
+            correlation_.copyTo(best_score_, update_mask_);
+            best_index_.setTo(cv::Scalar(static_cast<double>(k)), update_mask_);
+        }
+        stats_.coarse_angles = static_cast<uint32_t>(coarse_entries_.size());
+
+        // 窓の標準偏差（共通部分）で割ってNCCにする
+        const double min_variance = kMinWindowVariance * common_pixels_;
+        cv::multiply(window_sum_, window_sum_, window_sum_, 1.0 / common_pixels_);
+        cv::subtract(window_sqsum_, window_sum_, window_sqsum_);
+        cv::compare(window_sqsum_, min_variance, update_mask_, cv::CMP_LT);
+        cv::max(window_sqsum_, min_variance, window_sqsum_);
+        cv::sqrt(window_sqsum_, window_sqsum_);
+        cv::divide(best_score_, window_sqsum_, best_score_);
+        best_score_.setTo(cv::Scalar(0), update_mask_);
+    }
+
+    std::vector<peak_finder::Peak> candidates = peak_finder::find_peaks(
+        best_score_, threshold - kCoarseMargin, kMaxCandidates, common_mask_.size(), kMaxCandidateOverlap);
+    stats_.candidates = static_cast<uint32_t>(candidates.size());
+
+    if (candidates.empty()) {
+        double max_val = 0.0;
+        cv::minMaxLoc(best_score_, nullptr, &max_val);
+        result.confidence = std::clamp(static_cast<float>(max_val), 0.0f, 1.0f);
+        return result;
+    }
+
+    // 2段目: 候補ごとに1段目の角度を等倍で確認し、一致度が上がる間は隣の角度へ進める。
+    // 縮小画像では角度の区別が粗いため、一致度が低ければ1段目で隣り合う角度も確認する
+    PROFILE_ZONE("rotation_verify");
+    const int radius = static_cast<int>(std::ceil(1.0f / coarse_scale_)) + 1;
+    for (const auto& candidate : candidates) {
+        const cv::Point2f coarse_center(
+            (candidate.location.x - common_offset_.x + coarse_size_.width * 0.5f) / coarse_scale_,
+            (candidate.location.y - common_offset_.y + coarse_size_.height * 0.5f) / coarse_scale_);
+
+        size_t index = coarse_entries_[best_index_.at<uint16_t>(candidate.location)].index;
+        cv::Point location;
+        float score = verify(image, index, coarse_center, radius, location);
+
+        if (score < threshold - kCoarseMargin) {
+            const size_t coarse_index = index;
+            for (long next : {static_cast<long>(coarse_index) - static_cast<long>(angle_stride_),
+                              static_cast<long>(coarse_index + angle_stride_)}) {
+                if (next < 0 || next >= static_cast<long>(entries_.size())) continue;
+
+                cv::Point next_location;
+                const float next_score = verify(image, static_cast<size_t>(next), coarse_center, radius,
+                                                next_location);
+                if (next_score > score) {
+                    index = static_cast<size_t>(next);
+                    score = next_score;
+                    location = next_location;
+                }
+            }
+        }
+
+        if (score >= threshold - kCoarseMargin) {
+            climb(image, radius, index, score, location);
+        }
+
+        if (score > result.confidence) {
+            const Entry& entry = entries_[index];
+            result.confidence = score;
+            result.found = score >= threshold;
+            result.bounding_box = cv::Rect(location, entry.image.size());
+            result.center = cv::Point2f(location.x + entry.image.cols * 0.5f,
+                                        location.y + entry.image.rows * 0.5f);
+            result.angle = entry.angle;
+        }
+        if (result.found) break;
+    }
+
+    return result;
+}
+
+void RotationBank::climb(const cv::Mat& image, int radius, size_t& index, float& score, cv::Point& location)
+{
+    const long count = static_cast<long>(entries_.size());
+    auto center_of = [this](size_t entry_index, cv::Point top_left) {
+        const cv::Size size = entries_[entry_index].image.size();
+        return cv::Point2f(top_left.x + size.width * 0.5f, top_left.y + size.height * 0.5f);
+    };
+
+    // 両隣のうち一致度が高い方を進む向きにする
+    const long start = static_cast<long>(index);
+    const cv::Point2f start_center = center_of(index, location);
+    int direction = 0;
+    for (int d : {-1, 1}) {
+        const long next = start + d;
+        if (next < 0 || next >= count) continue;
+
+        cv::Point next_location;
+        const float next_score = verify(image, static_cast<size_t>(next), start_center, radius, next_location);
+        if (next_score > score) {
+            index = static_cast<size_t>(next);
+            score = next_score;
+            location = next_location;
+            direction = d;
+        }
+    }
+
+    // 一致度が上がる間だけ進める。補間の有無などで生じる小さな谷は1つ先まで越える
+    while (direction != 0) {
+        const cv::Point2f center = center_of(index, location);
+        bool improved = false;
+        for (long jump = 1; jump <= 2 && !improved; ++jump) {
+            const long next = static_cast<long>(index) + direction * jump;
+            if (next < 0 || next >= count) break;
+
+            cv::Point next_location;
+            const float next_score = verify(image, static_cast<size_t>(next), center, radius, next_location);
+            if (next_score > score) {
+                index = static_cast<size_t>(next);
+                score = next_score;
+                location = next_location;
+                improved = true;
+            }
+        }
+        if (!improved) break;
+    }
+}
+
+float RotationBank::verify(const cv::Mat& image, size_t index, cv::Point2f center, int radius, cv::Point& location)
+{
+    const Entry& entry = entries_[index];
+    cv::Rect window(cvRound(center.x - entry.image.cols * 0.5f) - radius,
+                    cvRound(center.y - entry.image.rows * 0.5f) - radius,
+                    entry.image.cols + 2 * radius, entry.image.rows + 2 * radius);
+    window &= cv::Rect(0, 0, image.cols, image.rows);
+    if (window.width < entry.image.cols || window.height < entry.image.rows) {
+        return 0.0f;
+    }
+
+    cv::matchTemplate(image(window), entry.image, verify_result_, cv::TM_CCOEFF_NORMED, entry.mask);
+    ++stats_.verified;
+
+    // マスク付きの照合は単色の窓でNaNや無限大になるため0にする
+    cv::patchNaNs(verify_result_, 0.0);
+    cv::compare(verify_result_, 1.0 + 1e-3, update_mask_, cv::CMP_GT);
+    verify_result_.setTo(cv::Scalar(0), update_mask_);
+
+    double max_val = 0.0;
+    cv::Point max_loc;
+    cv::minMaxLoc(verify_result_, nullptr, &max_val, nullptr, &max_loc);
+    location = window.tl() + max_loc;
+    return std::min(static_cast<float>(max_val), 1.0f);
+}
+
+size_t RotationBank::get_memory_usage() const
+{
+    auto mat_bytes = [](const cv::Mat& mat) { return mat.total() * mat.elemSize(); };
+
+    // 許容角度が0の場合のテンプレートは呼び出し側の画像を参照しているだけなので数えない
+    size_t bytes = mat_bytes(common_mask_);
+    for (size_t i = 0; i < entries_.size(); ++i) {
+        if (entries_[i].mask.empty()) continue;
+        bytes += mat_bytes(entries_[i].image) + mat_bytes(entries_[i].mask);
+    }
+    for (const auto& entry : coarse_entries_) {
+        bytes += mat_bytes(entry.kernel);
+    }
+
+    bytes += mat_bytes(coarse_image_) + mat_bytes(coarse_squared_) + mat_bytes(window_sum_) +
+             mat_bytes(window_sqsum_) + mat_bytes(correlation_) + mat_bytes(best_score_) +
+             mat_bytes(best_index_) + mat_bytes(update_mask_) + mat_bytes(verify_result_);
+    return bytes;
+}
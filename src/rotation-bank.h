@@ -0,0 +1,96 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <cstdint>
+#include <vector>
+
+/**
+ * 回転を許すテンプレートマッチング用の回転済みテンプレート群
+ * テンプレートの読み込み時に許容角度の範囲で回転したテンプレートとマスクを作っておき、照合は2段で行う
+ * 1段目: 縮小した探索画像で、間引いた角度のテンプレートを照合する。どの角度でも回転後のテンプレートの
+ *        共通部分（180度なら内接円）だけを使うため、窓の正規化はフレームごとに1回で済み、
+ *        角度ごとのコストは相関1回分になる
+ * 2段目: 一致度の高い候補位置で、1段目で最も一致した角度だけを等倍のマスク付きNCCで確認し、
+ *        隣の角度へ一致度が上がる間だけ進める
+ * 8bit単一チャンネルのみ対応。検出するのは1か所だけ
+ */
+class RotationBank {
+public:
+    struct Match {
+        bool found;
+        float confidence;
+        cv::Point2f center;
+        cv::Rect bounding_box;          // 回転したテンプレートの外接矩形
+        float angle;                    // 度（反時計回りが正。cv::getRotationMatrix2Dと同じ向き）
+    };
+
+    // 直近フレームの照合の内訳
+    struct Stats {
+        uint32_t coarse_angles;         // 1段目で照合した角度の数
+        uint32_t candidates;            // 1段目で残った候補位置
+        uint32_t verified;              // 等倍で照合した回数
+    };
+
+public:
+    RotationBank();
+
+    // tolerance_degreesは0〜180（0なら回転しないテンプレート1枚だけ）
+    bool set_template(const cv::Mat& template_image, float tolerance_degrees);
+    void reset();
+    bool is_ready() const { return !entries_.empty(); }
+
+    Match match(const cv::Mat& image, float threshold);
+
+    // 探索画像の大きさに比例する作業バッファを解放する
+    void release_buffers();
+
+    size_t get_angle_count() const { return entries_.size(); }
+    size_t get_coarse_angle_count() const { return coarse_entries_.size(); }
+    float get_angle_step() const { return angle_step_; }
+    float get_coarse_scale() const { return coarse_scale_; }
+    const Stats& get_last_stats() const { return stats_; }
+    size_t get_memory_usage() const;
+
+private:
+    bool build_coarse_entries(const cv::Mat& template_image);
+    float verify(const cv::Mat& image, size_t index, cv::Point2f center, int radius, cv::Point& location);
+    void climb(const cv::Mat& image, int radius, size_t& index, float& score, cv::Point& location);
+
+private:
+    struct Entry {
+        float angle;
+        cv::Mat image;                  // 回転したテンプレート（外接矩形の大きさ）
+        cv::Mat mask;                   // テンプレートの内側（許容角度が0の場合は空）
+    };
+
+    struct CoarseEntry {
+        size_t index;                   // entries_の添字
+        cv::Mat kernel;                 // 共通部分で平均を引いてノルムを1にした縮小テンプレート（CV_32F）
+    };
+
+    // 等倍の回転済みテンプレート（角度順）
+    std::vector<Entry> entries_;
+    float angle_step_;
+    size_t angle_stride_;               // 1段目の角度の間隔（entries_の添字の差）
+
+    // 1段目: 縮小したテンプレートの共通部分
+    std::vector<CoarseEntry> coarse_entries_;
+    float coarse_scale_;
+    cv::Size coarse_size_;              // 縮小したテンプレートの大きさ
+    cv::Point common_offset_;           // 縮小したテンプレート内での共通部分の左上
+    cv::Mat common_mask_;               // 共通部分（CV_32Fの0/1）
+    double common_pixels_;
+
+    // 作業バッファ
+    cv::Mat coarse_image_;
+    cv::Mat coarse_squared_;
+    cv::Mat window_sum_;
+    cv::Mat window_sqsum_;
+    cv::Mat correlation_;
+    cv::Mat best_score_;
+    cv::Mat best_index_;
+    cv::Mat update_mask_;
+    cv::Mat verify_result_;
+
+    Stats stats_;
+};
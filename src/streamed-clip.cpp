@@ -0,0 +1,393 @@
+#include "streamed-clip.h"
+#include "audio-output.h"
+#include "miniaudio.h"
+#include <obs-module.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+namespace {
+
+// I/Oスレッドが1回に読むフレーム数と、起こされなくてもリングを見に行く間隔
+const uint32_t kDecodeChunkFrames = 2048;
+const auto kPollInterval = std::chrono::milliseconds(20);
+
+#if GAT_HAVE_MINIAUDIO
+// パスはUTF-8。出力はステレオのfloat・ファイルのサンプルレート（変換はミキサーで行う）
+bool init_decoder(const std::string& path, ma_decoder* decoder)
+{
+    const ma_decoder_config config = ma_decoder_config_init(ma_format_f32, AudioMixer::kChannels, 0);
+#if defined(_WIN32)
+    const int length = MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, nullptr, 0);
+    std::wstring wide_path(length > 0 ? length : 0, L'\0');
+    if (length <= 0 || !MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, &wide_path[0], length)) {
+        return false;
+    }
+    return ma_decoder_init_file_w(wide_path.c_str(), &config, decoder) == MA_SUCCESS;
+#else
+    return ma_decoder_init_file(path.c_str(), &config, decoder) == MA_SUCCESS;
+#endif
+}
+#endif
+
+} // namespace
+
+struct AudioStreamer::State {
+    State(std::shared_ptr<const StreamedClip> source, bool loop, uint32_t frames)
+        : clip(std::move(source))
+        , looping(loop)
+        , capacity(frames)
+        , ring(static_cast<size_t>(frames) * AudioMixer::kChannels)
+    {
+        clip->ring_bytes_.fetch_add(ring.size() * sizeof(float), std::memory_order_relaxed);
+    }
+
+    ~State()
+    {
+        clip->ring_bytes_.fetch_sub(ring.size() * sizeof(float), std::memory_order_relaxed);
+#if GAT_HAVE_MINIAUDIO
+        if (decoder_open) {
+            ma_decoder_uninit(&decoder);
+        }
+#endif
+    }
+
+    const std::shared_ptr<const StreamedClip> clip;
+    const bool looping;
+    const uint32_t capacity;                            // フレーム数
+    std::vector<float> ring;
+
+    // 単調増加のフレーム位置（write_framesはI/Oスレッド、read_framesはオーディオスレッドだけが書く）
+    std::atomic<uint64_t> write_frames{0};
+    std::atomic<uint64_t> read_frames{0};
+    std::atomic<bool> finished{false};                  // これ以上書かない（末尾に達した・デコードに失敗した）
+    std::atomic<bool> closed{false};                    // ストリームが破棄された
+    std::atomic<uint64_t> underruns{0};
+
+    // I/Oスレッドのみが触る
+    ma_decoder decoder;
+    bool decoder_open = false;
+    uint64_t reported_underruns = 0;
+};
+
+// 再生1回分の読み出し位置（オーディオスレッドから読む）
+class StreamedStream : public AudioStream {
+public:
+    explicit StreamedStream(std::shared_ptr<AudioStreamer::State> state)
+        : state_(std::move(state))
+        , streamer_(AudioStreamer::instance())
+        , cursor_(0)
+    {
+    }
+
+    ~StreamedStream() override { state_->closed.store(true, std::memory_order_release); }
+
+    int get_sample_rate() const override { return state_->clip->sample_rate_; }
+
+    uint32_t read(float* stereo, uint32_t frames) override
+    {
+        // 先読み分（読み込み時にデコード済み）
+        const std::vector<float>& prefetch = state_->clip->prefetch_;
+        const uint64_t prefetch_frames = prefetch.size() / AudioMixer::kChannels;
+        uint32_t total = 0;
+        if (cursor_ < prefetch_frames) {
+            total = static_cast<uint32_t>(std::min<uint64_t>(frames, prefetch_frames - cursor_));
+            memcpy(stereo, prefetch.data() + cursor_ * AudioMixer::kChannels,
+                   static_cast<size_t>(total) * AudioMixer::kChannels * sizeof(float));
+            cursor_ += total;
+        }
+        if (total == frames) return total;
+
+        total += pop(stereo + static_cast<size_t>(total) * AudioMixer::kChannels, frames - total);
+        if (total == frames) return total;
+
+        if (state_->finished.load(std::memory_order_acquire)) {
+            // 終了を見る直前に書かれた分を読む
+            total += pop(stereo + static_cast<size_t>(total) * AudioMixer::kChannels, frames - total);
+            return total;
+        }
+
+        // アンダーラン: デコードが追いつくまで無音で埋める（短く返すとミキサーが再生を終えてしまう）
+        const uint32_t missing = frames - total;
+        memset(stereo + static_cast<size_t>(total) * AudioMixer::kChannels, 0,
+               static_cast<size_t>(missing) * AudioMixer::kChannels * sizeof(float));
+        state_->underruns.fetch_add(1, std::memory_order_relaxed);
+        streamer_.underruns_.fetch_add(1, std::memory_order_relaxed);
+        streamer_.underrun_frames_.fetch_add(missing, std::memory_order_relaxed);
+        return frames;
+    }
+
+    // ループはI/Oスレッドが先頭から続けてデコードするため、巻き戻すものはない
+    // （ミキサーが巻き戻すのはデコードに失敗して終わった場合だけで、そのまま終了する）
+    void rewind() override {}
+
+private:
+    uint32_t pop(float* stereo, uint32_t frames)
+    {
+        AudioStreamer::State& state = *state_;
+        const uint64_t read = state.read_frames.load(std::memory_order_relaxed);
+        const uint64_t written = state.write_frames.load(std::memory_order_acquire);
+        const uint32_t count = static_cast<uint32_t>(std::min<uint64_t>(frames, written - read));
+        if (count == 0) return 0;                       // 先読みだけで終わるストリームはリングを持たない
+
+        // リングの終端で折り返す
+        const uint32_t start = static_cast<uint32_t>(read % state.capacity);
+        const uint32_t first = std::min(count, state.capacity - start);
+        memcpy(stereo, state.ring.data() + static_cast<size_t>(start) * AudioMixer::kChannels,
+               static_cast<size_t>(first) * AudioMixer::kChannels * sizeof(float));
+        memcpy(stereo + static_cast<size_t>(first) * AudioMixer::kChannels, state.ring.data(),
+               static_cast<size_t>(count - first) * AudioMixer::kChannels * sizeof(float));
+
+        state.read_frames.store(read + count, std::memory_order_release);
+        return count;
+    }
+
+private:
+    std::shared_ptr<AudioStreamer::State> state_;
+    AudioStreamer& streamer_;                           // オーディオスレッドで静的変数の初期化を待たない
+    uint64_t cursor_;                                   // 先読み分の読み出し位置
+};
+
+// ===== StreamedClip =====
+
+StreamedClip::StreamedClip(const std::string& path)
+    : path_(path)
+    , sample_rate_(0)
+    , fully_prefetched_(false)
+    , ring_bytes_(0)
+{
+}
+
+std::shared_ptr<const StreamedClip> StreamedClip::open(const std::string& path, std::string& error)
+{
+#if !GAT_HAVE_MINIAUDIO
+    // デコーダーがないビルドでは作らない（WAVはPlaySoundで再生する）
+    (void)path;
+    error = "built without miniaudio";
+    return nullptr;
+#else
+    ma_decoder decoder;
+    if (!init_decoder(path, &decoder)) {
+        error = "cannot decode file";
+        return nullptr;
+    }
+
+    std::shared_ptr<StreamedClip> clip(new StreamedClip(path));
+    clip->sample_rate_ = static_cast<int>(decoder.outputSampleRate);
+
+    // 長さの取得はMP3では全体の走査になるため行わない
+    const uint64_t wanted = static_cast<uint64_t>(kPrefetchSeconds * clip->sample_rate_);
+    clip->prefetch_.resize(static_cast<size_t>(wanted) * AudioMixer::kChannels);
+    ma_uint64 frames_read = 0;
+    const ma_result result = ma_decoder_read_pcm_frames(&decoder, clip->prefetch_.data(), wanted, &frames_read);
+    ma_decoder_uninit(&decoder);
+
+    if ((result != MA_SUCCESS && result != MA_AT_END) || clip->sample_rate_ <= 0) {
+        error = "decode failed";
+        return nullptr;
+    }
+    if (frames_read == 0) {
+        error = "no samples";
+        return nullptr;
+    }
+    clip->prefetch_.resize(static_cast<size_t>(frames_read) * AudioMixer::kChannels);
+    clip->prefetch_.shrink_to_fit();
+    clip->fully_prefetched_ = frames_read < wanted;
+    return clip;
+#endif
+}
+
+std::shared_ptr<AudioStream> StreamedClip::create_stream(bool looping) const
+{
+    // 先読み分で全体を再生できる場合はデコードしないので、リングを確保しない
+    const bool prefetch_only = fully_prefetched_ && !looping;
+    const uint32_t capacity = prefetch_only ? 0 : static_cast<uint32_t>(kRingSeconds * sample_rate_);
+    auto state = std::make_shared<AudioStreamer::State>(shared_from_this(), looping, capacity);
+    if (prefetch_only) {
+        // 先読み分で全体なのでデコードは不要
+        state->finished.store(true, std::memory_order_release);
+    } else {
+        AudioStreamer::instance().add(state);
+    }
+    return std::make_shared<StreamedStream>(state);
+}
+
+// ===== AudioStreamer =====
+
+AudioStreamer& AudioStreamer::instance()
+{
+    static AudioStreamer streamer;
+    return streamer;
+}
+
+AudioStreamer::AudioStreamer()
+    : running_(false)
+    , streams_started_(0)
+    , decoded_frames_(0)
+    , underruns_(0)
+    , underrun_frames_(0)
+    , decode_errors_(0)
+    , active_streams_(0)
+{
+}
+
+AudioStreamer::~AudioStreamer()
+{
+    shutdown();
+}
+
+void AudioStreamer::shutdown()
+{
+    std::thread worker;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = false;
+        worker = std::move(worker_);
+    }
+    wake_.notify_all();
+    if (worker.joinable()) {
+        worker.join();
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& state : states_) {
+        state->finished.store(true, std::memory_order_release);
+    }
+    states_.clear();
+    active_streams_.store(0, std::memory_order_relaxed);
+}
+
+void AudioStreamer::add(const std::shared_ptr<State>& state)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        states_.push_back(state);
+        streams_started_.fetch_add(1, std::memory_order_relaxed);
+        active_streams_.store(static_cast<uint32_t>(states_.size()), std::memory_order_relaxed);
+        if (!running_) {
+            if (worker_.joinable()) worker_.join();
+            running_ = true;
+            worker_ = std::thread(&AudioStreamer::worker_loop, this);
+        }
+    }
+    wake_.notify_one();
+}
+
+void AudioStreamer::worker_loop()
+{
+    std::vector<std::shared_ptr<State>> states;
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (running_) {
+        // 破棄されたストリームと、書き終えたストリームを外す
+        states_.erase(std::remove_if(states_.begin(), states_.end(),
+                                     [](const std::shared_ptr<State>& state) {
+                                         return state->closed.load(std::memory_order_acquire) ||
+                                                state->finished.load(std::memory_order_relaxed);
+                                     }),
+                      states_.end());
+        active_streams_.store(static_cast<uint32_t>(states_.size()), std::memory_order_relaxed);
+        states = states_;
+
+        // デコードはロックの外で行う（制御側のaddを待たせない）
+        lock.unlock();
+        for (const auto& state : states) {
+            fill(*state);
+        }
+        states.clear();     // 破棄されたストリームのデコーダーはここで閉じる
+        lock.lock();
+
+        if (running_) {
+            wake_.wait_for(lock, kPollInterval);
+        }
+    }
+}
+
+void AudioStreamer::fill(State& state)
+{
+    const uint64_t underruns = state.underruns.load(std::memory_order_relaxed);
+    if (underruns != state.reported_underruns) {
+        blog(LOG_WARNING, "[AudioStreamer] Underrun while streaming %s (%llu total)", state.clip->path_.c_str(),
+             static_cast<unsigned long long>(underruns));
+        state.reported_underruns = underruns;
+    }
+
+#if !GAT_HAVE_MINIAUDIO
+    // openがnullptrを返すためストリームは作られない
+    state.finished.store(true, std::memory_order_release);
+#else
+    if (!state.decoder_open) {
+        // 先読み分の続きから読む
+        if (!init_decoder(state.clip->path_, &state.decoder) ||
+            ma_decoder_seek_to_pcm_frame(&state.decoder, state.clip->get_prefetch_frames()) != MA_SUCCESS) {
+            blog(LOG_WARNING, "[AudioStreamer] Failed to open decoder: %s", state.clip->path_.c_str());
+            decode_errors_.fetch_add(1, std::memory_order_relaxed);
+            state.finished.store(true, std::memory_order_release);
+            return;
+        }
+        state.decoder_open = true;
+    }
+
+    bool rewound = false;
+    while (!state.closed.load(std::memory_order_relaxed)) {
+        const uint64_t written = state.write_frames.load(std::memory_order_relaxed);
+        const uint64_t read = state.read_frames.load(std::memory_order_acquire);
+        const uint32_t free_frames = state.capacity - static_cast<uint32_t>(written - read);
+        if (free_frames == 0) break;
+
+        // リングの終端を越えないように読む
+        const uint32_t start = static_cast<uint32_t>(written % state.capacity);
+        const uint32_t wanted = std::min({free_frames, state.capacity - start, kDecodeChunkFrames});
+        ma_uint64 frames_read = 0;
+        const ma_result result = ma_decoder_read_pcm_frames(
+            &state.decoder, state.ring.data() + static_cast<size_t>(start) * AudioMixer::kChannels, wanted,
+            &frames_read);
+
+        if (frames_read > 0) {
+            state.write_frames.store(written + frames_read, std::memory_order_release);
+            decoded_frames_.fetch_add(frames_read, std::memory_order_relaxed);
+            rewound = false;
+        }
+        if (result != MA_SUCCESS && result != MA_AT_END) {
+            blog(LOG_WARNING, "[AudioStreamer] Decode error in %s", state.clip->path_.c_str());
+            decode_errors_.fetch_add(1, std::memory_order_relaxed);
+            state.finished.store(true, std::memory_order_release);
+            return;
+        }
+        if (frames_read < wanted) {
+            // 末尾: ループなら先頭から続ける（先頭で何も読めないファイルでは回り続けない）
+            if (!state.looping || rewound || ma_decoder_seek_to_pcm_frame(&state.decoder, 0) != MA_SUCCESS) {
+                state.finished.store(true, std::memory_order_release);
+                return;
+            }
+            rewound = true;
+        }
+    }
+#endif
+}
+
+AudioStreamer::Stats AudioStreamer::get_stats() const
+{
+    Stats stats;
+    stats.streams_started = streams_started_.load(std::memory_order_relaxed);
+    stats.decoded_frames = decoded_frames_.load(std::memory_order_relaxed);
+    stats.underruns = underruns_.load(std::memory_order_relaxed);
+    stats.underrun_frames = underrun_frames_.load(std::memory_order_relaxed);
+    stats.decode_errors = decode_errors_.load(std::memory_order_relaxed);
+    stats.active_streams = active_streams_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void AudioStreamer::log_summary() const
+{
+    const Stats stats = get_stats();
+    blog(LOG_INFO, "[AudioStreamer] started=%llu active=%u decoded=%llu frames underruns=%llu (%llu frames) errors=%llu",
+         static_cast<unsigned long long>(stats.streams_started), stats.active_streams,
+         static_cast<unsigned long long>(stats.decoded_frames), static_cast<unsigned long long>(stats.underruns),
+         static_cast<unsigned long long>(stats.underrun_frames),
+         static_cast<unsigned long long>(stats.decode_errors));
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include "audio-mixer.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * 再生しながらデコードする音声ファイル（MP3/OGGなど、miniaudioのデコーダーが読める形式）
+ * 長いBGMやループ用の音を全体デコードするとファイルごとに数十MBになるため、読み込み時には先頭の
+ * 数百ms分だけデコードしておき、続きは再生中にI/Oスレッド（AudioStreamer）がボイスごとの
+ * 固定長のリングバッファへデコードする。トリガー直後は先読み分から再生するので、メモリ上の音と
+ * 同じ遅延で鳴り始める
+ */
+class StreamedClip : public std::enable_shared_from_this<StreamedClip> {
+public:
+    static constexpr float kPrefetchSeconds = 0.3f;     // 読み込み時にデコードしておく長さ
+    static constexpr float kRingSeconds = 1.0f;         // 再生ごとのリングバッファの長さ
+
+public:
+    // デコーダーが開けないファイルはnullptr（理由はerror）
+    static std::shared_ptr<const StreamedClip> open(const std::string& path, std::string& error);
+
+    StreamedClip(const StreamedClip&) = delete;
+    StreamedClip& operator=(const StreamedClip&) = delete;
+
+    // 再生ごとのストリームを作り、I/Oスレッドに続きのデコードを依頼する。
+    // ループ再生ではI/Oスレッドが末尾から先頭へ切れ目なく続けてデコードする
+    std::shared_ptr<AudioStream> create_stream(bool looping) const;
+
+    const std::string& get_path() const { return path_; }
+    int get_sample_rate() const { return sample_rate_; }
+    uint64_t get_prefetch_frames() const { return prefetch_.size() / AudioMixer::kChannels; }
+    size_t get_prefetch_bytes() const { return prefetch_.size() * sizeof(float); }
+
+    // 再生中（ストリームが残っている）のリングバッファの合計
+    size_t get_ring_bytes() const { return ring_bytes_.load(std::memory_order_relaxed); }
+
+    // 先読みの範囲でファイルが終わった（短い効果音）
+    bool is_fully_prefetched() const { return fully_prefetched_; }
+
+private:
+    explicit StreamedClip(const std::string& path);
+
+    friend class StreamedStream;
+    friend class AudioStreamer;
+
+private:
+    const std::string path_;
+    int sample_rate_;
+    std::vector<float> prefetch_;                       // ステレオのfloat（インターリーブ）
+    bool fully_prefetched_;
+    mutable std::atomic<size_t> ring_bytes_;
+};
+
+/**
+ * StreamedClipの続きをデコードするI/Oスレッド（プラグイン全体で1つ）
+ * ボイスごとのリングバッファはI/Oスレッドが書き、オーディオスレッドが読む（単一の書き手と単一の
+ * 読み手なので、読み書きの位置のアトミック変数だけで受け渡す）。リングが空になった場合
+ * （アンダーラン）は無音で埋めて再生を続け、回数を記録する
+ */
+class AudioStreamer {
+public:
+    struct Stats {
+        uint64_t streams_started;
+        uint64_t decoded_frames;
+        uint64_t underruns;                             // リングが空で無音を出したread
+        uint64_t underrun_frames;
+        uint64_t decode_errors;
+        uint32_t active_streams;
+    };
+
+    // ボイスごとのデコード状態（ストリームとI/Oスレッドが共有する）
+    struct State;
+
+public:
+    static AudioStreamer& instance();
+
+    // プラグインのアンロード時（再生中のストリームは以降、先読み分と書き込み済みの分だけ再生する）
+    void shutdown();
+
+    void add(const std::shared_ptr<State>& state);
+
+    Stats get_stats() const;
+    void log_summary() const;
+
+private:
+    AudioStreamer();
+    ~AudioStreamer();
+
+    void worker_loop();
+    void fill(State& state);
+
+private:
+    mutable std::mutex mutex_;
+    std::condition_variable wake_;
+    std::vector<std::shared_ptr<State>> states_;
+    std::thread worker_;
+    bool running_;
+
+    std::atomic<uint64_t> streams_started_;
+    std::atomic<uint64_t> decoded_frames_;
+    std::atomic<uint64_t> underruns_;
+    std::atomic<uint64_t> underrun_frames_;
+    std::atomic<uint64_t> decode_errors_;
+    std::atomic<uint32_t> active_streams_;
+
+    friend class StreamedStream;
+};
@@ -0,0 +1,441 @@
+#include "template-bundle.h"
+#include <obs-module.h>
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <system_error>
+
+namespace {
+
+const char kMagic[8] = {'G', 'A', 'T', 'B', 'U', 'N', 'D', 'L'};
+const uint32_t kByteOrderMark = 0x01020304;
+const size_t kAlignment = 64;
+const size_t kNameSize = 128;
+const size_t kMaxFeatureSets = 3;           // ImageMatcher::FeatureDetectorの種類数
+
+// ファイル上の構造（パディングを含めて固定の大きさにする）
+struct FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t entry_count;
+    uint32_t entry_size;                    // sizeof(EntryRecord)（構造の食い違いの検出用）
+    uint64_t entry_table_offset;
+    uint64_t file_size;
+    uint8_t reserved[24];
+};
+
+struct PlaneRef {
+    uint64_t offset;                        // 0で画像なし
+    uint32_t rows;
+    uint32_t cols;
+    int32_t type;                           // CV_8UC1 / CV_8UC3 / CV_32FC1
+    uint32_t step;
+};
+
+struct KeypointRecord {
+    float x;
+    float y;
+    float size;
+    float angle;
+    float response;
+    int32_t octave;
+    int32_t class_id;
+};
+
+struct FeatureRef {
+    int32_t detector_type;
+    uint32_t keypoint_count;
+    uint64_t keypoint_offset;
+    PlaneRef descriptors;
+};
+
+struct EntryRecord {
+    char name[kNameSize];                   // 終端の0を含む
+    PlaneRef image;
+    PlaneRef gray;
+    PlaneRef edges;
+    uint32_t feature_count;
+    uint32_t reserved;
+    FeatureRef features[kMaxFeatureSets];
+};
+
+static_assert(sizeof(FileHeader) == 64, "FileHeader layout changed");
+static_assert(sizeof(PlaneRef) == 24, "PlaneRef layout changed");
+static_assert(sizeof(KeypointRecord) == 28, "KeypointRecord layout changed");
+static_assert(sizeof(FeatureRef) == 40, "FeatureRef layout changed");
+static_assert(sizeof(EntryRecord) == 328, "EntryRecord layout changed");
+
+bool is_supported_type(int type)
+{
+    return type == CV_8UC1 || type == CV_8UC3 || type == CV_32FC1;
+}
+
+// 範囲外を指していないか（オーバーフローしない順序で比較する）
+bool is_in_range(uint64_t offset, uint64_t bytes, uint64_t size)
+{
+    return offset <= size && bytes <= size - offset;
+}
+
+bool is_valid_plane(const PlaneRef& plane, uint64_t size)
+{
+    if (plane.offset == 0) {
+        return plane.rows == 0 && plane.cols == 0;
+    }
+    if (plane.rows == 0 || plane.cols == 0 || !is_supported_type(plane.type) || plane.offset % 8 != 0) {
+        return false;
+    }
+    const uint64_t row_bytes = static_cast<uint64_t>(plane.cols) * CV_ELEM_SIZE(plane.type);
+    if (plane.step < row_bytes) return false;
+    return is_in_range(plane.offset, static_cast<uint64_t>(plane.step) * (plane.rows - 1) + row_bytes, size);
+}
+
+const FileHeader& get_header(const MappedFile& file)
+{
+    return *reinterpret_cast<const FileHeader*>(file.data());
+}
+
+const EntryRecord& get_entry(const MappedFile& file, size_t index)
+{
+    return reinterpret_cast<const EntryRecord*>(file.data() + get_header(file).entry_table_offset)[index];
+}
+
+cv::Mat get_plane(const MappedFile& file, const PlaneRef& ref)
+{
+    if (ref.offset == 0) return cv::Mat();
+    return cv::Mat(static_cast<int>(ref.rows), static_cast<int>(ref.cols), ref.type, file.data() + ref.offset,
+                   ref.step);
+}
+
+bool has_extension(const std::string& path, const char* extension)
+{
+    const size_t length = strlen(extension);
+    if (path.size() < length) return false;
+    return std::equal(path.end() - length, path.end(), extension, [](char a, char b) {
+        return std::tolower(static_cast<unsigned char>(a)) == b;
+    });
+}
+
+// 書き込み用のバッファ（データは64バイト境界に揃える）
+class BundleWriter {
+public:
+    BundleWriter() : buffer_(sizeof(FileHeader), 0) {}
+
+    uint64_t append(const void* data, size_t bytes)
+    {
+        buffer_.resize((buffer_.size() + kAlignment - 1) / kAlignment * kAlignment, 0);
+        const uint64_t offset = buffer_.size();
+        const uint8_t* begin = static_cast<const uint8_t*>(data);
+        buffer_.insert(buffer_.end(), begin, begin + bytes);
+        return offset;
+    }
+
+    PlaneRef append_plane(const cv::Mat& mat)
+    {
+        PlaneRef plane = {};
+        if (mat.empty()) return plane;
+
+        const size_t row_bytes = mat.cols * mat.elemSize();
+        plane.rows = static_cast<uint32_t>(mat.rows);
+        plane.cols = static_cast<uint32_t>(mat.cols);
+        plane.type = mat.type();
+        plane.step = static_cast<uint32_t>(row_bytes);
+        plane.offset = append(mat.ptr(0), row_bytes);
+        for (int row = 1; row < mat.rows; ++row) {
+            const uint8_t* data = mat.ptr(row);
+            buffer_.insert(buffer_.end(), data, data + row_bytes);
+        }
+        return plane;
+    }
+
+    std::vector<uint8_t>& get_buffer() { return buffer_; }
+
+private:
+    std::vector<uint8_t> buffer_;
+};
+
+} // namespace
+
+// ===== TemplateBundle =====
+
+TemplateBundle::TemplateBundle(const std::string& path, int64_t mtime, uintmax_t file_size,
+                               std::unique_ptr<MappedFile> file)
+    : path_(path)
+    , mtime_(mtime)
+    , file_size_(file_size)
+    , file_(std::move(file))
+{
+}
+
+TemplateBundle::~TemplateBundle() = default;
+
+std::shared_ptr<const TemplateBundle> TemplateBundle::open(const std::string& path)
+{
+    int64_t mtime = 0;
+    uintmax_t file_size = 0;
+    if (!TemplateCache::get_file_stamp(path, mtime, file_size)) {
+        blog(LOG_ERROR, "[TemplateBundle] File does not exist: %s", path.c_str());
+        return nullptr;
+    }
+
+    // 画像は読み取り専用として扱うが、誤って書き込まれてもファイルを壊さないようコピーオンライトでマップする
+    std::string error;
+    auto file = std::make_unique<MappedFile>();
+    if (!file->open(path, true, error)) {
+        blog(LOG_ERROR, "[TemplateBundle] Failed to map '%s': %s", path.c_str(), error.c_str());
+        return nullptr;
+    }
+
+    std::shared_ptr<TemplateBundle> bundle(new TemplateBundle(path, mtime, file_size, std::move(file)));
+    if (!bundle->validate(error)) {
+        blog(LOG_ERROR, "[TemplateBundle] Invalid bundle '%s': %s", path.c_str(), error.c_str());
+        return nullptr;
+    }
+
+    blog(LOG_INFO, "[TemplateBundle] Mapped '%s' (%zu templates, %zu bytes)", path.c_str(),
+         bundle->get_entry_count(), bundle->file_->size());
+    return bundle;
+}
+
+bool TemplateBundle::validate(std::string& error) const
+{
+    const uint64_t size = file_->size();
+    if (size < sizeof(FileHeader)) {
+        error = "file too small";
+        return false;
+    }
+
+    const FileHeader& header = get_header(*file_);
+    if (memcmp(header.magic, kMagic, sizeof(kMagic)) != 0) {
+        error = "not a template bundle";
+        return false;
+    }
+    if (header.byte_order != kByteOrderMark) {
+        error = "byte order mismatch";
+        return false;
+    }
+    if (header.version != kVersion) {
+        error = "unsupported version " + std::to_string(header.version) + " (rebuild with template-bundler)";
+        return false;
+    }
+    if (header.entry_size != sizeof(EntryRecord) || header.file_size != size) {
+        error = "corrupted header";
+        return false;
+    }
+    if (header.entry_count == 0 || header.entry_table_offset % 8 != 0 ||
+        !is_in_range(header.entry_table_offset, static_cast<uint64_t>(header.entry_count) * sizeof(EntryRecord),
+                     size)) {
+        error = "corrupted entry table";
+        return false;
+    }
+
+    for (size_t index = 0; index < header.entry_count; ++index) {
+        const EntryRecord& entry = get_entry(*file_, index);
+        const std::string label = "entry " + std::to_string(index);
+
+        if (memchr(entry.name, 0, kNameSize) == nullptr) {
+            error = label + ": name not terminated";
+            return false;
+        }
+        if (!is_valid_plane(entry.image, size) || !is_valid_plane(entry.gray, size) ||
+            !is_valid_plane(entry.edges, size)) {
+            error = label + ": plane out of range";
+            return false;
+        }
+        // カラーとグレーは必須。エッジを省略した場合は初めて使うときに作る
+        if (entry.image.type != CV_8UC3 || entry.gray.type != CV_8UC1 ||
+            entry.gray.rows != entry.image.rows || entry.gray.cols != entry.image.cols ||
+            (entry.edges.offset != 0 && (entry.edges.type != CV_8UC1 || entry.edges.rows != entry.image.rows ||
+                                         entry.edges.cols != entry.image.cols))) {
+            error = label + ": unexpected plane format";
+            return false;
+        }
+
+        if (entry.feature_count > kMaxFeatureSets) {
+            error = label + ": too many feature sets";
+            return false;
+        }
+        for (uint32_t i = 0; i < entry.feature_count; ++i) {
+            const FeatureRef& feature = entry.features[i];
+            const bool empty = feature.keypoint_count == 0;
+            if (feature.detector_type < 0 || feature.detector_type >= static_cast<int32_t>(kMaxFeatureSets) ||
+                !is_in_range(feature.keypoint_offset,
+                             static_cast<uint64_t>(feature.keypoint_count) * sizeof(KeypointRecord), size) ||
+                (!empty && feature.keypoint_offset % 4 != 0) ||
+                !is_valid_plane(feature.descriptors, size) ||
+                (!empty && feature.descriptors.rows != feature.keypoint_count)) {
+                error = label + ": corrupted features";
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+size_t TemplateBundle::get_entry_count() const
+{
+    return get_header(*file_).entry_count;
+}
+
+std::string TemplateBundle::get_name(size_t index) const
+{
+    if (index >= get_entry_count()) return std::string();
+    return get_entry(*file_, index).name;
+}
+
+int TemplateBundle::find_entry(const std::string& name) const
+{
+    if (name.empty()) return 0;
+    for (size_t index = 0; index < get_entry_count(); ++index) {
+        if (name == get_entry(*file_, index).name) {
+            return static_cast<int>(index);
+        }
+    }
+    return -1;
+}
+
+std::shared_ptr<const TemplateAsset> TemplateBundle::create_asset(const std::string& name,
+                                                                  const std::string& asset_path) const
+{
+    const int index = find_entry(name);
+    if (index < 0) return nullptr;
+
+    const EntryRecord& entry = get_entry(*file_, index);
+    std::map<int, std::shared_ptr<const TemplateAsset::Features>> features;
+    for (uint32_t i = 0; i < entry.feature_count; ++i) {
+        const FeatureRef& ref = entry.features[i];
+        auto set = std::make_shared<TemplateAsset::Features>();
+
+        // キーポイントはcv::KeyPointの配置に依存しないよう1つずつ組み立てる（数百個程度）
+        const KeypointRecord* records =
+            reinterpret_cast<const KeypointRecord*>(file_->data() + ref.keypoint_offset);
+        set->keypoints.reserve(ref.keypoint_count);
+        for (uint32_t k = 0; k < ref.keypoint_count; ++k) {
+            const KeypointRecord& record = records[k];
+            set->keypoints.emplace_back(cv::Point2f(record.x, record.y), record.size, record.angle,
+                                        record.response, record.octave, record.class_id);
+        }
+        set->descriptors = get_plane(*file_, ref.descriptors);
+        features[ref.detector_type] = set;
+    }
+
+    return std::make_shared<const TemplateAsset>(asset_path, path_, mtime_, file_size_,
+                                                 get_plane(*file_, entry.image), get_plane(*file_, entry.gray),
+                                                 get_plane(*file_, entry.edges), features, shared_from_this());
+}
+
+bool TemplateBundle::write(const std::string& path, const std::vector<Entry>& entries, std::string& error)
+{
+    if (entries.empty()) {
+        error = "no templates";
+        return false;
+    }
+
+    BundleWriter writer;
+    std::vector<EntryRecord> records;
+    for (const Entry& entry : entries) {
+        if (entry.name.empty() || entry.name.size() >= kNameSize || entry.name.find('#') != std::string::npos) {
+            error = "invalid template name '" + entry.name + "'";
+            return false;
+        }
+        if (entry.image.type() != CV_8UC3 || entry.gray.type() != CV_8UC1 || entry.gray.size() != entry.image.size() ||
+            (!entry.edges.empty() && (entry.edges.type() != CV_8UC1 || entry.edges.size() != entry.image.size()))) {
+            error = "unexpected image format for '" + entry.name + "'";
+            return false;
+        }
+        if (entry.features.size() > kMaxFeatureSets) {
+            error = "too many feature sets for '" + entry.name + "'";
+            return false;
+        }
+
+        EntryRecord record = {};
+        memcpy(record.name, entry.name.c_str(), entry.name.size());
+        record.image = writer.append_plane(entry.image);
+        record.gray = writer.append_plane(entry.gray);
+        record.edges = writer.append_plane(entry.edges);
+
+        for (const auto& feature : entry.features) {
+            if (feature.first < 0 || feature.first >= static_cast<int>(kMaxFeatureSets) || !feature.second) {
+                error = "unexpected feature set for '" + entry.name + "'";
+                return false;
+            }
+            FeatureRef& ref = record.features[record.feature_count++];
+            std::vector<KeypointRecord> keypoints;
+            for (const cv::KeyPoint& keypoint : feature.second->keypoints) {
+                keypoints.push_back({keypoint.pt.x, keypoint.pt.y, keypoint.size, keypoint.angle,
+                                     keypoint.response, keypoint.octave, keypoint.class_id});
+            }
+            ref.detector_type = feature.first;
+            ref.keypoint_count = static_cast<uint32_t>(keypoints.size());
+            ref.keypoint_offset = writer.append(keypoints.data(), keypoints.size() * sizeof(KeypointRecord));
+            ref.descriptors = writer.append_plane(feature.second->descriptors);
+            if (!keypoints.empty() && (ref.descriptors.rows != ref.keypoint_count ||
+                                       !is_supported_type(ref.descriptors.type))) {
+                error = "unexpected descriptors for '" + entry.name + "'";
+                return false;
+            }
+        }
+        records.push_back(record);
+    }
+
+    FileHeader header = {};
+    memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.byte_order = kByteOrderMark;
+    header.entry_count = static_cast<uint32_t>(records.size());
+    header.entry_size = sizeof(EntryRecord);
+    header.entry_table_offset = writer.append(records.data(), records.size() * sizeof(EntryRecord));
+
+    std::vector<uint8_t>& buffer = writer.get_buffer();
+    header.file_size = buffer.size();
+    memcpy(buffer.data(), &header, sizeof(header));
+
+    // 読み込み中のプロセスが途中まで書かれたファイルを見ないよう、一時ファイルから置き換える
+    const std::string temp_path = path + ".tmp";
+    {
+        std::ofstream file(std::filesystem::u8path(temp_path), std::ios::binary | std::ios::trunc);
+        if (!file.write(reinterpret_cast<const char*>(buffer.data()), buffer.size())) {
+            error = "cannot write " + temp_path;
+            return false;
+        }
+    }
+
+    std::error_code rename_error;
+    std::filesystem::rename(std::filesystem::u8path(temp_path), std::filesystem::u8path(path), rename_error);
+    if (rename_error) {
+        // WindowsではOBSがマップ中のファイルへ上書きできない場合がある。MappedFileはFILE_SHARE_DELETEで
+        // 開いているため名前は変えられるので、古いファイルを退避してから置き換える（マップ中のソースは
+        // 退避したファイルを使い続け、次に読み込んだときに新しいファイルを使う）
+        const std::string old_path = path + ".old";
+        std::error_code ignored;
+        std::filesystem::remove(std::filesystem::u8path(old_path), ignored);
+        std::filesystem::rename(std::filesystem::u8path(path), std::filesystem::u8path(old_path), rename_error);
+        if (!rename_error) {
+            std::filesystem::rename(std::filesystem::u8path(temp_path), std::filesystem::u8path(path), rename_error);
+            if (rename_error) {
+                std::filesystem::rename(std::filesystem::u8path(old_path), std::filesystem::u8path(path), ignored);
+            }
+        }
+        if (rename_error) {
+            error = "cannot replace " + path + ": " + rename_error.message();
+            std::filesystem::remove(std::filesystem::u8path(temp_path), ignored);
+            return false;
+        }
+        // マップ中であれば削除できないので残す（次に書き出すときに削除する）
+        std::filesystem::remove(std::filesystem::u8path(old_path), ignored);
+    }
+    return true;
+}
+
+bool TemplateBundle::split_path(const std::string& path, std::string& bundle_file, std::string& name)
+{
+    const size_t separator = path.rfind('#');
+    const std::string file = separator == std::string::npos ? path : path.substr(0, separator);
+    if (!has_extension(file, ".gatb")) return false;
+
+    bundle_file = file;
+    name = separator == std::string::npos ? std::string() : path.substr(separator + 1);
+    return true;
+}
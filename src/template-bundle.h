@@ -0,0 +1,74 @@
+#pragma once
+
+#include "mapped-file.h"
+#include "template-cache.h"
+#include <opencv2/core.hpp>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * 前処理済みテンプレートのバンドルファイル（.gatb）
+ * 複数のテンプレートのカラー・グレー・エッジ画像と、検出器ごとの特徴点・記述子をまとめて保存する。
+ * ファイルはメモリマップ（MappedFile）で開き、画像と記述子はマップした領域をそのままcv::Matとして参照する
+ * （デコードも再計算もしない）。マップはコピーオンライトのため、誤って書き込んでもファイルは変わらない
+ *
+ * 形式（データは64バイト境界に配置）:
+ *   FileHeader | データ領域（画像・キーポイント・記述子） | EntryRecord x entry_count
+ * 版やバイト順が異なるファイルは読み込みを拒否する（template-bundlerで作り直す）。
+ * 特徴点はImageMatcher::get_shared_detectorと同じパラメータで抽出したものだけが有効なため、
+ * 検出器のパラメータを変えた場合はkVersionを上げる
+ */
+class TemplateBundle : public std::enable_shared_from_this<TemplateBundle> {
+public:
+    static constexpr uint32_t kVersion = 1;
+
+    // バンドルを作るときの1テンプレート分
+    struct Entry {
+        std::string name;               // 最大127バイト（UTF-8）
+        cv::Mat image;                  // BGR（CV_8UC3）
+        cv::Mat gray;
+        cv::Mat edges;
+        std::map<int, std::shared_ptr<const TemplateAsset::Features>> features;    // 検出器の種類ごと
+    };
+
+public:
+    ~TemplateBundle();
+
+    TemplateBundle(const TemplateBundle&) = delete;
+    TemplateBundle& operator=(const TemplateBundle&) = delete;
+
+    // 開けない・形式が不正な場合はnullptr（理由はログに出す）
+    static std::shared_ptr<const TemplateBundle> open(const std::string& path);
+
+    // 一時ファイルに書き込んでから置き換える
+    static bool write(const std::string& path, const std::vector<Entry>& entries, std::string& error);
+
+    // "bundle.gatb#name" 形式のパスを分解する（名前を省略した場合は先頭のテンプレート）
+    static bool split_path(const std::string& path, std::string& bundle_file, std::string& name);
+
+    const std::string& get_path() const { return path_; }
+    int64_t get_mtime() const { return mtime_; }
+    uintmax_t get_file_size() const { return file_size_; }
+    size_t get_entry_count() const;
+    std::string get_name(size_t index) const;
+
+    // マップした領域を参照するTemplateAssetを作る。TemplateAssetはバンドルを参照し続けるため、
+    // 最後のTemplateAssetが解放されるまでマップは解除されない。名前が見つからなければnullptr
+    // （空の名前は先頭のテンプレート）。asset_pathはTemplateAsset::get_pathに返すパス
+    std::shared_ptr<const TemplateAsset> create_asset(const std::string& name, const std::string& asset_path) const;
+
+private:
+    TemplateBundle(const std::string& path, int64_t mtime, uintmax_t file_size, std::unique_ptr<MappedFile> file);
+
+    bool validate(std::string& error) const;
+    int find_entry(const std::string& name) const;
+
+private:
+    const std::string path_;
+    const int64_t mtime_;
+    const uintmax_t file_size_;
+    std::unique_ptr<MappedFile> file_;
+};
@@ -0,0 +1,261 @@
+#include "template-cache.h"
+#include "template-bundle.h"
+#include <obs-module.h>
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+#include <filesystem>
+#include <iterator>
+#include <system_error>
+
+namespace {
+
+// 外部の領域（マップしたファイル）を参照するMatは確保した領域を持たない（u == nullptr）ため数えない
+size_t mat_bytes(const cv::Mat& mat)
+{
+    return mat.u ? mat.total() * mat.elemSize() : 0;
+}
+
+} // namespace
+
+// ===== TemplateAsset =====
+
+TemplateAsset::TemplateAsset(const std::string& path, int64_t mtime, uintmax_t file_size, const cv::Mat& image)
+    : path_(path)
+    , source_file_(path)
+    , mtime_(mtime)
+    , file_size_(file_size)
+    , image_(image)
+{
+    if (image_.channels() == 3) {
+        cv::cvtColor(image_, gray_, cv::COLOR_BGR2GRAY);
+    } else {
+        gray_ = image_;
+    }
+}
+
+TemplateAsset::TemplateAsset(const std::string& path, const std::string& source_file, int64_t mtime,
+                             uintmax_t file_size, const cv::Mat& image, const cv::Mat& gray, const cv::Mat& edges,
+                             const std::map<int, std::shared_ptr<const Features>>& features,
+                             std::shared_ptr<const void> storage)
+    : path_(path)
+    , source_file_(source_file)
+    , mtime_(mtime)
+    , file_size_(file_size)
+    , image_(image)
+    , gray_(gray)
+    , storage_(std::move(storage))
+    , edges_(edges)
+    , features_(features)
+{
+}
+
+cv::Mat TemplateAsset::get_edges() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (edges_.empty() && !gray_.empty()) {
+        cv::Canny(gray_, edges_, 50, 150);
+    }
+    return edges_;
+}
+
+std::shared_ptr<const TemplateAsset::Features> TemplateAsset::get_features(
+    int detector_type, const cv::Ptr<cv::Feature2D>& detector) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = features_.find(detector_type);
+    if (it != features_.end()) {
+        return it->second;
+    }
+
+    auto features = std::make_shared<Features>();
+    if (detector && !gray_.empty()) {
+        detector->detectAndCompute(gray_, cv::noArray(), features->keypoints, features->descriptors);
+    }
+    features_[detector_type] = features;
+    return features;
+}
+
+size_t TemplateAsset::get_memory_usage() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t bytes = mat_bytes(image_) + (gray_.data == image_.data ? 0 : mat_bytes(gray_)) + mat_bytes(edges_);
+    for (const auto& entry : features_) {
+        bytes += mat_bytes(entry.second->descriptors) + entry.second->keypoints.size() * sizeof(cv::KeyPoint);
+    }
+    return bytes;
+}
+
+// ===== TemplateCache =====
+
+TemplateCache& TemplateCache::instance()
+{
+    static TemplateCache cache;
+    return cache;
+}
+
+TemplateCache::TemplateCache()
+    : stats_{0, 0}
+{
+}
+
+std::shared_ptr<const TemplateAsset> TemplateCache::acquire(const std::string& path)
+{
+    if (path.empty()) return nullptr;
+
+    std::string bundle_file;
+    std::string name;
+    const bool in_bundle = TemplateBundle::split_path(path, bundle_file, name);
+
+    int64_t mtime = 0;
+    uintmax_t file_size = 0;
+    if (!get_file_stamp(in_bundle ? bundle_file : path, mtime, file_size)) return nullptr;
+
+    auto find_current = [&]() -> std::shared_ptr<const TemplateAsset> {
+        auto it = assets_.find(path);
+        if (it == assets_.end()) return nullptr;
+        auto asset = it->second.lock();
+        if (asset && asset->get_mtime() == mtime && asset->get_file_size() == file_size) {
+            return asset;
+        }
+        return nullptr;
+    };
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (auto asset = find_current()) {
+            ++stats_.hits;
+            return asset;
+        }
+    }
+
+    // デコード（バンドルのマップ）はロックの外で行う（他のファイルの取得を待たせない）
+    std::shared_ptr<const TemplateAsset> decoded;
+    if (in_bundle) {
+        decoded = load_from_bundle(path, bundle_file, name, mtime, file_size);
+    } else {
+        cv::Mat image = cv::imread(path, cv::IMREAD_COLOR);
+        if (!image.empty()) {
+            decoded = std::make_shared<const TemplateAsset>(path, mtime, file_size, image);
+        }
+    }
+    if (!decoded) return nullptr;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (auto asset = find_current()) {
+        // 同時に同じファイルを読み込んだ場合は先に登録された方を使う
+        ++stats_.hits;
+        return asset;
+    }
+
+    remove_expired();
+    assets_[path] = decoded;
+    ++stats_.misses;
+    blog(LOG_INFO, "[TemplateCache] %s '%s' (%dx%d, %zu assets)", in_bundle ? "Mapped" : "Decoded", path.c_str(),
+         decoded->get_image().cols, decoded->get_image().rows, assets_.size());
+    return decoded;
+}
+
+std::shared_ptr<const TemplateAsset> TemplateCache::load_from_bundle(const std::string& path,
+                                                                     const std::string& bundle_file,
+                                                                     const std::string& name, int64_t mtime,
+                                                                     uintmax_t file_size)
+{
+    std::shared_ptr<const TemplateBundle> bundle;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = bundles_.find(bundle_file);
+        if (it != bundles_.end()) {
+            bundle = it->second.lock();
+            if (bundle && (bundle->get_mtime() != mtime || bundle->get_file_size() != file_size)) {
+                bundle.reset();
+            }
+        }
+    }
+
+    if (!bundle) {
+        bundle = TemplateBundle::open(bundle_file);
+        if (!bundle) return nullptr;
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto it = bundles_.begin(); it != bundles_.end();) {
+            it = it->second.expired() ? bundles_.erase(it) : std::next(it);
+        }
+        bundles_[bundle_file] = bundle;
+    }
+
+    auto asset = bundle->create_asset(name, path);
+    if (!asset) {
+        blog(LOG_ERROR, "[TemplateCache] Template '%s' not found in bundle '%s'", name.c_str(), bundle_file.c_str());
+    }
+    return asset;
+}
+
+bool TemplateCache::is_current(const TemplateAsset& asset)
+{
+    int64_t mtime = 0;
+    uintmax_t file_size = 0;
+    return get_file_stamp(asset.get_source_file(), mtime, file_size) &&
+           mtime == asset.get_mtime() && file_size == asset.get_file_size();
+}
+
+bool TemplateCache::get_file_stamp(const std::string& path, int64_t& mtime, uintmax_t& file_size)
+{
+    std::error_code error;
+    const auto write_time = std::filesystem::last_write_time(path, error);
+    if (error) return false;
+    file_size = std::filesystem::file_size(path, error);
+    if (error) return false;
+
+    mtime = static_cast<int64_t>(write_time.time_since_epoch().count());
+    return true;
+}
+
+size_t TemplateCache::get_asset_count() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t count = 0;
+    for (const auto& entry : assets_) {
+        if (!entry.second.expired()) ++count;
+    }
+    return count;
+}
+
+TemplateCache::Stats TemplateCache::get_stats() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+void TemplateCache::log_summary() const
+{
+    std::vector<std::pair<std::shared_ptr<const TemplateAsset>, long>> assets;
+    Stats stats;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats = stats_;
+        for (const auto& entry : assets_) {
+            if (auto asset = entry.second.lock()) {
+                // ここで一時的に増やした分を除いた参照ソース数
+                assets.emplace_back(asset, entry.second.use_count() - 1);
+            }
+        }
+    }
+
+    blog(LOG_INFO, "[TemplateCache] assets=%zu hits=%llu misses=%llu", assets.size(),
+         static_cast<unsigned long long>(stats.hits), static_cast<unsigned long long>(stats.misses));
+    for (const auto& entry : assets) {
+        blog(LOG_INFO, "[TemplateCache] %s: sources=%ld bytes=%zu%s", entry.first->get_path().c_str(),
+             entry.second, entry.first->get_memory_usage(), entry.first->is_mapped() ? " (mapped)" : "");
+    }
+}
+
+void TemplateCache::remove_expired()
+{
+    for (auto it = assets_.begin(); it != assets_.end();) {
+        if (it->second.expired()) {
+            it = assets_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
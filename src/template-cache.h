@@ -0,0 +1,112 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <opencv2/features2d.hpp>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class TemplateBundle;
+
+/**
+ * デコード済みのテンプレート画像1つ分（同じファイルを使うソースで共有する）
+ * 共有されるため、取得した画像は読み取り専用として扱う。カラーとグレーは読み込み時に作り、
+ * エッジと特徴点は初めて要求されたときに作って以降は使い回す。
+ * バンドル（TemplateBundle）から作った場合は、画像と記述子がマップしたファイルを直接参照する
+ */
+class TemplateAsset {
+public:
+    struct Features {
+        std::vector<cv::KeyPoint> keypoints;
+        cv::Mat descriptors;
+    };
+
+public:
+    TemplateAsset(const std::string& path, int64_t mtime, uintmax_t file_size, const cv::Mat& image);
+
+    // 前処理済みの画像と特徴点から作る。storageは画像が参照する領域の持ち主（解放されるまで保持する）
+    TemplateAsset(const std::string& path, const std::string& source_file, int64_t mtime, uintmax_t file_size,
+                  const cv::Mat& image, const cv::Mat& gray, const cv::Mat& edges,
+                  const std::map<int, std::shared_ptr<const Features>>& features,
+                  std::shared_ptr<const void> storage);
+
+    TemplateAsset(const TemplateAsset&) = delete;
+    TemplateAsset& operator=(const TemplateAsset&) = delete;
+
+    const std::string& get_path() const { return path_; }
+    const std::string& get_source_file() const { return source_file_; }    // 更新時刻とサイズを調べるファイル
+    int64_t get_mtime() const { return mtime_; }
+    uintmax_t get_file_size() const { return file_size_; }
+
+    const cv::Mat& get_image() const { return image_; }     // BGR
+    const cv::Mat& get_gray() const { return gray_; }
+    cv::Mat get_edges() const;                              // Canny(50, 150)
+
+    // 検出器の種類（ImageMatcher::FeatureDetector）ごとに一度だけ抽出する
+    std::shared_ptr<const Features> get_features(int detector_type, const cv::Ptr<cv::Feature2D>& detector) const;
+
+    // ヒープに持っている分（マップしたファイルの領域はOSのファイルキャッシュなので含めない）
+    size_t get_memory_usage() const;
+    bool is_mapped() const { return storage_ != nullptr; }
+
+private:
+    const std::string path_;
+    const std::string source_file_;
+    const int64_t mtime_;
+    const uintmax_t file_size_;
+    cv::Mat image_;
+    cv::Mat gray_;
+    std::shared_ptr<const void> storage_;
+
+    mutable std::mutex mutex_;
+    mutable cv::Mat edges_;
+    mutable std::map<int, std::shared_ptr<const Features>> features_;
+};
+
+/**
+ * プラグイン全体のテンプレート画像キャッシュ
+ * パスごとに、ファイルの更新時刻とサイズが同じ間はデコード済みのTemplateAssetを1つだけ持つ。
+ * 参照するソースがなくなったTemplateAssetは破棄される。ファイルが更新された場合は
+ * 次のacquireで読み直す（古いTemplateAssetは参照しているソースが手放すまで残る）。
+ * "bundle.gatb#name" 形式のパスはバンドルから取り出す（開いたバンドルは同じファイルの全テンプレートで共有する）
+ */
+class TemplateCache {
+public:
+    struct Stats {
+        uint64_t hits;                  // デコード済みの画像を共有した回数
+        uint64_t misses;                // ファイルをデコードした回数
+    };
+
+public:
+    static TemplateCache& instance();
+
+    // 読み込めない場合はnullptr
+    std::shared_ptr<const TemplateAsset> acquire(const std::string& path);
+
+    // ファイルが読み込んだ時点から変わっていないか
+    static bool is_current(const TemplateAsset& asset);
+
+    // ファイルの更新時刻とサイズ（取得できなければfalse）
+    static bool get_file_stamp(const std::string& path, int64_t& mtime, uintmax_t& file_size);
+
+    size_t get_asset_count() const;
+    Stats get_stats() const;
+    void log_summary() const;
+
+private:
+    TemplateCache();
+
+    std::shared_ptr<const TemplateAsset> load_from_bundle(const std::string& path, const std::string& bundle_file,
+                                                          const std::string& name, int64_t mtime,
+                                                          uintmax_t file_size);
+    void remove_expired();
+
+private:
+    mutable std::mutex mutex_;
+    std::map<std::string, std::weak_ptr<const TemplateAsset>> assets_;
+    std::map<std::string, std::weak_ptr<const TemplateBundle>> bundles_;
+    Stats stats_;
+};
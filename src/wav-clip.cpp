@@ -0,0 +1,231 @@
+#include "wav-clip.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+const uint16_t kFormatPcm = 0x0001;
+const uint16_t kFormatFloat = 0x0003;
+const uint16_t kFormatExtensible = 0xFFFE;
+
+// 読み込み時に触れておく先頭の長さ（トリガー直後の再生でディスクを待たないように）
+const float kTouchSeconds = 0.25f;
+
+uint16_t read_u16(const uint8_t* data)
+{
+    return static_cast<uint16_t>(data[0] | (data[1] << 8));
+}
+
+uint32_t read_u32(const uint8_t* data)
+{
+    return static_cast<uint32_t>(data[0]) | (static_cast<uint32_t>(data[1]) << 8) |
+           (static_cast<uint32_t>(data[2]) << 16) | (static_cast<uint32_t>(data[3]) << 24);
+}
+
+template <typename T>
+T load(const uint8_t* data)
+{
+    // WAVのサンプルは境界に揃っているとは限らない
+    T value;
+    memcpy(&value, data, sizeof(T));
+    return value;
+}
+
+} // namespace
+
+// 再生1回分の読み出し位置（オーディオスレッドから読む）
+class WavStream : public AudioStream {
+public:
+    explicit WavStream(std::shared_ptr<const WavClip> clip) : clip_(std::move(clip)), cursor_(0) {}
+
+    int get_sample_rate() const override { return clip_->sample_rate_; }
+
+    uint32_t read(float* stereo, uint32_t frames) override
+    {
+        const uint64_t remaining = clip_->frame_count_ - cursor_;
+        const uint32_t count = static_cast<uint32_t>(std::min<uint64_t>(frames, remaining));
+        clip_->convert(cursor_, count, stereo);
+        cursor_ += count;
+        return count;
+    }
+
+    void rewind() override { cursor_ = 0; }
+
+private:
+    std::shared_ptr<const WavClip> clip_;
+    uint64_t cursor_;
+};
+
+// ===== WavClip =====
+
+WavClip::WavClip(const std::string& path)
+    : path_(path)
+    , sample_format_(SampleFormat::S16)
+    , channels_(0)
+    , sample_rate_(0)
+    , bytes_per_sample_(0)
+    , block_align_(0)
+    , data_offset_(0)
+    , frame_count_(0)
+{
+}
+
+std::shared_ptr<const WavClip> WavClip::open(const std::string& path, std::string& error)
+{
+    std::shared_ptr<WavClip> clip(new WavClip(path));
+    if (!clip->file_.open(path, false, error) || !clip->parse(error)) {
+        return nullptr;
+    }
+
+    const size_t touch_bytes = static_cast<size_t>(kTouchSeconds * clip->sample_rate_) * clip->block_align_;
+    clip->file_.touch(clip->data_offset_, touch_bytes);
+    return clip;
+}
+
+bool WavClip::parse(std::string& error)
+{
+    const uint8_t* data = file_.data();
+    const size_t size = file_.size();
+    if (size < 12 || memcmp(data, "RIFF", 4) != 0 || memcmp(data + 8, "WAVE", 4) != 0) {
+        error = "not a RIFF/WAVE file";
+        return false;
+    }
+
+    bool has_format = false;
+    uint16_t format_tag = 0;
+    int bits_per_sample = 0;
+    size_t data_size = 0;
+
+    for (size_t offset = 12; offset + 8 <= size;) {
+        const uint8_t* chunk = data + offset;
+        const size_t chunk_size = read_u32(chunk + 4);
+        const size_t body = offset + 8;
+        // 録音中に途切れたファイルはdataの長さが実際より大きいため、ファイルの終わりで切る
+        const size_t available = std::min(chunk_size, size - body);
+
+        if (memcmp(chunk, "fmt ", 4) == 0 && available >= 16) {
+            format_tag = read_u16(data + body);
+            channels_ = read_u16(data + body + 2);
+            sample_rate_ = static_cast<int>(read_u32(data + body + 4));
+            block_align_ = read_u16(data + body + 12);
+            bits_per_sample = read_u16(data + body + 14);
+            if (format_tag == kFormatExtensible && available >= 26) {
+                // サブフォーマットGUIDの先頭2バイトが形式
+                format_tag = read_u16(data + body + 24);
+            }
+            has_format = true;
+        } else if (memcmp(chunk, "data", 4) == 0) {
+            data_offset_ = body;
+            data_size = available;
+            break;
+        }
+
+        // チャンクは2バイト境界に揃う
+        offset = body + chunk_size + (chunk_size & 1);
+    }
+
+    if (!has_format || data_offset_ == 0) {
+        error = "missing fmt or data chunk";
+        return false;
+    }
+    if (channels_ <= 0 || sample_rate_ <= 0 || block_align_ == 0) {
+        error = "invalid format";
+        return false;
+    }
+
+    if (format_tag == kFormatPcm && bits_per_sample == 8) {
+        sample_format_ = SampleFormat::U8;
+    } else if (format_tag == kFormatPcm && bits_per_sample == 16) {
+        sample_format_ = SampleFormat::S16;
+    } else if (format_tag == kFormatPcm && bits_per_sample == 24) {
+        sample_format_ = SampleFormat::S24;
+    } else if (format_tag == kFormatPcm && bits_per_sample == 32) {
+        sample_format_ = SampleFormat::S32;
+    } else if (format_tag == kFormatFloat && bits_per_sample == 32) {
+        sample_format_ = SampleFormat::F32;
+    } else {
+        error = "unsupported encoding (format " + std::to_string(format_tag) + ", " +
+                std::to_string(bits_per_sample) + " bits)";
+        return false;
+    }
+
+    bytes_per_sample_ = bits_per_sample / 8;
+    if (block_align_ < static_cast<size_t>(bytes_per_sample_ * channels_)) {
+        error = "invalid block alignment";
+        return false;
+    }
+    frame_count_ = data_size / block_align_;
+    if (frame_count_ == 0) {
+        error = "no samples";
+        return false;
+    }
+    return true;
+}
+
+std::shared_ptr<AudioStream> WavClip::create_stream() const
+{
+    // 再生範囲のページの読み込みをOSに依頼しておく（オーディオスレッドでのページフォールトを減らす）
+    file_.prefetch(data_offset_, static_cast<size_t>(frame_count_ * block_align_));
+    return std::make_shared<WavStream>(shared_from_this());
+}
+
+void WavClip::convert(uint64_t first_frame, uint32_t frames, float* stereo) const
+{
+    const uint8_t* frame = file_.data() + data_offset_ + first_frame * block_align_;
+    const size_t right_offset = channels_ > 1 ? static_cast<size_t>(bytes_per_sample_) : 0;
+
+    // 形式ごとにループを分け、フレームごとの分岐を避ける
+    switch (sample_format_) {
+        case SampleFormat::U8:
+            for (uint32_t i = 0; i < frames; ++i, frame += block_align_) {
+                stereo[i * 2] = (frame[0] - 128) * (1.0f / 128.0f);
+                stereo[i * 2 + 1] = (frame[right_offset] - 128) * (1.0f / 128.0f);
+            }
+            break;
+        case SampleFormat::S16:
+            for (uint32_t i = 0; i < frames; ++i, frame += block_align_) {
+                stereo[i * 2] = load<int16_t>(frame) * (1.0f / 32768.0f);
+                stereo[i * 2 + 1] = load<int16_t>(frame + right_offset) * (1.0f / 32768.0f);
+            }
+            break;
+        case SampleFormat::S24:
+            for (uint32_t i = 0; i < frames; ++i, frame += block_align_) {
+                const uint8_t* left = frame;
+                const uint8_t* right = frame + right_offset;
+                // 上位24ビットに置いて符号を保ったまま変換する
+                const int32_t l = static_cast<int32_t>((static_cast<uint32_t>(left[0]) << 8) |
+                                                       (static_cast<uint32_t>(left[1]) << 16) |
+                                                       (static_cast<uint32_t>(left[2]) << 24));
+                const int32_t r = static_cast<int32_t>((static_cast<uint32_t>(right[0]) << 8) |
+                                                       (static_cast<uint32_t>(right[1]) << 16) |
+                                                       (static_cast<uint32_t>(right[2]) << 24));
+                stereo[i * 2] = l * (1.0f / 2147483648.0f);
+                stereo[i * 2 + 1] = r * (1.0f / 2147483648.0f);
+            }
+            break;
+        case SampleFormat::S32:
+            for (uint32_t i = 0; i < frames; ++i, frame += block_align_) {
+                stereo[i * 2] = load<int32_t>(frame) * (1.0f / 2147483648.0f);
+                stereo[i * 2 + 1] = load<int32_t>(frame + right_offset) * (1.0f / 2147483648.0f);
+            }
+            break;
+        case SampleFormat::F32:
+            for (uint32_t i = 0; i < frames; ++i, frame += block_align_) {
+                stereo[i * 2] = load<float>(frame);
+                stereo[i * 2 + 1] = load<float>(frame + right_offset);
+            }
+            break;
+    }
+}
+
+const char* WavClip::get_sample_format_name(SampleFormat format)
+{
+    switch (format) {
+        case SampleFormat::U8:  return "u8";
+        case SampleFormat::S16: return "s16";
+        case SampleFormat::S24: return "s24";
+        case SampleFormat::S32: return "s32";
+        case SampleFormat::F32: return "f32";
+        default:                return "unknown";
+    }
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "audio-mixer.h"
+#include "mapped-file.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+
+/**
+ * メモリマップしたPCM WAVファイル
+ * ヘッダーは開いたときに一度だけ解析し、サンプルはマップした領域からミキサーが直接読む
+ * （デコード済みのバッファを持たない）。サンプル形式の変換はボイスが読むときにブロック単位で行う。
+ * 同じファイルを使う複数のソースで別々に開いても、ページはOSのファイルキャッシュで共有される
+ */
+class WavClip : public std::enable_shared_from_this<WavClip> {
+public:
+    enum class SampleFormat {
+        U8,
+        S16,
+        S24,
+        S32,
+        F32
+    };
+
+public:
+    // 対応していない形式（圧縮WAVなど）や壊れたファイルはnullptr（理由はerror）
+    static std::shared_ptr<const WavClip> open(const std::string& path, std::string& error);
+
+    WavClip(const WavClip&) = delete;
+    WavClip& operator=(const WavClip&) = delete;
+
+    // 再生ごとに読み出し位置を持つストリームを作る（再生範囲の先読みもOSに依頼する）
+    std::shared_ptr<AudioStream> create_stream() const;
+
+    const std::string& get_path() const { return path_; }
+    SampleFormat get_sample_format() const { return sample_format_; }
+    int get_channels() const { return channels_; }
+    int get_sample_rate() const { return sample_rate_; }
+    uint64_t get_frame_count() const { return frame_count_; }
+    float get_duration() const { return static_cast<float>(frame_count_) / sample_rate_; }
+    size_t get_mapped_bytes() const { return file_.size(); }
+
+    static const char* get_sample_format_name(SampleFormat format);
+
+private:
+    explicit WavClip(const std::string& path);
+
+    bool parse(std::string& error);
+
+    // ステレオのfloatに変換する（モノラルは両チャンネルに、3チャンネル以上は先頭の2チャンネルを使う）
+    void convert(uint64_t first_frame, uint32_t frames, float* stereo) const;
+
+    friend class WavStream;
+
+private:
+    const std::string path_;
+    MappedFile file_;
+    SampleFormat sample_format_;
+    int channels_;
+    int sample_rate_;
+    int bytes_per_sample_;
+    size_t block_align_;
+    size_t data_offset_;
+    uint64_t frame_count_;
+};
@@ -0,0 +1,397 @@
+// AudioMixerの処理時間の測定とオーディオスレッドの制約の確認
+//
+// 使い方:
+//   audio-bench [--voices N,N,...] [--seconds S] [--block F] [--rates R,R,...]
+//
+// オーディオデバイスを使わずにAudioMixer::renderを直接呼び、出力1フレームあたりの処理時間（ns）を
+// 測定する（サウンドカードのない環境でも動く）。再生する音は一時ディレクトリに生成したWAVを
+// WavClipで開いたもの（実際の再生と同じくメモリマップから読む）。
+// 同時発音数（既定1,8,32）と出力サンプルレート（既定44100,48000,96000）ごとに次の場合を測る:
+//   same-rate   入力と出力のサンプルレートが同じ（変換なし）
+//   resample    44.1kHzのs16から変換
+//   speed       再生速度0.5〜2.0倍の混在
+//   fade        フェードイン・音量変更・フェード命令を制御側から送り続ける
+// renderの実行中はメモリの確保（operator new）とミューテックスのロック（Linuxのみ）を数え、
+// 1回でもあれば失敗として終了コード1を返す。
+
+#include "audio-mixer.h"
+#include "wav-clip.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <new>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#if defined(__linux__)
+#include <dlfcn.h>
+#include <pthread.h>
+#endif
+
+namespace {
+
+// renderの実行中だけ数える
+std::atomic<bool> g_tracking{false};
+std::atomic<uint64_t> g_allocations{0};
+std::atomic<uint64_t> g_locks{0};
+
+} // namespace
+
+// ===== 確保・ロックの検出 =====
+
+void* operator new(size_t size)
+{
+    if (g_tracking.load(std::memory_order_relaxed)) {
+        g_allocations.fetch_add(1, std::memory_order_relaxed);
+    }
+    void* ptr = std::malloc(size ? size : 1);
+    if (!ptr) throw std::bad_alloc();
+    return ptr;
+}
+
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept
+{
+    std::free(ptr);
+}
+
+#if defined(__linux__)
+// std::mutexはpthread_mutex_lockを呼ぶため、実行ファイル側で定義して横取りする
+namespace {
+
+using MutexFunc = int (*)(pthread_mutex_t*);
+MutexFunc g_real_lock = nullptr;
+MutexFunc g_real_trylock = nullptr;
+
+void resolve_mutex_functions()
+{
+    g_real_lock = reinterpret_cast<MutexFunc>(dlsym(RTLD_NEXT, "pthread_mutex_lock"));
+    g_real_trylock = reinterpret_cast<MutexFunc>(dlsym(RTLD_NEXT, "pthread_mutex_trylock"));
+}
+
+} // namespace
+
+extern "C" int pthread_mutex_lock(pthread_mutex_t* mutex)
+{
+    if (g_tracking.load(std::memory_order_relaxed)) {
+        g_locks.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (!g_real_lock) resolve_mutex_functions();
+    return g_real_lock(mutex);
+}
+
+extern "C" int pthread_mutex_trylock(pthread_mutex_t* mutex)
+{
+    if (g_tracking.load(std::memory_order_relaxed)) {
+        g_locks.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (!g_real_trylock) resolve_mutex_functions();
+    return g_real_trylock(mutex);
+}
+
+const bool kLockTracking = true;
+#else
+namespace {
+
+void resolve_mutex_functions() {}
+
+} // namespace
+
+const bool kLockTracking = false;
+#endif
+
+namespace {
+
+struct Options {
+    std::vector<int> voices = {1, 8, 32};
+    std::vector<int> rates = {44100, 48000, 96000};
+    int seconds = 5;
+    int block = 480;
+};
+
+enum class Scenario {
+    SAME_RATE,
+    RESAMPLE,
+    SPEED,
+    FADE
+};
+
+const Scenario kScenarios[] = {Scenario::SAME_RATE, Scenario::RESAMPLE, Scenario::SPEED, Scenario::FADE};
+
+const char* get_scenario_name(Scenario scenario)
+{
+    switch (scenario) {
+        case Scenario::SAME_RATE: return "same-rate";
+        case Scenario::RESAMPLE:  return "resample";
+        case Scenario::SPEED:     return "speed";
+        case Scenario::FADE:      return "fade";
+        default:                  return "unknown";
+    }
+}
+
+struct RunResult {
+    double ns_per_frame;
+    double ns_per_voice_frame;
+    double max_block_us;
+    float peak;
+    bool finite;
+};
+
+void write_u16(FILE* file, uint16_t value)
+{
+    fwrite(&value, sizeof(value), 1, file);
+}
+
+void write_u32(FILE* file, uint32_t value)
+{
+    fwrite(&value, sizeof(value), 1, file);
+}
+
+// 2秒の正弦波のステレオs16 WAV
+bool write_test_wav(const std::string& path, int sample_rate)
+{
+    FILE* file = fopen(path.c_str(), "wb");
+    if (!file) return false;
+
+    const uint32_t frames = static_cast<uint32_t>(sample_rate) * 2;
+    const uint32_t data_size = frames * 4;
+    fwrite("RIFF", 1, 4, file);
+    write_u32(file, 36 + data_size);
+    fwrite("WAVEfmt ", 1, 8, file);
+    write_u32(file, 16);
+    write_u16(file, 1);
+    write_u16(file, 2);
+    write_u32(file, static_cast<uint32_t>(sample_rate));
+    write_u32(file, static_cast<uint32_t>(sample_rate) * 4);
+    write_u16(file, 4);
+    write_u16(file, 16);
+    fwrite("data", 1, 4, file);
+    write_u32(file, data_size);
+
+    std::vector<int16_t> samples(static_cast<size_t>(frames) * 2);
+    for (uint32_t i = 0; i < frames; ++i) {
+        const double phase = 2.0 * 3.14159265358979 * 440.0 * i / sample_rate;
+        samples[i * 2] = static_cast<int16_t>(8000.0 * std::sin(phase));
+        samples[i * 2 + 1] = static_cast<int16_t>(8000.0 * std::sin(phase * 1.5));
+    }
+    const bool ok = fwrite(samples.data(), sizeof(int16_t), samples.size(), file) == samples.size();
+    fclose(file);
+    return ok;
+}
+
+RunResult run(const Options& options, Scenario scenario, int voices, int rate,
+              const std::shared_ptr<const WavClip>& clip)
+{
+    AudioMixer mixer(rate);
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> speed(0.5f, 2.0f);
+    std::uniform_real_distribution<float> gain(0.2f, 1.0f);
+
+    std::vector<AudioMixer::VoiceId> ids;
+    for (int i = 0; i < voices; ++i) {
+        AudioMixer::VoiceParams params;
+        params.volume = 1.0f / voices;
+        params.looping = true;
+        if (scenario == Scenario::SPEED) {
+            params.speed = speed(rng);
+        } else if (scenario == Scenario::FADE) {
+            params.fade_in_seconds = 0.5f;
+        }
+        ids.push_back(mixer.play(clip->create_stream(), params));
+    }
+
+    std::vector<float> output(static_cast<size_t>(options.block) * AudioMixer::kChannels);
+    const uint64_t total_frames = static_cast<uint64_t>(options.seconds) * rate;
+    const int control_interval = std::max(1, rate / 10 / options.block);   // 約100msごと
+
+    // 最初のブロックでボイスが開始される（ページにも触れておく）
+    mixer.render(output.data(), static_cast<uint32_t>(options.block));
+
+    RunResult result = {};
+    result.finite = true;
+    uint64_t elapsed_ns = 0;
+    uint64_t max_block_ns = 0;
+    uint64_t rendered = 0;
+    for (int block = 0; rendered < total_frames; ++block) {
+        // 制御側の操作（計測の対象外）
+        if (scenario == Scenario::FADE && block % control_interval == 0) {
+            for (size_t i = 0; i < ids.size(); ++i) {
+                if ((block / control_interval + i) % 2 == 0) {
+                    mixer.fade(ids[i], gain(rng), 0.05f);
+                } else {
+                    mixer.set_volume(ids[i], gain(rng) / voices);
+                }
+            }
+        }
+
+        const uint32_t frames = static_cast<uint32_t>(std::min<uint64_t>(options.block, total_frames - rendered));
+        g_tracking.store(true, std::memory_order_relaxed);
+        const auto start = std::chrono::steady_clock::now();
+        mixer.render(output.data(), frames);
+        const auto end = std::chrono::steady_clock::now();
+        g_tracking.store(false, std::memory_order_relaxed);
+
+        const uint64_t ns = static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+        elapsed_ns += ns;
+        max_block_ns = std::max(max_block_ns, ns);
+        rendered += frames;
+
+        for (uint32_t i = 0; i < frames * AudioMixer::kChannels; ++i) {
+            if (!std::isfinite(output[i])) result.finite = false;
+            result.peak = std::max(result.peak, std::fabs(output[i]));
+        }
+    }
+
+    mixer.stop_all();
+    result.ns_per_frame = static_cast<double>(elapsed_ns) / rendered;
+    result.ns_per_voice_frame = result.ns_per_frame / voices;
+    result.max_block_us = max_block_ns / 1000.0;
+    return result;
+}
+
+std::vector<int> parse_list(const char* value)
+{
+    std::vector<int> values;
+    std::stringstream stream(value);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        values.push_back(std::atoi(item.c_str()));
+    }
+    return values;
+}
+
+bool parse_options(int argc, char** argv, Options& options)
+{
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) return false;
+        const char* value = argv[++i];
+
+        if (arg == "--voices") options.voices = parse_list(value);
+        else if (arg == "--rates") options.rates = parse_list(value);
+        else if (arg == "--seconds") options.seconds = std::atoi(value);
+        else if (arg == "--block") options.block = std::atoi(value);
+        else return false;
+    }
+    for (int& voices : options.voices) {
+        if (voices <= 0) return false;
+        voices = std::min(voices, static_cast<int>(AudioMixer::kMaxVoices));
+    }
+    for (int rate : options.rates) {
+        if (rate <= 0) return false;
+    }
+    return !options.voices.empty() && !options.rates.empty() && options.seconds > 0 && options.block > 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    Options options;
+    if (!parse_options(argc, argv, options)) {
+        fprintf(stderr, "usage: audio-bench [--voices N,N,...] [--seconds S] [--block F] [--rates R,R,...]\n");
+        return 1;
+    }
+    resolve_mutex_functions();
+
+    // 44.1kHz（変換あり）と各出力レート（変換なし）のWAV
+    const std::filesystem::path dir = std::filesystem::temp_directory_path();
+    std::vector<int> clip_rates = options.rates;
+    clip_rates.push_back(44100);
+    std::sort(clip_rates.begin(), clip_rates.end());
+    clip_rates.erase(std::unique(clip_rates.begin(), clip_rates.end()), clip_rates.end());
+
+    std::vector<std::pair<int, std::shared_ptr<const WavClip>>> clips;
+    std::vector<std::string> paths;
+    for (int rate : clip_rates) {
+        const std::string path = (dir / ("audio-bench-" + std::to_string(rate) + ".wav")).string();
+        std::string error;
+        std::shared_ptr<const WavClip> clip;
+        if (write_test_wav(path, rate)) {
+            clip = WavClip::open(path, error);
+        }
+        if (!clip) {
+            fprintf(stderr, "failed to prepare %s %s\n", path.c_str(), error.c_str());
+            return 1;
+        }
+        clips.emplace_back(rate, clip);
+        paths.push_back(path);
+    }
+    auto find_clip = [&clips](int rate) {
+        for (const auto& entry : clips) {
+            if (entry.first == rate) return entry.second;
+        }
+        return clips.front().second;
+    };
+
+    printf("seconds=%d block=%d frames lock_tracking=%s atomics_lock_free=%s\n\n", options.seconds, options.block,
+           kLockTracking ? "on" : "off",
+           std::atomic<uint64_t>().is_lock_free() && std::atomic<float>().is_lock_free() ? "yes" : "no");
+    printf("%-10s %6s %6s %12s %14s %12s %7s %6s %6s %6s\n", "scenario", "rate", "voices", "ns/frame",
+           "ns/voice-frame", "max_block_us", "budget", "peak", "alloc", "locks");
+
+    uint64_t total_allocations = 0;
+    uint64_t total_locks = 0;
+    bool all_finite = true;
+    for (Scenario scenario : kScenarios) {
+        for (int rate : options.rates) {
+            const auto& clip = scenario == Scenario::SAME_RATE ? find_clip(rate) : find_clip(44100);
+            for (int voices : options.voices) {
+                g_allocations.store(0);
+                g_locks.store(0);
+                const RunResult result = run(options, scenario, voices, rate, clip);
+                const uint64_t allocations = g_allocations.load();
+                const uint64_t locks = g_locks.load();
+                total_allocations += allocations;
+                total_locks += locks;
+                all_finite = all_finite && result.finite;
+
+                // 1ブロックの処理時間がブロックの長さに占める割合
+                const double block_us = 1e6 * options.block / rate;
+                printf("%-10s %6d %6d %12.1f %14.2f %12.1f %6.2f%% %6.3f %6llu %6llu%s\n",
+                       get_scenario_name(scenario), rate, voices, result.ns_per_frame, result.ns_per_voice_frame,
+                       result.max_block_us, 100.0 * result.max_block_us / block_us, result.peak,
+                       static_cast<unsigned long long>(allocations),
+                       static_cast<unsigned long long>(locks), result.finite ? "" : "  non-finite output");
+            }
+        }
+    }
+
+    clips.clear();
+    for (const auto& path : paths) {
+        std::error_code ec;
+        std::filesystem::remove(path, ec);
+    }
+
+    const bool passed = total_allocations == 0 && total_locks == 0 && all_finite;
+    printf("\nrender: allocations=%llu locks=%llu%s -> %s\n", static_cast<unsigned long long>(total_allocations),
+           static_cast<unsigned long long>(total_locks), kLockTracking ? "" : " (not tracked)",
+           passed ? "PASS" : "FAIL");
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,20 @@
+// libobsをリンクしないコマンドラインツール用のblog
+// OBSの関数のうちblogしか使わないソース（ミキサー・スケジューラなど）を使うツールは、
+// libobsの代わりにこれをリンクする（ログは標準エラーへ出し、LOG_DEBUGは出さない）
+
+#include <util/base.h>
+#include <cstdarg>
+#include <cstdio>
+
+void blog(int log_level, const char *format, ...)
+{
+    if (log_level > LOG_INFO) return;
+
+    const char *prefix = log_level <= LOG_ERROR ? "error: " : (log_level <= LOG_WARNING ? "warning: " : "");
+    va_list args;
+    va_start(args, format);
+    fputs(prefix, stderr);
+    vfprintf(stderr, format, args);
+    fputc('\n', stderr);
+    va_end(args);
+}
@@ -0,0 +1,1067 @@
+// ImageMatcherのベンチマーク
+//
+// 使い方:
+//   matcher-bench <suite> [--frames N] [--width W] [--height H] [--template-size S]
+//                         [--seed N] [--threshold T] [--template PATH --frames-dir DIR]
+//                         [--sources N]
+//
+// 既定では合成シーン（ランダムな背景にテンプレートを貼り付けたフレームと、
+// 貼り付けていないフレーム）を生成し、処理時間と検出率・誤検出率を測定する。
+// --template と --frames-dir を指定すると録画から切り出したフレームで測定する
+// （正解位置がないため検出率のみ）。
+
+#include "image-matcher.h"
+#include "cascade-filter.h"
+#include "fft-correlator.h"
+#include "histogram.h"
+#include "ncc-kernel.h"
+#include "peak-finder.h"
+#include "template-bundle.h"
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#elif defined(__linux__)
+#include <unistd.h>
+#endif
+
+namespace {
+
+struct BenchOptions {
+    std::string suite;
+    int frames = 40;
+    int width = 1920;
+    int height = 1080;
+    int template_size = 96;
+    unsigned seed = 1;
+    float threshold = 0.8f;
+    std::string template_path;
+    std::string frames_dir;
+    int sources = 30;
+};
+
+struct Scene {
+    cv::Mat frame;
+    bool has_template;
+    cv::Point2f center;         // 正解の中心座標
+    float rotation = 0.0f;      // 正解の回転角度（度）
+};
+
+struct Dataset {
+    cv::Mat template_image;
+    std::vector<Scene> scenes;
+    bool has_ground_truth;
+};
+
+struct BenchResult {
+    std::string label;
+    Histogram latency;
+    int positives = 0;
+    int hits = 0;
+    int negatives = 0;
+    int false_positives = 0;
+    double max_error = 0.0;
+    double total_error = 0.0;
+};
+
+// ===== 合成データ =====
+
+cv::Scalar random_color(cv::RNG& rng)
+{
+    return cv::Scalar(rng.uniform(0, 256), rng.uniform(0, 256), rng.uniform(0, 256));
+}
+
+cv::Mat make_background(cv::RNG& rng, int width, int height)
+{
+    cv::Mat background(height, width, CV_8UC3);
+
+    // グラデーション
+    cv::Scalar top = random_color(rng);
+    cv::Scalar bottom = random_color(rng);
+    for (int y = 0; y < height; ++y) {
+        double t = static_cast<double>(y) / height;
+        background.row(y).setTo(top * (1.0 - t) + bottom * t);
+    }
+
+    // ゲーム画面らしいテクスチャ（図形・線・文字）
+    for (int i = 0; i < 60; ++i) {
+        cv::Point p1(rng.uniform(0, width), rng.uniform(0, height));
+        cv::Point p2(p1.x + rng.uniform(-200, 200), p1.y + rng.uniform(-200, 200));
+        switch (rng.uniform(0, 4)) {
+            case 0: cv::rectangle(background, p1, p2, random_color(rng), rng.uniform(-1, 4)); break;
+            case 1: cv::circle(background, p1, rng.uniform(5, 120), random_color(rng), rng.uniform(-1, 4)); break;
+            case 2: cv::line(background, p1, p2, random_color(rng), rng.uniform(1, 6)); break;
+            default:
+                cv::putText(background, "SCORE " + std::to_string(rng.uniform(0, 99999)), p1,
+                            cv::FONT_HERSHEY_SIMPLEX, rng.uniform(0.5, 2.0), random_color(rng), 2);
+                break;
+        }
+    }
+
+    cv::Mat noise(background.size(), background.type());
+    cv::randn(noise, cv::Scalar::all(0), cv::Scalar::all(6));
+    background += noise;
+    return background;
+}
+
+cv::Mat make_icon(cv::RNG& rng, cv::Size icon_size)
+{
+    const int size = std::min(icon_size.width, icon_size.height);
+    cv::Mat icon(icon_size, CV_8UC3, random_color(rng));
+    for (int i = 0; i < 8; ++i) {
+        cv::Point center(rng.uniform(0, icon_size.width), rng.uniform(0, icon_size.height));
+        if (rng.uniform(0, 2) == 0) {
+            cv::circle(icon, center, rng.uniform(size / 10, size / 3 + 1), random_color(rng), -1);
+        } else {
+            cv::Point offset(rng.uniform(size / 8, size / 2 + 1), rng.uniform(size / 8, size / 2 + 1));
+            cv::rectangle(icon, center - offset, center + offset, random_color(rng), -1);
+        }
+    }
+    cv::putText(icon, "A", cv::Point(size / 4, size * 3 / 4), cv::FONT_HERSHEY_DUPLEX,
+                size / 40.0, random_color(rng), std::max(1, size / 24));
+    cv::rectangle(icon, cv::Point(0, 0), cv::Point(icon_size.width - 1, icon_size.height - 1),
+                  cv::Scalar(255, 255, 255), 2);
+    return icon;
+}
+
+cv::Mat make_icon(cv::RNG& rng, int size)
+{
+    return make_icon(rng, cv::Size(size, size));
+}
+
+// テンプレートを変形して貼り付ける（scale・rotationは変形の度合い）
+cv::Point2f paste_template(cv::RNG& rng, cv::Mat& frame, const cv::Mat& icon, float scale, float rotation)
+{
+    cv::Mat transformed = icon;
+    cv::Mat mask;
+    if (scale != 1.0f || rotation != 0.0f) {
+        cv::Point2f center(icon.cols * 0.5f, icon.rows * 0.5f);
+        cv::Mat rotation_matrix = cv::getRotationMatrix2D(center, rotation, scale);
+        int size = static_cast<int>(std::ceil(std::max(icon.cols, icon.rows) * scale * 1.5f));
+        rotation_matrix.at<double>(0, 2) += size * 0.5 - center.x;
+        rotation_matrix.at<double>(1, 2) += size * 0.5 - center.y;
+        cv::warpAffine(icon, transformed, rotation_matrix, cv::Size(size, size),
+                       cv::INTER_LINEAR, cv::BORDER_REPLICATE);
+
+        // 回転で生じた余白は背景のまま残す（テンプレートの内側だけを貼る）
+        cv::Mat filled(icon.size(), CV_8UC1, cv::Scalar(255));
+        cv::warpAffine(filled, mask, rotation_matrix, cv::Size(size, size), cv::INTER_NEAREST);
+    }
+
+    int x = rng.uniform(0, frame.cols - transformed.cols);
+    int y = rng.uniform(0, frame.rows - transformed.rows);
+    cv::Mat region = frame(cv::Rect(x, y, transformed.cols, transformed.rows));
+
+    if (!mask.empty()) {
+        transformed.copyTo(region, mask);
+    } else {
+        transformed.copyTo(region);
+    }
+
+    // 圧縮ノイズと明るさの揺らぎを模擬する
+    cv::Mat noise(region.size(), region.type());
+    cv::randn(noise, cv::Scalar::all(0), cv::Scalar::all(4));
+    region += noise;
+    region += cv::Scalar::all(rng.uniform(-10, 10));
+
+    return cv::Point2f(x + transformed.cols * 0.5f, y + transformed.rows * 0.5f);
+}
+
+Dataset make_synthetic_dataset(const BenchOptions& options, float scale = 1.0f, float rotation = 0.0f)
+{
+    cv::RNG rng(options.seed);
+    Dataset dataset;
+    dataset.template_image = make_icon(rng, options.template_size);
+    dataset.has_ground_truth = true;
+
+    for (int i = 0; i < options.frames; ++i) {
+        Scene scene;
+        scene.frame = make_background(rng, options.width, options.height);
+        scene.has_template = (i % 2 == 0);
+        if (scene.has_template) {
+            scene.center = paste_template(rng, scene.frame, dataset.template_image, scale, rotation);
+        }
+        dataset.scenes.push_back(std::move(scene));
+    }
+    return dataset;
+}
+
+Dataset load_dataset(const BenchOptions& options)
+{
+    Dataset dataset;
+    dataset.has_ground_truth = false;
+    dataset.template_image = cv::imread(options.template_path, cv::IMREAD_COLOR);
+
+    std::vector<std::filesystem::path> paths;
+    for (const auto& entry : std::filesystem::directory_iterator(options.frames_dir)) {
+        if (entry.is_regular_file()) paths.push_back(entry.path());
+    }
+    std::sort(paths.begin(), paths.end());
+
+    for (const auto& path : paths) {
+        if (static_cast<int>(dataset.scenes.size()) >= options.frames) break;
+        cv::Mat frame = cv::imread(path.string(), cv::IMREAD_COLOR);
+        if (frame.empty()) continue;
+        dataset.scenes.push_back({frame, true, cv::Point2f()});
+    }
+    return dataset;
+}
+
+Dataset make_dataset(const BenchOptions& options, float scale = 1.0f, float rotation = 0.0f)
+{
+    if (!options.template_path.empty() && !options.frames_dir.empty()) {
+        return load_dataset(options);
+    }
+    return make_synthetic_dataset(options, scale, rotation);
+}
+
+// ===== 計測 =====
+
+void run_matcher(ImageMatcher& matcher, const Dataset& dataset, float threshold, BenchResult& result,
+                 const std::function<void(const ImageMatcher&)>& on_frame = nullptr)
+{
+    // 初回の遅延初期化を計測から除外する
+    if (!dataset.scenes.empty()) {
+        matcher.match(dataset.scenes.front().frame, threshold);
+    }
+
+    for (const auto& scene : dataset.scenes) {
+        auto start = std::chrono::steady_clock::now();
+        ImageMatcher::MatchResult match = matcher.match(scene.frame, threshold);
+        auto end = std::chrono::steady_clock::now();
+        result.latency.record(static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count()));
+        if (on_frame) on_frame(matcher);
+
+        if (!dataset.has_ground_truth) {
+            ++result.positives;
+            if (match.found) ++result.hits;
+            continue;
+        }
+
+        if (scene.has_template) {
+            ++result.positives;
+            double error = cv::norm(match.center - scene.center);
+            double tolerance = std::max(4.0, dataset.template_image.cols * 0.25);
+            if (match.found && error <= tolerance) {
+                ++result.hits;
+                result.total_error += error;
+                result.max_error = std::max(result.max_error, error);
+            }
+        } else {
+            ++result.negatives;
+            if (match.found) ++result.false_positives;
+        }
+    }
+}
+
+void print_header()
+{
+    printf("%-28s %9s %9s %9s %9s %8s %8s %9s %9s\n",
+           "config", "mean_ms", "p50_ms", "p95_ms", "max_ms", "recall", "fp_rate", "err_px", "max_err");
+}
+
+void print_result(const BenchResult& result)
+{
+    Histogram::Summary summary = result.latency.get_summary();
+    double recall = result.positives > 0 ? static_cast<double>(result.hits) / result.positives : 0.0;
+    double fp_rate = result.negatives > 0 ? static_cast<double>(result.false_positives) / result.negatives : 0.0;
+    double mean_error = result.hits > 0 ? result.total_error / result.hits : 0.0;
+
+    printf("%-28s %9.3f %9.3f %9.3f %9.3f %8.3f %8.3f %9.2f %9.2f\n",
+           result.label.c_str(), summary.mean / 1e6, summary.p50 / 1e6, summary.p95 / 1e6,
+           summary.max / 1e6, recall, fp_rate, mean_error, result.max_error);
+}
+
+// ===== スイート =====
+
+// 特徴点マッチング: 検出器ごとの処理時間と検出率
+int suite_features(const BenchOptions& options)
+{
+    Dataset dataset = make_dataset(options);
+
+    struct Config {
+        const char* label;
+        ImageMatcher::FeatureDetector detector;
+        int max_keypoints;
+    };
+    const Config configs[] = {
+        {"sift (uncapped)", ImageMatcher::FeatureDetector::SIFT, 0},
+        {"sift (1000 kp)", ImageMatcher::FeatureDetector::SIFT, 1000},
+        {"akaze (1000 kp)", ImageMatcher::FeatureDetector::AKAZE, 1000},
+        {"orb (1000 kp)", ImageMatcher::FeatureDetector::ORB, 1000},
+        {"orb (500 kp)", ImageMatcher::FeatureDetector::ORB, 500},
+    };
+
+    // 特徴点マッチングの信頼度はテンプレート特徴点の一致率なので閾値を下げて比較する
+    float threshold = std::min(options.threshold, 0.3f);
+
+    print_header();
+    for (const auto& config : configs) {
+        ImageMatcher matcher;
+        matcher.set_match_method(ImageMatcher::MatchMethod::FEATURE_MATCHING);
+        matcher.set_feature_detector(config.detector);
+        matcher.set_max_target_keypoints(config.max_keypoints);
+        matcher.load_template(dataset.template_image);
+
+        BenchResult result;
+        result.label = config.label;
+        run_matcher(matcher, dataset, threshold, result);
+        print_result(result);
+    }
+
+    // 比較用にテンプレートマッチングも計測する
+    ImageMatcher matcher;
+    matcher.load_template(dataset.template_image);
+    BenchResult result;
+    result.label = "template (reference)";
+    run_matcher(matcher, dataset, options.threshold, result);
+    print_result(result);
+    return 0;
+}
+
+// FFT相関: テンプレートサイズごとの空間法とFFT法の処理時間と、自動選択の結果
+int suite_fft(const BenchOptions& options)
+{
+    const cv::Size template_sizes[] = {
+        {32, 32}, {64, 32}, {96, 96}, {128, 48}, {200, 80}, {256, 96}, {400, 150}, {600, 200},
+    };
+    const int frames = std::min(options.frames, 10);
+
+    FftCorrelator::CostModel model = FftCorrelator::get_cost_model();
+    printf("cost model: spatial=%.4f ns/op fft=%.4f ns/op pixel=%.3f ns\n",
+           model.spatial_ns_per_op, model.fft_ns_per_op, model.pixel_ns);
+
+    printf("%-10s %11s %11s %11s %11s %8s %8s %10s\n", "template", "spatial_ms", "fft_ms",
+           "model_sp", "model_fft", "faster", "auto", "max_diff");
+
+    cv::Size crossover;
+    for (const cv::Size& template_size : template_sizes) {
+        if (template_size.width >= options.width || template_size.height >= options.height) continue;
+
+        cv::RNG rng(options.seed);
+        cv::Mat template_image = make_icon(rng, template_size);
+        std::vector<cv::Mat> scenes;
+        for (int i = 0; i < frames; ++i) {
+            cv::Mat frame = make_background(rng, options.width, options.height);
+            paste_template(rng, frame, template_image, 1.0f, 0.0f);
+            scenes.push_back(frame);
+        }
+
+        double median_ms[2] = {0.0, 0.0};
+        const ImageMatcher::CorrelationBackend backends[2] = {
+            ImageMatcher::CorrelationBackend::SPATIAL, ImageMatcher::CorrelationBackend::FFT,
+        };
+        for (int b = 0; b < 2; ++b) {
+            ImageMatcher matcher;
+            matcher.set_correlation_backend(backends[b]);
+            matcher.load_template(template_image);
+
+            BenchResult result;
+            Dataset dataset;
+            dataset.template_image = template_image;
+            dataset.has_ground_truth = false;
+            for (const auto& frame : scenes) dataset.scenes.push_back({frame, true, cv::Point2f()});
+            run_matcher(matcher, dataset, options.threshold, result);
+            median_ms[b] = result.latency.get_percentile(50.0) / 1e6;
+        }
+
+        // 自動選択の結果と、FFT法の結果がmatchTemplateと一致するか
+        ImageMatcher auto_matcher;
+        auto_matcher.load_template(template_image);
+        auto_matcher.match(scenes.front(), options.threshold);
+
+        cv::Mat gray, gray_template, spatial_result, fft_result;
+        cv::cvtColor(scenes.front(), gray, cv::COLOR_BGR2GRAY);
+        cv::cvtColor(template_image, gray_template, cv::COLOR_BGR2GRAY);
+        cv::matchTemplate(gray, gray_template, spatial_result, cv::TM_CCOEFF_NORMED);
+        FftCorrelator correlator;
+        correlator.set_template(gray_template);
+        correlator.correlate(gray, fft_result);
+        double max_diff = cv::norm(spatial_result, fft_result, cv::NORM_INF);
+
+        cv::Size image_size(options.width, options.height);
+        bool fft_faster = median_ms[1] < median_ms[0];
+        if (fft_faster && crossover.empty()) crossover = template_size;
+
+        char label[32];
+        snprintf(label, sizeof(label), "%dx%d", template_size.width, template_size.height);
+        printf("%-10s %11.3f %11.3f %11.3f %11.3f %8s %8s %10.2e\n", label, median_ms[0], median_ms[1],
+               FftCorrelator::estimate_spatial_cost(image_size, template_size, model) / 1e6,
+               FftCorrelator::estimate_fft_cost(image_size, model) / 1e6,
+               fft_faster ? "fft" : "spatial",
+               ImageMatcher::get_backend_name(auto_matcher.get_last_correlation_backend()), max_diff);
+    }
+
+    if (crossover.empty()) {
+        printf("crossover: spatial was faster for all template sizes\n");
+    } else {
+        printf("crossover: fft faster from %dx%d\n", crossover.width, crossover.height);
+    }
+    return 0;
+}
+
+// 在否判定モード: 相関マップ全体の計算との処理時間・検出率と、評価した候補位置の数
+int suite_presence(const BenchOptions& options)
+{
+    Dataset dataset = make_dataset(options);
+
+    print_header();
+    for (bool presence : {false, true}) {
+        ImageMatcher matcher;
+        matcher.set_correlation_backend(ImageMatcher::CorrelationBackend::SPATIAL);
+        matcher.set_presence_only(presence);
+        matcher.load_template(dataset.template_image);
+
+        BenchResult result;
+        result.label = presence ? "presence only" : "full map";
+        run_matcher(matcher, dataset, options.threshold, result);
+        print_result(result);
+    }
+
+    // 候補位置の評価数（検出あり/なしのフレーム別）
+    ImageMatcher matcher;
+    matcher.set_presence_only(true);
+    matcher.load_template(dataset.template_image);
+
+    uint64_t total[2] = {0, 0};
+    uint64_t evaluated[2] = {0, 0};
+    uint64_t rows[2] = {0, 0};
+    int frames[2] = {0, 0};
+    for (const auto& scene : dataset.scenes) {
+        matcher.match(scene.frame, options.threshold);
+        const PresenceScanner::Stats& stats = matcher.get_last_scan_stats();
+        int index = scene.has_template ? 1 : 0;
+        total[index] += stats.positions_total;
+        evaluated[index] += stats.positions_evaluated;
+        rows[index] += stats.rows_evaluated;
+        ++frames[index];
+    }
+
+    const char* labels[2] = {"negative", "positive"};
+    for (int i = 0; i < 2; ++i) {
+        if (frames[i] == 0) continue;
+        printf("%-9s positions/frame=%.0f of %.0f (%.2f%%) rows/position=%.2f\n", labels[i],
+               static_cast<double>(evaluated[i]) / frames[i], static_cast<double>(total[i]) / frames[i],
+               total[i] > 0 ? 100.0 * evaluated[i] / total[i] : 0.0,
+               evaluated[i] > 0 ? static_cast<double>(rows[i]) / evaluated[i] : 0.0);
+    }
+    return 0;
+}
+
+// 縮小照合: 倍率ごとの処理時間と位置の誤差
+int suite_scale(const BenchOptions& options)
+{
+    Dataset dataset = make_dataset(options);
+
+    // 録画フレームには正解位置がないため、等倍での検出位置を基準にする
+    if (!dataset.has_ground_truth) {
+        ImageMatcher reference;
+        reference.load_template(dataset.template_image);
+        for (auto& scene : dataset.scenes) {
+            ImageMatcher::MatchResult match = reference.match(scene.frame, options.threshold);
+            scene.has_template = match.found;
+            scene.center = match.center;
+        }
+        dataset.has_ground_truth = true;
+    }
+
+    const float scales[] = {1.0f, 0.75f, 0.5f, 0.33f, 0.25f, 0.0f};
+
+    print_header();
+    for (float scale : scales) {
+        ImageMatcher matcher;
+        matcher.set_working_scale(scale);
+        matcher.load_template(dataset.template_image);
+
+        char label[64];
+        if (scale <= 0.0f) {
+            snprintf(label, sizeof(label), "auto (%.3f)", matcher.get_working_scale());
+        } else {
+            snprintf(label, sizeof(label), "scale %.2f (%.3f)", scale, matcher.get_working_scale());
+        }
+
+        BenchResult result;
+        result.label = label;
+        run_matcher(matcher, dataset, options.threshold, result);
+        print_result(result);
+    }
+
+    // 解像度に合わせた自動スケーリング: 基準の解像度の1.5倍のウィンドウを模擬した合成シーンで、
+    // 等倍のテンプレートマッチング・倍率の掃引と、求めた倍率で作ったテンプレートを比べる
+    // （録画フレームでは基準の解像度が分からないため合成シーンのみ）
+    if (options.template_path.empty() || options.frames_dir.empty()) {
+        const float window_scale = 1.5f;
+        Dataset scaled = make_synthetic_dataset(options, window_scale);
+        const cv::Size reference_size(cvRound(options.width / window_scale), cvRound(options.height / window_scale));
+
+        struct AutoScaleConfig {
+            const char* label;
+            ImageMatcher::MatchMethod method;
+            bool auto_scale;
+        };
+        const AutoScaleConfig configs[] = {
+            {"template", ImageMatcher::MatchMethod::TEMPLATE_MATCHING, false},
+            {"multi 1.0-2.0", ImageMatcher::MatchMethod::MULTI_SCALE, false},
+            {"auto template", ImageMatcher::MatchMethod::TEMPLATE_MATCHING, true},
+            {"auto multi", ImageMatcher::MatchMethod::MULTI_SCALE, true},
+        };
+
+        printf("\nwindow %.1fx reference (%dx%d)\n", window_scale, reference_size.width, reference_size.height);
+        print_header();
+        for (const auto& config : configs) {
+            ImageMatcher matcher;
+            matcher.set_match_method(config.method);
+            matcher.set_scale_range(1.0f, 2.0f);
+            matcher.set_reference_size(reference_size);
+            matcher.set_auto_scale(config.auto_scale);
+            matcher.load_template(scaled.template_image);
+
+            BenchResult result;
+            result.label = config.label;
+            run_matcher(matcher, scaled, options.threshold, result);
+            print_result(result);
+        }
+    }
+    return 0;
+}
+
+// 従来方式の比較用: minMaxLocと矩形のマスクを繰り返して上位K件を取り出す
+std::vector<cv::Point> find_peaks_naive(cv::Mat map, float threshold, int max_peaks, cv::Size box_size)
+{
+    std::vector<cv::Point> peaks;
+    while (static_cast<int>(peaks.size()) < max_peaks) {
+        double min_val, max_val;
+        cv::Point min_loc, max_loc;
+        cv::minMaxLoc(map, &min_val, &max_val, &min_loc, &max_loc);
+        if (max_val < threshold) break;
+
+        peaks.push_back(max_loc);
+        cv::Rect suppress(max_loc.x - box_size.width / 2, max_loc.y - box_size.height / 2,
+                          box_size.width, box_size.height);
+        map(suppress & cv::Rect(0, 0, map.cols, map.rows)).setTo(-1.0f);
+    }
+    return peaks;
+}
+
+// 複数検出: K件の抽出にかかる時間と検出できたインスタンス数
+int suite_topk(const BenchOptions& options)
+{
+    const int instances = 24;
+    const int frames = std::min(options.frames, 10);
+
+    // テンプレートを重ならないように格子状に配置したフレーム
+    cv::RNG rng(options.seed);
+    cv::Mat template_image = make_icon(rng, options.template_size);
+    std::vector<cv::Mat> scenes;
+    const int cell = options.template_size * 2;
+    const int columns = std::max(1, options.width / cell);
+    for (int i = 0; i < frames; ++i) {
+        cv::Mat frame = make_background(rng, options.width, options.height);
+        for (int n = 0; n < instances; ++n) {
+            int x = (n % columns) * cell + rng.uniform(0, options.template_size / 2);
+            int y = (n / columns) * cell + rng.uniform(0, options.template_size / 2);
+            if (y + options.template_size > frame.rows) break;
+            template_image.copyTo(frame(cv::Rect(x, y, options.template_size, options.template_size)));
+        }
+        scenes.push_back(frame);
+    }
+
+    // 抽出処理のみを比較するための相関マップ
+    cv::Mat gray, gray_template, map;
+    cv::cvtColor(scenes.front(), gray, cv::COLOR_BGR2GRAY);
+    cv::cvtColor(template_image, gray_template, cv::COLOR_BGR2GRAY);
+    cv::matchTemplate(gray, gray_template, map, cv::TM_CCOEFF_NORMED);
+
+    printf("%-6s %12s %10s %14s %14s\n", "K", "match_p50_ms", "found", "find_peaks_ms", "naive_ms");
+    for (int k : {1, 2, 4, 8, 16, 32}) {
+        ImageMatcher matcher;
+        matcher.set_correlation_backend(ImageMatcher::CorrelationBackend::SPATIAL);
+        matcher.set_max_matches(k);
+        matcher.load_template(template_image);
+
+        Histogram latency;
+        size_t found = 0;
+        for (const auto& frame : scenes) {
+            auto start = std::chrono::steady_clock::now();
+            matcher.match(frame, options.threshold);
+            auto end = std::chrono::steady_clock::now();
+            latency.record(static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count()));
+            found += matcher.get_match_count();
+        }
+
+        auto time_ms = [](auto&& func) {
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < 10; ++i) func();
+            auto end = std::chrono::steady_clock::now();
+            return std::chrono::duration<double, std::milli>(end - start).count() / 10.0;
+        };
+        double peaks_ms = time_ms([&]() {
+            peak_finder::find_peaks(map, options.threshold, k, gray_template.size());
+        });
+        double naive_ms = time_ms([&]() {
+            find_peaks_naive(map.clone(), options.threshold, k, gray_template.size());
+        });
+
+        printf("%-6d %12.3f %10.1f %14.3f %14.3f\n", k, latency.get_percentile(50.0) / 1e6,
+               static_cast<double>(found) / scenes.size(), peaks_ms, naive_ms);
+    }
+    return 0;
+}
+
+// カスケード: 対象が映っていないフレームが大半の場合の処理時間と、段ごとの棄却率・処理時間
+int suite_cascade(const BenchOptions& options)
+{
+    Dataset dataset;
+    if (!options.template_path.empty() && !options.frames_dir.empty()) {
+        dataset = load_dataset(options);
+    } else {
+        // 10フレームに1回だけテンプレートが映る
+        cv::RNG rng(options.seed);
+        dataset.template_image = make_icon(rng, options.template_size);
+        dataset.has_ground_truth = true;
+        for (int i = 0; i < options.frames; ++i) {
+            Scene scene;
+            scene.frame = make_background(rng, options.width, options.height);
+            scene.has_template = (i % 10 == 0);
+            if (scene.has_template) {
+                scene.center = paste_template(rng, scene.frame, dataset.template_image, 1.0f, 0.0f);
+            }
+            dataset.scenes.push_back(std::move(scene));
+        }
+    }
+
+    struct Config {
+        const char* label;
+        ImageMatcher::MatchMethod method;
+        float threshold;
+    };
+    const Config configs[] = {
+        {"template", ImageMatcher::MatchMethod::TEMPLATE_MATCHING, options.threshold},
+        {"simd_ncc", ImageMatcher::MatchMethod::SIMD_NCC, options.threshold},
+        {"feature (orb)", ImageMatcher::MatchMethod::FEATURE_MATCHING, std::min(options.threshold, 0.3f)},
+    };
+
+    struct StageTotals {
+        std::array<uint64_t, CascadeFilter::kStageCount> entered{};
+        std::array<uint64_t, CascadeFilter::kStageCount> rejected{};
+        std::array<uint64_t, CascadeFilter::kStageCount> nanoseconds{};
+    };
+    std::vector<std::pair<std::string, StageTotals>> totals;
+
+    print_header();
+    for (const auto& config : configs) {
+        for (bool cascade : {false, true}) {
+            ImageMatcher matcher;
+            matcher.set_match_method(config.method);
+            matcher.set_feature_detector(ImageMatcher::FeatureDetector::ORB);
+            matcher.set_cascade_enabled(cascade);
+            matcher.load_template(dataset.template_image);
+
+            StageTotals stage_totals;
+            BenchResult result;
+            result.label = std::string(config.label) + (cascade ? " +cascade" : "");
+            run_matcher(matcher, dataset, config.threshold, result, [&](const ImageMatcher& m) {
+                const CascadeFilter::FrameStats& stats = m.get_last_cascade_stats();
+                for (int stage = 0; stats.evaluated && stage < stats.stages_run; ++stage) {
+                    ++stage_totals.entered[stage];
+                    stage_totals.nanoseconds[stage] += stats.stage_ns[stage];
+                    if (stage == stats.rejected_stage) ++stage_totals.rejected[stage];
+                }
+            });
+            print_result(result);
+
+            if (cascade) totals.emplace_back(result.label, stage_totals);
+        }
+    }
+
+    printf("\n%-28s %-12s %9s %12s %10s\n", "config", "stage", "entered", "reject_rate", "mean_ms");
+    for (const auto& entry : totals) {
+        for (size_t stage = 0; stage < CascadeFilter::kStageCount; ++stage) {
+            uint64_t entered = entry.second.entered[stage];
+            printf("%-28s %-12s %9llu %12.3f %10.3f\n", entry.first.c_str(),
+                   CascadeFilter::get_stage_name(static_cast<CascadeFilter::Stage>(stage)),
+                   static_cast<unsigned long long>(entered),
+                   entered > 0 ? static_cast<double>(entry.second.rejected[stage]) / entered : 0.0,
+                   entered > 0 ? entry.second.nanoseconds[stage] / 1e6 / entered : 0.0);
+        }
+    }
+    return 0;
+}
+
+// 回転を許す照合: 許容角度ごとの処理時間・検出率と、回転済みテンプレートの数・角度の誤差
+// （各フレームのテンプレートは許容角度の範囲でランダムに回転して貼る）
+int suite_rotation(const BenchOptions& options)
+{
+    const float tolerances[] = {0.0f, 5.0f, 15.0f, 30.0f, 90.0f, 180.0f};
+
+    struct RotationTotals {
+        std::string label;
+        size_t angles = 0;
+        size_t coarse_angles = 0;
+        uint64_t frames = 0;
+        uint64_t candidates = 0;
+        uint64_t verified = 0;
+        uint64_t matched = 0;
+        double total_angle_error = 0.0;
+        double max_angle_error = 0.0;
+    };
+    std::vector<RotationTotals> totals;
+
+    print_header();
+    for (float tolerance : tolerances) {
+        cv::RNG rng(options.seed);
+        Dataset dataset;
+        dataset.template_image = make_icon(rng, options.template_size);
+        dataset.has_ground_truth = true;
+        for (int i = 0; i < options.frames; ++i) {
+            Scene scene;
+            scene.frame = make_background(rng, options.width, options.height);
+            scene.has_template = (i % 2 == 0);
+            if (scene.has_template) {
+                scene.rotation = rng.uniform(-tolerance, tolerance);
+                scene.center = paste_template(rng, scene.frame, dataset.template_image, 1.0f, scene.rotation);
+            }
+            dataset.scenes.push_back(std::move(scene));
+        }
+
+        // 比較用: 回転を考慮しないテンプレートマッチング
+        {
+            ImageMatcher matcher;
+            matcher.load_template(dataset.template_image);
+
+            char label[64];
+            snprintf(label, sizeof(label), "template +/-%.0f", tolerance);
+            BenchResult result;
+            result.label = label;
+            run_matcher(matcher, dataset, options.threshold, result);
+            print_result(result);
+        }
+
+        ImageMatcher matcher;
+        matcher.set_match_method(ImageMatcher::MatchMethod::ROTATED);
+        matcher.set_rotation_tolerance(tolerance);
+        matcher.load_template(dataset.template_image);
+
+        RotationTotals rotation_totals;
+        char label[64];
+        snprintf(label, sizeof(label), "rotated +/-%.0f", tolerance);
+        rotation_totals.label = label;
+        rotation_totals.angles = matcher.get_rotation_angle_count();
+        rotation_totals.coarse_angles = matcher.get_rotation_coarse_angle_count();
+
+        size_t frame_index = 0;
+        BenchResult result;
+        result.label = label;
+        run_matcher(matcher, dataset, options.threshold, result, [&](const ImageMatcher& m) {
+            const Scene& scene = dataset.scenes[frame_index++];
+            const RotationBank::Stats& stats = m.get_last_rotation_stats();
+            ++rotation_totals.frames;
+            rotation_totals.candidates += stats.candidates;
+            rotation_totals.verified += stats.verified;
+
+            if (!scene.has_template || m.get_last_matches().empty()) return;
+            float error = std::abs(m.get_last_matches().front().rotation - scene.rotation);
+            error = std::min(error, 360.0f - error);
+            ++rotation_totals.matched;
+            rotation_totals.total_angle_error += error;
+            rotation_totals.max_angle_error = std::max(rotation_totals.max_angle_error, static_cast<double>(error));
+        });
+        print_result(result);
+        totals.push_back(rotation_totals);
+    }
+
+    // 1フレームのコストは1段目で照合する角度の数にほぼ比例する
+    printf("\n%-28s %7s %7s %11s %11s %10s %10s\n", "config", "angles", "coarse",
+           "cand/frame", "verify/frm", "angle_err", "max_angle");
+    for (const auto& entry : totals) {
+        const double frames = std::max<uint64_t>(1, entry.frames);
+        printf("%-28s %7zu %7zu %11.2f %11.2f %10.2f %10.2f\n", entry.label.c_str(), entry.angles,
+               entry.coarse_angles, entry.candidates / frames, entry.verified / frames,
+               entry.matched > 0 ? entry.total_angle_error / entry.matched : 0.0, entry.max_angle_error);
+    }
+    return 0;
+}
+
+// SIMD NCCカーネル: 命令セットごとの処理時間とTM_CCOEFF_NORMEDとの差
+int suite_simd(const BenchOptions& options)
+{
+    // HUD程度の探索範囲で測定する（スカラー版は全画面だと非常に遅い）
+    const cv::Size search_size(std::min(options.width, 640), std::min(options.height, 360));
+    const int repeat = 5;
+    const NccKernel::Isa isa_levels[] = {
+        NccKernel::Isa::SCALAR, NccKernel::Isa::SSE2, NccKernel::Isa::AVX2, NccKernel::Isa::NEON,
+    };
+
+    printf("search=%dx%d best_isa=%s\n", search_size.width, search_size.height,
+           NccKernel::get_isa_name(NccKernel::get_best_isa()));
+    printf("%-10s %-8s %10s %10s %12s\n", "template", "isa", "p50_ms", "speedup", "max_diff");
+
+    auto measure = [&](auto&& func) {
+        Histogram latency;
+        for (int i = 0; i < repeat; ++i) {
+            auto start = std::chrono::steady_clock::now();
+            func();
+            auto end = std::chrono::steady_clock::now();
+            latency.record(static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count()));
+        }
+        return latency.get_percentile(50.0) / 1e6;
+    };
+
+    for (int size : {32, 48, 64, 96}) {
+        cv::RNG rng(options.seed);
+        cv::Mat scene = make_background(rng, search_size.width, search_size.height);
+        cv::Mat icon = make_icon(rng, size);
+        paste_template(rng, scene, icon, 1.0f, 0.0f);
+
+        cv::Mat gray, gray_template, reference;
+        cv::cvtColor(scene, gray, cv::COLOR_BGR2GRAY);
+        cv::cvtColor(icon, gray_template, cv::COLOR_BGR2GRAY);
+
+        double opencv_ms = measure([&]() {
+            cv::matchTemplate(gray, gray_template, reference, cv::TM_CCOEFF_NORMED);
+        });
+
+        char label[32];
+        snprintf(label, sizeof(label), "%dx%d", size, size);
+        printf("%-10s %-8s %10.3f %10s %12s\n", label, "opencv", opencv_ms, "1.00", "-");
+
+        NccKernel kernel;
+        kernel.set_template(gray_template.data, gray_template.cols, gray_template.rows, gray_template.step);
+        cv::Mat result(reference.size(), CV_32F);
+
+        for (NccKernel::Isa isa : isa_levels) {
+            if (!NccKernel::is_isa_supported(isa)) continue;
+
+            double kernel_ms = measure([&]() {
+                kernel.match(gray.data, gray.cols, gray.rows, gray.step,
+                             result.ptr<float>(), result.step1(), isa);
+            });
+            double max_diff = cv::norm(reference, result, cv::NORM_INF);
+
+            char speedup[16];
+            snprintf(speedup, sizeof(speedup), "%.2f", opencv_ms / std::max(kernel_ms, 1e-6));
+            printf("%-10s %-8s %10.3f %10s %12.2e\n", label, NccKernel::get_isa_name(isa),
+                   kernel_ms, speedup, max_diff);
+        }
+    }
+    return 0;
+}
+
+// 現在のプロセスの常駐メモリ（取得できない環境では0）
+size_t get_resident_bytes()
+{
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return counters.WorkingSetSize;
+    }
+    return 0;
+#elif defined(__linux__)
+    FILE* file = fopen("/proc/self/statm", "r");
+    if (!file) return 0;
+    unsigned long pages = 0, resident = 0;
+    int fields = fscanf(file, "%lu %lu", &pages, &resident);
+    fclose(file);
+    return fields == 2 ? resident * static_cast<size_t>(sysconf(_SC_PAGESIZE)) : 0;
+#else
+    return 0;
+#endif
+}
+
+// ソース作成時のコスト: シーンコレクションの読み込みと同じく、N個のマッチャーを作ってテンプレートを読み込む
+int suite_startup(const BenchOptions& options)
+{
+    // ソースごとに別のテンプレートファイルを用意する（--template指定時は全ソースで同じファイル）
+    std::vector<std::string> paths;
+    std::filesystem::path temp_dir = std::filesystem::temp_directory_path() / "matcher-bench-startup";
+    std::filesystem::create_directories(temp_dir);
+    if (!options.template_path.empty()) {
+        paths.assign(options.sources, options.template_path);
+    } else {
+        cv::RNG rng(options.seed);
+        for (int i = 0; i < options.sources; ++i) {
+            std::string path = (temp_dir / ("icon" + std::to_string(i) + ".png")).string();
+            cv::imwrite(path, make_icon(rng, options.template_size));
+            paths.push_back(path);
+        }
+    }
+
+    // 同じテンプレートをORBの特徴点付きでまとめたバンドル（作成時間は測定に含めない）
+    const std::string bundle_file = (temp_dir / "startup.gatb").string();
+    std::vector<std::string> bundle_paths;
+    {
+        std::vector<TemplateBundle::Entry> entries;
+        auto detector = ImageMatcher::get_shared_detector(ImageMatcher::FeatureDetector::ORB);
+        for (size_t i = 0; i < paths.size() && (i == 0 || options.template_path.empty()); ++i) {
+            TemplateAsset asset(paths[i], 0, 0, cv::imread(paths[i], cv::IMREAD_COLOR));
+            TemplateBundle::Entry entry;
+            entry.name = "icon" + std::to_string(i);
+            entry.image = asset.get_image();
+            entry.gray = asset.get_gray();
+            entry.edges = asset.get_edges();
+            entry.features[static_cast<int>(ImageMatcher::FeatureDetector::ORB)] =
+                asset.get_features(static_cast<int>(ImageMatcher::FeatureDetector::ORB), detector);
+            entries.push_back(std::move(entry));
+        }
+        std::string error;
+        if (!TemplateBundle::write(bundle_file, entries, error)) {
+            fprintf(stderr, "cannot write bundle: %s\n", error.c_str());
+            return 1;
+        }
+        for (size_t i = 0; i < paths.size(); ++i) {
+            bundle_paths.push_back(bundle_file + "#" + entries[std::min(i, entries.size() - 1)].name);
+        }
+    }
+
+    struct Config {
+        const char* label;
+        ImageMatcher::MatchMethod method;
+        bool eager;                 // 以前の構成（ソースごとに全検出器を作り、全表現を保持する）を再現する
+        bool shared_file;           // 全ソースが同じテンプレートファイルを使う
+        bool bundle;                // 画像の代わりにバンドルから読み込む
+    };
+    const Config configs[] = {
+        {"template", ImageMatcher::MatchMethod::TEMPLATE_MATCHING, false, false, false},
+        {"feature (orb)", ImageMatcher::MatchMethod::FEATURE_MATCHING, false, false, false},
+        {"feature (orb, same file)", ImageMatcher::MatchMethod::FEATURE_MATCHING, false, true, false},
+        {"template (bundle)", ImageMatcher::MatchMethod::TEMPLATE_MATCHING, false, false, true},
+        {"feature (orb, bundle)", ImageMatcher::MatchMethod::FEATURE_MATCHING, false, false, true},
+        {"template (eager baseline)", ImageMatcher::MatchMethod::TEMPLATE_MATCHING, true, false, false},
+    };
+
+    printf("sources=%d\n", options.sources);
+    printf("%-28s %10s %12s %14s %12s\n", "config", "total_ms", "per_src_ms", "matcher_kb", "rss_delta_mb");
+
+    // 遅延作成の構成を先に測る（後の構成は解放済みのヒープを再利用するため、差は小さめに出る）
+    for (const auto& config : configs) {
+        const size_t rss_before = get_resident_bytes();
+        auto start = std::chrono::steady_clock::now();
+
+        std::vector<std::unique_ptr<ImageMatcher>> matchers;
+        std::vector<cv::Ptr<cv::Feature2D>> eager_detectors;
+        for (size_t i = 0; i < paths.size(); ++i) {
+            const std::string& path = config.bundle ? bundle_paths[i] : (config.shared_file ? paths.front() : paths[i]);
+            auto matcher = std::make_unique<ImageMatcher>();
+            matcher->set_match_method(config.method);
+            matcher->set_feature_detector(ImageMatcher::FeatureDetector::ORB);
+            if (config.eager) {
+                eager_detectors.push_back(cv::SIFT::create());
+                eager_detectors.push_back(cv::ORB::create(1000, 1.2f, 8, 15, 0, 2, cv::ORB::HARRIS_SCORE, 15));
+                eager_detectors.push_back(cv::AKAZE::create());
+                matcher->load_template(cv::imread(path, cv::IMREAD_COLOR));
+            } else {
+                matcher->load_template(path);
+            }
+            matchers.push_back(std::move(matcher));
+        }
+
+        auto end = std::chrono::steady_clock::now();
+        const size_t rss_after = get_resident_bytes();
+
+        size_t matcher_bytes = 0;
+        for (const auto& matcher : matchers) {
+            matcher_bytes += matcher->get_memory_usage();
+        }
+
+        const double total_ms = std::chrono::duration<double, std::milli>(end - start).count();
+        printf("%-28s %10.2f %12.3f %14.1f %12.2f\n", config.label, total_ms, total_ms / options.sources,
+               matcher_bytes / 1024.0,
+               rss_after > rss_before ? (rss_after - rss_before) / (1024.0 * 1024.0) : 0.0);
+    }
+
+    std::error_code error;
+    std::filesystem::remove_all(temp_dir, error);
+    return 0;
+}
+
+const std::map<std::string, std::function<int(const BenchOptions&)>>& get_suites()
+{
+    static const std::map<std::string, std::function<int(const BenchOptions&)>> suites = {
+        {"features", suite_features},
+        {"fft", suite_fft},
+        {"presence", suite_presence},
+        {"scale", suite_scale},
+        {"topk", suite_topk},
+        {"simd", suite_simd},
+        {"cascade", suite_cascade},
+        {"rotation", suite_rotation},
+        {"startup", suite_startup},
+    };
+    return suites;
+}
+
+void print_usage()
+{
+    fprintf(stderr, "usage: matcher-bench <suite> [--frames N] [--width W] [--height H] "
+                    "[--template-size S] [--seed N] [--threshold T] [--template PATH --frames-dir DIR] "
+                    "[--sources N]\n");
+    fprintf(stderr, "suites:");
+    for (const auto& suite : get_suites()) {
+        fprintf(stderr, " %s", suite.first.c_str());
+    }
+    fprintf(stderr, "\n");
+}
+
+bool parse_options(int argc, char** argv, BenchOptions& options)
+{
+    if (argc < 2) return false;
+    options.suite = argv[1];
+
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) return false;
+        const char* value = argv[++i];
+
+        if (arg == "--frames") options.frames = std::atoi(value);
+        else if (arg == "--width") options.width = std::atoi(value);
+        else if (arg == "--height") options.height = std::atoi(value);
+        else if (arg == "--template-size") options.template_size = std::atoi(value);
+        else if (arg == "--seed") options.seed = static_cast<unsigned>(std::atoi(value));
+        else if (arg == "--threshold") options.threshold = static_cast<float>(std::atof(value));
+        else if (arg == "--template") options.template_path = value;
+        else if (arg == "--frames-dir") options.frames_dir = value;
+        else if (arg == "--sources") options.sources = std::atoi(value);
+        else return false;
+    }
+    return options.frames > 0 && options.width > 0 && options.height > 0 && options.template_size > 0 &&
+           options.sources > 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    BenchOptions options;
+    if (!parse_options(argc, argv, options)) {
+        print_usage();
+        return 1;
+    }
+
+    auto suite = get_suites().find(options.suite);
+    if (suite == get_suites().end()) {
+        print_usage();
+        return 1;
+    }
+
+    printf("suite=%s frames=%d size=%dx%d template=%d\n", options.suite.c_str(), options.frames,
+           options.width, options.height, options.template_size);
+    return suite->second(options);
+}
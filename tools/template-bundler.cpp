@@ -0,0 +1,178 @@
+// テンプレートバンドル（.gatb）の作成
+//
+// 使い方:
+//   template-bundler <output.gatb> <image>... [--detectors orb,sift,akaze|none]
+//   template-bundler --list <bundle.gatb>
+//
+// 画像をデコードし、カラー・グレー・エッジ画像と指定した検出器の特徴点・記述子を
+// 1つのファイルにまとめる。テンプレート名は画像ファイル名の拡張子を除いた部分で、
+// プラグインでは "bundle.gatb#name" として（またはテンプレート名の設定で）指定する。
+// 特徴点はプラグインと同じ検出器（ImageMatcher::get_shared_detector）で抽出する。
+
+#include "image-matcher.h"
+#include "template-bundle.h"
+#include "template-cache.h"
+#include <opencv2/opencv.hpp>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Options {
+    std::string output_path;
+    std::vector<std::string> image_paths;
+    std::vector<ImageMatcher::FeatureDetector> detectors = {ImageMatcher::FeatureDetector::ORB};
+    std::string list_path;
+};
+
+const ImageMatcher::FeatureDetector kAllDetectors[] = {
+    ImageMatcher::FeatureDetector::SIFT,
+    ImageMatcher::FeatureDetector::ORB,
+    ImageMatcher::FeatureDetector::AKAZE,
+};
+
+bool parse_detectors(const std::string& value, std::vector<ImageMatcher::FeatureDetector>& detectors)
+{
+    detectors.clear();
+    if (value == "none") return true;
+
+    std::stringstream stream(value);
+    std::string name;
+    while (std::getline(stream, name, ',')) {
+        bool found = false;
+        for (ImageMatcher::FeatureDetector detector : kAllDetectors) {
+            if (name == ImageMatcher::get_detector_name(detector)) {
+                detectors.push_back(detector);
+                found = true;
+            }
+        }
+        if (!found) return false;
+    }
+    return !detectors.empty();
+}
+
+void print_usage()
+{
+    fprintf(stderr, "usage: template-bundler <output.gatb> <image>... [--detectors orb,sift,akaze|none]\n");
+    fprintf(stderr, "       template-bundler --list <bundle.gatb>\n");
+}
+
+bool parse_options(int argc, char** argv, Options& options)
+{
+    if (argc >= 3 && std::string(argv[1]) == "--list") {
+        options.list_path = argv[2];
+        return argc == 3;
+    }
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--detectors") {
+            if (i + 1 >= argc || !parse_detectors(argv[++i], options.detectors)) return false;
+        } else if (options.output_path.empty()) {
+            options.output_path = arg;
+        } else {
+            options.image_paths.push_back(arg);
+        }
+    }
+    return !options.output_path.empty() && !options.image_paths.empty();
+}
+
+int list_bundle(const std::string& path)
+{
+    std::shared_ptr<const TemplateBundle> bundle = TemplateBundle::open(path);
+    if (!bundle) {
+        fprintf(stderr, "cannot open bundle: %s\n", path.c_str());
+        return 1;
+    }
+
+    printf("version=%u templates=%zu bytes=%ju\n", TemplateBundle::kVersion, bundle->get_entry_count(),
+           bundle->get_file_size());
+    printf("%-32s %10s %8s %8s %8s\n", "name", "size", "sift", "orb", "akaze");
+    for (size_t index = 0; index < bundle->get_entry_count(); ++index) {
+        const std::string name = bundle->get_name(index);
+        std::shared_ptr<const TemplateAsset> asset = bundle->create_asset(name, path + "#" + name);
+        char size[32];
+        snprintf(size, sizeof(size), "%dx%d", asset->get_image().cols, asset->get_image().rows);
+        printf("%-32s %10s", name.c_str(), size);
+
+        // 検出器を渡さなければ、バンドルに含まれない種類は空になる
+        for (ImageMatcher::FeatureDetector detector : kAllDetectors) {
+            auto features = asset->get_features(static_cast<int>(detector), cv::Ptr<cv::Feature2D>());
+            printf(" %8zu", features->keypoints.size());
+        }
+        printf("\n");
+    }
+    return 0;
+}
+
+int build_bundle(const Options& options)
+{
+    const auto start = std::chrono::steady_clock::now();
+
+    std::vector<TemplateBundle::Entry> entries;
+    std::set<std::string> names;
+    size_t keypoint_count = 0;
+    for (const std::string& image_path : options.image_paths) {
+        const std::string name = std::filesystem::u8path(image_path).stem().u8string();
+        if (!names.insert(name).second) {
+            fprintf(stderr, "duplicate template name '%s' (%s)\n", name.c_str(), image_path.c_str());
+            return 1;
+        }
+
+        cv::Mat image = cv::imread(image_path, cv::IMREAD_COLOR);
+        if (image.empty()) {
+            fprintf(stderr, "cannot read image: %s\n", image_path.c_str());
+            return 1;
+        }
+
+        // プラグインが読み込み時に作るものと同じ表現を作る
+        TemplateAsset asset(image_path, 0, 0, image);
+        TemplateBundle::Entry entry;
+        entry.name = name;
+        entry.image = asset.get_image();
+        entry.gray = asset.get_gray();
+        entry.edges = asset.get_edges();
+        for (ImageMatcher::FeatureDetector detector : options.detectors) {
+            cv::Ptr<cv::Feature2D> feature2d = ImageMatcher::get_shared_detector(detector);
+            if (!feature2d) {
+                fprintf(stderr, "feature detector unavailable: %s\n", ImageMatcher::get_detector_name(detector));
+                return 1;
+            }
+            auto features = asset.get_features(static_cast<int>(detector), feature2d);
+            keypoint_count += features->keypoints.size();
+            entry.features[static_cast<int>(detector)] = features;
+        }
+        entries.push_back(std::move(entry));
+    }
+
+    std::string error;
+    if (!TemplateBundle::write(options.output_path, entries, error)) {
+        fprintf(stderr, "cannot write bundle: %s\n", error.c_str());
+        return 1;
+    }
+
+    const double elapsed_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::error_code size_error;
+    const uintmax_t file_size = std::filesystem::file_size(std::filesystem::u8path(options.output_path), size_error);
+    printf("wrote %s: templates=%zu keypoints=%zu bytes=%ju (%.1fms)\n", options.output_path.c_str(),
+           entries.size(), keypoint_count, size_error ? 0 : file_size, elapsed_ms);
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    Options options;
+    if (!parse_options(argc, argv, options)) {
+        print_usage();
+        return 1;
+    }
+
+    return options.list_path.empty() ? build_bundle(options) : list_bundle(options.list_path);
+}
@@ -0,0 +1,538 @@
+// 録画のバッチ解析
+//
+// 使い方:
+//   vod-analyzer <video> --rules PATH [--output PATH] [--format csv|json] [--threads N]
+//                [--chunk-seconds S] [--overlap-seconds S]
+//
+// プラグインと同じルール（テンプレート・閾値・マッチング方式・検索範囲・検出レート・
+// クールダウン・解像度に合わせた拡大縮小）で録画全体を照合し、検出イベントのタイムラインを出力する。
+// ルールファイルにはOBSのシーンコレクション（basic/scenes/*.json）をそのまま指定するか、
+// {"rules": [{"name": "...", "template_image": "...", "match_threshold": 0.8, ...}]}
+// の形式でソース設定と同じキーを書く。
+//
+// 録画をチャンクに分け、スレッドごとに別のデコーダで並列に処理する。各チャンクは
+// 前のチャンクと重なる位置からデコードし、重なり部分はクールダウンの状態を再現するためだけに
+// 照合する（イベントは出力しない）。結合後にもう一度クールダウンを適用して境界の重複を除く。
+
+#include "game-audio-trigger.h"
+#include "image-matcher.h"
+#include "json-util.h"
+#include "template-bundle.h"
+#include <obs-module.h>
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct Options {
+    std::string video_path;
+    std::string rules_path;
+    std::string output_path;            // 空で標準出力
+    std::string format = "csv";
+    int threads = 0;                    // 0でCPUのコア数
+    double chunk_seconds = 0.0;         // 0で自動（スレッド数の4倍程度に分割）
+    double overlap_seconds = -1.0;      // 負で自動（最長のクールダウン + 1秒）
+};
+
+// プラグインのソース設定1つ分
+struct Rule {
+    std::string name;
+    std::shared_ptr<const TemplateAsset> template_asset;    // 全ワーカーで共有する
+    float threshold;
+    int cooldown_ms;
+    int detection_rate;
+    int match_method;
+    int feature_detector;
+    int max_keypoints;
+    int correlation_backend;
+    bool presence_only;
+    float working_scale;
+    int max_matches;
+    bool cascade_filter;
+    bool auto_scale;
+    cv::Size reference_size;            // 空で最初の検出時に記録（チャンクごと）
+    float rotation_tolerance;
+    cv::Rect search_region;
+
+    // 動画のフレームレートから求める値
+    int64_t stride_frames;              // 何フレームごとに照合するか
+    int64_t cooldown_frames;
+};
+
+struct Event {
+    int64_t frame;
+    size_t rule;
+    float confidence;
+    cv::Rect box;
+    size_t match_count;
+};
+
+struct Chunk {
+    int64_t begin;                      // このチャンクがイベントを出力する範囲 [begin, end)
+    int64_t end;
+};
+
+struct VideoInfo {
+    double fps;
+    int64_t frame_count;                // 不明な場合は0
+    cv::Size size;
+};
+
+struct WorkerStats {
+    int64_t decoded = 0;                // デコードしたフレーム数（重なり部分を含む）
+    int64_t matched = 0;                // 照合のために画像を取り出したフレーム数
+    int64_t last_frame = -1;
+};
+
+// ===== ルール =====
+
+bool read_rule(obs_data_t *settings, const std::string& name, Rule& rule)
+{
+    obs_data_set_default_bool(settings, SETTING_ENABLED, DEFAULT_ENABLED);
+    obs_data_set_default_double(settings, SETTING_MATCH_THRESHOLD, DEFAULT_MATCH_THRESHOLD);
+    obs_data_set_default_int(settings, SETTING_COOLDOWN_MS, DEFAULT_COOLDOWN_MS);
+    obs_data_set_default_int(settings, SETTING_DETECTION_RATE, DEFAULT_DETECTION_RATE);
+    obs_data_set_default_int(settings, SETTING_MATCH_METHOD, DEFAULT_MATCH_METHOD);
+    obs_data_set_default_int(settings, SETTING_FEATURE_DETECTOR, DEFAULT_FEATURE_DETECTOR);
+    obs_data_set_default_int(settings, SETTING_MAX_KEYPOINTS, DEFAULT_MAX_KEYPOINTS);
+    obs_data_set_default_int(settings, SETTING_CORRELATION_BACKEND, DEFAULT_CORRELATION_BACKEND);
+    obs_data_set_default_bool(settings, SETTING_PRESENCE_ONLY, DEFAULT_PRESENCE_ONLY);
+    obs_data_set_default_double(settings, SETTING_WORKING_SCALE, DEFAULT_WORKING_SCALE);
+    obs_data_set_default_int(settings, SETTING_MAX_MATCHES, DEFAULT_MAX_MATCHES);
+    obs_data_set_default_bool(settings, SETTING_CASCADE_FILTER, DEFAULT_CASCADE_FILTER);
+    obs_data_set_default_bool(settings, SETTING_AUTO_SCALE, DEFAULT_AUTO_SCALE);
+    obs_data_set_default_double(settings, SETTING_ROTATION_TOLERANCE, DEFAULT_ROTATION_TOLERANCE);
+
+    if (!obs_data_get_bool(settings, SETTING_ENABLED)) {
+        fprintf(stderr, "skip disabled rule: %s\n", name.c_str());
+        return false;
+    }
+
+    // プラグインと同じく、バンドルの場合はテンプレート名を付けたパスで取り出す
+    std::string template_path = obs_data_get_string(settings, SETTING_TEMPLATE_IMAGE);
+    const std::string template_name = obs_data_get_string(settings, SETTING_TEMPLATE_NAME);
+    std::string bundle_file, bundle_entry;
+    if (!template_name.empty() && TemplateBundle::split_path(template_path, bundle_file, bundle_entry)) {
+        template_path = bundle_file + "#" + template_name;
+    }
+    rule.template_asset = TemplateCache::instance().acquire(template_path);
+    if (!rule.template_asset) {
+        fprintf(stderr, "skip rule without a readable template: %s (%s)\n", name.c_str(), template_path.c_str());
+        return false;
+    }
+
+    rule.name = name;
+    rule.threshold = static_cast<float>(obs_data_get_double(settings, SETTING_MATCH_THRESHOLD));
+    rule.cooldown_ms = static_cast<int>(obs_data_get_int(settings, SETTING_COOLDOWN_MS));
+    rule.detection_rate = static_cast<int>(obs_data_get_int(settings, SETTING_DETECTION_RATE));
+    rule.match_method = static_cast<int>(obs_data_get_int(settings, SETTING_MATCH_METHOD));
+    rule.feature_detector = static_cast<int>(obs_data_get_int(settings, SETTING_FEATURE_DETECTOR));
+    rule.max_keypoints = static_cast<int>(obs_data_get_int(settings, SETTING_MAX_KEYPOINTS));
+    rule.correlation_backend = static_cast<int>(obs_data_get_int(settings, SETTING_CORRELATION_BACKEND));
+    rule.presence_only = obs_data_get_bool(settings, SETTING_PRESENCE_ONLY);
+    rule.working_scale = static_cast<float>(obs_data_get_double(settings, SETTING_WORKING_SCALE));
+    rule.max_matches = static_cast<int>(obs_data_get_int(settings, SETTING_MAX_MATCHES));
+    rule.cascade_filter = obs_data_get_bool(settings, SETTING_CASCADE_FILTER);
+    rule.auto_scale = obs_data_get_bool(settings, SETTING_AUTO_SCALE);
+    rule.reference_size = cv::Size(static_cast<int>(obs_data_get_int(settings, SETTING_REFERENCE_WIDTH)),
+                                   static_cast<int>(obs_data_get_int(settings, SETTING_REFERENCE_HEIGHT)));
+    rule.rotation_tolerance = static_cast<float>(obs_data_get_double(settings, SETTING_ROTATION_TOLERANCE));
+    rule.search_region = cv::Rect(static_cast<int>(obs_data_get_int(settings, SETTING_SEARCH_X)),
+                                  static_cast<int>(obs_data_get_int(settings, SETTING_SEARCH_Y)),
+                                  static_cast<int>(obs_data_get_int(settings, SETTING_SEARCH_WIDTH)),
+                                  static_cast<int>(obs_data_get_int(settings, SETTING_SEARCH_HEIGHT)));
+    return true;
+}
+
+// シーンコレクション（"sources"）またはルール一覧（"rules"）を読み込む
+std::vector<Rule> load_rules(const std::string& path)
+{
+    std::vector<Rule> rules;
+    obs_data_t *root = obs_data_create_from_json_file(path.c_str());
+    if (!root) {
+        fprintf(stderr, "failed to read rules: %s\n", path.c_str());
+        return rules;
+    }
+
+    obs_data_array_t *sources = obs_data_get_array(root, "sources");
+    const bool scene_collection = sources != nullptr;
+    obs_data_array_t *items = scene_collection ? sources : obs_data_get_array(root, "rules");
+
+    const size_t count = items ? obs_data_array_count(items) : 0;
+    for (size_t i = 0; i < count; ++i) {
+        obs_data_t *item = obs_data_array_item(items, i);
+        std::string name = obs_data_get_string(item, "name");
+        if (name.empty()) name = "rule-" + std::to_string(i + 1);
+
+        if (scene_collection) {
+            // このプラグインのソースだけを対象にする
+            if (std::string(obs_data_get_string(item, "id")) == "game_audio_trigger") {
+                obs_data_t *settings = obs_data_get_obj(item, "settings");
+                if (settings) {
+                    Rule rule;
+                    if (read_rule(settings, name, rule)) rules.push_back(std::move(rule));
+                    obs_data_release(settings);
+                }
+            }
+        } else {
+            Rule rule;
+            if (read_rule(item, name, rule)) rules.push_back(std::move(rule));
+        }
+        obs_data_release(item);
+    }
+
+    obs_data_array_release(items);
+    obs_data_release(root);
+    return rules;
+}
+
+// プラグインのapply_matcher_settingsと同じ順序で設定する
+void configure_matcher(const Rule& rule, ImageMatcher& matcher)
+{
+    matcher.set_feature_detector(static_cast<ImageMatcher::FeatureDetector>(rule.feature_detector));
+    matcher.set_match_method(static_cast<ImageMatcher::MatchMethod>(rule.match_method));
+    matcher.set_rotation_tolerance(rule.rotation_tolerance);
+    matcher.set_max_target_keypoints(rule.max_keypoints);
+    matcher.set_correlation_backend(static_cast<ImageMatcher::CorrelationBackend>(rule.correlation_backend));
+    matcher.set_presence_only(rule.presence_only);
+    matcher.set_working_scale(rule.working_scale);
+    matcher.set_max_matches(rule.max_matches);
+    matcher.set_cascade_enabled(rule.cascade_filter);
+    matcher.set_reference_size(rule.reference_size);
+    matcher.set_auto_scale(rule.auto_scale);
+    matcher.set_search_region(rule.search_region);
+    matcher.load_template(rule.template_asset);
+}
+
+// ===== 解析 =====
+
+bool probe_video(const std::string& path, VideoInfo& info)
+{
+    cv::VideoCapture capture(path);
+    if (!capture.isOpened()) return false;
+
+    info.fps = capture.get(cv::CAP_PROP_FPS);
+    info.frame_count = static_cast<int64_t>(capture.get(cv::CAP_PROP_FRAME_COUNT));
+    info.size = cv::Size(static_cast<int>(capture.get(cv::CAP_PROP_FRAME_WIDTH)),
+                         static_cast<int>(capture.get(cv::CAP_PROP_FRAME_HEIGHT)));
+    if (!(info.fps > 0.0)) info.fps = 60.0;
+    if (info.frame_count < 0) info.frame_count = 0;
+    return true;
+}
+
+std::vector<Chunk> make_chunks(const VideoInfo& info, int threads, double chunk_seconds)
+{
+    std::vector<Chunk> chunks;
+    const int64_t unbounded = std::numeric_limits<int64_t>::max();
+
+    // フレーム数が分からない場合は分割できない
+    if (info.frame_count <= 0) {
+        chunks.push_back({0, unbounded});
+        return chunks;
+    }
+
+    int64_t chunk_frames = static_cast<int64_t>(chunk_seconds * info.fps);
+    if (chunk_frames <= 0) {
+        // スレッド数の4倍程度に分けて、終わる時刻のばらつきを抑える（短すぎると重なりの無駄が増える）
+        const int64_t min_frames = static_cast<int64_t>(30.0 * info.fps);
+        chunk_frames = std::max(min_frames, info.frame_count / (static_cast<int64_t>(threads) * 4));
+    }
+
+    for (int64_t begin = 0; begin < info.frame_count; begin += chunk_frames) {
+        chunks.push_back({begin, begin + chunk_frames});
+    }
+    // フレーム数は概算のことがあるため、最後のチャンクは終端まで読む
+    chunks.back().end = unbounded;
+    return chunks;
+}
+
+void process_chunk(const Options& options, const std::vector<Rule>& rules, const Chunk& chunk,
+                   int64_t overlap_frames, std::vector<ImageMatcher>& matchers,
+                   std::vector<Event>& events, WorkerStats& stats)
+{
+    cv::VideoCapture capture(options.video_path);
+    if (!capture.isOpened()) return;
+
+    // 重なりの分だけ手前からデコードする（シーク位置はキーフレームの都合で前後することがある）
+    const int64_t start = std::max<int64_t>(0, chunk.begin - overlap_frames);
+    int64_t frame_index = 0;
+    if (start > 0) {
+        capture.set(cv::CAP_PROP_POS_FRAMES, static_cast<double>(start));
+        const int64_t position = static_cast<int64_t>(capture.get(cv::CAP_PROP_POS_FRAMES));
+        frame_index = position >= 0 && position <= start ? position : start;
+    }
+
+    std::vector<int64_t> last_event(rules.size(), std::numeric_limits<int64_t>::min() / 2);
+    std::vector<bool> due(rules.size());
+    cv::Mat frame;
+
+    while (frame_index < chunk.end) {
+        // 照合するルールがないフレームは色変換を省く（grabのみ）
+        bool any_due = false;
+        for (size_t r = 0; r < rules.size(); ++r) {
+            due[r] = frame_index % rules[r].stride_frames == 0 &&
+                     frame_index - last_event[r] >= rules[r].cooldown_frames;
+            any_due = any_due || due[r];
+        }
+
+        if (!capture.grab()) break;
+        ++stats.decoded;
+
+        if (any_due && capture.retrieve(frame) && !frame.empty()) {
+            ++stats.matched;
+            for (size_t r = 0; r < rules.size(); ++r) {
+                if (!due[r]) continue;
+
+                ImageMatcher::MatchResult result = matchers[r].match(frame, rules[r].threshold);
+                if (!result.found) continue;
+
+                last_event[r] = frame_index;
+                if (frame_index >= chunk.begin) {
+                    events.push_back({frame_index, r, result.confidence, result.bounding_box,
+                                      std::max<size_t>(1, matchers[r].get_match_count())});
+                }
+            }
+        }
+        ++frame_index;
+    }
+    stats.last_frame = std::max(stats.last_frame, frame_index - 1);
+}
+
+// チャンクの境界で重複したイベントをクールダウンで除く
+std::vector<Event> merge_events(std::vector<Event> events, const std::vector<Rule>& rules)
+{
+    std::sort(events.begin(), events.end(), [](const Event& a, const Event& b) {
+        return a.frame != b.frame ? a.frame < b.frame : a.rule < b.rule;
+    });
+
+    std::vector<int64_t> last_event(rules.size(), std::numeric_limits<int64_t>::min() / 2);
+    std::vector<Event> merged;
+    merged.reserve(events.size());
+    for (const auto& event : events) {
+        if (event.frame - last_event[event.rule] < rules[event.rule].cooldown_frames) continue;
+        last_event[event.rule] = event.frame;
+        merged.push_back(event);
+    }
+    return merged;
+}
+
+// ===== 出力 =====
+
+// 編集ソフト向けのタイムコード（ノンドロップ、HH:MM:SS:FF）
+std::string format_timecode(int64_t frame, double fps)
+{
+    const int64_t rounded_fps = std::max<int64_t>(1, static_cast<int64_t>(std::llround(fps)));
+    const int64_t frames = frame % rounded_fps;
+    const int64_t total_seconds = frame / rounded_fps;
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%02lld:%02lld:%02lld:%02lld",
+             static_cast<long long>(total_seconds / 3600), static_cast<long long>(total_seconds / 60 % 60),
+             static_cast<long long>(total_seconds % 60), static_cast<long long>(frames));
+    return buffer;
+}
+
+std::string format_csv(const std::vector<Event>& events, const std::vector<Rule>& rules, double fps)
+{
+    std::ostringstream out;
+    out << "time_sec,timecode,frame,rule,confidence,x,y,width,height,count\n";
+    for (const auto& event : events) {
+        char line[256];
+        snprintf(line, sizeof(line), "%.3f,%s,%lld,", event.frame / fps, format_timecode(event.frame, fps).c_str(),
+                 static_cast<long long>(event.frame));
+        out << line;
+
+        // ルール名はCSVの引用符で囲む
+        std::string name = rules[event.rule].name;
+        std::string quoted = "\"";
+        for (char c : name) {
+            if (c == '"') quoted += '"';
+            quoted += c;
+        }
+        quoted += "\"";
+        out << quoted;
+
+        snprintf(line, sizeof(line), ",%.4f,%d,%d,%d,%d,%zu\n", event.confidence, event.box.x, event.box.y,
+                 event.box.width, event.box.height, event.match_count);
+        out << line;
+    }
+    return out.str();
+}
+
+std::string format_json(const std::vector<Event>& events, const std::vector<Rule>& rules,
+                        const Options& options, double fps)
+{
+    std::ostringstream out;
+    char number[64];
+    snprintf(number, sizeof(number), "%.3f", fps);
+
+    out << "{\n  \"video\": \"" << json_util::escape(options.video_path) << "\",\n";
+    out << "  \"fps\": " << number << ",\n  \"rules\": [";
+    for (size_t r = 0; r < rules.size(); ++r) {
+        out << (r > 0 ? ", " : "") << "\"" << json_util::escape(rules[r].name) << "\"";
+    }
+    out << "],\n  \"events\": [";
+
+    for (size_t i = 0; i < events.size(); ++i) {
+        const Event& event = events[i];
+        snprintf(number, sizeof(number), "%.3f", event.frame / fps);
+        out << (i > 0 ? "," : "") << "\n    {\"time_sec\": " << number
+            << ", \"timecode\": \"" << format_timecode(event.frame, fps) << "\""
+            << ", \"frame\": " << event.frame
+            << ", \"rule\": \"" << json_util::escape(rules[event.rule].name) << "\"";
+        snprintf(number, sizeof(number), "%.4f", event.confidence);
+        out << ", \"confidence\": " << number
+            << ", \"box\": [" << event.box.x << ", " << event.box.y << ", " << event.box.width << ", "
+            << event.box.height << "]"
+            << ", \"count\": " << event.match_count << "}";
+    }
+    out << (events.empty() ? "" : "\n  ") << "]\n}\n";
+    return out.str();
+}
+
+// ===== コマンドライン =====
+
+void print_usage()
+{
+    fprintf(stderr, "usage: vod-analyzer <video> --rules PATH [--output PATH] [--format csv|json] "
+                    "[--threads N] [--chunk-seconds S] [--overlap-seconds S]\n");
+}
+
+bool parse_options(int argc, char** argv, Options& options)
+{
+    if (argc < 2) return false;
+    options.video_path = argv[1];
+
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) return false;
+        const char* value = argv[++i];
+
+        if (arg == "--rules") options.rules_path = value;
+        else if (arg == "--output") options.output_path = value;
+        else if (arg == "--format") options.format = value;
+        else if (arg == "--threads") options.threads = std::atoi(value);
+        else if (arg == "--chunk-seconds") options.chunk_seconds = std::atof(value);
+        else if (arg == "--overlap-seconds") options.overlap_seconds = std::atof(value);
+        else return false;
+    }
+    return !options.rules_path.empty() && options.threads >= 0 &&
+           (options.format == "csv" || options.format == "json");
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    Options options;
+    if (!parse_options(argc, argv, options)) {
+        print_usage();
+        return 1;
+    }
+
+    std::vector<Rule> rules = load_rules(options.rules_path);
+    if (rules.empty()) {
+        fprintf(stderr, "no usable rules in %s\n", options.rules_path.c_str());
+        return 1;
+    }
+
+    VideoInfo info;
+    if (!probe_video(options.video_path, info)) {
+        fprintf(stderr, "failed to open video: %s\n", options.video_path.c_str());
+        return 1;
+    }
+
+    // 並列化はチャンク単位で行い、OpenCV内部のスレッドは使わない
+    const int threads = options.threads > 0 ? options.threads
+                                            : std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    cv::setNumThreads(1);
+
+    int max_cooldown_ms = 0;
+    for (auto& rule : rules) {
+        rule.stride_frames = std::max<int64_t>(1, std::llround(info.fps / std::max(1, rule.detection_rate)));
+        rule.cooldown_frames = static_cast<int64_t>(std::ceil(std::max(0, rule.cooldown_ms) * info.fps / 1000.0));
+        max_cooldown_ms = std::max(max_cooldown_ms, rule.cooldown_ms);
+    }
+    const double overlap_seconds = options.overlap_seconds >= 0.0 ? options.overlap_seconds
+                                                                  : max_cooldown_ms / 1000.0 + 1.0;
+    const int64_t overlap_frames = static_cast<int64_t>(std::ceil(overlap_seconds * info.fps));
+
+    std::vector<Chunk> chunks = make_chunks(info, threads, options.chunk_seconds);
+    fprintf(stderr, "video=%s %dx%d fps=%.3f frames=%lld rules=%zu threads=%d chunks=%zu overlap=%.1fs\n",
+            options.video_path.c_str(), info.size.width, info.size.height, info.fps,
+            static_cast<long long>(info.frame_count), rules.size(), threads, chunks.size(), overlap_seconds);
+
+    std::atomic<size_t> next_chunk{0};
+    std::atomic<size_t> done_chunks{0};
+    std::mutex result_mutex;
+    std::vector<Event> all_events;
+    WorkerStats total;
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (int t = 0; t < std::min<int>(threads, static_cast<int>(chunks.size())); ++t) {
+        workers.emplace_back([&]() {
+            // テンプレートの前処理はスレッドごとに一度だけ行い、チャンク間で使い回す
+            std::vector<ImageMatcher> matchers(rules.size());
+            for (size_t r = 0; r < rules.size(); ++r) {
+                configure_matcher(rules[r], matchers[r]);
+            }
+
+            for (size_t index = next_chunk++; index < chunks.size(); index = next_chunk++) {
+                std::vector<Event> events;
+                WorkerStats stats;
+                process_chunk(options, rules, chunks[index], overlap_frames, matchers, events, stats);
+
+                std::lock_guard<std::mutex> lock(result_mutex);
+                all_events.insert(all_events.end(), events.begin(), events.end());
+                total.decoded += stats.decoded;
+                total.matched += stats.matched;
+                total.last_frame = std::max(total.last_frame, stats.last_frame);
+                fprintf(stderr, "\rchunks %zu/%zu", ++done_chunks, chunks.size());
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    fprintf(stderr, "\n");
+
+    std::vector<Event> events = merge_events(std::move(all_events), rules);
+    const std::string output = options.format == "json" ? format_json(events, rules, options, info.fps)
+                                                        : format_csv(events, rules, info.fps);
+    if (options.output_path.empty()) {
+        fwrite(output.data(), 1, output.size(), stdout);
+    } else {
+        std::ofstream file(options.output_path, std::ios::binary);
+        if (!file) {
+            fprintf(stderr, "failed to write %s\n", options.output_path.c_str());
+            return 1;
+        }
+        file << output;
+    }
+
+    // 処理速度（録画のフレーム数基準）と、重なりによる重複デコードの割合
+    const int64_t video_frames = total.last_frame + 1;
+    const double video_seconds = video_frames / info.fps;
+    fprintf(stderr, "frames=%lld decoded=%lld (+%.1f%% overlap) matched=%lld time=%.1fs "
+                    "speed=%.0f frames/s (%.1fx realtime) events=%zu\n",
+            static_cast<long long>(video_frames), static_cast<long long>(total.decoded),
+            video_frames > 0 ? 100.0 * (total.decoded - video_frames) / video_frames : 0.0,
+            static_cast<long long>(total.matched), elapsed,
+            elapsed > 0.0 ? video_frames / elapsed : 0.0,
+            elapsed > 0.0 ? video_seconds / elapsed : 0.0, events.size());
+    return 0;
+}